@@ -135,9 +135,14 @@ Ptr<OpenGymDataContainer>
 MyGymEnv::GetObservation()
 {
   NS_LOG_FUNCTION (this);
-  uint32_t nodeNum = NodeList::GetNNodes ();
-  std::vector<uint32_t> shape = {nodeNum,};
-  Ptr<OpenGymBoxContainer<uint32_t> > box = CreateObject<OpenGymBoxContainer<uint32_t> >(shape);
+  // the container is created once and refilled on every step
+  if (!m_obs) {
+    uint32_t nodeNum = NodeList::GetNNodes ();
+    std::vector<uint32_t> shape = {nodeNum,};
+    m_obs = CreateObject<OpenGymBoxContainer<uint32_t> >(shape);
+  }
+  Ptr<OpenGymBoxContainer<uint32_t> > box = m_obs;
+  box->Clear();
 
   for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i) {
     Ptr<Node> node = *i;
@@ -61,6 +61,7 @@ private:
   Time m_interval = Seconds(0.1);
   Ptr<Node> m_currentNode;
   uint64_t m_rxPktNum;
+  Ptr<OpenGymBoxContainer<uint32_t> > m_obs;
 
 };
 
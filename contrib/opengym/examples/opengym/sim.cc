@@ -140,6 +140,8 @@ main (int argc, char *argv[])
   double envStepTime = 0.1; //seconds, ns3gym env step time interval
   uint32_t openGymPort = 5555;
   uint32_t testArg = 0;
+  std::string agent = "";
+  std::string agentFile = "";
 
   CommandLine cmd;
   // required parameters for OpenGym interface
@@ -148,6 +150,8 @@ main (int argc, char *argv[])
   // optional parameters
   cmd.AddValue ("simTime", "Simulation time in seconds. Default: 10s", simulationTime);
   cmd.AddValue ("testArg", "Extra simulation argument. Default: 0", testArg);
+  cmd.AddValue ("agent", "In-process agent instead of the Python one: tabular or mlp. Default: none", agent);
+  cmd.AddValue ("agentFile", "Q table (tabular) or weights file (mlp) of the in-process agent", agentFile);
   cmd.Parse (argc, argv);
 
   NS_LOG_UNCOND("Ns3Env parameters:");
@@ -169,6 +173,11 @@ main (int argc, char *argv[])
   openGym->SetGetRewardCb( MakeCallback (&MyGetReward) );
   openGym->SetGetExtraInfoCb( MakeCallback (&MyGetExtraInfo) );
   openGym->SetExecuteActionsCb( MakeCallback (&MyExecuteActions) );
+  if (agent == "tabular") {
+    openGym->SetAgent(CreateObject<OpenGymTabularAgent> ("TableFile", StringValue (agentFile)));
+  } else if (agent == "mlp") {
+    openGym->SetAgent(CreateObject<OpenGymMlpAgent> ("WeightsFile", StringValue (agentFile)));
+  }
   Simulator::Schedule (Seconds(0.0), &ScheduleNextStateRead, envStepTime, openGym);
 
   NS_LOG_UNCOND ("Simulation start");
@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import argparse
+from ns3gym import ns3env
+
+__author__ = "Piotr Gawlowicz"
+__copyright__ = "Copyright (c) 2018, Technische Universität Berlin"
+__version__ = "0.1.0"
+__email__ = "gawlowicz@tkn.tu-berlin.de"
+
+
+parser = argparse.ArgumentParser(description='Run several ns-3 instances as one vectorized env')
+parser.add_argument('--envs',
+                    type=int,
+                    default=4,
+                    help='Number of ns-3 simulation instances, Default: 4')
+args = parser.parse_args()
+numEnvs = int(args.envs)
+
+simTime = 20 # seconds
+stepTime = 0.5  # seconds
+simArgs = {"--simTime": simTime,
+           "--testArg": 123}
+
+env = ns3env.Ns3VecEnv(numEnvs, stepTime=stepTime, simArgs=simArgs)
+
+print("Observation space: ", env.observation_space, env.observation_space.dtype)
+print("Action space: ", env.action_space, env.action_space.dtype)
+
+stepIdx = 0
+
+try:
+    obs = env.reset()
+    while True:
+        stepIdx += 1
+        actions = env.get_random_action()
+        obs, rewards, dones, infos = env.step(actions)
+        print("Step: ", stepIdx)
+        print("---obs, rewards, dones: ", obs, rewards, dones)
+
+        if dones.any():
+            break
+
+except KeyboardInterrupt:
+    print("Ctrl-C -> Exit")
+finally:
+    env.close()
+    print("Done")
@@ -27,6 +27,7 @@
 #include "ns3/tcp-socket-base.h"
 #include <vector>
 #include <numeric>
+#include <sstream>
 
 
 namespace ns3 {
@@ -298,7 +299,12 @@ TcpEventGymEnv::GetObservation()
   uint32_t parameterNum = 15;
   std::vector<uint32_t> shape = {parameterNum,};
 
-  Ptr<OpenGymBoxContainer<uint64_t> > box = CreateObject<OpenGymBoxContainer<uint64_t> >(shape);
+  // the container is created once and refilled on every step
+  if (!m_obs) {
+    m_obs = CreateObject<OpenGymBoxContainer<uint64_t> >(shape);
+  }
+  Ptr<OpenGymBoxContainer<uint64_t> > box = m_obs;
+  box->Clear();
 
   box->AddValue(m_socketUuid);
   box->AddValue(0);
@@ -307,9 +313,12 @@ TcpEventGymEnv::GetObservation()
   box->AddValue(m_tcb->m_ssThresh);
   box->AddValue(m_tcb->m_cWnd);
   box->AddValue(m_tcb->m_segmentSize);
-  box->AddValue(m_segmentsAcked);
+  // with coalescing, segmentsAcked covers all merged triggers and rtt is their mean
+  const FeatureStats &acked = GetFeatureStats(FEATURE_SEGMENTS_ACKED);
+  const FeatureStats &rtt = GetFeatureStats(FEATURE_RTT);
+  box->AddValue(acked.count ? static_cast<uint64_t>(acked.sum) : m_segmentsAcked);
   box->AddValue(m_bytesInFlight);
-  box->AddValue(m_rtt.GetMicroSeconds ());
+  box->AddValue(rtt.count ? static_cast<uint64_t>(rtt.GetMean()) : m_rtt.GetMicroSeconds ());
   box->AddValue(m_tcb->m_minRtt.GetMicroSeconds ());
   box->AddValue(m_calledFunc);
   box->AddValue(m_tcb->m_congState);
@@ -321,6 +330,38 @@ TcpEventGymEnv::GetObservation()
   return box;
 }
 
+/*
+Reward of all coalesced triggers
+*/
+float
+TcpEventGymEnv::GetReward()
+{
+  const FeatureStats &reward = GetFeatureStats(FEATURE_REWARD);
+  if (reward.count) {
+    m_envReward = reward.sum;
+  }
+  return TcpGymEnv::GetReward();
+}
+
+std::string
+TcpEventGymEnv::GetExtraInfo()
+{
+  uint32_t events = GetCoalescedEvents();
+  if (events <= 1) {
+    return TcpGymEnv::GetExtraInfo();
+  }
+
+  // summary of the merged triggers, e.g. IncreaseWindow|events=12|rtt=100,180,132.5
+  const FeatureStats &rtt = GetFeatureStats(FEATURE_RTT);
+  std::ostringstream info;
+  info << m_info << "|events=" << events;
+  if (rtt.count) {
+    info << "|rtt=" << rtt.min << "," << rtt.max << "," << rtt.GetMean();
+  }
+  NS_LOG_INFO("MyGetExtraInfo: " << info.str());
+  return info.str();
+}
+
 void
 TcpEventGymEnv::TxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpSocketBase>)
 {
@@ -345,7 +386,9 @@ TcpEventGymEnv::GetSsThresh (Ptr<const TcpSocketState> tcb, uint32_t bytesInFlig
   m_info = "GetSsThresh";
   m_tcb = tcb;
   m_bytesInFlight = bytesInFlight;
-  Notify();
+  AccumulateFeature(FEATURE_REWARD, m_envReward);
+  // losses are rare and important, never coalesce them
+  NotifyNow();
   return m_new_ssThresh;
 }
 
@@ -361,6 +404,9 @@ TcpEventGymEnv::IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
   m_info = "IncreaseWindow";
   m_tcb = tcb;
   m_segmentsAcked = segmentsAcked;
+  AccumulateFeature(FEATURE_REWARD, m_envReward);
+  AccumulateFeature(FEATURE_SEGMENTS_ACKED, segmentsAcked);
+  // between steps the window stays at the last action of the agent
   Notify();
   tcb->m_cWnd = m_new_cWnd;
 }
@@ -375,6 +421,7 @@ TcpEventGymEnv::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked, cons
   m_tcb = tcb;
   m_segmentsAcked = segmentsAcked;
   m_rtt = rtt;
+  AccumulateFeature(FEATURE_RTT, rtt.GetMicroSeconds ());
 }
 
 void
@@ -492,7 +539,12 @@ TcpTimeStepGymEnv::GetObservation()
   uint32_t parameterNum = 16;
   std::vector<uint32_t> shape = {parameterNum,};
 
-  Ptr<OpenGymBoxContainer<uint64_t> > box = CreateObject<OpenGymBoxContainer<uint64_t> >(shape);
+  // the container is created once and refilled on every step
+  if (!m_obs) {
+    m_obs = CreateObject<OpenGymBoxContainer<uint64_t> >(shape);
+  }
+  Ptr<OpenGymBoxContainer<uint64_t> > box = m_obs;
+  box->Clear();
 
   box->AddValue(m_socketUuid);
   box->AddValue(1);
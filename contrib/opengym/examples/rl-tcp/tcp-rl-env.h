@@ -94,6 +94,9 @@ protected:
   // extra info
   std::string m_info;
 
+  // observation container, reused between steps
+  Ptr<OpenGymBoxContainer<uint64_t> > m_obs;
+
   // actions
   uint32_t m_new_ssThresh;
   uint32_t m_new_cWnd;
@@ -114,6 +117,8 @@ public:
   // OpenGym interface
   virtual Ptr<OpenGymSpace> GetObservationSpace();
   Ptr<OpenGymDataContainer> GetObservation();
+  virtual float GetReward();
+  virtual std::string GetExtraInfo();
 
   // trace packets, e.g. for calculating inter tx/rx time
   virtual void TxPktTrace(Ptr<const Packet>, const TcpHeader&, Ptr<const TcpSocketBase>);
@@ -128,6 +133,14 @@ public:
   virtual void CwndEvent (Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCAEvent_t event);
 
 private:
+  // features accumulated over the coalesced triggers of a step
+  enum
+  {
+    FEATURE_REWARD = 0,
+    FEATURE_SEGMENTS_ACKED,
+    FEATURE_RTT,
+  };
+
   // state
   CalledFunc_t m_calledFunc;
   Ptr<const TcpSocketState> m_tcb;
@@ -19,6 +19,8 @@
  *
  */
 
+#include <cstring>
+#include <cstdint>
 #include "ns3/log.h"
 #include "container.h"
 
@@ -61,8 +63,86 @@ OpenGymDataContainer::DoInitialize (void)
   //NS_LOG_FUNCTION (this);
 }
 
+void
+OpenGymCopyLittleEndian(void *dst, const void *src, uint64_t count, uint32_t size)
+{
+  const uint16_t probe = 1;
+  if (*reinterpret_cast<const uint8_t*>(&probe) == 1) {
+    std::memcpy(dst, src, count * size);
+    return;
+  }
+
+  const uint8_t *in = static_cast<const uint8_t*>(src);
+  uint8_t *out = static_cast<uint8_t*>(dst);
+  for (uint64_t i = 0; i < count; i++) {
+    for (uint32_t b = 0; b < size; b++) {
+      out[i * size + b] = in[i * size + size - 1 - b];
+    }
+  }
+}
+
+void
+OpenGymPackAny(google::protobuf::Any *any, const google::protobuf::Message &msg)
+{
+  static const char prefix[] = "type.googleapis.com/";
+  const size_t prefixLen = sizeof(prefix) - 1;
+  const std::string &name = msg.GetDescriptor()->full_name();
+
+  std::string *typeUrl = any->mutable_type_url();
+  if (typeUrl->size() != prefixLen + name.size() || typeUrl->compare(prefixLen, std::string::npos, name) != 0) {
+    typeUrl->assign(prefix, prefixLen);
+    typeUrl->append(name);
+  }
+  msg.SerializeToString(any->mutable_value());
+}
+
+ns3opengym::DataContainer
+OpenGymDataContainer::GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm)
+{
+  return GetDataContainerPbMsg();
+}
+
+void
+OpenGymDataContainer::FillDataContainerPbMsg(ns3opengym::DataContainer &msg, Ptr<OpenGymShmRegion> shm)
+{
+  msg = GetSharedDataContainerPbMsg(shm);
+}
+
+template <typename T, typename R>
+static Ptr<OpenGymDataContainer>
+CreateBoxContainer(const ns3opengym::BoxDataContainer &boxContainerPbMsg, const R &repeated, Ptr<OpenGymShmRegion> shm)
+{
+  std::vector<uint32_t> shape;
+  shape.assign(boxContainerPbMsg.shape().begin(), boxContainerPbMsg.shape().end());
+  Ptr<OpenGymBoxContainer<T> > box = CreateObject<OpenGymBoxContainer<T> >(shape);
+  std::vector<T> myData;
+
+  if (!boxContainerPbMsg.rawdata().empty()) {
+    const std::string &raw = boxContainerPbMsg.rawdata();
+    myData.resize(raw.size() / sizeof(T));
+    OpenGymCopyLittleEndian(myData.data(), raw.data(), myData.size(), sizeof(T));
+  } else if (boxContainerPbMsg.shmdata()) {
+    uint64_t count = boxContainerPbMsg.shmcount();
+    const uint8_t *buffer = 0;
+    if (shm && count <= UINT64_MAX / sizeof(T)) {
+      buffer = shm->GetPointer(boxContainerPbMsg.shmoffset(), count * sizeof(T));
+    }
+    if (buffer) {
+      myData.resize(count);
+      std::memcpy(myData.data(), buffer, count * sizeof(T));
+    } else {
+      NS_LOG_WARN("Box data points outside of the shared memory region, ignored");
+    }
+  } else {
+    myData.assign(repeated.begin(), repeated.end());
+  }
+
+  box->SetData(myData);
+  return box;
+}
+
 Ptr<OpenGymDataContainer>
-OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3opengym::DataContainer &dataContainerPbMsg)
+OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3opengym::DataContainer &dataContainerPbMsg, Ptr<OpenGymShmRegion> shm)
 {
   Ptr<OpenGymDataContainer> actDataContainer;
 
@@ -81,39 +161,19 @@ OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3opengym::DataContainer &da
     dataContainerPbMsg.data().UnpackTo(&boxContainerPbMsg);
 
     if (boxContainerPbMsg.dtype() == ns3opengym::INT) {
-      Ptr<OpenGymBoxContainer<int32_t> > box = CreateObject<OpenGymBoxContainer<int32_t> >();
-      std::vector<int32_t> myData;
-      myData.assign(boxContainerPbMsg.intdata().begin(), boxContainerPbMsg.intdata().end());
-      box->SetData(myData);
-      actDataContainer = box;
+      actDataContainer = CreateBoxContainer<int32_t>(boxContainerPbMsg, boxContainerPbMsg.intdata(), shm);
 
     } else if (boxContainerPbMsg.dtype() == ns3opengym::UINT) {
-      Ptr<OpenGymBoxContainer<uint32_t> > box = CreateObject<OpenGymBoxContainer<uint32_t> >();
-      std::vector<uint32_t> myData;
-      myData.assign(boxContainerPbMsg.uintdata().begin(), boxContainerPbMsg.uintdata().end());
-      box->SetData(myData);
-      actDataContainer = box;
+      actDataContainer = CreateBoxContainer<uint32_t>(boxContainerPbMsg, boxContainerPbMsg.uintdata(), shm);
 
     } else if (boxContainerPbMsg.dtype() == ns3opengym::FLOAT) {
-      Ptr<OpenGymBoxContainer<float> > box = CreateObject<OpenGymBoxContainer<float> >();
-      std::vector<float> myData;
-      myData.assign(boxContainerPbMsg.floatdata().begin(), boxContainerPbMsg.floatdata().end());
-      box->SetData(myData);
-      actDataContainer = box;
+      actDataContainer = CreateBoxContainer<float>(boxContainerPbMsg, boxContainerPbMsg.floatdata(), shm);
 
     } else if (boxContainerPbMsg.dtype() == ns3opengym::DOUBLE) {
-      Ptr<OpenGymBoxContainer<double> > box = CreateObject<OpenGymBoxContainer<double> >();
-      std::vector<double> myData;
-      myData.assign(boxContainerPbMsg.doubledata().begin(), boxContainerPbMsg.doubledata().end());
-      box->SetData(myData);
-      actDataContainer = box;
+      actDataContainer = CreateBoxContainer<double>(boxContainerPbMsg, boxContainerPbMsg.doubledata(), shm);
 
     } else {
-      Ptr<OpenGymBoxContainer<float> > box = CreateObject<OpenGymBoxContainer<float> >();
-      std::vector<float> myData;
-      myData.assign(boxContainerPbMsg.floatdata().begin(), boxContainerPbMsg.floatdata().end());
-      box->SetData(myData);
-      actDataContainer = box;
+      actDataContainer = CreateBoxContainer<float>(boxContainerPbMsg, boxContainerPbMsg.floatdata(), shm);
     }
   }
   else if (dataContainerPbMsg.type() == ns3opengym::Tuple)
@@ -129,7 +189,7 @@ OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3opengym::DataContainer &da
     std::vector< ns3opengym::DataContainer >::iterator it;
     for(it=elements.begin();it!=elements.end();++it)
     {
-      Ptr<OpenGymDataContainer> subData = OpenGymDataContainer::CreateFromDataContainerPbMsg(*it);
+      Ptr<OpenGymDataContainer> subData = OpenGymDataContainer::CreateFromDataContainerPbMsg(*it, shm);
       tupleData->Add(subData);
     }
 
@@ -148,7 +208,7 @@ OpenGymDataContainer::CreateFromDataContainerPbMsg(ns3opengym::DataContainer &da
     std::vector< ns3opengym::DataContainer >::iterator it;
     for(it=elements.begin();it!=elements.end();++it)
     {
-      Ptr<OpenGymDataContainer> subSpace = OpenGymDataContainer::CreateFromDataContainerPbMsg(*it);
+      Ptr<OpenGymDataContainer> subSpace = OpenGymDataContainer::CreateFromDataContainerPbMsg(*it, shm);
       dictData->Add((*it).name(), subSpace);
     }
 
@@ -202,12 +262,18 @@ ns3opengym::DataContainer
 OpenGymDiscreteContainer::GetDataContainerPbMsg()
 {
   ns3opengym::DataContainer dataContainerPbMsg;
+  FillDataContainerPbMsg(dataContainerPbMsg, 0);
+  return dataContainerPbMsg;
+}
+
+void
+OpenGymDiscreteContainer::FillDataContainerPbMsg(ns3opengym::DataContainer &dataContainerPbMsg, Ptr<OpenGymShmRegion> shm)
+{
   ns3opengym::DiscreteDataContainer discreteContainerPbMsg;
   discreteContainerPbMsg.set_data(GetValue());
 
   dataContainerPbMsg.set_type(ns3opengym::Discrete);
-  dataContainerPbMsg.mutable_data()->PackFrom(discreteContainerPbMsg);
-  return dataContainerPbMsg;
+  OpenGymPackAny(dataContainerPbMsg.mutable_data(), discreteContainerPbMsg);
 }
 
 bool
@@ -264,6 +330,12 @@ OpenGymTupleContainer::DoInitialize (void)
 
 ns3opengym::DataContainer
 OpenGymTupleContainer::GetDataContainerPbMsg()
+{
+  return GetSharedDataContainerPbMsg(0);
+}
+
+ns3opengym::DataContainer
+OpenGymTupleContainer::GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm)
 {
   ns3opengym::DataContainer dataContainerPbMsg;
   dataContainerPbMsg.set_type(ns3opengym::Tuple);
@@ -274,7 +346,7 @@ OpenGymTupleContainer::GetDataContainerPbMsg()
   for (it=m_tuple.begin(); it!=m_tuple.end(); ++it)
   {
     Ptr<OpenGymDataContainer> subSpace = *it;
-    ns3opengym::DataContainer subDataContainer = subSpace->GetDataContainerPbMsg();
+    ns3opengym::DataContainer subDataContainer = subSpace->GetSharedDataContainerPbMsg(shm);
 
     tupleContainerPbMsg.add_element()->CopyFrom(subDataContainer);
   }
@@ -360,6 +432,12 @@ OpenGymDictContainer::DoInitialize (void)
 
 ns3opengym::DataContainer
 OpenGymDictContainer::GetDataContainerPbMsg()
+{
+  return GetSharedDataContainerPbMsg(0);
+}
+
+ns3opengym::DataContainer
+OpenGymDictContainer::GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm)
 {
   ns3opengym::DataContainer dataContainerPbMsg;
   dataContainerPbMsg.set_type(ns3opengym::Dict);
@@ -372,7 +450,7 @@ OpenGymDictContainer::GetDataContainerPbMsg()
     std::string name = it->first;
     Ptr<OpenGymDataContainer> subSpace = it->second;
 
-    ns3opengym::DataContainer subDataContainer = subSpace->GetDataContainerPbMsg();
+    ns3opengym::DataContainer subDataContainer = subSpace->GetSharedDataContainerPbMsg(shm);
     subDataContainer.set_name(name);
 
     dictContainerPbMsg.add_element()->CopyFrom(subDataContainer);
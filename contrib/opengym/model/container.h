@@ -25,9 +25,23 @@
 #include "ns3/object.h"
 #include "ns3/type-name.h"
 #include "messages.pb.h"
+#include "opengym_shm.h"
+#include <cstring>
 
 namespace ns3 {
 
+/**
+ * Copy count elements of the given size, converting between host byte
+ * order and the little-endian layout used by rawData in both directions.
+ */
+void OpenGymCopyLittleEndian(void *dst, const void *src, uint64_t count, uint32_t size);
+
+/**
+ * Same as Any::PackFrom, but keeps the type url and value buffers of the
+ * given Any, so repacking into the same Any does not allocate.
+ */
+void OpenGymPackAny(google::protobuf::Any *any, const google::protobuf::Message &msg);
+
 class OpenGymDataContainer : public Object
 {
 public:
@@ -37,7 +51,11 @@ public:
   static TypeId GetTypeId ();
 
   virtual ns3opengym::DataContainer GetDataContainerPbMsg() = 0;
-  static Ptr<OpenGymDataContainer> CreateFromDataContainerPbMsg(ns3opengym::DataContainer &dataContainer);
+  // like GetDataContainerPbMsg, but may place the data in the shared memory region
+  virtual ns3opengym::DataContainer GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm);
+  // like GetSharedDataContainerPbMsg, but fills msg in place reusing its buffers
+  virtual void FillDataContainerPbMsg(ns3opengym::DataContainer &msg, Ptr<OpenGymShmRegion> shm);
+  static Ptr<OpenGymDataContainer> CreateFromDataContainerPbMsg(ns3opengym::DataContainer &dataContainer, Ptr<OpenGymShmRegion> shm = 0);
 
   virtual void Print(std::ostream& where) const = 0;
   friend std::ostream& operator<< (std::ostream& os, const Ptr<OpenGymDataContainer> container)
@@ -63,6 +81,7 @@ public:
   static TypeId GetTypeId ();
 
   virtual ns3opengym::DataContainer GetDataContainerPbMsg();
+  virtual void FillDataContainerPbMsg(ns3opengym::DataContainer &msg, Ptr<OpenGymShmRegion> shm);
 
   virtual void Print(std::ostream& where) const;
   friend std::ostream& operator<< (std::ostream& os, const Ptr<OpenGymDiscreteContainer> container)
@@ -94,6 +113,8 @@ public:
   static TypeId GetTypeId ();
 
   virtual ns3opengym::DataContainer GetDataContainerPbMsg();
+  virtual ns3opengym::DataContainer GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm);
+  virtual void FillDataContainerPbMsg(ns3opengym::DataContainer &msg, Ptr<OpenGymShmRegion> shm);
 
   virtual void Print(std::ostream& where) const;
   friend std::ostream& operator<< (std::ostream& os, const Ptr<OpenGymBoxContainer> container)
@@ -104,11 +125,15 @@ public:
 
   bool AddValue(T value);
   T GetValue(uint32_t idx);
+  // overwrite an existing element in place
+  bool SetValue(uint32_t idx, T value);
+  // drop all values but keep the storage, to refill the container every step
+  void Clear();
 
   bool SetData(std::vector<T> data);
-  std::vector<T> GetData();
+  const std::vector<T>& GetData() const;
 
-  std::vector<uint32_t> GetShape();
+  const std::vector<uint32_t>& GetShape() const;
 
 protected:
   // Inherited
@@ -119,7 +144,11 @@ private:
   void SetDtype();
 	std::vector<uint32_t> m_shape;
 	ns3opengym::Dtype m_dtype;
+  // true if T has the memory layout of m_dtype on the Python side
+  bool m_nativeLayout;
 	std::vector<T> m_data;
+  // reused by FillDataContainerPbMsg, so that repeated steps do not allocate
+  ns3opengym::BoxDataContainer m_pbMsg;
 };
 
 template <typename T>
@@ -146,6 +175,12 @@ OpenGymBoxContainer<T>::OpenGymBoxContainer(std::vector<uint32_t> shape):
 	m_shape(shape)
 {
   SetDtype();
+  uint64_t size = 1;
+  for (auto dim : m_shape)
+  {
+    size *= dim;
+  }
+  m_data.reserve(size);
 }
 
 template <typename T>
@@ -158,6 +193,7 @@ void
 OpenGymBoxContainer<T>::SetDtype ()
 {
   std::string name = TypeNameGet<T> ();
+  m_nativeLayout = (name == "int32_t" || name == "uint32_t" || name == "float" || name == "double");
   if (name == "int8_t" || name == "int16_t" || name == "int32_t" || name == "int64_t") 
     m_dtype = ns3opengym::INT;
   else if (name == "uint8_t" || name == "uint16_t" || name == "uint32_t" || name == "uint64_t") 
@@ -187,34 +223,69 @@ ns3opengym::DataContainer
 OpenGymBoxContainer<T>::GetDataContainerPbMsg()
 {
   ns3opengym::DataContainer dataContainerPbMsg;
-  ns3opengym::BoxDataContainer boxContainerPbMsg;
+  FillDataContainerPbMsg(dataContainerPbMsg, 0);
+  return dataContainerPbMsg;
+}
 
-  std::vector<uint32_t> shape = GetShape();
-  *boxContainerPbMsg.mutable_shape() = {shape.begin(), shape.end()};
+template <typename T>
+ns3opengym::DataContainer
+OpenGymBoxContainer<T>::GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm)
+{
+  ns3opengym::DataContainer dataContainerPbMsg;
+  FillDataContainerPbMsg(dataContainerPbMsg, shm);
+  return dataContainerPbMsg;
+}
 
+template <typename T>
+void
+OpenGymBoxContainer<T>::FillDataContainerPbMsg(ns3opengym::DataContainer &dataContainerPbMsg, Ptr<OpenGymShmRegion> shm)
+{
+  ns3opengym::BoxDataContainer &boxContainerPbMsg = m_pbMsg;
+  boxContainerPbMsg.Clear();
 
+  for (auto dim : m_shape)
+  {
+    boxContainerPbMsg.add_shape(dim);
+  }
   boxContainerPbMsg.set_dtype(m_dtype);
-  std::vector<T> data = GetData();
 
-  if (m_dtype == ns3opengym::INT) {
-    *boxContainerPbMsg.mutable_intdata() = {data.begin(), data.end()};
+  uint64_t length = m_data.size() * sizeof(T);
+  uint64_t offset = 0;
+  uint8_t *buffer = 0;
+  if (shm && m_nativeLayout && length > 0) {
+    buffer = shm->AllocateObservation(length, offset);
+  }
+
+  if (buffer) {
+    std::memcpy(buffer, m_data.data(), length);
+    boxContainerPbMsg.set_shmdata(true);
+    boxContainerPbMsg.set_shmoffset(offset);
+    boxContainerPbMsg.set_shmcount(m_data.size());
+
+  } else if (m_nativeLayout) {
+    // single copy of the whole array instead of one append per element
+    std::string *raw = boxContainerPbMsg.mutable_rawdata();
+    raw->resize(length);
+    OpenGymCopyLittleEndian(&(*raw)[0], m_data.data(), m_data.size(), sizeof(T));
+
+  } else if (m_dtype == ns3opengym::INT) {
+    boxContainerPbMsg.mutable_intdata()->Add(m_data.begin(), m_data.end());
 
   } else if (m_dtype == ns3opengym::UINT) {
-    *boxContainerPbMsg.mutable_uintdata() = {data.begin(), data.end()};
+    boxContainerPbMsg.mutable_uintdata()->Add(m_data.begin(), m_data.end());
 
   } else if (m_dtype == ns3opengym::FLOAT) {
-    *boxContainerPbMsg.mutable_floatdata() = {data.begin(), data.end()};
+    boxContainerPbMsg.mutable_floatdata()->Add(m_data.begin(), m_data.end());
 
   } else if (m_dtype == ns3opengym::DOUBLE) {
-    *boxContainerPbMsg.mutable_doubledata() = {data.begin(), data.end()};
+    boxContainerPbMsg.mutable_doubledata()->Add(m_data.begin(), m_data.end());
 
   } else {
-    *boxContainerPbMsg.mutable_floatdata() = {data.begin(), data.end()};
+    boxContainerPbMsg.mutable_floatdata()->Add(m_data.begin(), m_data.end());
   }
 
   dataContainerPbMsg.set_type(ns3opengym::Box);
-  dataContainerPbMsg.mutable_data()->PackFrom(boxContainerPbMsg);
-  return dataContainerPbMsg;
+  OpenGymPackAny(dataContainerPbMsg.mutable_data(), boxContainerPbMsg);
 }
 
 template <typename T>
@@ -237,6 +308,25 @@ OpenGymBoxContainer<T>::GetValue(uint32_t idx)
   return data;
 }
 
+template <typename T>
+bool
+OpenGymBoxContainer<T>::SetValue(uint32_t idx, T value)
+{
+  if (idx >= m_data.size())
+  {
+    return false;
+  }
+  m_data[idx] = value;
+  return true;
+}
+
+template <typename T>
+void
+OpenGymBoxContainer<T>::Clear()
+{
+  m_data.clear();
+}
+
 template <typename T>
 bool
 OpenGymBoxContainer<T>::SetData(std::vector<T> data)
@@ -246,15 +336,15 @@ OpenGymBoxContainer<T>::SetData(std::vector<T> data)
 }
 
 template <typename T>
-std::vector<uint32_t>
-OpenGymBoxContainer<T>::GetShape()
+const std::vector<uint32_t>&
+OpenGymBoxContainer<T>::GetShape() const
 {
   return m_shape;
 }
 
 template <typename T>
-std::vector<T>
-OpenGymBoxContainer<T>::GetData()
+const std::vector<T>&
+OpenGymBoxContainer<T>::GetData() const
 {
   return m_data;
 }
@@ -285,6 +375,7 @@ public:
   static TypeId GetTypeId ();
 
   virtual ns3opengym::DataContainer GetDataContainerPbMsg();
+  virtual ns3opengym::DataContainer GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm);
 
   virtual void Print(std::ostream& where) const;
   friend std::ostream& operator<< (std::ostream& os, const Ptr<OpenGymTupleContainer> container)
@@ -314,6 +405,7 @@ public:
   static TypeId GetTypeId ();
 
   virtual ns3opengym::DataContainer GetDataContainerPbMsg();
+  virtual ns3opengym::DataContainer GetSharedDataContainerPbMsg(Ptr<OpenGymShmRegion> shm);
 
   virtual void Print(std::ostream& where) const;
   friend std::ostream& operator<< ( std::ostream& os, const Ptr<OpenGymDictContainer> container)
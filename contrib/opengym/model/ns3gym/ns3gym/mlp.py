@@ -0,0 +1,36 @@
+import numpy as np
+
+__author__ = "Piotr Gawlowicz"
+__copyright__ = "Copyright (c) 2018, Technische Universität Berlin"
+__version__ = "0.1.0"
+__email__ = "gawlowicz.p@gmail.com"
+
+
+ACTIVATIONS = ('linear', 'relu', 'tanh', 'sigmoid')
+
+
+def save_mlp(path, layers):
+    """Write a fully connected network in the text format of OpenGymMlpAgent.
+
+    layers is a list of (weights, biases, activation) tuples, weights with
+    the shape (out, in), i.e. y = activation(weights @ x + biases). For a
+    Keras Dense layer pass (kernel.T, bias, activation).
+    """
+    with open(path, 'w') as f:
+        f.write("# ns3gym MLP, %d layers\n" % len(layers))
+        prevOut = None
+        for weights, biases, activation in layers:
+            weights = np.asarray(weights, dtype=np.float64)
+            biases = np.asarray(biases, dtype=np.float64).reshape(-1)
+            if activation not in ACTIVATIONS:
+                raise ValueError("Unsupported activation: %s" % activation)
+            if weights.ndim != 2 or weights.shape[0] != biases.shape[0]:
+                raise ValueError("Weights must have the shape (out, in) matching the biases")
+            if prevOut is not None and weights.shape[1] != prevOut:
+                raise ValueError("Layer input size does not match previous output size")
+            prevOut = weights.shape[0]
+
+            f.write("layer %d %d %s\n" % (weights.shape[1], weights.shape[0], activation))
+            for row in weights:
+                f.write(" ".join(repr(float(v)) for v in row) + "\n")
+            f.write(" ".join(repr(float(v)) for v in biases) + "\n")
@@ -2,6 +2,8 @@ import os
 import sys
 import zmq
 import time
+import signal
+import mmap
 
 import numpy as np
 
@@ -11,6 +13,7 @@ from gym.utils import seeding
 from enum import IntEnum
 
 from ns3gym.start_sim import start_sim_script, build_ns3_project
+from ns3gym.stats import StepStats
 
 import ns3gym.messages_pb2 as pb
 from google.protobuf.any_pb2 import Any
@@ -34,6 +37,8 @@ class Ns3ZmqBridge(object):
         self.envStopped = False
         self.simPid = None
         self.wafPid = None
+        self.forkServerPid = None
+        self.episode = 0
         self.ns3Process = None
 
         context = zmq.Context()
@@ -78,24 +83,88 @@ class Ns3ZmqBridge(object):
         self.gameOverReason = None
         self.extraInfo = None
         self.newStateRx = False
+        # a request of ns-3 waits for its reply on the REP socket
+        self.replyPending = False
+
+        self.shm = None
+        self.shmActOffset = 0
+        self.shmActPos = 0
+        self.agentIds = []
+        self.coalescingPolicy = None
+        self.stats = StepStats()
+
+    def _open_shm(self, name, size, actOffset):
+        # map the region announced by ns-3 and drop its name right away,
+        # the mapping stays valid in both processes until they exit
+        path = "/dev/shm/" + name.lstrip("/")
+        with open(path, "r+b") as f:
+            self.shm = mmap.mmap(f.fileno(), size)
+        try:
+            os.unlink(path)
+        except OSError:
+            pass
+        self.shmActOffset = actOffset
+
+    def _np_dtype(self, dtype):
+        # little-endian, as used by rawData; same as native on supported hosts
+        if dtype == pb.INT:
+            return np.dtype('<i4')
+        elif dtype == pb.UINT:
+            return np.dtype('<u4')
+        elif dtype == pb.DOUBLE:
+            return np.dtype('<f8')
+        return np.dtype('<f4')
 
     def close(self):
         try:
             if not self.envStopped:
                 self.envStopped = True
                 self.force_env_stop()
-                self.rx_env_state()
-                self.send_close_command()
+                if self.is_multi_agent():
+                    self.rx_multi_env_state()
+                    if self.replyPending:
+                        self.send_multi_close_command()
+                else:
+                    self.rx_env_state()
+                    if self.replyPending:
+                        self.send_close_command()
                 self.ns3Process.kill()
                 if self.simPid:
                     os.kill(self.simPid, signal.SIGTERM)
                     self.simPid = None
+                if self.forkServerPid:
+                    os.kill(self.forkServerPid, signal.SIGTERM)
+                    self.forkServerPid = None
                 if self.wafPid:
                     os.kill(self.wafPid, signal.SIGTERM)
                     self.wafPid = None
         except Exception as e:
             pass
 
+    def is_fork_server(self):
+        return self.forkServerPid is not None
+
+    def next_episode(self, stepInterval):
+        # stop the current episode process, the fork server then starts the
+        # next one from the warm-up snapshot and it connects to the same socket
+        if not self.envStopped:
+            self.force_env_stop()
+            self.rx_env_state()
+            # a game over already got the stop reply in rx_env_state
+            if self.replyPending:
+                self.send_close_command()
+
+        # do not close the mapping, the agent may still hold views of the
+        # last observation into it; it is unmapped once they are released
+        self.shm = None
+
+        self.envStopped = False
+        self.forceEnvStop = False
+        self.gameOver = False
+        self.gameOverReason = None
+        self.newStateRx = False
+        return self.initialize_env(stepInterval)
+
     def _create_space(self, spaceDesc):
         space = None
         if (spaceDesc.type == pb.Discrete):
@@ -154,9 +223,26 @@ class Ns3ZmqBridge(object):
 
         self.simPid = int(simInitMsg.simProcessId)
         self.wafPid = int(simInitMsg.wafShellProcessId)
+        if simInitMsg.forkServerProcessId:
+            # episode processes are children of the fork server, not of waf
+            self.forkServerPid = int(simInitMsg.forkServerProcessId)
+            self.wafPid = None
+            self.episode = int(simInitMsg.episode)
         self._action_space = self._create_space(simInitMsg.actSpace)
         self._observation_space = self._create_space(simInitMsg.obsSpace)
 
+        # multi-agent mode, spaces per agent id
+        self.agentIds = []
+        self.agentActionSpaces = {}
+        self.agentObservationSpaces = {}
+        for agent in simInitMsg.agents:
+            self.agentIds.append(agent.agentId)
+            self.agentActionSpaces[agent.agentId] = self._create_space(agent.actSpace)
+            self.agentObservationSpaces[agent.agentId] = self._create_space(agent.obsSpace)
+
+        if simInitMsg.shmName:
+            self._open_shm(simInitMsg.shmName, simInitMsg.shmSize, simInitMsg.shmActOffset)
+
         reply = pb.SimInitAck()
         reply.done = True
         reply.stopSimReq = False
@@ -177,11 +263,16 @@ class Ns3ZmqBridge(object):
         if self.newStateRx:
             return
 
+        start = time.perf_counter()
         request = self.socket.recv()
+        self.replyPending = True
+        start = self.stats.add('wait', start)
         envStateMsg = pb.EnvStateMsg()
         envStateMsg.ParseFromString(request)
 
         self.obsData = self._create_data(envStateMsg.obsData)
+        self.stats.add('deserialize', start)
+        self.stats.finish_step()
         self.reward = envStateMsg.reward
         self.gameOver = envStateMsg.isGameOver
         self.gameOverReason = envStateMsg.reason
@@ -206,11 +297,23 @@ class Ns3ZmqBridge(object):
 
         replyMsg = reply.SerializeToString()
         self.socket.send(replyMsg)
+        self.replyPending = False
         self.newStateRx = False
         return True
 
+    def set_coalescing(self, stepEveryEvents=1, minStepInterval=0.0):
+        # sent along with the next actions
+        self.coalescingPolicy = (int(stepEveryEvents), float(minStepInterval))
+
     def send_actions(self, actions):
+        start = time.perf_counter()
         reply = pb.EnvActMsg()
+        self.shmActPos = self.shmActOffset
+
+        if self.coalescingPolicy is not None:
+            reply.policy.stepEveryEvents = self.coalescingPolicy[0]
+            reply.policy.minStepInterval = self.coalescingPolicy[1]
+            self.coalescingPolicy = None
 
         actionMsg = self._pack_data(actions, self._action_space)
         reply.actData.CopyFrom(actionMsg)
@@ -220,7 +323,10 @@ class Ns3ZmqBridge(object):
             reply.stopSimReq = True
 
         replyMsg = reply.SerializeToString()
+        start = self.stats.add('serialize', start)
         self.socket.send(replyMsg)
+        self.replyPending = False
+        self.stats.add('send', start)
         self.newStateRx = False
         return True
 
@@ -233,6 +339,72 @@ class Ns3ZmqBridge(object):
     def is_game_over(self):
         return self.gameOver
 
+    def is_multi_agent(self):
+        return len(self.agentIds) > 0
+
+    def rx_multi_env_state(self):
+        # states of the agents triggered at the same simulated time
+        if self.newStateRx:
+            return
+
+        start = time.perf_counter()
+        request = self.socket.recv()
+        self.replyPending = True
+        start = self.stats.add('wait', start)
+        stateMsg = pb.MultiEnvStateMsg()
+        stateMsg.ParseFromString(request)
+
+        self.agentObs = {}
+        self.agentRewards = {}
+        self.agentDones = {}
+        self.agentInfos = {}
+        for agent in stateMsg.agents:
+            self.agentObs[agent.agentId] = self._create_data(agent.obsData)
+            self.agentRewards[agent.agentId] = agent.reward
+            self.agentDones[agent.agentId] = agent.isGameOver
+            self.agentInfos[agent.agentId] = agent.info
+        self.stats.add('deserialize', start)
+        self.stats.finish_step()
+
+        self.gameOver = stateMsg.isGameOver
+        self.gameOverReason = stateMsg.reason
+        if self.gameOver:
+            self.envStopped = True
+            self.send_multi_close_command()
+
+        self.newStateRx = True
+
+    def send_multi_close_command(self):
+        reply = pb.MultiEnvActMsg()
+        reply.stopSimReq = True
+        self.socket.send(reply.SerializeToString())
+        self.replyPending = False
+        self.newStateRx = False
+        return True
+
+    def send_multi_actions(self, actions):
+        start = time.perf_counter()
+        reply = pb.MultiEnvActMsg()
+        self.shmActPos = self.shmActOffset
+
+        for agentId, action in actions.items():
+            agentAction = reply.actions.add()
+            agentAction.agentId = agentId
+            agentAction.actData.CopyFrom(self._pack_data(action, self.agentActionSpaces[agentId]))
+
+        reply.stopSimReq = self.forceEnvStop
+        replyMsg = reply.SerializeToString()
+        start = self.stats.add('serialize', start)
+        self.socket.send(replyMsg)
+        self.replyPending = False
+        self.stats.add('send', start)
+        self.newStateRx = False
+        return True
+
+    def multi_step(self, actions):
+        self.send_multi_actions(actions)
+        self.rx_multi_env_state()
+
     def _create_data(self, dataContainerPb):
         if (dataContainerPb.type == pb.Discrete):
             discreteContainerPb = pb.DiscreteDataContainer()
@@ -245,6 +417,23 @@ class Ns3ZmqBridge(object):
             dataContainerPb.data.Unpack(boxContainerPb)
             # print(boxContainerPb.shape, boxContainerPb.dtype, boxContainerPb.uintData)
 
+            if boxContainerPb.shmData:
+                # read-only view into shared memory, valid until the next step is received
+                data = np.frombuffer(self.shm, dtype=self._np_dtype(boxContainerPb.dtype),
+                                     count=boxContainerPb.shmCount, offset=boxContainerPb.shmOffset)
+                shape = tuple(boxContainerPb.shape)
+                if shape and int(np.prod(shape)) == data.size:
+                    data = data.reshape(shape)
+                data.flags.writeable = False
+                return data
+
+            if boxContainerPb.rawData:
+                data = np.frombuffer(boxContainerPb.rawData, dtype=self._np_dtype(boxContainerPb.dtype))
+                shape = tuple(boxContainerPb.shape)
+                if shape and int(np.prod(shape)) == data.size:
+                    data = data.reshape(shape)
+                return data
+
             if boxContainerPb.dtype == pb.INT:
                 data = boxContainerPb.intData
             elif boxContainerPb.dtype == pb.UINT:
@@ -290,6 +479,20 @@ class Ns3ZmqBridge(object):
     def get_extra_info(self):
         return self.extraInfo
 
+    def _move_box_to_shm(self, boxContainerPb, values):
+        start = self.shmActPos
+        end = start + values.nbytes
+        if end > len(self.shm):
+            return False
+
+        np.frombuffer(self.shm, dtype=values.dtype, count=values.size, offset=start)[:] = values
+        self.shmActPos = (end + 7) & ~7
+
+        boxContainerPb.shmData = True
+        boxContainerPb.shmOffset = start
+        boxContainerPb.shmCount = values.size
+        return True
+
     def _pack_data(self, actions, spaceDesc):
         dataContainer = pb.DataContainer()
 
@@ -309,23 +512,22 @@ class Ns3ZmqBridge(object):
 
             if (spaceDesc.dtype in ['int', 'int8', 'int16', 'int32', 'int64']):
                 boxContainerPb.dtype = pb.INT
-                boxContainerPb.intData.extend(actions)
 
             elif (spaceDesc.dtype in ['uint', 'uint8', 'uint16', 'uint32', 'uint64']):
                 boxContainerPb.dtype = pb.UINT
-                boxContainerPb.uintData.extend(actions)
 
             elif (spaceDesc.dtype in ['float', 'float32', 'float64']):
                 boxContainerPb.dtype = pb.FLOAT
-                boxContainerPb.floatData.extend(actions)
 
             elif (spaceDesc.dtype in ['double']):
                 boxContainerPb.dtype = pb.DOUBLE
-                boxContainerPb.doubleData.extend(actions)
 
             else:
                 boxContainerPb.dtype = pb.FLOAT
-                boxContainerPb.floatData.extend(actions)
+
+            values = np.ascontiguousarray(actions, dtype=self._np_dtype(boxContainerPb.dtype)).ravel()
+            if self.shm is None or not self._move_box_to_shm(boxContainerPb, values):
+                boxContainerPb.rawData = values.tobytes()
 
             dataContainer.data.Pack(boxContainerPb)
 
@@ -333,7 +535,7 @@ class Ns3ZmqBridge(object):
             dataContainer.type = pb.Tuple
             tupleDataPb = pb.TupleDataContainer()
 
-            spaceList = list(self._action_space.spaces)
+            spaceList = list(spaceDesc.spaces)
             subDataList = []
             for subAction, subActSpaceType in zip(actions, spaceList):
                 subData = self._pack_data(subAction, subActSpaceType)
@@ -348,7 +550,7 @@ class Ns3ZmqBridge(object):
 
             subDataList = []
             for sName, subAction in actions.items():
-                subActSpaceType = self._action_space.spaces[sName]
+                subActSpaceType = spaceDesc.spaces[sName]
                 subData = self._pack_data(subAction, subActSpaceType)
                 subData.name = sName
                 subDataList.append(subData)
@@ -376,8 +578,12 @@ class Ns3Env(gym.Env):
         self.viewer = None
         self.state = None
         self.steps_beyond_done = None
+        self.coalescing = None
+        # kept across episodes
+        self.stats = StepStats()
 
         self.ns3ZmqBridge = Ns3ZmqBridge(self.port, self.startSim, self.simSeed, self.simArgs, self.debug)
+        self.ns3ZmqBridge.stats = self.stats
         self.ns3ZmqBridge.initialize_env(self.stepTime)
         self.action_space = self.ns3ZmqBridge.get_action_space()
         self.observation_space = self.ns3ZmqBridge.get_observation_space()
@@ -407,13 +613,20 @@ class Ns3Env(gym.Env):
             obs = self.ns3ZmqBridge.get_obs()
             return obs
 
-        if self.ns3ZmqBridge:
-            self.ns3ZmqBridge.close()
-            self.ns3ZmqBridge = None
-
         self.envDirty = False
-        self.ns3ZmqBridge = Ns3ZmqBridge(self.port, self.startSim, self.simSeed, self.simArgs, self.debug)
-        self.ns3ZmqBridge.initialize_env(self.stepTime)
+        if self.ns3ZmqBridge and self.ns3ZmqBridge.is_fork_server():
+            # no need to restart ns-3, just switch to the next forked episode
+            self.ns3ZmqBridge.next_episode(self.stepTime)
+        else:
+            if self.ns3ZmqBridge:
+                self.ns3ZmqBridge.close()
+                self.ns3ZmqBridge = None
+
+            self.ns3ZmqBridge = Ns3ZmqBridge(self.port, self.startSim, self.simSeed, self.simArgs, self.debug)
+            self.ns3ZmqBridge.stats = self.stats
+            self.ns3ZmqBridge.initialize_env(self.stepTime)
+        if self.coalescing is not None:
+            self.ns3ZmqBridge.set_coalescing(*self.coalescing)
         self.action_space = self.ns3ZmqBridge.get_action_space()
         self.observation_space = self.ns3ZmqBridge.get_observation_space()
         # get first observations
@@ -421,6 +634,19 @@ class Ns3Env(gym.Env):
         obs = self.ns3ZmqBridge.get_obs()
         return obs
 
+    def set_coalescing(self, stepEveryEvents=1, minStepInterval=0.0):
+        """Ask the ns-3 env to merge its triggers into one step per
+        stepEveryEvents triggers and at most one step per minStepInterval
+        seconds of simulated time. Takes effect with the next step()
+        and is kept for the following episodes."""
+        self.coalescing = (stepEveryEvents, minStepInterval)
+        self.ns3ZmqBridge.set_coalescing(stepEveryEvents, minStepInterval)
+
+    def get_stats(self):
+        """Time spent per step on the agent side: waiting for ns-3,
+        decoding the state and encoding and sending the actions."""
+        return self.stats.as_dict()
+
     def render(self, mode='human'):
         return
 
@@ -432,6 +658,188 @@ class Ns3Env(gym.Env):
         if self.ns3ZmqBridge:
             self.ns3ZmqBridge.close()
             self.ns3ZmqBridge = None
+            if self.debug:
+                print(self.stats)
 
         if self.viewer:
-            self.viewer.close()
\ No newline at end of file
+            self.viewer.close()
+
+
+class Ns3VecEnv(gym.Env):
+    """Drive several ns-3 simulation instances with one batched step.
+
+    Every instance is a separate ns-3 process with its own Ns3ZmqBridge.
+    A step first sends the actions to all instances and only then waits
+    for their new states, so the instances simulate concurrently and the
+    per-step round trip is paid once per batch instead of once per env.
+    """
+    def __init__(self, numEnvs, stepTime=0, port=0, startSim=True, simSeed=0, simArgs={}, debug=False):
+        self.numEnvs = int(numEnvs)
+        self.stepTime = stepTime
+        self.port = port
+        self.startSim = startSim
+        self.simSeed = simSeed
+        self.simArgs = simArgs
+        self.debug = debug
+
+        self.bridges = [None] * self.numEnvs
+        self.envDirty = [False] * self.numEnvs
+        self.action_space = None
+        self.observation_space = None
+
+        for idx in range(self.numEnvs):
+            self._start_instance(idx)
+
+        self.seed()
+
+    def _instance_port(self, idx):
+        if self.port == 0:
+            return 0
+        return int(self.port) + idx
+
+    def _instance_seed(self, idx):
+        if self.simSeed == 0:
+            return 0
+        return int(self.simSeed) + idx
+
+    def _start_instance(self, idx):
+        bridge = Ns3ZmqBridge(self._instance_port(idx), self.startSim, self._instance_seed(idx), self.simArgs, self.debug)
+        bridge.initialize_env(self.stepTime)
+        self.action_space = bridge.get_action_space()
+        self.observation_space = bridge.get_observation_space()
+        # get first observations
+        bridge.rx_env_state()
+        self.bridges[idx] = bridge
+        self.envDirty[idx] = False
+
+    def _get_state(self, idx):
+        bridge = self.bridges[idx]
+        return (bridge.get_obs(), bridge.get_reward(), bridge.is_game_over(), bridge.get_extra_info())
+
+    def seed(self, seed=None):
+        self.np_random, seed = seeding.np_random(seed)
+        return [seed]
+
+    def step(self, actions):
+        if len(actions) != self.numEnvs:
+            raise ValueError("Expected %d actions, got %d" % (self.numEnvs, len(actions)))
+
+        # send all actions first, so that all instances run in parallel
+        for bridge, action in zip(self.bridges, actions):
+            bridge.send_actions(action)
+
+        for idx, bridge in enumerate(self.bridges):
+            bridge.rx_env_state()
+            self.envDirty[idx] = True
+
+        obs, rewards, dones, infos = zip(*[self._get_state(idx) for idx in range(self.numEnvs)])
+        return list(obs), np.array(rewards), np.array(dones), list(infos)
+
+    def reset(self, indices=None):
+        if indices is None:
+            indices = range(self.numEnvs)
+
+        for idx in indices:
+            if not self.envDirty[idx]:
+                continue
+            bridge = self.bridges[idx]
+            if bridge.is_fork_server():
+                bridge.next_episode(self.stepTime)
+                bridge.rx_env_state()
+                self.envDirty[idx] = False
+                continue
+            bridge.close()
+            self.bridges[idx] = None
+            self._start_instance(idx)
+
+        return [bridge.get_obs() for bridge in self.bridges]
+
+    def render(self, mode='human'):
+        return
+
+    def get_random_action(self):
+        return [self.action_space.sample() for _ in range(self.numEnvs)]
+
+    def set_coalescing(self, stepEveryEvents=1, minStepInterval=0.0):
+        for bridge in self.bridges:
+            bridge.set_coalescing(stepEveryEvents, minStepInterval)
+
+    def close(self):
+        for idx, bridge in enumerate(self.bridges):
+            if bridge:
+                bridge.close()
+                self.bridges[idx] = None
+
+
+class Ns3MultiAgentEnv(gym.Env):
+    """Multi-agent env for ns-3 scenarios that register several OpenGymEnv
+    instances (agents) on one OpenGymInterface.
+
+    Observations, rewards, dones and infos are dicts keyed by agent id and
+    contain only the agents triggered at the current simulated time, all
+    of them delivered in one message. step() takes a dict with an action
+    for each of these agents. dones["__all__"] is set at the simulation end.
+    """
+    def __init__(self, stepTime=0, port=0, startSim=True, simSeed=0, simArgs={}, debug=False):
+        self.stepTime = stepTime
+        self.port = port
+        self.startSim = startSim
+        self.simSeed = simSeed
+        self.simArgs = simArgs
+        self.debug = debug
+
+        self.ns3ZmqBridge = None
+        self.envDirty = False
+        self.stats = StepStats()
+        self._start()
+        self.seed()
+
+    def _start(self):
+        self.ns3ZmqBridge = Ns3ZmqBridge(self.port, self.startSim, self.simSeed, self.simArgs, self.debug)
+        self.ns3ZmqBridge.stats = self.stats
+        self.ns3ZmqBridge.initialize_env(self.stepTime)
+        if not self.ns3ZmqBridge.is_multi_agent():
+            raise RuntimeError("The ns-3 simulation did not register any agents, use Ns3Env instead")
+        self.agent_ids = list(self.ns3ZmqBridge.agentIds)
+        self.action_spaces = self.ns3ZmqBridge.agentActionSpaces
+        self.observation_spaces = self.ns3ZmqBridge.agentObservationSpaces
+        # get first observations
+        self.ns3ZmqBridge.rx_multi_env_state()
+        self.envDirty = False
+
+    def seed(self, seed=None):
+        self.np_random, seed = seeding.np_random(seed)
+        return [seed]
+
+    def get_state(self):
+        bridge = self.ns3ZmqBridge
+        dones = dict(bridge.agentDones)
+        dones["__all__"] = bridge.is_game_over()
+        return (dict(bridge.agentObs), dict(bridge.agentRewards), dones, dict(bridge.agentInfos))
+
+    def step(self, actions):
+        self.ns3ZmqBridge.multi_step(actions)
+        self.envDirty = True
+        return self.get_state()
+
+    def reset(self):
+        if self.envDirty:
+            self.ns3ZmqBridge.close()
+            self._start()
+        return dict(self.ns3ZmqBridge.agentObs)
+
+    def get_stats(self):
+        return self.stats.as_dict()
+
+    def render(self, mode='human'):
+        return
+
+    def get_random_action(self):
+        return {agentId: self.action_spaces[agentId].sample() for agentId in self.ns3ZmqBridge.agentObs}
+
+    def close(self):
+        if self.ns3ZmqBridge:
+            self.ns3ZmqBridge.close()
+            self.ns3ZmqBridge = None
+            if self.debug:
+                print(self.stats)
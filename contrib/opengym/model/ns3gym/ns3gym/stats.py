@@ -0,0 +1,76 @@
+import time
+import math
+
+__author__ = "Piotr Gawlowicz"
+__copyright__ = "Copyright (c) 2018, Technische Universität Berlin"
+__version__ = "0.1.0"
+__email__ = "gawlowicz.p@gmail.com"
+
+
+class StepStats(object):
+    """Wall clock time spent in the stages of the gym steps on the agent
+    side, the counterpart of OpenGymStepStats in ns-3.
+
+    wait is the time blocked in recv, i.e. the time ns-3 needed to simulate
+    up to the next step; the remaining time between steps is spent by the
+    agent itself.
+    """
+    STAGES = ('wait', 'deserialize', 'serialize', 'send')
+    HIST_BUCKETS = 24
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self.count = dict((s, 0) for s in self.STAGES)
+        self.total = dict((s, 0.0) for s in self.STAGES)
+        self.max = dict((s, 0.0) for s in self.STAGES)
+        self.hist = dict((s, [0] * self.HIST_BUCKETS) for s in self.STAGES)
+        self.steps = 0
+        self.wallStart = None
+        self.wallLast = None
+
+    def add(self, stage, start):
+        """Add the time from start until now to stage, return now."""
+        now = time.perf_counter()
+        us = (now - start) * 1e6
+        self.count[stage] += 1
+        self.total[stage] += us
+        if us > self.max[stage]:
+            self.max[stage] = us
+        # bucket 0 is below 1us, bucket i covers [2^(i-1), 2^i) us
+        bucket = 0 if us < 1 else min(int(math.log2(us)) + 1, self.HIST_BUCKETS - 1)
+        self.hist[stage][bucket] += 1
+        return now
+
+    def finish_step(self):
+        now = time.perf_counter()
+        if self.wallStart is None:
+            self.wallStart = now
+        self.wallLast = now
+        self.steps += 1
+
+    def get_steps_per_second(self):
+        if self.steps < 2 or self.wallLast <= self.wallStart:
+            return 0.0
+        return (self.steps - 1) / (self.wallLast - self.wallStart)
+
+    def as_dict(self):
+        stats = {'steps': self.steps, 'stepsPerSecond': self.get_steps_per_second()}
+        for s in self.STAGES:
+            mean = self.total[s] / self.count[s] if self.count[s] else 0.0
+            stats[s] = {'count': self.count[s], 'totalUs': self.total[s], 'meanUs': mean,
+                        'maxUs': self.max[s], 'hist': list(self.hist[s])}
+        return stats
+
+    def __str__(self):
+        lines = ["ns3gym step stats: %d steps, %.1f steps/s" % (self.steps, self.get_steps_per_second()),
+                 "  %-12s%10s%14s%12s%12s  histogram (<1us, <2us, <4us, ...)" % ('stage', 'count', 'total[ms]', 'mean[us]', 'max[us]')]
+        for s in self.STAGES:
+            mean = self.total[s] / self.count[s] if self.count[s] else 0.0
+            hist = list(self.hist[s])
+            while hist and hist[-1] == 0:
+                hist.pop()
+            lines.append("  %-12s%10d%14.3f%12.1f%12.1f  %s" % (s, self.count[s], self.total[s] / 1000.0, mean,
+                                                                self.max[s], " ".join(str(h) for h in hist)))
+        return "\n".join(lines)
@@ -0,0 +1,623 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "opengym_agent.h"
+#include "container.h"
+#include "spaces.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OpenGymAgent");
+
+NS_OBJECT_ENSURE_REGISTERED (OpenGymAgent);
+NS_OBJECT_ENSURE_REGISTERED (OpenGymTabularAgent);
+NS_OBJECT_ENSURE_REGISTERED (OpenGymMlpAgent);
+
+template <typename T>
+static bool
+AppendBoxValues(Ptr<OpenGymDataContainer> container, std::vector<double> &values)
+{
+  Ptr<OpenGymBoxContainer<T> > box = DynamicCast<OpenGymBoxContainer<T> >(container);
+  if (!box) {
+    return false;
+  }
+  const std::vector<T> &data = box->GetData();
+  values.insert(values.end(), data.begin(), data.end());
+  return true;
+}
+
+template <typename T>
+static Ptr<OpenGymDataContainer>
+CreateBoxAction(const std::vector<uint32_t> &shape, const std::vector<double> &values)
+{
+  Ptr<OpenGymBoxContainer<T> > box = CreateObject<OpenGymBoxContainer<T> >(shape);
+  for (auto i = values.begin(); i != values.end(); ++i) {
+    box->AddValue(static_cast<T>(*i));
+  }
+  return box;
+}
+
+
+TypeId
+OpenGymAgent::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("OpenGymAgent")
+    .SetParent<Object> ()
+    .SetGroupName ("OpenGym")
+    ;
+  return tid;
+}
+
+OpenGymAgent::OpenGymAgent ()
+  : m_actType(ns3opengym::NoSpaceType), m_actDtype(ns3opengym::NoDType),
+    m_actSize(0), m_actLow(0), m_actHigh(0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OpenGymAgent::~OpenGymAgent ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+OpenGymAgent::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_obsSpace = 0;
+  m_actSpace = 0;
+}
+
+void
+OpenGymAgent::DoInitialize (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+OpenGymAgent::Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace)
+{
+  NS_LOG_FUNCTION (this);
+  m_obsSpace = obsSpace;
+  m_actSpace = actSpace;
+  m_actType = ns3opengym::NoSpaceType;
+  m_actShape.clear();
+  m_actSize = 0;
+
+  if (!actSpace) {
+    return;
+  }
+
+  ns3opengym::SpaceDescription desc = actSpace->GetSpaceDescription();
+  m_actType = desc.type();
+  if (m_actType == ns3opengym::Discrete) {
+    ns3opengym::DiscreteSpace discrete;
+    desc.space().UnpackTo(&discrete);
+    m_actSize = 1;
+    m_actLow = 0;
+    m_actHigh = discrete.n() - 1;
+  } else if (m_actType == ns3opengym::Box) {
+    ns3opengym::BoxSpace box;
+    desc.space().UnpackTo(&box);
+    m_actDtype = box.dtype();
+    m_actLow = box.low();
+    m_actHigh = box.high();
+    m_actSize = 1;
+    for (int i = 0; i < box.shape_size(); i++) {
+      m_actShape.push_back(box.shape(i));
+      m_actSize *= box.shape(i);
+    }
+  } else {
+    NS_ABORT_MSG ("In-process agents support discrete and box action spaces only");
+  }
+}
+
+void
+OpenGymAgent::NotifyEpisodeEnd()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+OpenGymAgent::GetValues(Ptr<OpenGymDataContainer> container, std::vector<double> &values)
+{
+  values.clear();
+  if (!container) {
+    return false;
+  }
+
+  Ptr<OpenGymDiscreteContainer> discrete = DynamicCast<OpenGymDiscreteContainer>(container);
+  if (discrete) {
+    values.push_back(discrete->GetValue());
+    return true;
+  }
+
+  return AppendBoxValues<float>(container, values)
+         || AppendBoxValues<double>(container, values)
+         || AppendBoxValues<int32_t>(container, values)
+         || AppendBoxValues<uint32_t>(container, values)
+         || AppendBoxValues<int64_t>(container, values)
+         || AppendBoxValues<uint64_t>(container, values)
+         || AppendBoxValues<int16_t>(container, values)
+         || AppendBoxValues<uint16_t>(container, values)
+         || AppendBoxValues<int8_t>(container, values)
+         || AppendBoxValues<uint8_t>(container, values);
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymAgent::CreateAction(const std::vector<double> &values)
+{
+  if (m_actType == ns3opengym::Discrete) {
+    NS_ASSERT (!values.empty());
+    Ptr<OpenGymDiscreteContainer> discrete = CreateObject<OpenGymDiscreteContainer>(m_actHigh + 1);
+    discrete->SetValue(static_cast<uint32_t>(values[0]));
+    return discrete;
+  }
+
+  // same container types as created for actions received from Python
+  switch (m_actDtype) {
+    case ns3opengym::INT:
+      return CreateBoxAction<int32_t>(m_actShape, values);
+    case ns3opengym::UINT:
+      return CreateBoxAction<uint32_t>(m_actShape, values);
+    case ns3opengym::DOUBLE:
+      return CreateBoxAction<double>(m_actShape, values);
+    default:
+      return CreateBoxAction<float>(m_actShape, values);
+  }
+}
+
+
+TypeId
+OpenGymTabularAgent::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("OpenGymTabularAgent")
+    .SetParent<OpenGymAgent> ()
+    .SetGroupName ("OpenGym")
+    .AddConstructor<OpenGymTabularAgent> ()
+    .AddAttribute ("LearningRate",
+                   "Learning rate (alpha) of the Q update",
+                   DoubleValue (0.75),
+                   MakeDoubleAccessor (&OpenGymTabularAgent::m_alpha),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("Discount",
+                   "Discount factor of future rewards",
+                   DoubleValue (0.95),
+                   MakeDoubleAccessor (&OpenGymTabularAgent::m_discount),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("Epsilon",
+                   "Probability of a random action while learning",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&OpenGymTabularAgent::m_epsilon),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("Learning",
+                   "Update the table; if false the agent only acts greedily",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&OpenGymTabularAgent::m_learning),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TableFile",
+                   "Q table loaded at start (if it exists) and, while learning, saved at the end of the episode",
+                   StringValue (""),
+                   MakeStringAccessor (&OpenGymTabularAgent::m_tableFile),
+                   MakeStringChecker ())
+    ;
+  return tid;
+}
+
+OpenGymTabularAgent::OpenGymTabularAgent ()
+  : m_numLearners(0), m_numActions(0), m_actionOffset(0), m_hasLast(false)
+{
+  NS_LOG_FUNCTION (this);
+  m_rng = CreateObject<UniformRandomVariable> ();
+}
+
+OpenGymTabularAgent::~OpenGymTabularAgent ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+OpenGymTabularAgent::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_tables.clear();
+  m_rng = 0;
+  OpenGymAgent::DoDispose ();
+}
+
+int64_t
+OpenGymTabularAgent::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_rng->SetStream (stream);
+  return 1;
+}
+
+void
+OpenGymTabularAgent::Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace)
+{
+  NS_LOG_FUNCTION (this);
+  OpenGymAgent::Init(obsSpace, actSpace);
+
+  if (m_actType == ns3opengym::Discrete) {
+    m_numLearners = 1;
+    m_numActions = m_actHigh + 1;
+    m_actionOffset = 0;
+  } else {
+    NS_ABORT_MSG_IF (m_actDtype != ns3opengym::INT && m_actDtype != ns3opengym::UINT,
+                     "Tabular agent needs a discrete or integer box action space");
+    m_numLearners = m_actSize;
+    m_actionOffset = static_cast<int64_t>(m_actLow);
+    m_numActions = static_cast<int64_t>(m_actHigh) - m_actionOffset + 1;
+  }
+  NS_ABORT_MSG_IF (m_numActions == 0, "Empty action space");
+
+  m_tables.assign(m_numLearners, QTable());
+  m_lastState.assign(m_numLearners, StateKey());
+  m_lastAction.assign(m_numLearners, 0);
+  m_hasLast = false;
+
+  if (!m_tableFile.empty()) {
+    LoadTable(m_tableFile);
+  }
+}
+
+OpenGymTabularAgent::StateKey
+OpenGymTabularAgent::GetStateKey(const std::vector<double> &obs, uint32_t learner) const
+{
+  if (m_numLearners > 1 && obs.size() == m_numLearners) {
+    return StateKey(1, std::llround(obs[learner]));
+  }
+  StateKey key;
+  key.reserve(obs.size());
+  for (auto i = obs.begin(); i != obs.end(); ++i) {
+    key.push_back(std::llround(*i));
+  }
+  return key;
+}
+
+std::vector<double>&
+OpenGymTabularAgent::GetRow(uint32_t learner, const StateKey &key)
+{
+  std::vector<double> &row = m_tables[learner][key];
+  if (row.size() != m_numActions) {
+    row.assign(m_numActions, 0.0);
+  }
+  return row;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymTabularAgent::GetAction(Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info)
+{
+  NS_LOG_FUNCTION (this << reward << done);
+  std::vector<double> values;
+  if (!GetValues(obs, values)) {
+    NS_LOG_WARN ("Unsupported observation, no action");
+    return 0;
+  }
+
+  std::vector<double> actions(m_numLearners);
+  for (uint32_t n = 0; n < m_numLearners; n++) {
+    StateKey state = GetStateKey(values, n);
+    std::vector<double> &row = GetRow(n, state);
+    uint32_t best = std::max_element(row.begin(), row.end()) - row.begin();
+
+    if (m_learning && m_hasLast) {
+      double target = reward;
+      if (!done) {
+        target += m_discount * row[best];
+      }
+      double &q = GetRow(n, m_lastState[n])[m_lastAction[n]];
+      q += m_alpha * (target - q);
+    }
+
+    uint32_t action = best;
+    if (m_learning && m_epsilon > 0 && m_rng->GetValue() < m_epsilon) {
+      action = m_rng->GetInteger(0, m_numActions - 1);
+    }
+
+    m_lastState[n] = state;
+    m_lastAction[n] = action;
+    actions[n] = static_cast<double>(action + m_actionOffset);
+  }
+  m_hasLast = !done;
+
+  if (done) {
+    return 0;
+  }
+  return CreateAction(actions);
+}
+
+void
+OpenGymTabularAgent::NotifyEpisodeEnd()
+{
+  NS_LOG_FUNCTION (this);
+  m_hasLast = false;
+  if (m_learning && !m_tableFile.empty()) {
+    SaveTable(m_tableFile);
+  }
+}
+
+bool
+OpenGymTabularAgent::LoadTable(std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream is(filename.c_str());
+  if (!is) {
+    NS_LOG_DEBUG ("No Q table in " << filename);
+    return false;
+  }
+
+  // one line per row: <learner> <key size> <key...> <action values...>
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    uint32_t learner, keySize;
+    if (!(ls >> learner >> keySize) || learner >= m_numLearners) {
+      continue;
+    }
+    StateKey key(keySize);
+    for (uint32_t i = 0; i < keySize; i++) {
+      ls >> key[i];
+    }
+    std::vector<double> &row = GetRow(learner, key);
+    for (uint32_t a = 0; a < m_numActions; a++) {
+      ls >> row[a];
+    }
+    if (!ls) {
+      NS_LOG_WARN ("Malformed Q table line: " << line);
+      m_tables[learner].erase(key);
+    }
+  }
+  return true;
+}
+
+bool
+OpenGymTabularAgent::SaveTable(std::string filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ofstream os(filename.c_str());
+  if (!os) {
+    NS_LOG_WARN ("Cannot write Q table to " << filename);
+    return false;
+  }
+  os.precision(17);
+  for (uint32_t n = 0; n < m_tables.size(); n++) {
+    for (auto i = m_tables[n].begin(); i != m_tables[n].end(); ++i) {
+      os << n << " " << i->first.size();
+      for (auto k = i->first.begin(); k != i->first.end(); ++k) {
+        os << " " << *k;
+      }
+      for (auto v = i->second.begin(); v != i->second.end(); ++v) {
+        os << " " << *v;
+      }
+      os << std::endl;
+    }
+  }
+  return true;
+}
+
+
+TypeId
+OpenGymMlpAgent::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("OpenGymMlpAgent")
+    .SetParent<OpenGymAgent> ()
+    .SetGroupName ("OpenGym")
+    .AddConstructor<OpenGymMlpAgent> ()
+    .AddAttribute ("WeightsFile",
+                   "Text file with the network weights, loaded on Init",
+                   StringValue (""),
+                   MakeStringAccessor (&OpenGymMlpAgent::m_weightsFile),
+                   MakeStringChecker ())
+    ;
+  return tid;
+}
+
+OpenGymMlpAgent::OpenGymMlpAgent ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OpenGymMlpAgent::~OpenGymMlpAgent ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+OpenGymMlpAgent::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_layers.clear();
+  OpenGymAgent::DoDispose ();
+}
+
+void
+OpenGymMlpAgent::Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace)
+{
+  NS_LOG_FUNCTION (this);
+  OpenGymAgent::Init(obsSpace, actSpace);
+
+  if (!m_weightsFile.empty()) {
+    NS_ABORT_MSG_UNLESS (LoadWeights(m_weightsFile), "Cannot load MLP weights from " << m_weightsFile);
+  }
+  NS_ABORT_MSG_IF (m_layers.empty(), "MLP agent without layers");
+
+  uint32_t outputs = m_layers.back().out;
+  if (m_actType == ns3opengym::Discrete) {
+    NS_ABORT_MSG_UNLESS (outputs == m_actHigh + 1, "MLP output does not match the discrete action space");
+  } else {
+    NS_ABORT_MSG_UNLESS (outputs == m_actSize, "MLP output does not match the box action space");
+  }
+}
+
+bool
+OpenGymMlpAgent::LoadWeights(std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream is(filename.c_str());
+  if (!is) {
+    return false;
+  }
+  return LoadWeights(is);
+}
+
+bool
+OpenGymMlpAgent::LoadWeights(std::istream &is)
+{
+  NS_LOG_FUNCTION (this);
+  // strip comments, the rest is whitespace separated
+  std::stringstream tokens;
+  std::string line;
+  while (std::getline(is, line)) {
+    tokens << line.substr(0, line.find('#')) << "\n";
+  }
+
+  std::vector<Layer> layers;
+  std::string keyword;
+  while (tokens >> keyword) {
+    if (keyword != "layer") {
+      NS_LOG_WARN ("Expected 'layer', got '" << keyword << "'");
+      return false;
+    }
+
+    Layer layer;
+    std::string activation;
+    if (!(tokens >> layer.in >> layer.out >> activation)) {
+      return false;
+    }
+    if (activation == "linear") {
+      layer.activation = LINEAR;
+    } else if (activation == "relu") {
+      layer.activation = RELU;
+    } else if (activation == "tanh") {
+      layer.activation = TANH;
+    } else if (activation == "sigmoid") {
+      layer.activation = SIGMOID;
+    } else {
+      NS_LOG_WARN ("Unknown activation '" << activation << "'");
+      return false;
+    }
+    if (!layers.empty() && layers.back().out != layer.in) {
+      NS_LOG_WARN ("Layer input size " << layer.in << " does not match previous output size " << layers.back().out);
+      return false;
+    }
+
+    layer.weights.resize(layer.in * layer.out);
+    layer.biases.resize(layer.out);
+    for (auto i = layer.weights.begin(); i != layer.weights.end(); ++i) {
+      tokens >> *i;
+    }
+    for (auto i = layer.biases.begin(); i != layer.biases.end(); ++i) {
+      tokens >> *i;
+    }
+    if (!tokens) {
+      NS_LOG_WARN ("Not enough weights for layer " << layers.size());
+      return false;
+    }
+    layers.push_back(layer);
+  }
+
+  if (layers.empty()) {
+    return false;
+  }
+  m_layers.swap(layers);
+  return true;
+}
+
+const std::vector<double>&
+OpenGymMlpAgent::Evaluate(const std::vector<double> &input)
+{
+  NS_ASSERT (!m_layers.empty());
+  NS_ABORT_MSG_UNLESS (input.size() == m_layers.front().in,
+                       "MLP expects " << m_layers.front().in << " inputs, got " << input.size());
+
+  const std::vector<double> *x = &input;
+  for (uint32_t l = 0; l < m_layers.size(); l++) {
+    const Layer &layer = m_layers[l];
+    std::vector<double> &y = m_buffer[l % 2];
+    y.resize(layer.out);
+    for (uint32_t o = 0; o < layer.out; o++) {
+      const double *w = &layer.weights[o * layer.in];
+      double sum = layer.biases[o];
+      for (uint32_t i = 0; i < layer.in; i++) {
+        sum += w[i] * (*x)[i];
+      }
+      switch (layer.activation) {
+        case RELU:
+          sum = std::max(0.0, sum);
+          break;
+        case TANH:
+          sum = std::tanh(sum);
+          break;
+        case SIGMOID:
+          sum = 1.0 / (1.0 + std::exp(-sum));
+          break;
+        case LINEAR:
+          break;
+      }
+      y[o] = sum;
+    }
+    x = &y;
+  }
+  return *x;
+}
+
+Ptr<OpenGymDataContainer>
+OpenGymMlpAgent::GetAction(Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info)
+{
+  NS_LOG_FUNCTION (this << reward << done);
+  if (done) {
+    return 0;
+  }
+
+  std::vector<double> values;
+  if (!GetValues(obs, values)) {
+    NS_LOG_WARN ("Unsupported observation, no action");
+    return 0;
+  }
+
+  const std::vector<double> &out = Evaluate(values);
+  if (m_actType == ns3opengym::Discrete) {
+    double best = std::max_element(out.begin(), out.end()) - out.begin();
+    return CreateAction(std::vector<double>(1, best));
+  }
+
+  std::vector<double> actions(out);
+  for (auto i = actions.begin(); i != actions.end(); ++i) {
+    *i = std::min<double>(std::max<double>(*i, m_actLow), m_actHigh);
+    if (m_actDtype == ns3opengym::INT || m_actDtype == ns3opengym::UINT) {
+      *i = std::floor(*i + 0.5);
+    }
+  }
+  return CreateAction(actions);
+}
+
+} // namespace ns3
@@ -0,0 +1,187 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#ifndef OPENGYM_AGENT_H
+#define OPENGYM_AGENT_H
+
+#include "ns3/object.h"
+#include "ns3/random-variable-stream.h"
+#include "messages.pb.h"
+#include <map>
+
+namespace ns3 {
+
+class OpenGymSpace;
+class OpenGymDataContainer;
+
+/**
+ * Agent running inside the simulation process. When an agent is set on
+ * the OpenGymInterface, it is asked for the actions directly instead of
+ * the Python agent, i.e. no ZMQ connection is made at all.
+ */
+class OpenGymAgent : public Object
+{
+public:
+  OpenGymAgent ();
+  virtual ~OpenGymAgent ();
+
+  static TypeId GetTypeId ();
+
+  virtual void Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace);
+  // may return 0 if there is no action to execute
+  virtual Ptr<OpenGymDataContainer> GetAction(Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info) = 0;
+  // called once the episode is over, after the last GetAction
+  virtual void NotifyEpisodeEnd();
+
+  // flatten a discrete or box container into values, false for other types
+  static bool GetValues(Ptr<OpenGymDataContainer> container, std::vector<double> &values);
+
+protected:
+  // Inherited
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+  // build a container for the action space from the given values:
+  // a discrete space takes the first value, a box one value per element
+  Ptr<OpenGymDataContainer> CreateAction(const std::vector<double> &values);
+
+  Ptr<OpenGymSpace> m_obsSpace;
+  Ptr<OpenGymSpace> m_actSpace;
+
+  // action space properties
+  ns3opengym::SpaceType m_actType;
+  ns3opengym::Dtype m_actDtype;
+  std::vector<uint32_t> m_actShape;
+  uint32_t m_actSize;
+  float m_actLow;
+  float m_actHigh;
+};
+
+/**
+ * Tabular Q-learning, the same algorithm as examples/linear-mesh/qlearn_full.py.
+ *
+ * With a discrete action space there is one table indexed by the whole
+ * observation. With a box action space of integers every element is an
+ * independent learner choosing a value in [low, high]; if the observation
+ * has as many elements as the action, learner i only sees observation i.
+ */
+class OpenGymTabularAgent : public OpenGymAgent
+{
+public:
+  OpenGymTabularAgent ();
+  virtual ~OpenGymTabularAgent ();
+
+  static TypeId GetTypeId ();
+
+  virtual void Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace);
+  virtual Ptr<OpenGymDataContainer> GetAction(Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info);
+  virtual void NotifyEpisodeEnd();
+
+  bool LoadTable(std::string filename);
+  bool SaveTable(std::string filename) const;
+
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  // Inherited
+  virtual void DoDispose (void);
+
+private:
+  typedef std::vector<int64_t> StateKey;
+  typedef std::map<StateKey, std::vector<double> > QTable;
+
+  StateKey GetStateKey(const std::vector<double> &obs, uint32_t learner) const;
+  std::vector<double>& GetRow(uint32_t learner, const StateKey &key);
+
+  double m_alpha;
+  double m_discount;
+  double m_epsilon;
+  bool m_learning;
+  std::string m_tableFile;
+
+  uint32_t m_numLearners;
+  uint32_t m_numActions;
+  int64_t m_actionOffset;
+  std::vector<QTable> m_tables;
+
+  bool m_hasLast;
+  std::vector<StateKey> m_lastState;
+  std::vector<uint32_t> m_lastAction;
+
+  Ptr<UniformRandomVariable> m_rng;
+};
+
+/**
+ * Small fully connected network evaluated on the CPU, e.g. a policy
+ * trained in Python and exported with ns3gym.mlp.save_mlp().
+ *
+ * The weights file is plain text, '#' starts a comment. Every layer is
+ *   layer <in> <out> <linear|relu|tanh|sigmoid>
+ * followed by <out> rows of <in> weights and a row of <out> biases.
+ * With a discrete action space the action is the argmax of the output,
+ * with a box space the outputs, clipped to [low, high], are the action.
+ */
+class OpenGymMlpAgent : public OpenGymAgent
+{
+public:
+  OpenGymMlpAgent ();
+  virtual ~OpenGymMlpAgent ();
+
+  static TypeId GetTypeId ();
+
+  virtual void Init(Ptr<OpenGymSpace> obsSpace, Ptr<OpenGymSpace> actSpace);
+  virtual Ptr<OpenGymDataContainer> GetAction(Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info);
+
+  bool LoadWeights(std::string filename);
+  bool LoadWeights(std::istream &is);
+
+  // forward pass, exposed for testing
+  const std::vector<double>& Evaluate(const std::vector<double> &input);
+
+protected:
+  // Inherited
+  virtual void DoDispose (void);
+
+private:
+  enum Activation {
+    LINEAR,
+    RELU,
+    TANH,
+    SIGMOID
+  };
+
+  struct Layer {
+    uint32_t in;
+    uint32_t out;
+    Activation activation;
+    std::vector<double> weights; // out x in, row major
+    std::vector<double> biases;
+  };
+
+  std::string m_weightsFile;
+  std::vector<Layer> m_layers;
+  // ping-pong buffers for the forward pass
+  std::vector<double> m_buffer[2];
+};
+
+} // end of namespace ns3
+
+#endif /* OPENGYM_AGENT_H */
@@ -21,6 +21,9 @@
 
 #include "ns3/log.h"
 #include "ns3/object.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
 #include "opengym_env.h"
 #include "container.h"
 #include "spaces.h"
@@ -38,11 +41,22 @@ OpenGymEnv::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::OpenGymEnv")
     .SetParent<Object> ()
     .SetGroupName ("OpenGym")
+    .AddAttribute ("StepEveryEvents",
+                   "Coalesce triggers (Notify) so that a step is made at most every this many triggers",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&OpenGymEnv::m_stepEveryEvents),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MinStepInterval",
+                   "Coalesce triggers (Notify) so that a step is made at most once per this simulated interval",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&OpenGymEnv::m_minStepInterval),
+                   MakeTimeChecker ())
     ;
   return tid;
 }
 
 OpenGymEnv::OpenGymEnv()
+  : m_stepEveryEvents(1), m_events(0), m_stepped(false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -76,16 +90,103 @@ OpenGymEnv::SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface)
   openGymInterface->SetGetRewardCb( MakeCallback (&OpenGymEnv::GetReward, this) );
   openGymInterface->SetGetExtraInfoCb( MakeCallback (&OpenGymEnv::GetExtraInfo, this) );
   openGymInterface->SetExecuteActionsCb( MakeCallback (&OpenGymEnv::ExecuteActions, this) );
+  openGymInterface->SetCoalescingCb( MakeCallback (&OpenGymEnv::SetCoalescing, this) );
+}
+
+void
+OpenGymEnv::SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface, std::string agentId)
+{
+  NS_LOG_FUNCTION (this << agentId);
+  m_openGymInterface = openGymInterface;
+  openGymInterface->RegisterAgent(agentId, this);
 }
 
 void
 OpenGymEnv::Notify()
 {
   NS_LOG_FUNCTION (this);
+  m_events++;
+  if (m_events < m_stepEveryEvents) {
+    return;
+  }
+  if (m_stepped && Simulator::Now() - m_lastStep < m_minStepInterval) {
+    return;
+  }
+  DoNotify();
+}
+
+void
+OpenGymEnv::NotifyNow()
+{
+  NS_LOG_FUNCTION (this);
+  m_events++;
+  DoNotify();
+}
+
+void
+OpenGymEnv::DoNotify()
+{
+  NS_LOG_FUNCTION (this);
+  m_stepped = true;
+  m_lastStep = Simulator::Now();
   if (m_openGymInterface)
   {
     m_openGymInterface->Notify(this);
   }
+
+  // start collecting the next step, the storage is kept
+  m_events = 0;
+  for (auto i = m_features.begin(); i != m_features.end(); ++i) {
+    i->count = 0;
+  }
+}
+
+void
+OpenGymEnv::SetCoalescing(uint32_t everyEvents, Time minInterval)
+{
+  NS_LOG_FUNCTION (this << everyEvents << minInterval);
+  m_stepEveryEvents = std::max<uint32_t>(everyEvents, 1);
+  m_minStepInterval = minInterval;
+}
+
+double
+OpenGymEnv::FeatureStats::GetMean() const
+{
+  return count ? sum / count : 0.0;
+}
+
+void
+OpenGymEnv::AccumulateFeature(uint32_t feature, double value)
+{
+  if (feature >= m_features.size()) {
+    FeatureStats empty = {0, 0.0, 0.0, 0.0};
+    m_features.resize(feature + 1, empty);
+  }
+  FeatureStats &stats = m_features[feature];
+  if (stats.count == 0) {
+    stats.min = stats.max = stats.sum = value;
+  } else {
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+    stats.sum += value;
+  }
+  stats.count++;
+}
+
+const OpenGymEnv::FeatureStats&
+OpenGymEnv::GetFeatureStats(uint32_t feature) const
+{
+  static const FeatureStats empty = {0, 0.0, 0.0, 0.0};
+  if (feature >= m_features.size() || m_features[feature].count == 0) {
+    return empty;
+  }
+  return m_features[feature];
+}
+
+uint32_t
+OpenGymEnv::GetCoalescedEvents() const
+{
+  return m_events;
 }
 
 void
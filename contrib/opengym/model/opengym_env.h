@@ -23,6 +23,8 @@
 #define OPENGYM_ENV_H
 
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -49,9 +51,35 @@ public:
   virtual bool ExecuteActions(Ptr<OpenGymDataContainer> action) = 0;
 
   void SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface);
+  // register as one of several agents of the interface (multi-agent mode)
+  void SetOpenGymInterface(Ptr<OpenGymInterface> openGymInterface, std::string agentId);
+  // a trigger; becomes a step only when the coalescing policy allows it
   void Notify();
+  // a step regardless of the coalescing policy, e.g. for rare important events
+  void NotifyNow();
   void NotifySimulationEnd();
 
+  // Coalescing of triggers: a step is made once at least everyEvents
+  // triggers arrived and minInterval passed since the previous step.
+  // The defaults (1, 0) make every trigger a step.
+  void SetCoalescing(uint32_t everyEvents, Time minInterval);
+
+  struct FeatureStats
+  {
+    uint32_t count;
+    double min;
+    double max;
+    double sum;
+    double GetMean() const;
+  };
+
+  // record a value of a feature of the current trigger; the statistics
+  // cover all triggers coalesced into the next step
+  void AccumulateFeature(uint32_t feature, double value);
+  const FeatureStats& GetFeatureStats(uint32_t feature) const;
+  // number of triggers coalesced into the current step
+  uint32_t GetCoalescedEvents() const;
+
 
 protected:
   // Inherited
@@ -60,6 +88,14 @@ protected:
 
   Ptr<OpenGymInterface> m_openGymInterface;
 private:
+  void DoNotify();
+
+  uint32_t m_stepEveryEvents;
+  Time m_minStepInterval;
+  uint32_t m_events;
+  Time m_lastStep;
+  bool m_stepped;
+  std::vector<FeatureStats> m_features;
 
 };
 
@@ -20,14 +20,26 @@
  */
 
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
 #include "ns3/log.h"
 #include "ns3/config.h"
 #include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/abort.h"
 #include "opengym_interface.h"
 #include "opengym_env.h"
 #include "container.h"
 #include "spaces.h"
+#include "opengym_shm.h"
+#include "opengym_agent.h"
+#include "ns3/trace-source-accessor.h"
 #include "messages.pb.h"
 
 namespace ns3 {
@@ -44,6 +56,51 @@ OpenGymInterface::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName ("OpenGym")
     .AddConstructor<OpenGymInterface> ()
+    .AddAttribute ("SharedMemory",
+                   "Pass box observations and actions through a POSIX shared memory region "
+                   "instead of serializing them into the ZMQ messages",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&OpenGymInterface::m_shmEnabled),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SharedMemorySize",
+                   "Size in bytes of the shared memory region",
+                   UintegerValue (16 * 1024 * 1024),
+                   MakeUintegerAccessor (&OpenGymInterface::m_shmSize),
+                   MakeUintegerChecker<uint32_t> (4096))
+    .AddAttribute ("ActionDelay",
+                   "If positive, do not block the simulation while the agent computes its action. "
+                   "The simulation keeps running and the action is applied at the latest "
+                   "this amount of simulated time after the state was sent",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&OpenGymInterface::m_actionDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("ActionPollInterval",
+                   "If positive and ActionDelay is used, check for the action every interval "
+                   "and apply it as soon as it arrives instead of waiting for the delay to pass",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&OpenGymInterface::m_actionPollInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ForkServerTime",
+                   "If positive, run the scenario up to this time once (warm-up, no agent "
+                   "interaction) and then fork a new process for every episode, "
+                   "each continuing from this point with its own run number",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&OpenGymInterface::m_forkTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("PrintStepStats",
+                   "Print the timing statistics of the steps at the end of the simulation",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&OpenGymInterface::m_printStepStats),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("StepTimes",
+                     "Wall clock time spent in the stages of a step, fired when the step is done",
+                     MakeTraceSourceAccessor (&OpenGymInterface::m_stepTimesTrace),
+                     "ns3::OpenGymInterface::StepTimesTracedCallback")
+    .AddAttribute ("ForkServerMaxEpisodes",
+                   "Number of episodes after which the fork server stops, 0 for no limit",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&OpenGymInterface::m_forkMaxEpisodes),
+                   MakeUintegerChecker<uint32_t> ())
     ;
   return tid;
 }
@@ -79,7 +136,11 @@ OpenGymInterface::Delete (void)
 
 OpenGymInterface::OpenGymInterface(uint32_t port):
   m_port(port), m_zmq_context(1), m_zmq_socket(m_zmq_context, ZMQ_REQ),
-  m_simEnd(false), m_stopEnvRequested(false), m_initSimMsgSent(false)
+  m_simEnd(false), m_stopEnvRequested(false), m_initSimMsgSent(false),
+  m_shmEnabled(false), m_shmSize(0),
+  m_forkMaxEpisodes(0), m_forkServerRunning(false), m_forkServerPid(0), m_episode(0),
+  m_printStepStats(true),
+  m_actionPending(false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -93,6 +154,17 @@ void
 OpenGymInterface::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  m_actionDeadlineEvent.Cancel ();
+  m_actionPollEvent.Cancel ();
+  m_flushEvent.Cancel ();
+  m_agents.clear();
+  m_agentByEnv.clear();
+  m_agentById.clear();
+  if (m_shm) {
+    m_shm->Dispose();
+    m_shm = 0;
+  }
+  m_agent = 0;
 }
 
 void
@@ -101,6 +173,89 @@ OpenGymInterface::DoInitialize (void)
   NS_LOG_FUNCTION (this);
 }
 
+void
+OpenGymInterface::NotifyConstructionCompleted (void)
+{
+  NS_LOG_FUNCTION (this);
+  Object::NotifyConstructionCompleted ();
+  if (m_forkTime.IsStrictlyPositive()) {
+    NS_ABORT_MSG_IF (m_forkTime < Simulator::Now(), "ForkServerTime is in the past");
+    m_forkServerRunning = true;
+    Simulator::Schedule (m_forkTime - Simulator::Now(), &OpenGymInterface::RunForkServer, this);
+  }
+}
+
+void
+OpenGymInterface::SetAgent(Ptr<OpenGymAgent> agent)
+{
+  NS_LOG_FUNCTION (this << agent);
+  NS_ABORT_MSG_IF (m_initSimMsgSent, "The agent has to be set before the first state is sent");
+  NS_ABORT_MSG_IF (IsMultiAgent(), "Multi-agent mode does not support in-process agents");
+  m_agent = agent;
+}
+
+Ptr<OpenGymAgent>
+OpenGymInterface::GetAgent() const
+{
+  return m_agent;
+}
+
+void
+OpenGymInterface::SetForkCallback(Callback<void, uint32_t> cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_forkCb = cb;
+}
+
+void
+OpenGymInterface::RunForkServer()
+{
+  NS_LOG_FUNCTION (this);
+  // the server itself never talks to the agent, so the zmq socket is
+  // still unconnected here and each episode process connects its own
+  uint32_t baseRun = RngSeedManager::GetRun ();
+  m_forkServerPid = ::getpid();
+  NS_LOG_UNCOND("Fork server process id: " << m_forkServerPid << ", warm-up finished at " << Simulator::Now().GetSeconds() << "s");
+
+  for (uint32_t episode = 0; m_forkMaxEpisodes == 0 || episode < m_forkMaxEpisodes; episode++) {
+    // do not let the child inherit unflushed output
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(NULL);
+
+    pid_t pid = ::fork();
+    NS_ABORT_MSG_IF (pid < 0, "fork() failed");
+
+    if (pid == 0) {
+      // the inherited zmq context refers to I/O threads that only exist in
+      // the parent; tearing it down here could block, so leave it behind
+      // and build a fresh context and socket in place
+      new (&m_zmq_context) zmq::context_t(1);
+      new (&m_zmq_socket) zmq::socket_t(m_zmq_context, ZMQ_REQ);
+
+      m_forkServerRunning = false;
+      m_episode = episode;
+      RngSeedManager::SetRun (baseRun + episode + 1);
+      if (!m_forkCb.IsNull()) {
+        m_forkCb(episode);
+      }
+      // continue the simulation as this episode
+      return;
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      NS_LOG_UNCOND("Episode process " << pid << " did not exit cleanly, stopping fork server");
+      break;
+    }
+  }
+
+  Simulator::Stop();
+  Simulator::Destroy ();
+  std::exit(0);
+}
+
 void
 OpenGymInterface::SetGetActionSpaceCb(Callback< Ptr<OpenGymSpace> > cb)
 {
@@ -150,6 +305,13 @@ OpenGymInterface::SetExecuteActionsCb(Callback<bool, Ptr<OpenGymDataContainer> >
   m_actionCb = cb;
 }
 
+void
+OpenGymInterface::SetCoalescingCb(Callback<void, uint32_t, Time> cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_coalescingCb = cb;
+}
+
 void 
 OpenGymInterface::Init()
 {
@@ -160,6 +322,12 @@ OpenGymInterface::Init()
   }
   m_initSimMsgSent = true;
 
+  if (m_agent) {
+    NS_LOG_UNCOND("Simulation process id: " << ::getpid() << ", using in-process agent " << m_agent->GetInstanceTypeId().GetName());
+    m_agent->Init(GetObservationSpace(), GetActionSpace());
+    return;
+  }
+
   std::string connectAddr = "tcp://localhost:" + std::to_string(m_port);
   zmq_connect ((void*)m_zmq_socket, connectAddr.c_str());
 
@@ -173,6 +341,23 @@ OpenGymInterface::Init()
   ns3opengym::SimInitMsg simInitMsg;
   simInitMsg.set_simprocessid(::getpid());
   simInitMsg.set_wafshellprocessid(::getppid());
+  if (m_forkServerPid) {
+    simInitMsg.set_forkserverprocessid(m_forkServerPid);
+    simInitMsg.set_episode(m_episode);
+  }
+
+  for (auto i = m_agents.begin(); i != m_agents.end(); ++i) {
+    ns3opengym::AgentSpaces *agentSpaces = simInitMsg.add_agents();
+    agentSpaces->set_agentid(i->id);
+    Ptr<OpenGymSpace> agentObsSpace = i->env->GetObservationSpace();
+    if (agentObsSpace) {
+      *agentSpaces->mutable_obsspace() = agentObsSpace->GetSpaceDescription();
+    }
+    Ptr<OpenGymSpace> agentActSpace = i->env->GetActionSpace();
+    if (agentActSpace) {
+      *agentSpaces->mutable_actspace() = agentActSpace->GetSpaceDescription();
+    }
+  }
 
   if (obsSpace) {
     ns3opengym::SpaceDescription spaceDesc;
@@ -186,6 +371,20 @@ OpenGymInterface::Init()
     simInitMsg.mutable_actspace()->CopyFrom(spaceDesc);
   }
 
+  if (m_shmEnabled) {
+    std::string shmName = "/ns3gym-" + std::to_string(::getpid()) + "-" + std::to_string(m_port);
+    m_shm = CreateObject<OpenGymShmRegion> (shmName, m_shmSize);
+    if (m_shm->Open()) {
+      NS_LOG_UNCOND("Using shared memory region: " << shmName);
+      simInitMsg.set_shmname(shmName);
+      simInitMsg.set_shmsize(m_shm->GetSize());
+      simInitMsg.set_shmactoffset(m_shm->GetActionOffset());
+    } else {
+      NS_LOG_WARN("Cannot create shared memory region, falling back to ZMQ only");
+      m_shm = 0;
+    }
+  }
+
   // send init msg to python
   zmq::message_t request(simInitMsg.ByteSize());;
   simInitMsg.SerializeToArray(request.data(), simInitMsg.ByteSize());
@@ -215,6 +414,11 @@ OpenGymInterface::NotifyCurrentState()
 {
   NS_LOG_FUNCTION (this);
 
+  // no agent during the warm-up of the fork server
+  if (m_forkServerRunning) {
+    return;
+  }
+
   if (!m_initSimMsgSent) {
     Init();
   }
@@ -223,23 +427,53 @@ OpenGymInterface::NotifyCurrentState()
     return;
   }
 
+  if (m_agent) {
+    NotifyAgent();
+    return;
+  }
+
+  if (IsMultiAgent()) {
+    // all agents step
+    for (uint32_t i = 0; i < m_agents.size(); i++) {
+      if (!m_agents[i].pending) {
+        m_agents[i].pending = true;
+        m_pendingAgents.push_back(i);
+      }
+    }
+    m_flushEvent.Cancel();
+    FlushAgentStates();
+    return;
+  }
+
+  // the agent has to answer the previous state before a new one is sent
+  if (m_actionPending) {
+    ReceiveActions(true);
+  }
+
   // collect current env state
+  OpenGymStepStats::Clock::time_point t = OpenGymStepStats::Clock::now();
   Ptr<OpenGymDataContainer> obsDataContainer = GetObservation();
   float reward = GetReward();
   bool isGameOver = IsGameOver();
   std::string extraInfo = GetExtraInfo();
+  t = m_stepStats.Add(OpenGymStepStats::OBSERVE, t);
 
-  ns3opengym::EnvStateMsg envStateMsg;
+  // the message is kept between steps, refilling it reuses its buffers
+  ns3opengym::EnvStateMsg &envStateMsg = m_envStateMsg;
   // observation
-  ns3opengym::DataContainer obsDataContainerPbMsg;
   if (obsDataContainer) {
-    obsDataContainerPbMsg = obsDataContainer->GetDataContainerPbMsg();
-    envStateMsg.mutable_obsdata()->CopyFrom(obsDataContainerPbMsg);
+    if (m_shm) {
+      m_shm->NextStep();
+    }
+    obsDataContainer->FillDataContainerPbMsg(*envStateMsg.mutable_obsdata(), m_shm);
+  } else {
+    envStateMsg.clear_obsdata();
   }
   // reward
   envStateMsg.set_reward(reward);
   // game over
   envStateMsg.set_isgameover(false);
+  envStateMsg.set_reason(ns3opengym::EnvStateMsg::SimulationEnd);
   if (isGameOver)
   {
     envStateMsg.set_isgameover(true);
@@ -253,20 +487,201 @@ OpenGymInterface::NotifyCurrentState()
   // extra info
   envStateMsg.set_info(extraInfo);
 
-  // send env state msg to python
-  zmq::message_t request(envStateMsg.ByteSize());;
-  envStateMsg.SerializeToArray(request.data(), envStateMsg.ByteSize());
+  // send env state msg to python, the buffer stays valid until the reply
+  // is received, so zmq can send it without taking a copy
+  int size = envStateMsg.ByteSize();
+  m_sendBuffer.resize(size);
+  envStateMsg.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(&m_sendBuffer[0]));
+  t = m_stepStats.Add(OpenGymStepStats::SERIALIZE, t);
+  zmq::message_t request(&m_sendBuffer[0], size, NULL, NULL);
   m_zmq_socket.send (request);
+  m_stepStats.Add(OpenGymStepStats::SEND, t);
+
+  if (m_actionDelay.IsStrictlyPositive() && !m_simEnd) {
+    // asynchronous mode: keep simulating, the action is applied later
+    m_actionPending = true;
+    m_actionDeadline = Simulator::Now() + m_actionDelay;
+    m_actionDeadlineEvent = Simulator::Schedule (m_actionDelay, &OpenGymInterface::ActionDeadline, this);
+    if (m_actionPollInterval.IsStrictlyPositive() && m_actionPollInterval < m_actionDelay) {
+      m_actionPollEvent = Simulator::Schedule (m_actionPollInterval, &OpenGymInterface::PollAction, this);
+    }
+    return;
+  }
+
+  ReceiveActions(true);
+}
+
+void
+OpenGymInterface::FinishStep()
+{
+  m_stepTimesTrace(m_stepStats.FinishStep());
+}
+
+const OpenGymStepStats&
+OpenGymInterface::GetStepStats() const
+{
+  return m_stepStats;
+}
+
+void
+OpenGymInterface::FlushAgentStates()
+{
+  NS_LOG_FUNCTION (this << m_pendingAgents.size());
+  if (m_forkServerRunning || m_pendingAgents.empty()) {
+    for (auto i = m_pendingAgents.begin(); i != m_pendingAgents.end(); ++i) {
+      m_agents[*i].pending = false;
+    }
+    m_pendingAgents.clear();
+    return;
+  }
+
+  if (!m_initSimMsgSent) {
+    Init();
+  }
+
+  if (m_stopEnvRequested) {
+    return;
+  }
+
+  if (m_shm) {
+    m_shm->NextStep();
+  }
+
+  // the elements of the repeated field are reused between exchanges
+  ns3opengym::MultiEnvStateMsg &stateMsg = m_multiStateMsg;
+  OpenGymStepStats::Clock::time_point t;
+  int count = 0;
+  for (auto i = m_pendingAgents.begin(); i != m_pendingAgents.end(); ++i) {
+    AgentEntry &agent = m_agents[*i];
+    agent.pending = false;
+
+    ns3opengym::AgentState *agentState = count < stateMsg.agents_size() ? stateMsg.mutable_agents(count) : stateMsg.add_agents();
+    count++;
+
+    t = OpenGymStepStats::Clock::now();
+    Ptr<OpenGymDataContainer> obsDataContainer = agent.env->GetObservation();
+    float reward = agent.env->GetReward();
+    bool isGameOver = agent.env->GetGameOver() || m_simEnd;
+    agentState->set_info(agent.env->GetExtraInfo());
+    t = m_stepStats.Add(OpenGymStepStats::OBSERVE, t);
+
+    agentState->set_agentid(agent.id);
+    if (obsDataContainer) {
+      obsDataContainer->FillDataContainerPbMsg(*agentState->mutable_obsdata(), m_shm);
+    } else {
+      agentState->clear_obsdata();
+    }
+    agentState->set_reward(reward);
+    agentState->set_isgameover(isGameOver);
+    m_stepStats.Add(OpenGymStepStats::SERIALIZE, t);
+  }
+  m_pendingAgents.clear();
+  while (stateMsg.agents_size() > count) {
+    stateMsg.mutable_agents()->RemoveLast();
+  }
+  stateMsg.set_isgameover(m_simEnd);
+  stateMsg.set_reason(ns3opengym::EnvStateMsg::SimulationEnd);
+
+  t = OpenGymStepStats::Clock::now();
+  int size = stateMsg.ByteSize();
+  m_sendBuffer.resize(size);
+  stateMsg.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(&m_sendBuffer[0]));
+  t = m_stepStats.Add(OpenGymStepStats::SERIALIZE, t);
+  zmq::message_t request(&m_sendBuffer[0], size, NULL, NULL);
+  m_zmq_socket.send (request);
+  t = m_stepStats.Add(OpenGymStepStats::SEND, t);
+
+  zmq::message_t reply;
+  m_zmq_socket.recv (&reply);
+  t = m_stepStats.Add(OpenGymStepStats::WAIT, t);
+  ns3opengym::MultiEnvActMsg &actMsg = m_multiActMsg;
+  actMsg.ParseFromArray(reply.data(), reply.size());
+
+  if (m_simEnd) {
+    m_stepStats.Add(OpenGymStepStats::DESERIALIZE, t);
+    FinishStep();
+    return;
+  }
+
+  if (actMsg.stopsimreq()) {
+    NS_LOG_DEBUG("---Stop requested");
+    m_stopEnvRequested = true;
+    Simulator::Stop();
+    Simulator::Destroy ();
+    std::exit(0);
+  }
+
+  for (int i = 0; i < actMsg.actions_size(); i++) {
+    ns3opengym::AgentAction &action = *actMsg.mutable_actions(i);
+    auto agent = m_agentById.find(action.agentid());
+    if (agent == m_agentById.end()) {
+      NS_LOG_WARN("Action for unknown agent " << action.agentid());
+      continue;
+    }
+    Ptr<OpenGymDataContainer> actDataContainer = OpenGymDataContainer::CreateFromDataContainerPbMsg(*action.mutable_actdata(), m_shm);
+    t = m_stepStats.Add(OpenGymStepStats::DESERIALIZE, t);
+    m_agents[agent->second].env->ExecuteActions(actDataContainer);
+    t = m_stepStats.Add(OpenGymStepStats::EXECUTE, t);
+  }
+  FinishStep();
+}
+
+void
+OpenGymInterface::NotifyAgent()
+{
+  NS_LOG_FUNCTION (this);
+  OpenGymStepStats::Clock::time_point t = OpenGymStepStats::Clock::now();
+  Ptr<OpenGymDataContainer> obsDataContainer = GetObservation();
+  float reward = GetReward();
+  bool isGameOver = IsGameOver();
+  std::string extraInfo = GetExtraInfo();
+  t = m_stepStats.Add(OpenGymStepStats::OBSERVE, t);
+
+  // the agent's time counts as waiting for the agent
+  Ptr<OpenGymDataContainer> action = m_agent->GetAction(obsDataContainer, reward, isGameOver, extraInfo);
+  t = m_stepStats.Add(OpenGymStepStats::WAIT, t);
+  if (isGameOver) {
+    FinishStep();
+    m_agent->NotifyEpisodeEnd();
+    m_stopEnvRequested = true;
+    if (!m_simEnd) {
+      // the Python agent would stop the simulation at this point too
+      Simulator::Stop();
+    }
+    return;
+  }
+
+  if (action) {
+    ExecuteActions(action);
+    m_stepStats.Add(OpenGymStepStats::EXECUTE, t);
+  }
+  FinishStep();
+}
+
+bool
+OpenGymInterface::ReceiveActions(bool blocking)
+{
+  NS_LOG_FUNCTION (this << blocking);
 
   // receive act msg form python
   ns3opengym::EnvActMsg envActMsg;
   zmq::message_t reply;
-  m_zmq_socket.recv (&reply);
+  OpenGymStepStats::Clock::time_point t = OpenGymStepStats::Clock::now();
+  if (!m_zmq_socket.recv (&reply, blocking ? 0 : ZMQ_DONTWAIT)) {
+    return false;
+  }
+  t = m_stepStats.Add(OpenGymStepStats::WAIT, t);
   envActMsg.ParseFromArray(reply.data(), reply.size());
 
+  m_actionPending = false;
+  m_actionDeadlineEvent.Cancel ();
+  m_actionPollEvent.Cancel ();
+
   if (m_simEnd) {
     // if sim end only rx ms and quit
-    return;
+    m_stepStats.Add(OpenGymStepStats::DESERIALIZE, t);
+    FinishStep();
+    return true;
   }
 
   bool stopSim = envActMsg.stopsimreq();
@@ -278,11 +693,41 @@ OpenGymInterface::NotifyCurrentState()
     std::exit(0);
   }
 
+  if (envActMsg.has_policy() && !m_coalescingCb.IsNull()) {
+    const ns3opengym::CoalescingPolicy &policy = envActMsg.policy();
+    NS_LOG_DEBUG("---Coalescing policy: every " << policy.stepeveryevents() << " events, min interval " << policy.minstepinterval() << "s");
+    m_coalescingCb(policy.stepeveryevents(), Seconds(policy.minstepinterval()));
+  }
+
   // first step after reset is called without actions, just to get current state
   ns3opengym::DataContainer actDataContainerPbMsg = envActMsg.actdata();
-  Ptr<OpenGymDataContainer> actDataContainer = OpenGymDataContainer::CreateFromDataContainerPbMsg(actDataContainerPbMsg);
+  Ptr<OpenGymDataContainer> actDataContainer = OpenGymDataContainer::CreateFromDataContainerPbMsg(actDataContainerPbMsg, m_shm);
+  t = m_stepStats.Add(OpenGymStepStats::DESERIALIZE, t);
   ExecuteActions(actDataContainer);
+  m_stepStats.Add(OpenGymStepStats::EXECUTE, t);
+  FinishStep();
+  return true;
+}
 
+void
+OpenGymInterface::ActionDeadline()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_actionPending) {
+    ReceiveActions(true);
+  }
+}
+
+void
+OpenGymInterface::PollAction()
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_actionPending || ReceiveActions(false)) {
+    return;
+  }
+  if (Simulator::Now() + m_actionPollInterval < m_actionDeadline) {
+    m_actionPollEvent = Simulator::Schedule (m_actionPollInterval, &OpenGymInterface::PollAction, this);
+  }
 }
 
 void
@@ -297,9 +742,21 @@ void
 OpenGymInterface::NotifySimulationEnd()
 {
   NS_LOG_FUNCTION (this);
+  // in multi-agent mode every env may report the end
+  if (m_simEnd) {
+    return;
+  }
   m_simEnd = true;
-  if (m_initSimMsgSent) {
-    WaitForStop();
+  if (m_initSimMsgSent && !m_forkServerRunning) {
+    if (m_agent) {
+      // let the agent see the final state, nothing to wait for
+      NotifyCurrentState();
+    } else {
+      WaitForStop();
+    }
+    if (m_printStepStats) {
+      m_stepStats.Print(std::cout);
+    }
   }
 }
 
@@ -392,14 +849,52 @@ OpenGymInterface::Notify(Ptr<OpenGymEnv> entity)
 {
   NS_LOG_FUNCTION (this);
 
+  auto agent = m_agentByEnv.find(PeekPointer(entity));
+  if (agent != m_agentByEnv.end()) {
+    // multi-agent mode: collect all agents triggered at this time
+    AgentEntry &entry = m_agents[agent->second];
+    if (!entry.pending) {
+      entry.pending = true;
+      m_pendingAgents.push_back(agent->second);
+    }
+    if (!m_flushEvent.IsRunning()) {
+      m_flushEvent = Simulator::ScheduleNow (&OpenGymInterface::FlushAgentStates, this);
+    }
+    return;
+  }
+
   SetGetGameOverCb( MakeCallback (&OpenGymEnv::GetGameOver, entity) );
   SetGetObservationCb( MakeCallback (&OpenGymEnv::GetObservation, entity) );
   SetGetRewardCb( MakeCallback (&OpenGymEnv::GetReward, entity) );
   SetGetExtraInfoCb( MakeCallback (&OpenGymEnv::GetExtraInfo, entity) );
   SetExecuteActionsCb( MakeCallback (&OpenGymEnv::ExecuteActions, entity) );
+  SetCoalescingCb( MakeCallback (&OpenGymEnv::SetCoalescing, entity) );
 
   NotifyCurrentState();
 }
 
+void
+OpenGymInterface::RegisterAgent(std::string agentId, Ptr<OpenGymEnv> env)
+{
+  NS_LOG_FUNCTION (this << agentId << env);
+  NS_ABORT_MSG_IF (m_initSimMsgSent, "Agents have to be registered before the first state is sent");
+  NS_ABORT_MSG_IF (m_agent, "Multi-agent mode does not support in-process agents");
+  NS_ABORT_MSG_IF (m_agentById.count(agentId), "Agent " << agentId << " registered twice");
+
+  AgentEntry entry;
+  entry.id = agentId;
+  entry.env = env;
+  entry.pending = false;
+  m_agentById[agentId] = m_agents.size();
+  m_agentByEnv[PeekPointer(env)] = m_agents.size();
+  m_agents.push_back(entry);
+}
+
+bool
+OpenGymInterface::IsMultiAgent() const
+{
+  return !m_agents.empty();
+}
+
 }
 
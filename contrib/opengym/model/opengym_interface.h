@@ -23,6 +23,12 @@
 #define OPENGYM_INTERFACE_H
 
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "opengym_stats.h"
+#include "messages.pb.h"
+#include <map>
 #include <zmq.hpp>
 
 namespace ns3 {
@@ -30,6 +36,8 @@ namespace ns3 {
 class OpenGymSpace;
 class OpenGymDataContainer;
 class OpenGymEnv;
+class OpenGymShmRegion;
+class OpenGymAgent;
 
 class OpenGymInterface : public Object
 {
@@ -62,18 +70,47 @@ public:
   void SetGetGameOverCb(Callback< bool > cb);
   void SetGetExtraInfoCb(Callback<std::string> cb);
   void SetExecuteActionsCb(Callback<bool, Ptr<OpenGymDataContainer> > cb);
+  void SetCoalescingCb(Callback<void, uint32_t, Time> cb);
 
   void Notify(Ptr<OpenGymEnv> entity);
 
+  // Multi-agent mode: every registered env is an agent with its own spaces.
+  // Agents notifying at the same simulated time are sent to Python in one
+  // message at the end of that time, and get their actions from one reply.
+  void RegisterAgent(std::string agentId, Ptr<OpenGymEnv> env);
+  bool IsMultiAgent() const;
+
+  // act with the given in-process agent instead of the Python one
+  void SetAgent(Ptr<OpenGymAgent> agent);
+  Ptr<OpenGymAgent> GetAgent() const;
+
+  // timing statistics of the steps so far
+  const OpenGymStepStats& GetStepStats() const;
+
+  typedef void (* StepTimesTracedCallback)(const OpenGymStepStats::StepTimes &times);
+
+  // called in every episode process right after the fork, with the episode number
+  void SetForkCallback(Callback<void, uint32_t> cb);
+
 protected:
   // Inherited
   virtual void DoInitialize (void);
   virtual void DoDispose (void);
+  virtual void NotifyConstructionCompleted (void);
 
 private:
   static Ptr<OpenGymInterface> *DoGet (uint32_t port=5555);
   static void Delete (void);
 
+  void RunForkServer();
+
+  void NotifyAgent();
+  void FlushAgentStates();
+  void FinishStep();
+  bool ReceiveActions(bool blocking);
+  void ActionDeadline();
+  void PollAction();
+
   uint32_t m_port;
   zmq::context_t m_zmq_context;
   zmq::socket_t m_zmq_socket;
@@ -82,6 +119,33 @@ private:
   bool m_stopEnvRequested;
   bool m_initSimMsgSent;
 
+  bool m_shmEnabled;
+  uint32_t m_shmSize;
+  Ptr<OpenGymShmRegion> m_shm;
+
+  Ptr<OpenGymAgent> m_agent;
+
+  Time m_forkTime;
+  uint32_t m_forkMaxEpisodes;
+  bool m_forkServerRunning;
+  uint32_t m_forkServerPid;
+  uint32_t m_episode;
+  Callback<void, uint32_t> m_forkCb;
+
+  bool m_printStepStats;
+  OpenGymStepStats m_stepStats;
+  TracedCallback<const OpenGymStepStats::StepTimes &> m_stepTimesTrace;
+
+  ns3opengym::EnvStateMsg m_envStateMsg;
+  std::string m_sendBuffer;
+
+  Time m_actionDelay;
+  Time m_actionPollInterval;
+  bool m_actionPending;
+  Time m_actionDeadline;
+  EventId m_actionDeadlineEvent;
+  EventId m_actionPollEvent;
+
   Callback< Ptr<OpenGymSpace> > m_actionSpaceCb;
   Callback< Ptr<OpenGymSpace> > m_observationSpaceCb;
   Callback< bool > m_gameOverCb;
@@ -89,6 +153,21 @@ private:
   Callback<float> m_rewardCb;
   Callback<std::string> m_extraInfoCb;
   Callback<bool, Ptr<OpenGymDataContainer> > m_actionCb;
+  Callback<void, uint32_t, Time> m_coalescingCb;
+
+  struct AgentEntry
+  {
+    std::string id;
+    Ptr<OpenGymEnv> env;
+    bool pending;
+  };
+  std::vector<AgentEntry> m_agents;
+  std::map<OpenGymEnv*, uint32_t> m_agentByEnv;
+  std::map<std::string, uint32_t> m_agentById;
+  std::vector<uint32_t> m_pendingAgents;
+  EventId m_flushEvent;
+  ns3opengym::MultiEnvStateMsg m_multiStateMsg;
+  ns3opengym::MultiEnvActMsg m_multiActMsg;
 };
 
 } // end of namespace ns3
@@ -0,0 +1,191 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "ns3/log.h"
+#include "opengym_shm.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("OpenGymShmRegion");
+
+NS_OBJECT_ENSURE_REGISTERED (OpenGymShmRegion);
+
+// keep every block 8-byte aligned, so that it can be viewed as any dtype
+static const uint64_t SHM_ALIGN = 8;
+
+TypeId
+OpenGymShmRegion::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::OpenGymShmRegion")
+    .SetParent<Object> ()
+    .SetGroupName ("OpenGym")
+    .AddConstructor<OpenGymShmRegion> ()
+    ;
+  return tid;
+}
+
+OpenGymShmRegion::OpenGymShmRegion ()
+  : m_size (0), m_base (0), m_halfSize (0), m_half (0), m_writePos (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+OpenGymShmRegion::OpenGymShmRegion (std::string name, uint64_t size)
+  : m_name (name), m_size (size), m_base (0), m_halfSize (0), m_half (0), m_writePos (0)
+{
+  NS_LOG_FUNCTION (this << name << size);
+  // 3/4 of the region for the two observation halves, the rest for actions
+  m_halfSize = ((m_size / 4 * 3) / 2) & ~(SHM_ALIGN - 1);
+}
+
+OpenGymShmRegion::~OpenGymShmRegion ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+OpenGymShmRegion::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+void
+OpenGymShmRegion::DoInitialize (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+OpenGymShmRegion::Open ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_base)
+    {
+      return true;
+    }
+
+  int fd = shm_open (m_name.c_str (), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+    {
+      NS_LOG_WARN ("shm_open(" << m_name << ") failed: " << std::strerror (errno));
+      return false;
+    }
+
+  if (ftruncate (fd, m_size) != 0)
+    {
+      NS_LOG_WARN ("ftruncate(" << m_name << ") failed: " << std::strerror (errno));
+      close (fd);
+      shm_unlink (m_name.c_str ());
+      return false;
+    }
+
+  void *addr = mmap (0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (addr == MAP_FAILED)
+    {
+      NS_LOG_WARN ("mmap(" << m_name << ") failed: " << std::strerror (errno));
+      shm_unlink (m_name.c_str ());
+      return false;
+    }
+
+  m_base = static_cast<uint8_t*> (addr);
+  m_half = 0;
+  m_writePos = 0;
+  return true;
+}
+
+void
+OpenGymShmRegion::Close ()
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_base)
+    {
+      return;
+    }
+  munmap (m_base, m_size);
+  // the agent usually unlinks the name right after mapping it
+  shm_unlink (m_name.c_str ());
+  m_base = 0;
+}
+
+bool
+OpenGymShmRegion::IsOpen () const
+{
+  return m_base != 0;
+}
+
+std::string
+OpenGymShmRegion::GetName () const
+{
+  return m_name;
+}
+
+uint64_t
+OpenGymShmRegion::GetSize () const
+{
+  return m_size;
+}
+
+uint64_t
+OpenGymShmRegion::GetActionOffset () const
+{
+  return 2 * m_halfSize;
+}
+
+void
+OpenGymShmRegion::NextStep ()
+{
+  m_half = 1 - m_half;
+  m_writePos = 0;
+}
+
+uint8_t*
+OpenGymShmRegion::AllocateObservation (uint64_t length, uint64_t &offset)
+{
+  uint64_t aligned = (length + SHM_ALIGN - 1) & ~(SHM_ALIGN - 1);
+  if (!m_base || aligned > m_halfSize - m_writePos)
+    {
+      return 0;
+    }
+  offset = m_half * m_halfSize + m_writePos;
+  m_writePos += aligned;
+  return m_base + offset;
+}
+
+const uint8_t*
+OpenGymShmRegion::GetPointer (uint64_t offset, uint64_t length) const
+{
+  if (!m_base || offset > m_size || length > m_size - offset)
+    {
+      return 0;
+    }
+  return m_base + offset;
+}
+
+}
@@ -0,0 +1,80 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#ifndef OPENGYM_SHM_H
+#define OPENGYM_SHM_H
+
+#include "ns3/object.h"
+
+namespace ns3 {
+
+/**
+ * POSIX shared memory region used to exchange box data with the Python
+ * agent without serializing it into the ZMQ messages.
+ *
+ * The region is split into two observation halves, used alternately on
+ * consecutive steps, followed by an action area written by the agent.
+ * Alternating the halves keeps the previous observation intact while
+ * the next one is written, so the agent may keep a view on it for one
+ * more step.
+ */
+class OpenGymShmRegion : public Object
+{
+public:
+  OpenGymShmRegion ();
+  OpenGymShmRegion (std::string name, uint64_t size);
+  virtual ~OpenGymShmRegion ();
+
+  static TypeId GetTypeId ();
+
+  bool Open ();
+  void Close ();
+  bool IsOpen () const;
+
+  std::string GetName () const;
+  uint64_t GetSize () const;
+  uint64_t GetActionOffset () const;
+
+  // switch to the other observation half, called once per step
+  void NextStep ();
+  // returns 0 if there is no room left in the current observation half
+  uint8_t* AllocateObservation (uint64_t length, uint64_t &offset);
+  // returns 0 if [offset, offset+length) is not inside the region
+  const uint8_t* GetPointer (uint64_t offset, uint64_t length) const;
+
+protected:
+  // Inherited
+  virtual void DoInitialize (void);
+  virtual void DoDispose (void);
+
+private:
+  std::string m_name;
+  uint64_t m_size;
+  uint8_t *m_base;
+
+  uint64_t m_halfSize;
+  uint32_t m_half;
+  uint64_t m_writePos;
+};
+
+} // end of namespace ns3
+
+#endif /* OPENGYM_SHM_H */
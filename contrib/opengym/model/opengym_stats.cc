@@ -0,0 +1,190 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#include <cstring>
+#include <iomanip>
+#include "ns3/simulator.h"
+#include "opengym_stats.h"
+
+namespace ns3 {
+
+OpenGymStepStats::OpenGymStepStats ()
+{
+  Reset ();
+}
+
+const char*
+OpenGymStepStats::GetStageName (Stage stage)
+{
+  switch (stage)
+    {
+    case OBSERVE:
+      return "observe";
+    case SERIALIZE:
+      return "serialize";
+    case SEND:
+      return "send";
+    case WAIT:
+      return "wait";
+    case DESERIALIZE:
+      return "deserialize";
+    case EXECUTE:
+      return "execute";
+    default:
+      return "unknown";
+    }
+}
+
+void
+OpenGymStepStats::Reset ()
+{
+  std::memset (m_stages, 0, sizeof (m_stages));
+  std::memset (&m_current, 0, sizeof (m_current));
+  m_steps = 0;
+  m_started = false;
+}
+
+OpenGymStepStats::Clock::time_point
+OpenGymStepStats::Add (Stage stage, Clock::time_point start)
+{
+  Clock::time_point now = Clock::now ();
+  double us = std::chrono::duration<double, std::micro> (now - start).count ();
+  m_current.us[stage] += us;
+
+  StageStats &stats = m_stages[stage];
+  stats.count++;
+  stats.sum += us;
+  if (us > stats.max)
+    {
+      stats.max = us;
+    }
+  // bucket 0 is below 1us, bucket i covers [2^(i-1), 2^i) us
+  uint32_t bucket = 0;
+  for (double limit = 1.0; us >= limit && bucket < HIST_BUCKETS - 1; limit *= 2)
+    {
+      bucket++;
+    }
+  stats.hist[bucket]++;
+  return now;
+}
+
+const OpenGymStepStats::StepTimes&
+OpenGymStepStats::FinishStep ()
+{
+  Clock::time_point now = Clock::now ();
+  if (!m_started)
+    {
+      m_started = true;
+      m_wallStart = now;
+      m_simStart = Simulator::Now ();
+    }
+  m_wallLast = now;
+  m_simLast = Simulator::Now ();
+  m_steps++;
+
+  m_last = m_current;
+  std::memset (&m_current, 0, sizeof (m_current));
+  return m_last;
+}
+
+uint64_t
+OpenGymStepStats::GetCount (Stage stage) const
+{
+  return m_stages[stage].count;
+}
+
+double
+OpenGymStepStats::GetMean (Stage stage) const
+{
+  const StageStats &stats = m_stages[stage];
+  return stats.count ? stats.sum / stats.count : 0.0;
+}
+
+double
+OpenGymStepStats::GetMax (Stage stage) const
+{
+  return m_stages[stage].max;
+}
+
+uint64_t
+OpenGymStepStats::GetSteps () const
+{
+  return m_steps;
+}
+
+double
+OpenGymStepStats::GetStepsPerWallSecond () const
+{
+  if (m_steps < 2)
+    {
+      return 0.0;
+    }
+  double seconds = std::chrono::duration<double> (m_wallLast - m_wallStart).count ();
+  return seconds > 0 ? (m_steps - 1) / seconds : 0.0;
+}
+
+double
+OpenGymStepStats::GetSimSecondsPerStep () const
+{
+  if (m_steps < 2)
+    {
+      return 0.0;
+    }
+  return (m_simLast - m_simStart).GetSeconds () / (m_steps - 1);
+}
+
+void
+OpenGymStepStats::Print (std::ostream &os) const
+{
+  std::ios::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << "OpenGym step stats: " << m_steps << " steps, "
+     << GetStepsPerWallSecond () << " steps/wall-s, "
+     << GetSimSecondsPerStep () << " sim-s/step" << std::endl;
+  os << "  " << std::left << std::setw (12) << "stage" << std::right
+     << std::setw (10) << "count" << std::setw (14) << "total[ms]"
+     << std::setw (12) << "mean[us]" << std::setw (12) << "max[us]"
+     << "  histogram (<1us, <2us, <4us, ...)" << std::endl;
+  for (uint32_t s = 0; s < NUM_STAGES; s++)
+    {
+      const StageStats &stats = m_stages[s];
+      os << "  " << std::left << std::setw (12) << GetStageName (static_cast<Stage> (s)) << std::right
+         << std::setw (10) << stats.count
+         << std::setw (14) << std::fixed << std::setprecision (3) << stats.sum / 1000.0
+         << std::setw (12) << std::setprecision (1) << GetMean (static_cast<Stage> (s))
+         << std::setw (12) << stats.max << " ";
+      // print up to the last non-empty bucket
+      int32_t last = HIST_BUCKETS - 1;
+      while (last >= 0 && stats.hist[last] == 0)
+        {
+          last--;
+        }
+      for (int32_t b = 0; b <= last; b++)
+        {
+          os << " " << stats.hist[b];
+        }
+      os << std::endl;
+    }
+  os.flags (flags);
+  os.precision (precision);
+}
+
+} // namespace ns3
@@ -0,0 +1,106 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 Piotr Gawlowicz
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Piotr Gawlowicz <gawlowicz.p@gmail.com>
+ *
+ */
+
+#ifndef OPENGYM_STATS_H
+#define OPENGYM_STATS_H
+
+#include "ns3/nstime.h"
+#include <chrono>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * Wall clock time spent in the stages of the gym steps, to tell whether
+ * a run is bound by the simulation, by the encoding or by the agent.
+ *
+ * Every stage keeps a count, sum and maximum and a histogram with
+ * power of two buckets in microseconds. Adding a sample is a few
+ * arithmetic operations, so the statistics are always collected.
+ */
+class OpenGymStepStats
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum Stage
+  {
+    OBSERVE = 0,  // observation, reward, game over and info callbacks
+    SERIALIZE,    // encoding of the state message
+    SEND,
+    WAIT,         // blocking until the reply of the agent arrived
+    DESERIALIZE,  // decoding of the action message
+    EXECUTE,      // ExecuteActions callbacks
+    NUM_STAGES
+  };
+
+  // times of a single step in microseconds, passed to the trace source
+  struct StepTimes
+  {
+    double us[NUM_STAGES];
+  };
+
+  OpenGymStepStats ();
+
+  static const char* GetStageName (Stage stage);
+
+  void Reset ();
+
+  // add the time from start until now to the stage of the current step
+  // and return now, so that consecutive stages can be chained
+  Clock::time_point Add (Stage stage, Clock::time_point start);
+  // close the current step and return its times
+  const StepTimes& FinishStep ();
+
+  uint64_t GetCount (Stage stage) const;
+  double GetMean (Stage stage) const;
+  double GetMax (Stage stage) const;
+  uint64_t GetSteps () const;
+  double GetStepsPerWallSecond () const;
+  double GetSimSecondsPerStep () const;
+
+  void Print (std::ostream &os) const;
+
+private:
+  static const uint32_t HIST_BUCKETS = 24;
+
+  struct StageStats
+  {
+    uint64_t count;
+    double sum;
+    double max;
+    uint64_t hist[HIST_BUCKETS];
+  };
+
+  StageStats m_stages[NUM_STAGES];
+  StepTimes m_current;
+  StepTimes m_last;
+  uint64_t m_steps;
+  bool m_started;
+  Clock::time_point m_wallStart;
+  Clock::time_point m_wallLast;
+  Time m_simStart;
+  Time m_simLast;
+};
+
+} // end of namespace ns3
+
+#endif /* OPENGYM_STATS_H */
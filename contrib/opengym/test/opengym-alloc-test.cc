@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+// Refill a reused box container and serialize it into a reused protobuf
+// message, the way OpenGymInterface does every step, and check that the
+// steady state does not touch the heap.
+//
+// This is a program of its own rather than a case of the opengym suite:
+// counting needs a replaced global operator new, which would apply to
+// every suite linked into test-runner.  It exits with a non-zero status
+// on failure.
+
+#include "ns3/opengym-module.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+using namespace ns3;
+
+// Counting allocator: the global operator new counts calls while
+// g_countAllocations is set and behaves like the default one otherwise.
+static bool g_countAllocations = false;
+static uint64_t g_allocations = 0;
+
+void*
+operator new (std::size_t size)
+{
+  if (g_countAllocations)
+    {
+      g_allocations++;
+    }
+  void *ptr = std::malloc (size ? size : 1);
+  if (!ptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return ptr;
+}
+
+void
+operator delete (void *ptr) noexcept
+{
+  std::free (ptr);
+}
+
+static void
+Step (Ptr<OpenGymBoxContainer<float> > box, Ptr<OpenGymBoxContainer<uint64_t> > wideBox,
+      ns3opengym::EnvStateMsg &msg, ns3opengym::DataContainer &wideMsg, uint32_t step)
+{
+  box->Clear ();
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      box->AddValue (step + i * 0.5f);
+    }
+  box->FillDataContainerPbMsg (*msg.mutable_obsdata (), 0);
+
+  wideBox->Clear ();
+  for (uint32_t i = 0; i < 15; i++)
+    {
+      wideBox->AddValue (step * i);
+    }
+  wideBox->FillDataContainerPbMsg (wideMsg, 0);
+  msg.set_reward (step);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Ptr<OpenGymBoxContainer<float> > box = CreateObject<OpenGymBoxContainer<float> > (std::vector<uint32_t> (1, 1000));
+  Ptr<OpenGymBoxContainer<uint64_t> > wideBox = CreateObject<OpenGymBoxContainer<uint64_t> > (std::vector<uint32_t> (1, 15));
+  ns3opengym::EnvStateMsg msg;
+  ns3opengym::DataContainer wideMsg;
+
+  // first step sizes all buffers
+  Step (box, wideBox, msg, wideMsg, 0);
+
+  g_allocations = 0;
+  g_countAllocations = true;
+  for (uint32_t step = 1; step < 10; step++)
+    {
+      Step (box, wideBox, msg, wideMsg, step);
+    }
+  g_countAllocations = false;
+
+  int status = 0;
+  if (g_allocations != 0)
+    {
+      std::cerr << "steady state observation path allocated memory "
+                << g_allocations << " times" << std::endl;
+      status = 1;
+    }
+
+  ns3opengym::BoxDataContainer boxMsg;
+  msg.obsdata ().data ().UnpackTo (&boxMsg);
+  if (boxMsg.rawdata ().size () != 1000 * sizeof (float))
+    {
+      std::cerr << "wrong payload size " << boxMsg.rawdata ().size () << std::endl;
+      return 1;
+    }
+  float last;
+  std::memcpy (&last, boxMsg.rawdata ().data () + 999 * sizeof (float), sizeof (float));
+  if (std::fabs (last - (9 + 999 * 0.5f)) > 0.001)
+    {
+      std::cerr << "payload not refreshed" << std::endl;
+      status = 1;
+    }
+  return status;
+}
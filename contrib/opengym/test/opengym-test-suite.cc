@@ -5,6 +5,11 @@
 
 // An essential include is test.h
 #include "ns3/test.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+
+#include <sstream>
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
@@ -46,6 +51,297 @@ OpengymTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Encode box containers to protobuf and back, for the packed rawData path
+// (native dtype layout) and the repeated field fallback (other types).
+class OpengymBoxCodecTestCase : public TestCase
+{
+public:
+  OpengymBoxCodecTestCase ();
+  virtual ~OpengymBoxCodecTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+OpengymBoxCodecTestCase::OpengymBoxCodecTestCase ()
+  : TestCase ("Opengym box container protobuf round trip")
+{
+}
+
+OpengymBoxCodecTestCase::~OpengymBoxCodecTestCase ()
+{
+}
+
+void
+OpengymBoxCodecTestCase::DoRun (void)
+{
+  std::vector<uint32_t> shape = {2, 3};
+  Ptr<OpenGymBoxContainer<float> > box = CreateObject<OpenGymBoxContainer<float> > (shape);
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      box->AddValue (i * 1.5f);
+    }
+
+  ns3opengym::DataContainer msg = box->GetDataContainerPbMsg ();
+  ns3opengym::BoxDataContainer boxMsg;
+  msg.data ().UnpackTo (&boxMsg);
+  NS_TEST_ASSERT_MSG_EQ (boxMsg.rawdata ().size (), 6 * sizeof (float), "float box not packed as raw bytes");
+  NS_TEST_ASSERT_MSG_EQ (boxMsg.floatdata_size (), 0, "float box also filled repeated field");
+
+  Ptr<OpenGymBoxContainer<float> > decoded = DynamicCast<OpenGymBoxContainer<float> > (OpenGymDataContainer::CreateFromDataContainerPbMsg (msg));
+  NS_TEST_ASSERT_MSG_NE (decoded, 0, "decoded container has wrong type");
+  NS_TEST_ASSERT_MSG_EQ ((decoded->GetShape () == shape), true, "shape not preserved");
+  NS_TEST_ASSERT_MSG_EQ ((decoded->GetData () == box->GetData ()), true, "data not preserved");
+
+  Ptr<OpenGymBoxContainer<int8_t> > smallBox = CreateObject<OpenGymBoxContainer<int8_t> > (std::vector<uint32_t> (1, 3));
+  smallBox->AddValue (-1);
+  smallBox->AddValue (0);
+  smallBox->AddValue (7);
+
+  msg = smallBox->GetDataContainerPbMsg ();
+  msg.data ().UnpackTo (&boxMsg);
+  NS_TEST_ASSERT_MSG_EQ (boxMsg.rawdata ().empty (), true, "int8 box must not use raw bytes");
+  NS_TEST_ASSERT_MSG_EQ (boxMsg.intdata_size (), 3, "int8 box not sent as repeated int32");
+
+  Ptr<OpenGymBoxContainer<int32_t> > decodedInt = DynamicCast<OpenGymBoxContainer<int32_t> > (OpenGymDataContainer::CreateFromDataContainerPbMsg (msg));
+  NS_TEST_ASSERT_MSG_NE (decodedInt, 0, "decoded container has wrong type");
+  NS_TEST_ASSERT_MSG_EQ (decodedInt->GetValue (0), -1, "wrong value");
+  NS_TEST_ASSERT_MSG_EQ (decodedInt->GetValue (2), 7, "wrong value");
+}
+
+// Evaluate the in-process agents without an interface: a hand computed
+// MLP forward pass and a tabular agent learning a two-armed bandit.
+class OpengymAgentTestCase : public TestCase
+{
+public:
+  OpengymAgentTestCase ();
+  virtual ~OpengymAgentTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+OpengymAgentTestCase::OpengymAgentTestCase ()
+  : TestCase ("Opengym in-process agents")
+{
+}
+
+OpengymAgentTestCase::~OpengymAgentTestCase ()
+{
+}
+
+void
+OpengymAgentTestCase::DoRun (void)
+{
+  std::vector<uint32_t> obsShape = {2};
+  Ptr<OpenGymSpace> obsSpace = CreateObject<OpenGymBoxSpace> (-10.0, 10.0, obsShape, TypeNameGet<float> ());
+  Ptr<OpenGymSpace> actSpace = CreateObject<OpenGymDiscreteSpace> (3);
+
+  std::istringstream weights (
+    "# 2-2-3 network\n"
+    "layer 2 2 relu\n"
+    "1 0\n"
+    "0 -1\n"
+    "0 0.5\n"
+    "layer 2 3 linear\n"
+    "1 1\n"
+    "-1 0\n"
+    "0 2\n"
+    "0 0 0\n");
+  Ptr<OpenGymMlpAgent> mlp = CreateObject<OpenGymMlpAgent> ();
+  NS_TEST_ASSERT_MSG_EQ (mlp->LoadWeights (weights), true, "cannot parse weights");
+  mlp->Init (obsSpace, actSpace);
+
+  // hidden = relu(x0, -x1 + 0.5)
+  std::vector<double> input = {2.0, -1.0};
+  std::vector<double> out = mlp->Evaluate (input);
+  NS_TEST_ASSERT_MSG_EQ (out.size (), 3, "wrong output size");
+  NS_TEST_ASSERT_MSG_EQ_TOL (out[0], 3.5, 1e-9, "wrong output 0");
+  NS_TEST_ASSERT_MSG_EQ_TOL (out[1], -2.0, 1e-9, "wrong output 1");
+  NS_TEST_ASSERT_MSG_EQ_TOL (out[2], 3.0, 1e-9, "wrong output 2");
+
+  Ptr<OpenGymBoxContainer<float> > obs = CreateObject<OpenGymBoxContainer<float> > (obsShape);
+  obs->AddValue (0.0f);
+  obs->AddValue (-2.0f);
+  Ptr<OpenGymDiscreteContainer> action = DynamicCast<OpenGymDiscreteContainer> (mlp->GetAction (obs, 0, false, ""));
+  NS_TEST_ASSERT_MSG_NE (action, 0, "no discrete action");
+  NS_TEST_ASSERT_MSG_EQ (action->GetValue (), 2, "MLP action is not the argmax");
+
+  // only arm 1 pays off, the reward is given on the next step
+  Ptr<OpenGymSpace> banditSpace = CreateObject<OpenGymDiscreteSpace> (2);
+  Ptr<OpenGymTabularAgent> tabular = CreateObject<OpenGymTabularAgent> ();
+  tabular->SetAttribute ("Epsilon", DoubleValue (0.3));
+  tabular->AssignStreams (1);
+  tabular->Init (banditSpace, banditSpace);
+
+  Ptr<OpenGymDiscreteContainer> state = CreateObject<OpenGymDiscreteContainer> (2);
+  state->SetValue (0);
+  float reward = 0;
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      action = DynamicCast<OpenGymDiscreteContainer> (tabular->GetAction (state, reward, false, ""));
+      NS_TEST_ASSERT_MSG_NE (action, 0, "no discrete action");
+      reward = action->GetValue () == 1 ? 1 : 0;
+    }
+
+  tabular->SetAttribute ("Learning", BooleanValue (false));
+  action = DynamicCast<OpenGymDiscreteContainer> (tabular->GetAction (state, reward, false, ""));
+  NS_TEST_ASSERT_MSG_EQ (action->GetValue (), 1, "tabular agent did not learn the better arm");
+}
+
+// Env and agent recording what reaches a step, for the coalescing test.
+class CoalescingTestEnv : public OpenGymEnv
+{
+public:
+  CoalescingTestEnv () : m_steps (0), m_lastEvents (0), m_lastSum (0), m_lastMax (0) {}
+
+  virtual Ptr<OpenGymSpace> GetActionSpace () { return CreateObject<OpenGymDiscreteSpace> (2); }
+  virtual Ptr<OpenGymSpace> GetObservationSpace () { return CreateObject<OpenGymDiscreteSpace> (2); }
+  virtual bool GetGameOver () { return false; }
+  virtual Ptr<OpenGymDataContainer> GetObservation ()
+  {
+    m_steps++;
+    m_lastEvents = GetCoalescedEvents ();
+    m_lastSum = GetFeatureStats (0).sum;
+    m_lastMax = GetFeatureStats (0).max;
+    Ptr<OpenGymDiscreteContainer> obs = CreateObject<OpenGymDiscreteContainer> (2);
+    obs->SetValue (0);
+    return obs;
+  }
+  virtual float GetReward () { return 0; }
+  virtual std::string GetExtraInfo () { return ""; }
+  virtual bool ExecuteActions (Ptr<OpenGymDataContainer> action) { return true; }
+
+  void Trigger (double value)
+  {
+    AccumulateFeature (0, value);
+    Notify ();
+  }
+
+  uint32_t m_steps;
+  uint32_t m_lastEvents;
+  double m_lastSum;
+  double m_lastMax;
+};
+
+class CoalescingTestAgent : public OpenGymAgent
+{
+public:
+  virtual Ptr<OpenGymDataContainer> GetAction (Ptr<OpenGymDataContainer> obs, float reward, bool done, std::string info)
+  {
+    return CreateAction (std::vector<double> (1, 0));
+  }
+};
+
+class OpengymCoalescingTestCase : public TestCase
+{
+public:
+  OpengymCoalescingTestCase ();
+  virtual ~OpengymCoalescingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+OpengymCoalescingTestCase::OpengymCoalescingTestCase ()
+  : TestCase ("Opengym env trigger coalescing")
+{
+}
+
+OpengymCoalescingTestCase::~OpengymCoalescingTestCase ()
+{
+}
+
+void
+OpengymCoalescingTestCase::DoRun (void)
+{
+  Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface> (5555);
+  openGym->SetAgent (CreateObject<CoalescingTestAgent> ());
+  Ptr<CoalescingTestEnv> env = CreateObject<CoalescingTestEnv> ();
+  env->SetOpenGymInterface (openGym);
+
+  // default: every trigger is a step
+  env->Trigger (1);
+  env->Trigger (2);
+  NS_TEST_ASSERT_MSG_EQ (env->m_steps, 2, "triggers coalesced by default");
+  NS_TEST_ASSERT_MSG_EQ (env->m_lastEvents, 1, "wrong event count");
+
+  // every 4 triggers
+  env->SetCoalescing (4, Seconds (0));
+  for (uint32_t i = 1; i <= 10; i++)
+    {
+      env->Trigger (i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (env->m_steps, 4, "wrong number of coalesced steps");
+  NS_TEST_ASSERT_MSG_EQ (env->m_lastEvents, 4, "wrong event count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (env->m_lastSum, 5 + 6 + 7 + 8, 1e-9, "wrong feature sum");
+  NS_TEST_ASSERT_MSG_EQ_TOL (env->m_lastMax, 8, 1e-9, "wrong feature max");
+
+  // at most one step per 10ms, triggers every 1ms
+  env->SetCoalescing (1, MilliSeconds (10));
+  env->m_steps = 0;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      Simulator::Schedule (MilliSeconds (i + 1), &CoalescingTestEnv::Trigger, env, 1.0);
+    }
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (env->m_steps, 10, "rate limit not applied");
+  NS_TEST_ASSERT_MSG_EQ (env->m_lastEvents, 10, "wrong event count");
+
+  openGym->Dispose ();
+  Simulator::Destroy ();
+}
+
+// The step statistics chain the stages and sum them up per step
+class OpengymStepStatsTestCase : public TestCase
+{
+public:
+  OpengymStepStatsTestCase ();
+  virtual ~OpengymStepStatsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+OpengymStepStatsTestCase::OpengymStepStatsTestCase ()
+  : TestCase ("Opengym step statistics")
+{
+}
+
+OpengymStepStatsTestCase::~OpengymStepStatsTestCase ()
+{
+}
+
+void
+OpengymStepStatsTestCase::DoRun (void)
+{
+  OpenGymStepStats stats;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      OpenGymStepStats::Clock::time_point start = OpenGymStepStats::Clock::now ();
+      start = stats.Add (OpenGymStepStats::OBSERVE, start);
+      start = stats.Add (OpenGymStepStats::SERIALIZE, start - std::chrono::microseconds (100));
+      // two sends in one step, e.g. two agents
+      start = stats.Add (OpenGymStepStats::SEND, start);
+      stats.Add (OpenGymStepStats::SEND, start);
+      const OpenGymStepStats::StepTimes &times = stats.FinishStep ();
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (times.us[OpenGymStepStats::SERIALIZE], 100.0, "serialize time lost");
+      NS_TEST_ASSERT_MSG_EQ (times.us[OpenGymStepStats::WAIT], 0.0, "unused stage has a time");
+    }
+  NS_TEST_ASSERT_MSG_EQ (stats.GetSteps (), 3, "wrong number of steps");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetCount (OpenGymStepStats::SEND), 6, "wrong send count");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetCount (OpenGymStepStats::EXECUTE), 0, "wrong execute count");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (stats.GetMax (OpenGymStepStats::SERIALIZE), stats.GetMean (OpenGymStepStats::SERIALIZE), "max below mean");
+
+  std::ostringstream os;
+  stats.Print (os);
+  NS_TEST_ASSERT_MSG_NE (os.str ().find ("deserialize"), std::string::npos, "stage missing in the table");
+
+  stats.Reset ();
+  NS_TEST_ASSERT_MSG_EQ (stats.GetSteps (), 0, "not reset");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetCount (OpenGymStepStats::SEND), 0, "not reset");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,6 +357,10 @@ OpengymTestSuite::OpengymTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new OpengymTestCase1, TestCase::QUICK);
+  AddTestCase (new OpengymBoxCodecTestCase, TestCase::QUICK);
+  AddTestCase (new OpengymAgentTestCase, TestCase::QUICK);
+  AddTestCase (new OpengymCoalescingTestCase, TestCase::QUICK);
+  AddTestCase (new OpengymStepStatsTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -22,6 +22,7 @@
 #define CALENDAR_SCHEDULER_H
 
 #include "scheduler.h"
+#include "pool-allocator.h"
 #include <stdint.h>
 #include <list>
 
@@ -78,7 +79,8 @@ private:
   Scheduler::Event DoRemoveNext (void);
   void DoInsert (const Event &ev);
 
-  typedef std::list<Scheduler::Event> Bucket;
+  /** The list nodes come from the SmallObjectPool. */
+  typedef std::list<Scheduler::Event, PoolAllocator<Scheduler::Event> > Bucket;
   Bucket *m_buckets;
   // number of buckets in array
   uint32_t m_nBuckets;
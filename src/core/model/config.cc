@@ -24,8 +24,11 @@
 #include "object-ptr-container.h"
 #include "names.h"
 #include "pointer.h"
+#include "simple-ref-count.h"
+#include "trace-source-accessor.h"
 #include "log.h"
 
+#include <map>
 #include <sstream>
 
 /**
@@ -38,6 +41,121 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Config");
 
+namespace {
+
+/**
+ * \ingroup config
+ * Set an attribute of many objects. The attribute is looked up, and the
+ * value checked, once per type of object instead of once per object as
+ * in ObjectBase::SetAttribute.
+ */
+class AttributeSetter
+{
+public:
+  /**
+   * \param name the name of the attribute.
+   * \param value the value to set.
+   */
+  AttributeSetter (std::string name, const AttributeValue &value);
+  /**
+   * Set the attribute of an object, as ObjectBase::SetAttribute.
+   * \param object the object.
+   */
+  void Set (Ptr<Object> object);
+private:
+  std::string m_name;
+  const AttributeValue &m_value;
+  // the uid of the type of the previous object, 0 if none
+  uint16_t m_uid;
+  Ptr<const AttributeAccessor> m_accessor;
+  Ptr<AttributeValue> m_checked;
+};
+
+AttributeSetter::AttributeSetter (std::string name, const AttributeValue &value)
+  : m_name (name),
+    m_value (value),
+    m_uid (0)
+{
+  NS_LOG_FUNCTION (this << name << &value);
+}
+
+void
+AttributeSetter::Set (Ptr<Object> object)
+{
+  NS_LOG_FUNCTION (this << object);
+  TypeId tid = object->GetInstanceTypeId ();
+  if (tid.GetUid () != m_uid)
+    {
+      struct TypeId::AttributeInformation info;
+      if (!tid.LookupAttributeByName (m_name, &info))
+        {
+          NS_FATAL_ERROR ("Attribute name="<<m_name<<" does not exist for this object: tid="<<tid.GetName ());
+        }
+      if (!(info.flags & TypeId::ATTR_SET) ||
+          !info.accessor->HasSetter ())
+        {
+          NS_FATAL_ERROR ("Attribute name="<<m_name<<" is not settable for this object: tid="<<tid.GetName ());
+        }
+      m_checked = info.checker->CreateValidValue (m_value);
+      if (m_checked == 0)
+        {
+          NS_FATAL_ERROR ("Attribute name="<<m_name<<" could not be set for this object: tid="<<tid.GetName ());
+        }
+      m_accessor = info.accessor;
+      m_uid = tid.GetUid ();
+    }
+  if (!m_accessor->Set (PeekPointer (object), *m_checked))
+    {
+      NS_FATAL_ERROR ("Attribute name="<<m_name<<" could not be set for this object: tid="<<tid.GetName ());
+    }
+}
+
+/**
+ * \ingroup config
+ * Find a trace source of many objects, looked up once per type of
+ * object.
+ */
+class TraceSourceFinder
+{
+public:
+  /**
+   * \param name the name of the trace source.
+   */
+  TraceSourceFinder (std::string name);
+  /**
+   * \param object the object.
+   * \returns the accessor of the trace source of the object, or 0.
+   */
+  Ptr<const TraceSourceAccessor> Find (Ptr<Object> object);
+private:
+  std::string m_name;
+  // the uid of the type of the previous object, 0 if none
+  uint16_t m_uid;
+  Ptr<const TraceSourceAccessor> m_accessor;
+};
+
+TraceSourceFinder::TraceSourceFinder (std::string name)
+  : m_name (name),
+    m_uid (0)
+{
+  NS_LOG_FUNCTION (this << name);
+}
+
+Ptr<const TraceSourceAccessor>
+TraceSourceFinder::Find (Ptr<Object> object)
+{
+  NS_LOG_FUNCTION (this << object);
+  TypeId tid = object->GetInstanceTypeId ();
+  if (tid.GetUid () != m_uid)
+    {
+      m_accessor = tid.LookupTraceSourceByName (m_name);
+      m_uid = tid.GetUid ();
+    }
+  return m_accessor;
+}
+
+} // unnamed namespace
+
 namespace Config {
 
 MatchContainer::MatchContainer ()
@@ -94,10 +212,10 @@ void
 MatchContainer::Set (std::string name, const AttributeValue &value)
 {
   NS_LOG_FUNCTION (this << name << &value);
+  AttributeSetter setter (name, value);
   for (Iterator tmp = Begin (); tmp != End (); ++tmp)
     {
-      Ptr<Object> object = *tmp;
-      object->SetAttribute (name, value);
+      setter.Set (*tmp);
     }
 }
 void 
@@ -105,22 +223,30 @@ MatchContainer::Connect (std::string name, const CallbackBase &cb)
 {
   NS_LOG_FUNCTION (this << name << &cb);
   NS_ASSERT (m_objects.size () == m_contexts.size ());
+  TraceSourceFinder finder (name);
   for (uint32_t i = 0; i < m_objects.size (); ++i)
     {
       Ptr<Object> object = m_objects[i];
-      std::string ctx = m_contexts[i] + name;
-      object->TraceConnect (name, ctx, cb);
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (object);
+      if (accessor != 0)
+        {
+          accessor->Connect (PeekPointer (object), m_contexts[i] + name, cb);
+        }
     }
 }
 void 
 MatchContainer::ConnectWithoutContext (std::string name, const CallbackBase &cb)
 {
   NS_LOG_FUNCTION (this << name << &cb);
-
+  TraceSourceFinder finder (name);
   for (Iterator tmp = Begin (); tmp != End (); ++tmp)
     {
       Ptr<Object> object = *tmp;
-      object->TraceConnectWithoutContext (name, cb);
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (object);
+      if (accessor != 0)
+        {
+          accessor->ConnectWithoutContext (PeekPointer (object), cb);
+        }
     }
 }
 void 
@@ -128,105 +254,144 @@ MatchContainer::Disconnect (std::string name, const CallbackBase &cb)
 {
   NS_LOG_FUNCTION (this << name << &cb);
   NS_ASSERT (m_objects.size () == m_contexts.size ());
+  TraceSourceFinder finder (name);
   for (uint32_t i = 0; i < m_objects.size (); ++i)
     {
       Ptr<Object> object = m_objects[i];
-      std::string ctx = m_contexts[i] + name;
-      object->TraceDisconnect (name, ctx, cb);
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (object);
+      if (accessor != 0)
+        {
+          accessor->Disconnect (PeekPointer (object), m_contexts[i] + name, cb);
+        }
     }
 }
 void 
 MatchContainer::DisconnectWithoutContext (std::string name, const CallbackBase &cb)
 {
   NS_LOG_FUNCTION (this << name << &cb);
+  TraceSourceFinder finder (name);
   for (Iterator tmp = Begin (); tmp != End (); ++tmp)
     {
       Ptr<Object> object = *tmp;
-      object->TraceDisconnectWithoutContext (name, cb);
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (object);
+      if (accessor != 0)
+        {
+          accessor->DisconnectWithoutContext (PeekPointer (object), cb);
+        }
     }
 }
 
 } // namespace Config
 
+/**
+ * \ingroup config
+ * Match the indices of an ObjectPtrContainer against an item of a path:
+ * "*", an index, a range "[min-max]", or several of them separated by
+ * "|". The item is parsed once, by the constructor.
+ */
 class ArrayMatcher
 {
 public:
   ArrayMatcher (std::string element);
   bool Matches (uint32_t i) const;
+  /**
+   * \param [out] i the index matched by the item, if there is only one.
+   * \returns true if the item matches a single index.
+   */
+  bool GetSingle (uint32_t *i) const;
 private:
+  void Parse (std::string element);
   bool StringToUint32 (std::string str, uint32_t *value) const;
   std::string m_element;
+  // true for "*"
+  bool m_all;
+  // the ranges of matching indices, bounds included
+  std::vector<std::pair<uint32_t, uint32_t> > m_ranges;
 };
 
 
 ArrayMatcher::ArrayMatcher (std::string element)
-  : m_element (element)
+  : m_element (element),
+    m_all (false)
 {
   NS_LOG_FUNCTION (this << element);
+  Parse (element);
 }
-bool
-ArrayMatcher::Matches (uint32_t i) const
+void
+ArrayMatcher::Parse (std::string element)
 {
-  NS_LOG_FUNCTION (this << i);
-  if (m_element == "*")
+  NS_LOG_FUNCTION (this << element);
+  if (element == "*")
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches *");
-      return true;
+      m_all = true;
+      return;
     }
   std::string::size_type tmp;
-  tmp = m_element.find ("|");
+  tmp = element.find ("|");
   if (tmp != std::string::npos)
     {
-      std::string left = m_element.substr (0, tmp-0);
-      std::string right = m_element.substr (tmp+1, m_element.size () - (tmp + 1));
-      ArrayMatcher matcher = ArrayMatcher (left);
-      if (matcher.Matches (i))
-        {
-          NS_LOG_DEBUG ("Array "<<i<<" matches "<<left);
-          return true;
-        }
-      matcher = ArrayMatcher (right);
-      if (matcher.Matches (i))
-        {
-          NS_LOG_DEBUG ("Array "<<i<<" matches "<<right);
-          return true;
-        }
-      NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
-      return false;
+      std::string left = element.substr (0, tmp-0);
+      std::string right = element.substr (tmp+1, element.size () - (tmp + 1));
+      Parse (left);
+      Parse (right);
+      return;
     }
-  std::string::size_type leftBracket = m_element.find ("[");
-  std::string::size_type rightBracket = m_element.find ("]");
-  std::string::size_type dash = m_element.find ("-");
-  if (leftBracket == 0 && rightBracket == m_element.size () - 1 &&
+  std::string::size_type leftBracket = element.find ("[");
+  std::string::size_type rightBracket = element.find ("]");
+  std::string::size_type dash = element.find ("-");
+  if (leftBracket == 0 && rightBracket == element.size () - 1 &&
       dash > leftBracket && dash < rightBracket)
     {
-      std::string lowerBound = m_element.substr (leftBracket + 1, dash - (leftBracket + 1));
-      std::string upperBound = m_element.substr (dash + 1, rightBracket - (dash + 1));
+      std::string lowerBound = element.substr (leftBracket + 1, dash - (leftBracket + 1));
+      std::string upperBound = element.substr (dash + 1, rightBracket - (dash + 1));
       uint32_t min;
       uint32_t max;
       if (StringToUint32 (lowerBound, &min) && 
           StringToUint32 (upperBound, &max) &&
-          i >= min && i <= max)
-        {
-          NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
-          return true;
-        }
-      else
+          min <= max)
         {
-          NS_LOG_DEBUG ("Array "<<i<<" does not "<<m_element);
-          return false;
+          m_ranges.push_back (std::make_pair (min, max));
         }
+      return;
     }
   uint32_t value;
-  if (StringToUint32 (m_element, &value) &&
-      i == value)
+  if (StringToUint32 (element, &value))
+    {
+      m_ranges.push_back (std::make_pair (value, value));
+    }
+}
+bool
+ArrayMatcher::Matches (uint32_t i) const
+{
+  NS_LOG_FUNCTION (this << i);
+  if (m_all)
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
+      NS_LOG_DEBUG ("Array "<<i<<" matches *");
       return true;
     }
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator j = m_ranges.begin ();
+       j != m_ranges.end (); ++j)
+    {
+      if (i >= j->first && i <= j->second)
+        {
+          NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
+          return true;
+        }
+    }
   NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
   return false;
 }
+bool
+ArrayMatcher::GetSingle (uint32_t *i) const
+{
+  NS_LOG_FUNCTION (this << i);
+  if (m_all || m_ranges.size () != 1 || m_ranges[0].first != m_ranges[0].second)
+    {
+      return false;
+    }
+  *i = m_ranges[0].first;
+  return true;
+}
 
 bool
 ArrayMatcher::StringToUint32 (std::string str, uint32_t *value) const
@@ -239,60 +404,208 @@ ArrayMatcher::StringToUint32 (std::string str, uint32_t *value) const
 }
 
 
-class Resolver
+/**
+ * \ingroup config
+ * An attribute which leads from an object to the objects of an item of
+ * a path: a Pointer or an ObjectPtrContainer attribute.
+ */
+struct AttributeStep
+{
+  std::string name;                               //!< The attribute name.
+  Ptr<const AttributeAccessor> accessor;          //!< Its accessor, if gettable.
+  bool container;                                 //!< An ObjectPtrContainer.
+  const ObjectPtrContainerAccessor *items;        //!< Its accessor, if available.
+};
+/** The attributes of a type which match an item of a path. */
+typedef std::vector<AttributeStep> AttributeSteps;
+
+/**
+ * \ingroup config
+ * \param tid the type of an object.
+ * \param item an item of a path.
+ * \returns the Pointer and ObjectPtrContainer attributes of the type
+ *          and its parents which match the item, in the order of
+ *          the search of the attributes.
+ *
+ * The attributes are looked up once per type and item, then cached.
+ */
+const AttributeSteps *
+LookupAttributeSteps (TypeId tid, const std::string &item)
+{
+  NS_LOG_FUNCTION (tid << item);
+  typedef std::map<std::pair<uint16_t, std::string>, AttributeSteps> Cache;
+  static Cache cache;
+  std::pair<uint16_t, std::string> key (tid.GetUid (), item);
+  Cache::const_iterator i = cache.find (key);
+  if (i != cache.end ())
+    {
+      return &i->second;
+    }
+
+  AttributeSteps steps;
+  TypeId nextTid = tid;
+  do
+    {
+      tid = nextTid;
+      for (uint32_t j = 0; j < tid.GetAttributeN (); j++)
+        {
+          struct TypeId::AttributeInformation info = tid.GetAttribute (j);
+          if (info.name != item && item != "*")
+            {
+              continue;
+            }
+          AttributeStep step;
+          step.name = info.name;
+          step.items = 0;
+          if ((info.flags & TypeId::ATTR_GET) && info.accessor->HasGetter ())
+            {
+              step.accessor = info.accessor;
+            }
+          if (dynamic_cast<const PointerChecker *> (PeekPointer (info.checker)) != 0)
+            {
+              step.container = false;
+              steps.push_back (step);
+            }
+          else if (dynamic_cast<const ObjectPtrContainerChecker *> (PeekPointer (info.checker)) != 0)
+            {
+              step.container = true;
+              step.items = dynamic_cast<const ObjectPtrContainerAccessor *> (PeekPointer (step.accessor));
+              steps.push_back (step);
+            }
+          // this could be anything else and we don't know what to do with it.
+          // So, we just ignore it.
+        }
+      nextTid = tid.GetParent ();
+    } while (nextTid != tid);
+  return &cache.insert (std::make_pair (key, steps)).first->second;
+}
+
+/**
+ * \ingroup config
+ * A path split in items, with what can be computed from the items
+ * before the path is resolved.
+ */
+class CompiledPath : public SimpleRefCount<CompiledPath>
 {
 public:
-  Resolver (std::string path);
-  virtual ~Resolver ();
+  /** An item of the path, between two '/'. */
+  struct Item
+  {
+    /** \param name the item. */
+    Item (std::string name);
+    /**
+     * \param tid the type of an object.
+     * \returns the attributes of the type which match the item.
+     */
+    const AttributeSteps * GetSteps (TypeId tid) const;
 
-  void Resolve (Ptr<Object> root);
-private:
-  void Canonicalize (void);
-  void DoResolve (std::string path, Ptr<Object> root);
-  void DoArrayResolve (std::string path, const ObjectPtrContainerValue &vector);
-  void DoResolveOne (Ptr<Object> object);
-  std::string GetResolvedPath (void) const;
-  virtual void DoOne (Ptr<Object> object, std::string path) = 0;
-  std::vector<std::string> m_workStack;
-  std::string m_path;
+    std::string name;         //!< The item.
+    bool getObject;           //!< A "$" item, a call to GetObject.
+    TypeId tid;               //!< The type of a "$" item.
+    bool tidFound;            //!< The type of a "$" item is registered.
+    ArrayMatcher matcher;     //!< The item, as an index of an ObjectPtrContainer.
+    mutable uint16_t uid;     //!< The type of the last GetSteps, 0 if none.
+    mutable const AttributeSteps *steps; //!< The result of the last GetSteps.
+  };
+
+  /** \param path the path. */
+  CompiledPath (std::string path);
+  std::vector<Item> m_items;  //!< The items of the path.
 };
 
-Resolver::Resolver (std::string path)
-  : m_path (path)
+CompiledPath::Item::Item (std::string name)
+  : name (name),
+    getObject (name.find ("$") == 0),
+    tidFound (false),
+    matcher (name),
+    uid (0),
+    steps (0)
 {
-  NS_LOG_FUNCTION (this << path);
-  Canonicalize ();
+  if (getObject)
+    {
+      tidFound = TypeId::LookupByNameFailSafe (name.substr (1, name.size () - 1), &tid);
+    }
 }
-Resolver::~Resolver ()
+
+const AttributeSteps *
+CompiledPath::Item::GetSteps (TypeId tid) const
 {
-  NS_LOG_FUNCTION (this);
+  if (tid.GetUid () != uid)
+    {
+      steps = LookupAttributeSteps (tid, name);
+      uid = tid.GetUid ();
+    }
+  return steps;
 }
-void
-Resolver::Canonicalize (void)
+
+CompiledPath::CompiledPath (std::string path)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << path);
 
   // ensure that we start and end with a '/'
-  std::string::size_type tmp = m_path.find ("/");
+  std::string::size_type tmp = path.find ("/");
   if (tmp != 0)
     {
       // no slash at start
-      m_path = "/" + m_path;
+      path = "/" + path;
     }
-  tmp = m_path.find_last_of ("/");
-  if (tmp != (m_path.size () - 1))
+  tmp = path.find_last_of ("/");
+  if (tmp != (path.size () - 1))
     {
       // no slash at end
-      m_path = m_path + "/";
+      path = path + "/";
+    }
+
+  std::string::size_type start = 1;
+  while (start < path.size ())
+    {
+      std::string::size_type next = path.find ("/", start);
+      m_items.push_back (Item (path.substr (start, next - start)));
+      start = next + 1;
     }
 }
 
+
+class Resolver
+{
+public:
+  /**
+   * \param path the path.
+   * \param contexts whether DoOne needs the matched path of the objects.
+   */
+  Resolver (const CompiledPath &path, bool contexts);
+  virtual ~Resolver ();
+
+  void Resolve (Ptr<Object> root);
+private:
+  void DoResolve (uint32_t item, Ptr<Object> root);
+  void DoArrayResolve (uint32_t item, Ptr<Object> root, const AttributeStep &step);
+  void DoResolveIndex (uint32_t item, uint32_t index, Ptr<Object> object);
+  void DoResolveOne (Ptr<Object> object);
+  std::string GetResolvedPath (void) const;
+  virtual void DoOne (Ptr<Object> object, std::string path) = 0;
+  std::vector<std::string> m_workStack;
+  const CompiledPath &m_path;
+  bool m_contexts;
+};
+
+Resolver::Resolver (const CompiledPath &path, bool contexts)
+  : m_path (path),
+    m_contexts (contexts)
+{
+  NS_LOG_FUNCTION (this << &path << contexts);
+}
+Resolver::~Resolver ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
 void 
 Resolver::Resolve (Ptr<Object> root)
 {
   NS_LOG_FUNCTION (this << root);
 
-  DoResolve (m_path, root);
+  DoResolve (0, root);
 }
 
 std::string
@@ -314,17 +627,15 @@ Resolver::DoResolveOne (Ptr<Object> object)
   NS_LOG_FUNCTION (this << object);
 
   NS_LOG_DEBUG ("resolved="<<GetResolvedPath ());
-  DoOne (object, GetResolvedPath ());
+  DoOne (object, m_contexts ? GetResolvedPath () : std::string ());
 }
 
 void
-Resolver::DoResolve (std::string path, Ptr<Object> root)
+Resolver::DoResolve (uint32_t i, Ptr<Object> root)
 {
-  NS_LOG_FUNCTION (this << path << root);
-  NS_ASSERT ((path.find ("/")) == 0);
-  std::string::size_type next = path.find ("/", 1);
+  NS_LOG_FUNCTION (this << i << root);
 
-  if (next == std::string::npos)
+  if (i == m_path.m_items.size ())
     {
       //
       // If root is zero, we're beginning to see if we can use the object name 
@@ -340,8 +651,7 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
         }
       return;
     }
-  std::string item = path.substr (1, next-1);
-  std::string pathLeft = path.substr (next, path.size ()-next);
+  const CompiledPath::Item &item = m_path.m_items[i];
 
   //
   // If root is zero, we're beginning to see if we can use the object name 
@@ -352,11 +662,10 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
   //
   if (root == 0)
     {
-      std::string::size_type offset = path.find ("/Names");
-      if (offset == 0)
+      if (item.name.compare (0, 5, "Names") == 0)
         {
-          m_workStack.push_back (item);
-          DoResolve (pathLeft, root);
+          m_workStack.push_back (item.name);
+          DoResolve (i + 1, root);
           m_workStack.pop_back ();
           return;
         }
@@ -368,12 +677,12 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
   // zero, this means to look in the root of the "/Names" name space, otherwise
   // it refers to a name space context (level).
   //
-  Ptr<Object> namedObject = Names::Find<Object> (root, item);
+  Ptr<Object> namedObject = Names::Find<Object> (root, item.name);
   if (namedObject)
     {
-      NS_LOG_DEBUG ("Name system resolved item = " << item << " to " << namedObject);
-      m_workStack.push_back (item);
-      DoResolve (pathLeft, namedObject);
+      NS_LOG_DEBUG ("Name system resolved item = " << item.name << " to " << namedObject);
+      m_workStack.push_back (item.name);
+      DoResolve (i + 1, namedObject);
       m_workStack.pop_back ();
       return;
     }
@@ -389,117 +698,144 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
     {
       return;
     }
-  std::string::size_type dollarPos = item.find ("$");
-  if (dollarPos == 0)
+  if (item.getObject)
     {
       // This is a call to GetObject
-      std::string tidString = item.substr (1, item.size () - 1);
-      NS_LOG_DEBUG ("GetObject="<<tidString<<" on path="<<GetResolvedPath ());
-      TypeId tid = TypeId::LookupByName (tidString);
+      NS_LOG_DEBUG ("GetObject="<<item.name<<" on path="<<GetResolvedPath ());
+      TypeId tid = item.tid;
+      if (!item.tidFound)
+        {
+          // not registered when the path was parsed
+          tid = TypeId::LookupByName (item.name.substr (1, item.name.size () - 1));
+        }
       Ptr<Object> object = root->GetObject<Object> (tid);
       if (object == 0)
         {
-          NS_LOG_DEBUG ("GetObject ("<<tidString<<") failed on path="<<GetResolvedPath ());
+          NS_LOG_DEBUG ("GetObject ("<<item.name<<") failed on path="<<GetResolvedPath ());
           return;
         }
-      m_workStack.push_back (item);
-      DoResolve (pathLeft, object);
+      m_workStack.push_back (item.name);
+      DoResolve (i + 1, object);
       m_workStack.pop_back ();
     }
   else 
     {
       // this is a normal attribute.
-      TypeId tid;
-      TypeId nextTid = root->GetInstanceTypeId ();
-      bool foundMatch = false;
-      
-      do
+      const AttributeSteps *steps = item.GetSteps (root->GetInstanceTypeId ());
+      for (AttributeSteps::const_iterator step = steps->begin (); step != steps->end (); ++step)
         {
-          tid = nextTid;
-          
-          for (uint32_t i = 0; i < tid.GetAttributeN(); i++)
+          if (!step->container)
             {
-              struct TypeId::AttributeInformation info;
-              info = tid.GetAttribute(i);
-              if (info.name != item && item != "*")
+              NS_LOG_DEBUG ("GetAttribute(ptr)="<<step->name<<" on path="<<GetResolvedPath ());
+              PointerValue ptr;
+              if (step->accessor == 0 || !step->accessor->Get (PeekPointer (root), ptr))
                 {
-                  continue;
-                }
-              // attempt to cast to a pointer checker.
-              const PointerChecker *ptr = dynamic_cast<const PointerChecker *> (PeekPointer (info.checker));
-              if (ptr != 0)
-                {
-                  NS_LOG_DEBUG ("GetAttribute(ptr)="<<info.name<<" on path="<<GetResolvedPath ());
-                  PointerValue ptr;
-                  root->GetAttribute (info.name, ptr);
-                  Ptr<Object> object = ptr.Get<Object> ();
-                  if (object == 0)
-                    {
-                      NS_LOG_ERROR ("Requested object name=\""<<item<<
-                                    "\" exists on path=\""<<GetResolvedPath ()<<"\""
-                                    " but is null.");
-                      continue;
-                    }
-                  foundMatch = true;
-                  m_workStack.push_back (info.name);
-                  DoResolve (pathLeft, object);
-                  m_workStack.pop_back ();
+                  root->GetAttribute (step->name, ptr);
                 }
-              // attempt to cast to an object vector.
-              const ObjectPtrContainerChecker *vectorChecker = 
-                dynamic_cast<const ObjectPtrContainerChecker *> (PeekPointer (info.checker));
-              if (vectorChecker != 0)
+              Ptr<Object> object = ptr.Get<Object> ();
+              if (object == 0)
                 {
-                  NS_LOG_DEBUG ("GetAttribute(vector)="<<info.name<<" on path="<<GetResolvedPath () << pathLeft);
-                  foundMatch = true;
-                  ObjectPtrContainerValue vector;
-                  root->GetAttribute (info.name, vector);
-                  m_workStack.push_back (info.name);
-                  DoArrayResolve (pathLeft, vector);
-                  m_workStack.pop_back ();
+                  NS_LOG_ERROR ("Requested object name=\""<<item.name<<
+                                "\" exists on path=\""<<GetResolvedPath ()<<"\""
+                                " but is null.");
+                  continue;
                 }
-              // this could be anything else and we don't know what to do with it.
-              // So, we just ignore it.
+              m_workStack.push_back (step->name);
+              DoResolve (i + 1, object);
+              m_workStack.pop_back ();
             }
-
-          nextTid = tid.GetParent ();
-        } while (nextTid != tid);
-      
-      if (!foundMatch)
+          else
+            {
+              NS_LOG_DEBUG ("GetAttribute(vector)="<<step->name<<" on path="<<GetResolvedPath ());
+              m_workStack.push_back (step->name);
+              DoArrayResolve (i + 1, root, *step);
+              m_workStack.pop_back ();
+            }
+        }
+      if (steps->empty ())
         {
-          NS_LOG_DEBUG ("Requested item="<<item<<" does not exist on path="<<GetResolvedPath ());
+          NS_LOG_DEBUG ("Requested item="<<item.name<<" does not exist on path="<<GetResolvedPath ());
           return;
         }
     }
 }
 
 void 
-Resolver::DoArrayResolve (std::string path, const ObjectPtrContainerValue &container)
+Resolver::DoArrayResolve (uint32_t i, Ptr<Object> root, const AttributeStep &step)
 {
-  NS_LOG_FUNCTION(this << path << &container);
-  NS_ASSERT (path != "");
-  NS_ASSERT ((path.find ("/")) == 0);
-  std::string::size_type next = path.find ("/", 1);
-  if (next == std::string::npos)
+  NS_LOG_FUNCTION (this << i << root << step.name);
+  if (i == m_path.m_items.size ())
     {
       return;
     }
-  std::string item = path.substr (1, next-1);
-  std::string pathLeft = path.substr (next, path.size ()-next);
+  const ArrayMatcher &matcher = m_path.m_items[i].matcher;
 
-  ArrayMatcher matcher = ArrayMatcher (item);
-  ObjectPtrContainerValue::Iterator it;
-  for (it = container.Begin (); it != container.End (); ++it)
+  if (step.items == 0)
     {
-      if (matcher.Matches ((*it).first))
+      ObjectPtrContainerValue container;
+      root->GetAttribute (step.name, container);
+      ObjectPtrContainerValue::Iterator it;
+      for (it = container.Begin (); it != container.End (); ++it)
         {
-          std::ostringstream oss;
-          oss << (*it).first;
-          m_workStack.push_back (oss.str ());
-          DoResolve (pathLeft, (*it).second);
-          m_workStack.pop_back ();
+          if (matcher.Matches ((*it).first))
+            {
+              DoResolveIndex (i, (*it).first, (*it).second);
+            }
+        }
+      return;
+    }
+
+  // walk the container in place, instead of copying all its objects
+  uint32_t n;
+  if (!step.items->GetItemN (PeekPointer (root), &n))
+    {
+      return;
+    }
+  uint32_t index;
+  uint32_t single;
+  if (matcher.GetSingle (&single) && single < n)
+    {
+      // the objects of a vector are at their index
+      Ptr<Object> object = step.items->GetItem (PeekPointer (root), single, &index);
+      if (index == single)
+        {
+          DoResolveIndex (i, index, object);
+          return;
+        }
+    }
+  // the objects are resolved in the order of their indices
+  std::map<uint32_t, Ptr<Object> > objects;
+  for (uint32_t j = 0; j < n; j++)
+    {
+      Ptr<Object> object = step.items->GetItem (PeekPointer (root), j, &index);
+      if (matcher.Matches (index))
+        {
+          objects.insert (std::make_pair (index, object));
         }
     }
+  for (std::map<uint32_t, Ptr<Object> >::const_iterator it = objects.begin ();
+       it != objects.end (); ++it)
+    {
+      DoResolveIndex (i, it->first, it->second);
+    }
+}
+
+void
+Resolver::DoResolveIndex (uint32_t i, uint32_t index, Ptr<Object> object)
+{
+  NS_LOG_FUNCTION (this << i << index << object);
+  if (m_contexts)
+    {
+      std::ostringstream oss;
+      oss << index;
+      m_workStack.push_back (oss.str ());
+    }
+  else
+    {
+      m_workStack.push_back (std::string ());
+    }
+  DoResolve (i + 1, object);
+  m_workStack.pop_back ();
 }
 
 
@@ -544,8 +880,7 @@ ConfigImpl::Set (std::string path, const AttributeValue &value)
 
   std::string root, leaf;
   ParsePath (path, &root, &leaf);
-  Config::MatchContainer container = LookupMatches (root);
-  container.Set (leaf, value);
+  Config::Path (root).Set (leaf, value);
 }
 void 
 ConfigImpl::ConnectWithoutContext (std::string path, const CallbackBase &cb)
@@ -553,8 +888,7 @@ ConfigImpl::ConnectWithoutContext (std::string path, const CallbackBase &cb)
   NS_LOG_FUNCTION (this << path << &cb);
   std::string root, leaf;
   ParsePath (path, &root, &leaf);
-  Config::MatchContainer container = LookupMatches (root);
-  container.ConnectWithoutContext (leaf, cb);
+  Config::Path (root).ConnectWithoutContext (leaf, cb);
 }
 void 
 ConfigImpl::DisconnectWithoutContext (std::string path, const CallbackBase &cb)
@@ -562,8 +896,7 @@ ConfigImpl::DisconnectWithoutContext (std::string path, const CallbackBase &cb)
   NS_LOG_FUNCTION (this << path << &cb);
   std::string root, leaf;
   ParsePath (path, &root, &leaf);
-  Config::MatchContainer container = LookupMatches (root);
-  container.DisconnectWithoutContext (leaf, cb);
+  Config::Path (root).DisconnectWithoutContext (leaf, cb);
 }
 void 
 ConfigImpl::Connect (std::string path, const CallbackBase &cb)
@@ -572,8 +905,7 @@ ConfigImpl::Connect (std::string path, const CallbackBase &cb)
 
   std::string root, leaf;
   ParsePath (path, &root, &leaf);
-  Config::MatchContainer container = LookupMatches (root);
-  container.Connect (leaf, cb);
+  Config::Path (root).Connect (leaf, cb);
 }
 void 
 ConfigImpl::Disconnect (std::string path, const CallbackBase &cb)
@@ -582,40 +914,14 @@ ConfigImpl::Disconnect (std::string path, const CallbackBase &cb)
 
   std::string root, leaf;
   ParsePath (path, &root, &leaf);
-  Config::MatchContainer container = LookupMatches (root);
-  container.Disconnect (leaf, cb);
+  Config::Path (root).Disconnect (leaf, cb);
 }
 
 Config::MatchContainer 
 ConfigImpl::LookupMatches (std::string path)
 {
   NS_LOG_FUNCTION (this << path);
-  class LookupMatchesResolver : public Resolver 
-  {
-  public:
-    LookupMatchesResolver (std::string path)
-      : Resolver (path)
-    {}
-    virtual void DoOne (Ptr<Object> object, std::string path) {
-      m_objects.push_back (object);
-      m_contexts.push_back (path);
-    }
-    std::vector<Ptr<Object> > m_objects;
-    std::vector<std::string> m_contexts;
-  } resolver = LookupMatchesResolver (path);
-  for (Roots::const_iterator i = m_roots.begin (); i != m_roots.end (); i++)
-    {
-      resolver.Resolve (*i);
-    }
-
-  //
-  // See if we can do something with the object name service.  Starting with
-  // the root pointer zeroed indicates to the resolver that it should start
-  // looking at the root of the "/Names" namespace during this go.
-  //
-  resolver.Resolve (0);
-
-  return Config::MatchContainer (resolver.m_objects, resolver.m_contexts, path);
+  return Config::Path (path).LookupMatches ();
 }
 
 void 
@@ -757,6 +1063,166 @@ Config::MatchContainer LookupMatches (std::string path)
   NS_LOG_FUNCTION (path);
   return Singleton<ConfigImpl>::Get ()->LookupMatches (path);
 }
+void SetMany (std::string path, const AttributeValueList &values)
+{
+  NS_LOG_FUNCTION (path << &values);
+  Path (path).SetMany (values);
+}
+
+Path::Path (std::string path)
+  : m_path (path),
+    m_compiled (Create<CompiledPath> (path))
+{
+  NS_LOG_FUNCTION (this << path);
+}
+Path::Path (const Path &o)
+  : m_path (o.m_path),
+    m_compiled (o.m_compiled)
+{
+  NS_LOG_FUNCTION (this << &o);
+}
+Path &
+Path::operator = (const Path &o)
+{
+  NS_LOG_FUNCTION (this << &o);
+  m_path = o.m_path;
+  m_compiled = o.m_compiled;
+  return *this;
+}
+Path::~Path ()
+{
+  NS_LOG_FUNCTION (this);
+}
+std::string
+Path::GetPath (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_path;
+}
+
+void
+Path::Resolve (std::vector<Ptr<Object> > *objects,
+               std::vector<std::string> *contexts) const
+{
+  NS_LOG_FUNCTION (this << objects << contexts);
+  class CollectResolver : public Resolver 
+  {
+  public:
+    CollectResolver (const CompiledPath &path,
+                     std::vector<Ptr<Object> > *objects,
+                     std::vector<std::string> *contexts)
+      : Resolver (path, contexts != 0),
+        m_objects (objects),
+        m_contexts (contexts)
+    {}
+    virtual void DoOne (Ptr<Object> object, std::string path) {
+      m_objects->push_back (object);
+      if (m_contexts != 0)
+        {
+          m_contexts->push_back (path);
+        }
+    }
+    std::vector<Ptr<Object> > *m_objects;
+    std::vector<std::string> *m_contexts;
+  } resolver = CollectResolver (*m_compiled, objects, contexts);
+  uint32_t n = GetRootNamespaceObjectN ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      resolver.Resolve (GetRootNamespaceObject (i));
+    }
+
+  //
+  // See if we can do something with the object name service.  Starting with
+  // the root pointer zeroed indicates to the resolver that it should start
+  // looking at the root of the "/Names" namespace during this go.
+  //
+  resolver.Resolve (0);
+}
+
+MatchContainer
+Path::LookupMatches (void) const
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<Ptr<Object> > objects;
+  std::vector<std::string> contexts;
+  Resolve (&objects, &contexts);
+  return MatchContainer (objects, contexts, m_path);
+}
+void
+Path::Set (std::string name, const AttributeValue &value) const
+{
+  NS_LOG_FUNCTION (this << name << &value);
+  std::vector<Ptr<Object> > objects;
+  Resolve (&objects, 0);
+  AttributeSetter setter (name, value);
+  for (std::vector<Ptr<Object> >::const_iterator i = objects.begin (); i != objects.end (); ++i)
+    {
+      setter.Set (*i);
+    }
+}
+void
+Path::SetMany (const AttributeValueList &values) const
+{
+  NS_LOG_FUNCTION (this << &values);
+  std::vector<Ptr<Object> > objects;
+  Resolve (&objects, 0);
+  std::vector<AttributeSetter> setters;
+  for (AttributeValueList::const_iterator i = values.begin (); i != values.end (); ++i)
+    {
+      setters.push_back (AttributeSetter (i->first, *i->second));
+    }
+  for (std::vector<Ptr<Object> >::const_iterator i = objects.begin (); i != objects.end (); ++i)
+    {
+      for (std::vector<AttributeSetter>::iterator j = setters.begin (); j != setters.end (); ++j)
+        {
+          j->Set (*i);
+        }
+    }
+}
+void
+Path::Connect (std::string name, const CallbackBase &cb) const
+{
+  NS_LOG_FUNCTION (this << name << &cb);
+  LookupMatches ().Connect (name, cb);
+}
+void
+Path::ConnectWithoutContext (std::string name, const CallbackBase &cb) const
+{
+  NS_LOG_FUNCTION (this << name << &cb);
+  std::vector<Ptr<Object> > objects;
+  Resolve (&objects, 0);
+  TraceSourceFinder finder (name);
+  for (std::vector<Ptr<Object> >::const_iterator i = objects.begin (); i != objects.end (); ++i)
+    {
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (*i);
+      if (accessor != 0)
+        {
+          accessor->ConnectWithoutContext (PeekPointer (*i), cb);
+        }
+    }
+}
+void
+Path::Disconnect (std::string name, const CallbackBase &cb) const
+{
+  NS_LOG_FUNCTION (this << name << &cb);
+  LookupMatches ().Disconnect (name, cb);
+}
+void
+Path::DisconnectWithoutContext (std::string name, const CallbackBase &cb) const
+{
+  NS_LOG_FUNCTION (this << name << &cb);
+  std::vector<Ptr<Object> > objects;
+  Resolve (&objects, 0);
+  TraceSourceFinder finder (name);
+  for (std::vector<Ptr<Object> >::const_iterator i = objects.begin (); i != objects.end (); ++i)
+    {
+      Ptr<const TraceSourceAccessor> accessor = finder.Find (*i);
+      if (accessor != 0)
+        {
+          accessor->DisconnectWithoutContext (PeekPointer (*i), cb);
+        }
+    }
+}
 
 void RegisterRootNamespaceObject (Ptr<Object> obj)
 {
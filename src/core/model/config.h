@@ -22,6 +22,7 @@
 
 #include "ptr.h"
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -35,6 +36,7 @@ namespace ns3 {
 class AttributeValue;
 class Object;
 class CallbackBase;
+class CompiledPath;
 
 /**
  * \ingroup core
@@ -246,6 +248,130 @@ private:
  */
 MatchContainer LookupMatches (std::string path);
 
+/**
+ * \ingroup config
+ * A list of attribute names and values, see Config::SetMany.
+ */
+typedef std::vector<std::pair<std::string, Ptr<const AttributeValue> > > AttributeValueList;
+
+/**
+ * \ingroup config
+ * \param path a path to match objects, as for Config::LookupMatches.
+ * \param values the names and the values of the attributes to set.
+ *
+ * Set several attributes of all the objects which match the input
+ * path. The path is resolved once: this is faster than a call to
+ * Config::Set for each attribute.
+ */
+void SetMany (std::string path, const AttributeValueList &values);
+
+/**
+ * \ingroup config
+ * \brief a path to match objects, parsed once
+ *
+ * Config::Set, Config::Connect and Config::LookupMatches parse their
+ * path on each call. A Path parses it once, and can then be resolved
+ * many times, for example to connect several trace sources under the
+ * same objects:
+ * \code
+ *   Config::Path path ("/NodeList/[0-99]/DeviceList/[0]/$ns3::PointToPointNetDevice");
+ *   path.ConnectWithoutContext ("MacTx", MakeCallback (&MacTx));
+ *   path.ConnectWithoutContext ("MacRx", MakeCallback (&MacRx));
+ * \endcode
+ *
+ * The objects are matched again at each call, so the path sees the
+ * objects created since it was built. The attributes which lead from
+ * an object to the next item of the path are looked up once per type
+ * of object.
+ */
+class Path
+{
+public:
+  /**
+   * \param path a path to match objects, as for Config::LookupMatches.
+   */
+  Path (std::string path);
+  /**
+   * \param o the path to copy.
+   */
+  Path (const Path &o);
+  /**
+   * \param o the path to copy.
+   * \returns this path.
+   */
+  Path & operator = (const Path &o);
+  ~Path ();
+
+  /**
+   * \returns the path used to perform the object matching.
+   */
+  std::string GetPath (void) const;
+  /**
+   * \returns a container which contains all the objects which match
+   *          the path.
+   * \sa ns3::Config::LookupMatches
+   */
+  MatchContainer LookupMatches (void) const;
+
+  /**
+   * \param name name of attribute to set
+   * \param value value to set to the attribute
+   *
+   * Set the specified attribute value to all the objects which match
+   * the path.
+   * \sa ns3::Config::Set
+   */
+  void Set (std::string name, const AttributeValue &value) const;
+  /**
+   * \param values the names and the values of the attributes to set.
+   *
+   * Set the specified attribute values to all the objects which match
+   * the path.
+   * \sa ns3::Config::SetMany
+   */
+  void SetMany (const AttributeValueList &values) const;
+  /**
+   * \param name the name of the trace source to connect to
+   * \param cb the sink to connect to the trace source
+   *
+   * \sa ns3::Config::Connect
+   */
+  void Connect (std::string name, const CallbackBase &cb) const;
+  /**
+   * \param name the name of the trace source to connect to
+   * \param cb the sink to connect to the trace source
+   *
+   * \sa ns3::Config::ConnectWithoutContext
+   */
+  void ConnectWithoutContext (std::string name, const CallbackBase &cb) const;
+  /**
+   * \param name the name of the trace source to disconnect from
+   * \param cb the sink to disconnect from the trace source
+   *
+   * \sa ns3::Config::Disconnect
+   */
+  void Disconnect (std::string name, const CallbackBase &cb) const;
+  /**
+   * \param name the name of the trace source to disconnect from
+   * \param cb the sink to disconnect from the trace source
+   *
+   * \sa ns3::Config::DisconnectWithoutContext
+   */
+  void DisconnectWithoutContext (std::string name, const CallbackBase &cb) const;
+
+private:
+  /**
+   * \param objects the objects which match the path.
+   * \param contexts if not null, the matched path of each object.
+   */
+  void Resolve (std::vector<Ptr<Object> > *objects,
+                std::vector<std::string> *contexts) const;
+
+  std::string m_path;
+  // the parsed path, shared by the copies
+  Ptr<CompiledPath> m_compiled;
+};
+
 /**
  * \ingroup config
  * \param obj a new root object
@@ -25,10 +25,13 @@
 
 #include "ptr.h"
 #include "pointer.h"
+#include "string.h"
 #include "assert.h"
 #include "log.h"
 
 #include <cmath>
+#include <fstream>
+#include <iostream>
 
 
 /**
@@ -53,6 +56,22 @@ DefaultSimulatorImpl::GetTypeId (void)
     .SetParent<SimulatorImpl> ()
     .SetGroupName ("Core")
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("ProfileReport",
+                   "If not empty, the wall clock time of the events is recorded "
+                   "per event type and per context, and a report sorted by time "
+                   "is written to this file by Simulator::Destroy. "
+                   "\"-\" is the standard output.",
+                   StringValue (""),
+                   MakeStringAccessor (&DefaultSimulatorImpl::m_profileReport),
+                   MakeStringChecker ())
+    .AddAttribute ("ProfileFolded",
+                   "If not empty, the wall clock time of the events is recorded "
+                   "per event type and per context, and written to this file by "
+                   "Simulator::Destroy in the folded stack format of the flame "
+                   "graph tools.",
+                   StringValue (""),
+                   MakeStringAccessor (&DefaultSimulatorImpl::m_profileFolded),
+                   MakeStringChecker ())
   ;
   return tid;
 }
@@ -71,8 +90,9 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentTs = 0;
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
-  m_eventsWithContextEmpty = true;
+  m_removeOnCancel = false;
   m_main = SystemThread::Self();
+  m_profiler = 0;
 }
 
 DefaultSimulatorImpl::~DefaultSimulatorImpl ()
@@ -90,6 +110,8 @@ DefaultSimulatorImpl::DoDispose (void)
       next.impl->Unref ();
     }
   m_events = 0;
+  delete m_profiler;
+  m_profiler = 0;
   SimulatorImpl::DoDispose ();
 }
 void
@@ -106,6 +128,40 @@ DefaultSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+  if (m_profiler != 0)
+    {
+      WriteProfile ();
+      delete m_profiler;
+      m_profiler = 0;
+    }
+}
+
+void
+DefaultSimulatorImpl::WriteProfile (void) const
+{
+  NS_LOG_FUNCTION (this);
+  if (m_profileReport == "-")
+    {
+      m_profiler->PrintReport (std::cout);
+    }
+  else if (!m_profileReport.empty ())
+    {
+      std::ofstream os (m_profileReport.c_str ());
+      if (!os.is_open ())
+        {
+          NS_FATAL_ERROR ("Can not open profile report file " << m_profileReport);
+        }
+      m_profiler->PrintReport (os);
+    }
+  if (!m_profileFolded.empty ())
+    {
+      std::ofstream os (m_profileFolded.c_str ());
+      if (!os.is_open ())
+        {
+          NS_FATAL_ERROR ("Can not open profile file " << m_profileFolded);
+        }
+      m_profiler->PrintFolded (os);
+    }
 }
 
 void
@@ -123,6 +179,7 @@ DefaultSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
         }
     }
   m_events = scheduler;
+  m_removeOnCancel = scheduler->IsRemoveCheap ();
 }
 
 // System ID for non-distributed simulation is always zero
@@ -132,6 +189,7 @@ DefaultSimulatorImpl::GetSystemId (void) const
   return 0;
 }
 
+template <bool PROFILE>
 void
 DefaultSimulatorImpl::ProcessOneEvent (void)
 {
@@ -144,7 +202,14 @@ DefaultSimulatorImpl::ProcessOneEvent (void)
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
-  next.impl->Invoke ();
+  if (PROFILE)
+    {
+      m_profiler->Invoke (next.impl, m_currentContext);
+    }
+  else
+    {
+      next.impl->Invoke ();
+    }
   next.impl->Unref ();
 
   ProcessEventsWithContext ();
@@ -159,22 +224,14 @@ DefaultSimulatorImpl::IsFinished (void) const
 void
 DefaultSimulatorImpl::ProcessEventsWithContext (void)
 {
-  if (m_eventsWithContextEmpty)
+  if (m_eventsWithContext.IsEmpty ())
     {
       return;
     }
 
-  // swap queues
-  EventsWithContext eventsWithContext;
-  {
-    CriticalSection cs (m_eventsWithContextMutex);
-    m_eventsWithContext.swap(eventsWithContext);
-    m_eventsWithContextEmpty = true;
-  }
-  while (!eventsWithContext.empty ())
+  EventWithContext event;
+  while (m_eventsWithContext.Pop (event))
     {
-       EventWithContext event = eventsWithContext.front ();
-       eventsWithContext.pop_front ();
        Scheduler::Event ev;
        ev.impl = event.event;
        ev.key.m_ts = m_currentTs + event.timestamp;
@@ -195,9 +252,24 @@ DefaultSimulatorImpl::Run (void)
   ProcessEventsWithContext ();
   m_stop = false;
 
-  while (!m_events->IsEmpty () && !m_stop) 
+  if (m_profiler == 0 && (!m_profileReport.empty () || !m_profileFolded.empty ()))
     {
-      ProcessOneEvent ();
+      m_profiler = new EventProfiler ();
+    }
+
+  if (m_profiler == 0)
+    {
+      while (!m_events->IsEmpty () && !m_stop) 
+        {
+          ProcessOneEvent<false> ();
+        }
+    }
+  else
+    {
+      while (!m_events->IsEmpty () && !m_stop) 
+        {
+          ProcessOneEvent<true> ();
+        }
     }
 
   // If the simulator stopped naturally by lack of events, make a
@@ -266,11 +338,7 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, E
       ev.context = context;
       ev.timestamp = time.GetTimeStep ();
       ev.event = event;
-      {
-        CriticalSection cs (m_eventsWithContextMutex);
-        m_eventsWithContext.push_back(ev);
-        m_eventsWithContextEmpty = false;
-      }
+      m_eventsWithContext.Push (ev);
     }
 }
 
@@ -357,7 +425,16 @@ DefaultSimulatorImpl::Remove (const EventId &id)
 void
 DefaultSimulatorImpl::Cancel (const EventId &id)
 {
-  if (!IsExpired (id))
+  if (IsExpired (id))
+    {
+      return;
+    }
+  if (m_removeOnCancel && id.GetUid () != 2)
+    {
+      // do not keep the cancelled event in the event list
+      Remove (id);
+    }
+  else
     {
       id.PeekEventImpl ()->Cancel ();
     }
@@ -25,11 +25,13 @@
 #include "scheduler.h"
 #include "event-impl.h"
 #include "system-thread.h"
-#include "ns3/system-mutex.h"
+#include "mpsc-queue.h"
+#include "event-profiler.h"
 
 #include "ptr.h"
 
 #include <list>
+#include <string>
 
 /**
  * \file
@@ -73,7 +75,16 @@ public:
 
 private:
   virtual void DoDispose (void);
+  /**
+   * Run the next event.
+   * \tparam PROFILE Whether the time of the event is recorded by
+   *         m_profiler. Run chooses the instance once, so the loop
+   *         without profiling has no test per event.
+   */
+  template <bool PROFILE>
   void ProcessOneEvent (void);
+  /** Write the reports of m_profiler to the files set by the attributes. */
+  void WriteProfile (void) const;
   void ProcessEventsWithContext (void);
  
   struct EventWithContext {
@@ -81,15 +92,15 @@ private:
     uint64_t timestamp;
     EventImpl *event;
   };
-  typedef std::list<struct EventWithContext> EventsWithContext;
-  EventsWithContext m_eventsWithContext;
-  bool m_eventsWithContextEmpty;
-  SystemMutex m_eventsWithContextMutex;
+  // events scheduled from other threads, without a lock
+  MpscQueue<struct EventWithContext> m_eventsWithContext;
 
   typedef std::list<EventId> DestroyEvents;
   DestroyEvents m_destroyEvents;
   bool m_stop;
   Ptr<Scheduler> m_events;
+  // cancelled events are removed from m_events, see Scheduler::IsRemoveCheap
+  bool m_removeOnCancel;
 
   uint32_t m_uid;
   uint32_t m_currentUid;
@@ -100,6 +111,12 @@ private:
   int m_unscheduledEvents;
 
   SystemThread::ThreadId m_main;
+
+  // the profile is written to these files, if set
+  std::string m_profileReport;
+  std::string m_profileFolded;
+  // created by Run when one of the files is set
+  EventProfiler *m_profiler;
 };
 
 } // namespace ns3
@@ -20,6 +20,7 @@
 #ifndef EVENT_IMPL_H
 #define EVENT_IMPL_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "simple-ref-count.h"
 
@@ -66,6 +67,22 @@ public:
    */
   bool IsCancelled (void);
 
+  /**
+   * Events are allocated from the SmallObjectPool: they are created and
+   * destroyed at a high rate, and most of them are of a few sizes only.
+   *
+   * \param [in] size The size of the event.
+   * \returns The memory for the event.
+   */
+  static void * operator new (size_t size);
+  /**
+   * The destructor is virtual, so size is the one of the actual event.
+   *
+   * \param [in] p The event memory.
+   * \param [in] size The size of the event.
+   */
+  static void operator delete (void *p, size_t size);
+
 protected:
   /**
    * Implementation for Invoke().
@@ -0,0 +1,229 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-profiler.h"
+#include "event-impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#if (__GNUC__ >= 3)
+#include <cxxabi.h>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * Implementation of class ns3::EventProfiler.
+ */
+
+namespace ns3 {
+
+namespace {
+
+/** A line of a report: a name and its stats. */
+typedef std::pair<std::string, std::pair<uint64_t, uint64_t> > Line;
+
+/**
+ * Order the lines of a report by decreasing time, then by name.
+ * \param [in] a A line.
+ * \param [in] b Another line.
+ * \returns true if a comes before b.
+ */
+bool
+CompareLines (const Line &a, const Line &b)
+{
+  if (a.second.second != b.second.second)
+    {
+      return a.second.second > b.second.second;
+    }
+  return a.first < b.first;
+}
+
+/**
+ * Print a table of a report.
+ * \param [in] os The output stream.
+ * \param [in] title The title of the table.
+ * \param [in] lines The lines of the table.
+ * \param [in] total The total time, in nanoseconds.
+ */
+void
+PrintTable (std::ostream &os, std::string title,
+            std::vector<Line> lines, uint64_t total)
+{
+  std::sort (lines.begin (), lines.end (), &CompareLines);
+  os << title << ":" << std::endl
+     << std::setw (12) << "time (ms)"
+     << std::setw (8) << "share"
+     << std::setw (12) << "count"
+     << std::setw (12) << "mean (us)"
+     << "  " << "name" << std::endl;
+  for (std::vector<Line>::const_iterator i = lines.begin (); i != lines.end (); ++i)
+    {
+      uint64_t count = i->second.first;
+      uint64_t ns = i->second.second;
+      os << std::setw (12) << ns / 1e6
+         << std::setw (7) << (total > 0 ? 100.0 * ns / total : 0.0) << "%"
+         << std::setw (12) << count
+         << std::setw (12) << (count > 0 ? ns / 1e3 / count : 0.0)
+         << "  " << i->first << std::endl;
+    }
+}
+
+} // unnamed namespace
+
+EventProfiler::EventProfiler ()
+{
+}
+
+void
+EventProfiler::Invoke (EventImpl *event, uint32_t context)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  event->Invoke ();
+  std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now () - start;
+  Record (typeid (*event), context,
+          std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count ());
+}
+
+void
+EventProfiler::Record (const std::type_info &type, uint32_t context, uint64_t ns)
+{
+  Stats &stats = m_stats[std::type_index (type)][context];
+  stats.count++;
+  stats.ns += ns;
+  m_total.count++;
+  m_total.ns += ns;
+}
+
+void
+EventProfiler::PrintReport (std::ostream &os) const
+{
+  std::vector<Line> types;
+  std::map<uint32_t, std::pair<uint64_t, uint64_t> > contexts;
+  for (TypeStats::const_iterator i = m_stats.begin (); i != m_stats.end (); ++i)
+    {
+      Line type (GetTypeName (i->first), std::make_pair (0, 0));
+      for (ContextStats::const_iterator j = i->second.begin (); j != i->second.end (); ++j)
+        {
+          type.second.first += j->second.count;
+          type.second.second += j->second.ns;
+          contexts[j->first].first += j->second.count;
+          contexts[j->first].second += j->second.ns;
+        }
+      types.push_back (type);
+    }
+  std::vector<Line> lines;
+  for (std::map<uint32_t, std::pair<uint64_t, uint64_t> >::const_iterator i = contexts.begin ();
+       i != contexts.end (); ++i)
+    {
+      lines.push_back (Line (GetContextName (i->first), i->second));
+    }
+
+  std::ios_base::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os << std::fixed << std::setprecision (3);
+  os << "Event profile: " << m_total.count << " events, "
+     << m_total.ns / 1e6 << " ms" << std::endl;
+  PrintTable (os, "Per event type", types, m_total.ns);
+  PrintTable (os, "Per context", lines, m_total.ns);
+  os.flags (flags);
+  os.precision (precision);
+}
+
+void
+EventProfiler::PrintFolded (std::ostream &os) const
+{
+  std::vector<Line> lines;
+  for (TypeStats::const_iterator i = m_stats.begin (); i != m_stats.end (); ++i)
+    {
+      std::string type = GetTypeName (i->first);
+      // ';' separates the frames of a stack
+      std::replace (type.begin (), type.end (), ';', ',');
+      for (ContextStats::const_iterator j = i->second.begin (); j != i->second.end (); ++j)
+        {
+          std::string stack = GetContextName (j->first) + ";" + type;
+          lines.push_back (Line (stack, std::make_pair (j->second.count, j->second.ns)));
+        }
+    }
+  std::sort (lines.begin (), lines.end (), &CompareLines);
+  for (std::vector<Line>::const_iterator i = lines.begin (); i != lines.end (); ++i)
+    {
+      os << i->first << " " << i->second.second << std::endl;
+    }
+}
+
+std::string
+EventProfiler::GetTypeName (std::type_index type)
+{
+  std::string name = type.name ();
+#if (__GNUC__ >= 3)
+  int status;
+  char *demangled = abi::__cxa_demangle (type.name (), NULL, NULL, &status);
+  if (status == 0)
+    {
+      name = demangled;
+    }
+  std::free (demangled);
+#endif
+  // the events are local classes of the MakeEvent functions, which
+  // return an EventImpl pointer
+  std::string prefix = "ns3::EventImpl* ";
+  if (name.compare (0, prefix.size (), prefix) == 0)
+    {
+      name = name.substr (prefix.size ());
+    }
+  // the parameters of MakeEvent repeat its template arguments: keep
+  // only MakeEvent<...> and the name of the local class
+  std::string::size_type open = name.find ('<');
+  std::string::size_type local = name.rfind ("::");
+  if (name.compare (0, open, "ns3::MakeEvent") == 0 && local != std::string::npos)
+    {
+      int depth = 0;
+      for (std::string::size_type i = open; i < local; i++)
+        {
+          if (name[i] == '<')
+            {
+              depth++;
+            }
+          else if (name[i] == '>' && --depth == 0)
+            {
+              return name.substr (0, i + 1) + name.substr (local);
+            }
+        }
+    }
+  return name;
+}
+
+std::string
+EventProfiler::GetContextName (uint32_t context)
+{
+  if (context == 0xffffffff)
+    {
+      return "no context";
+    }
+  std::ostringstream oss;
+  oss << "node " << context;
+  return oss.str ();
+}
+
+} // namespace ns3
@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+/**
+ * \file
+ * \ingroup simulator
+ * Declaration of class ns3::EventProfiler.
+ */
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup simulator
+ * \brief accumulate the wall clock time spent in the events
+ *
+ * The time and the number of events are attributed to the type of the
+ * events, and to their context. The type of an event is the MakeEvent
+ * instantiation which created it: its name carries the signature of the
+ * function and, for a member function, the type of the object. The
+ * context of an event is its node id, see Simulator::GetContext.
+ *
+ * DefaultSimulatorImpl uses an EventProfiler when its ProfileReport or
+ * ProfileFolded attribute is set, and writes the results at
+ * Simulator::Destroy.
+ */
+class EventProfiler
+{
+public:
+  EventProfiler ();
+
+  /**
+   * Invoke an event and record the time it took.
+   * \param [in] event The event.
+   * \param [in] context The context of the event.
+   */
+  void Invoke (EventImpl *event, uint32_t context);
+  /**
+   * Record an event.
+   * \param [in] type The type of the event.
+   * \param [in] context The context of the event.
+   * \param [in] ns The wall clock time of the event, in nanoseconds.
+   */
+  void Record (const std::type_info &type, uint32_t context, uint64_t ns);
+  /**
+   * Print the time and the count of the events, per type and per
+   * context, sorted by decreasing time.
+   * \param [in] os The output stream.
+   */
+  void PrintReport (std::ostream &os) const;
+  /**
+   * Print the time of the events in the folded stack format of the
+   * flame graph tools: one line per context and type, with the context
+   * as the caller of the type, followed by the time in nanoseconds.
+   * \param [in] os The output stream.
+   */
+  void PrintFolded (std::ostream &os) const;
+
+  /**
+   * \param [in] type The type of an event.
+   * \returns The readable name of the type.
+   */
+  static std::string GetTypeName (std::type_index type);
+  /**
+   * \param [in] context The context of an event.
+   * \returns The name of the context, as in the reports.
+   */
+  static std::string GetContextName (uint32_t context);
+
+private:
+  /** The count and the time of a set of events. */
+  struct Stats
+  {
+    Stats () : count (0), ns (0) {}
+    uint64_t count;  /**< The number of events. */
+    uint64_t ns;     /**< The total time, in nanoseconds. */
+  };
+  /** The stats of the events of a type, per context. */
+  typedef std::unordered_map<uint32_t, Stats> ContextStats;
+  /** The stats of the events, per type. */
+  typedef std::unordered_map<std::type_index, ContextStats> TypeStats;
+
+  TypeStats m_stats;   /**< The stats of the events. */
+  Stats m_total;       /**< The stats of all the events. */
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
@@ -31,7 +31,8 @@
 /**
  * \file
  * \ingroup fatalimpl
- * \brief Implementation of RegisterStream(), UnregisterStream(), and FlushStreams(); see Implementation note!
+ * \brief Implementation of RegisterStream(), UnregisterStream(), RegisterHook(),
+ * UnregisterHook() and FlushStreams(); see Implementation note!
  *
  * \note Implementation.
  *
@@ -117,6 +118,20 @@ struct destructor
     *pstreams = 0;
   }
 };
+
+/**
+ * \ingroup fatalimpl
+ * \brief Static variable pointing to the list of functions to be
+ * called on fatal errors.
+ *
+ * \returns The address of the static pointer.
+ */
+std::list<void (*)(void)> **PeekHookList (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  static std::list<void (*)(void)> *hooks = 0;
+  return &hooks;
+}
 }  // anonymous namespace
 
 void
@@ -143,6 +158,35 @@ UnregisterStream (std::ostream* stream)
     }
 }
 
+void
+RegisterHook (void (*hook)(void))
+{
+  NS_LOG_FUNCTION (hook);
+  std::list<void (*)(void)> **pl = PeekHookList ();
+  if (*pl == 0)
+    {
+      *pl = new std::list<void (*)(void)> ();
+    }
+  (*pl)->push_back (hook);
+}
+
+void
+UnregisterHook (void (*hook)(void))
+{
+  NS_LOG_FUNCTION (hook);
+  std::list<void (*)(void)> **pl = PeekHookList ();
+  if (*pl == 0)
+    {
+      return;
+    }
+  (*pl)->remove (hook);
+  if ((*pl)->empty ())
+    {
+      delete *pl;
+      *pl = 0;
+    }
+}
+
 /**
  * \ingroup fatalimpl
  * Anonymous namespace for fatal streams signal hander.
@@ -172,6 +216,19 @@ void
 FlushStreams (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  /* The hooks may write to the registered streams, so call them first */
+  std::list<void (*)(void)> **hl = PeekHookList ();
+  if (*hl != 0)
+    {
+      std::list<void (*)(void)> *hooks = *hl;
+      *hl = 0;
+      for (std::list<void (*)(void)>::const_iterator i = hooks->begin (); i != hooks->end (); ++i)
+        {
+          (*i)();
+        }
+      delete hooks;
+    }
+
   std::list<std::ostream*> **pl = PeekStreamList ();
   if (*pl == 0)
     {
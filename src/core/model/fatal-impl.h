@@ -26,7 +26,8 @@
 /**
  * \file
  * \ingroup fatalimpl
- * \brief Declaration of RegisterStream(), UnregisterStream(), and FlushStreams().
+ * \brief Declaration of RegisterStream(), UnregisterStream(), RegisterHook(),
+ * UnregisterHook() and FlushStreams().
  */
 
 /**
@@ -72,12 +73,37 @@ void RegisterStream (std::ostream* stream);
  */
 void UnregisterStream (std::ostream* stream);
 
+/**
+ * \ingroup fatalimpl
+ *
+ * \brief Register a function to be called on abnormal exit.
+ *
+ * The hooks are called by FlushStreams(), before the streams are
+ * flushed, for the output which is not (yet) in the buffer of a
+ * registered stream, such as records queued to another thread.
+ *
+ * \param hook The function to be called on abnormal exit.
+ */
+void RegisterHook (void (*hook)(void));
+
+/**
+ * \ingroup fatalimpl
+ *
+ * \brief Unregister a function to be called on abnormal exit.
+ *
+ * If the function is not registered, nothing will happen.
+ *
+ * \param hook The function to be unregistered.
+ */
+void UnregisterHook (void (*hook)(void));
+
 /**
  * \ingroup fatalimpl
  *
  * \brief Flush all currently registered streams.
  *
- * This function iterates through each registered stream and
+ * This function first calls and unregisters each registered hook.
+ * It then iterates through each registered stream and
  * unregisters them. The default \c SIGSEGV handler is overridden
  * when this function is being executed, and will be restored
  * when this function returns.
@@ -50,6 +50,8 @@ class int64x64_t
   static const uint64_t    HP_MASK_LO = 0xffffffffffffffffULL;
   /// Mask for sign + integer part.
   static const uint64_t    HP_MASK_HI = ~HP_MASK_LO;
+  /// Bound of the integer part of the operands of the fast paths.
+  static const int64_t     HP_SMALL = 1LL << 31;
   /**
    * Floating point value of HP_MASK_LO + 1.
    * We really want:
@@ -272,6 +274,33 @@ private:
   friend int64x64_t   operator -  (const int64x64_t & lhs);
   friend int64x64_t   operator !  (const int64x64_t & lhs);
 
+  /**
+   * \return \c true if this value is an integer in [-2^31, 2^31).
+   */
+  inline bool IsSmallInteger (void) const
+  {
+    return (_v & HP_MASK_LO) == 0 && GetHigh () >= -HP_SMALL && GetHigh () < HP_SMALL;
+  }
+  /**
+   * \return \c true if the product of this value and a small
+   * integer fits in 128 bits.
+   */
+  inline bool IsSmall (void) const
+  {
+    return GetHigh () >= -HP_SMALL && GetHigh () < HP_SMALL;
+  }
+  /**
+   * Implement `/=` by an integer, with the same result as Div.
+   *
+   * \param [in] v The divisor, not null.
+   */
+  inline void DivByInteger (const int64_t v)
+  {
+    bool negative = (_v < 0) != (v < 0);
+    uint128_t a = _v < 0 ? -_v : _v;
+    uint128_t result = a / (uint128_t)(v < 0 ? -v : v);
+    _v = negative ? -result : result;
+  }
   /**
    * Implement `*=`.
    *
@@ -390,7 +419,19 @@ inline int64x64_t & operator -= (int64x64_t & lhs, const int64x64_t & rhs)
  */
 inline int64x64_t & operator *= (int64x64_t & lhs, const int64x64_t & rhs)
 {
-  lhs.Mul (rhs);
+  // A small integer factor gives an exact product, which fits in 128 bits
+  if (rhs.IsSmallInteger () && lhs.IsSmall ())
+    {
+      lhs._v *= rhs.GetHigh ();
+    }
+  else if (lhs.IsSmallInteger () && rhs.IsSmall ())
+    {
+      lhs._v = rhs._v * lhs.GetHigh ();
+    }
+  else
+    {
+      lhs.Mul (rhs);
+    }
   return lhs;
 }
 /**
@@ -399,7 +440,15 @@ inline int64x64_t & operator *= (int64x64_t & lhs, const int64x64_t & rhs)
  */
 inline int64x64_t & operator /= (int64x64_t & lhs, const int64x64_t & rhs)
 {
-  lhs.Div (rhs);
+  // Dividing by an integer is a single 128 bit division
+  if (rhs.IsSmallInteger () && rhs._v != 0)
+    {
+      lhs.DivByInteger (rhs.GetHigh ());
+    }
+  else
+    {
+      lhs.Div (rhs);
+    }
   return lhs;
 }
 
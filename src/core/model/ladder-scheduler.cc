@@ -0,0 +1,328 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+#include <functional>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Implementation of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+namespace {
+
+/** Buckets with at most this many events are sorted into the bottom. */
+const uint32_t BOTTOM_LIMIT = 64;
+/** Maximum number of rungs of the ladder. */
+const uint32_t MAX_RUNGS = 8;
+
+/** Descending order of the events, for the bottom. */
+struct EventGreater
+{
+  bool operator () (const Scheduler::Event &a, const Scheduler::Event &b) const
+  {
+    return a.key > b.key;
+  }
+};
+
+} // anonymous namespace
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (0),
+    m_topMax (0),
+    m_nRungs (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+  // references to the buckets are held while a new rung is added
+  m_rungs.reserve (MAX_RUNGS);
+}
+
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::RungCurrentStart (const Rung &rung) const
+{
+  return rung.start + rung.current * rung.width;
+}
+
+uint32_t
+LadderScheduler::FindRung (uint64_t ts) const
+{
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      if (ts >= RungCurrentStart (m_rungs[i]))
+        {
+          return i;
+        }
+    }
+  return m_nRungs;
+}
+
+void
+LadderScheduler::SpawnRung (Bucket &events, uint64_t start, uint64_t end)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << end);
+  NS_ASSERT (m_nRungs < MAX_RUNGS && !events.empty () && end > start);
+  uint64_t n = events.size ();
+  uint64_t range = end - start;
+  uint64_t width = range / n + (range % n != 0 ? 1 : 0);
+  uint64_t nBuckets = range / width + (range % width != 0 ? 1 : 0);
+
+  if (m_rungs.size () == m_nRungs)
+    {
+      m_rungs.push_back (Rung ());
+    }
+  Rung &rung = m_rungs[m_nRungs++];
+  rung.start = start;
+  rung.width = width;
+  rung.current = 0;
+  rung.count = n;
+  rung.buckets.resize (nBuckets);
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      rung.buckets[(i->key.m_ts - start) / width].push_back (*i);
+    }
+  events.clear ();
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  Bucket::iterator pos = std::upper_bound (m_bottom.begin (), m_bottom.end (), ev, EventGreater ());
+  m_bottom.insert (pos, ev);
+
+  // many events below the ladder, e.g. a burst of near-future timers:
+  // spread them over a new rung instead of keeping a long sorted vector
+  if (m_bottom.size () > 2 * BOTTOM_LIMIT && m_nRungs < MAX_RUNGS
+      && m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      uint64_t end = m_nRungs > 0 ? RungCurrentStart (m_rungs[m_nRungs - 1]) : m_topStart;
+      SpawnRung (m_bottom, m_bottom.back ().key.m_ts, end);
+    }
+}
+
+void
+LadderScheduler::MoveToBottom (Bucket &events)
+{
+  NS_ASSERT (m_bottom.empty ());
+  std::sort (events.begin (), events.end (), EventGreater ());
+  m_bottom.swap (events);
+}
+
+void
+LadderScheduler::Refill (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_bottom.empty ());
+  while (true)
+    {
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          uint64_t end = m_topMax + 1;
+          if (m_top.size () <= BOTTOM_LIMIT || m_topMin == m_topMax)
+            {
+              MoveToBottom (m_top);
+            }
+          else
+            {
+              SpawnRung (m_top, m_topMin, end);
+            }
+          m_topStart = end;
+          if (!m_bottom.empty ())
+            {
+              return;
+            }
+          continue;
+        }
+
+      Rung &rung = m_rungs[m_nRungs - 1];
+      if (rung.count == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t end = rung.start + (rung.current + 1) * rung.width;
+      rung.current++;
+      rung.count -= bucket.size ();
+
+      if (bucket.size () <= BOTTOM_LIMIT || m_nRungs == MAX_RUNGS || rung.width == 1)
+        {
+          MoveToBottom (bucket);
+          return;
+        }
+      uint64_t min = bucket.front ().key.m_ts;
+      uint64_t max = min;
+      for (Bucket::const_iterator i = bucket.begin (); i != bucket.end (); ++i)
+        {
+          min = std::min (min, i->key.m_ts);
+          max = std::max (max, i->key.m_ts);
+        }
+      if (min == max)
+        {
+          MoveToBottom (bucket);
+          return;
+        }
+      // the new rung must end where the current bucket of this one ends,
+      // so that it can take all the events inserted later below that
+      SpawnRung (bucket, min, end);
+    }
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_size++;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  uint32_t i = FindRung (ts);
+  if (i < m_nRungs)
+    {
+      Rung &rung = m_rungs[i];
+      rung.buckets[(ts - rung.start) / rung.width].push_back (ev);
+      rung.count++;
+      return;
+    }
+  InsertBottom (ev);
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      // sorting the next bucket does not change the content of the queue
+      const_cast<LadderScheduler *> (this)->Refill ();
+    }
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      Refill ();
+    }
+  Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  NS_LOG_DEBUG (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  return ev;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  Bucket *bucket;
+  if (ts >= m_topStart)
+    {
+      bucket = &m_top;
+    }
+  else
+    {
+      uint32_t i = FindRung (ts);
+      if (i == m_nRungs)
+        {
+          Bucket::iterator pos = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, EventGreater ());
+          NS_ASSERT (pos != m_bottom.end () && pos->impl == ev.impl);
+          m_bottom.erase (pos);
+          m_size--;
+          return;
+        }
+      Rung &rung = m_rungs[i];
+      bucket = &rung.buckets[(ts - rung.start) / rung.width];
+      rung.count--;
+    }
+  // the top and the buckets are not sorted
+  for (Bucket::iterator i = bucket->begin (); i != bucket->end (); ++i)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          *i = bucket->back ();
+          bucket->pop_back ();
+          m_size--;
+          return;
+        }
+    }
+  NS_ASSERT_MSG (false, "event not found");
+}
+
+} // namespace ns3
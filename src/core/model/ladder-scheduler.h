@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Declaration of ns3::LadderScheduler class.
+ */
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue described in
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation" by Tang, Goh and Thng (2005).
+ *
+ * Events are kept in three tiers:
+ *  - Top: an unsorted vector of the far-future events.
+ *  - Ladder: up to MAX_RUNGS rungs of buckets. A rung is created by
+ *    spreading the content of the Top, or of one bucket of the rung above,
+ *    over buckets of a smaller width. Buckets are not sorted.
+ *  - Bottom: the few earliest events, sorted by (timestamp, uid).
+ *
+ * Sorting is thus deferred until a bucket is small enough to move to
+ * the Bottom, which makes Insert and RemoveNext O(1) amortized for most
+ * event distributions. The events are returned in exactly the same
+ * (timestamp, uid) order as with the other schedulers.
+ *
+ * Remove searches the tier the event belongs to linearly; this is
+ * cheap for the Bottom and the rungs, but O(n) for the Top.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  struct Rung
+  {
+    uint64_t start;               // timestamp of the first bucket
+    uint64_t width;               // duration of a bucket
+    uint32_t current;             // first bucket which was not dequeued
+    uint32_t count;               // number of events in the rung
+    std::vector<Bucket> buckets;
+  };
+
+  // first timestamp which still goes into the rung
+  inline uint64_t RungCurrentStart (const Rung &rung) const;
+  // index of the rung the timestamp belongs to, m_nRungs for the bottom
+  uint32_t FindRung (uint64_t ts) const;
+  // spread events with timestamps in [start, end) over a new rung
+  void SpawnRung (Bucket &events, uint64_t start, uint64_t end);
+  void InsertBottom (const Event &ev);
+  // sort the events in descending order and make them the new bottom
+  void MoveToBottom (Bucket &events);
+  // move the next events to the bottom, which must be empty
+  void Refill (void);
+
+  Bucket m_top;
+  // all events with a timestamp of at least m_topStart are in the top
+  uint64_t m_topStart;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+
+  // rungs are reused, only the first m_nRungs of them are in use
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+
+  // sorted in descending order, the next event is at the back
+  Bucket m_bottom;
+
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
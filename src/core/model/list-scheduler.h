@@ -22,6 +22,7 @@
 #define LIST_SCHEDULER_H
 
 #include "scheduler.h"
+#include "pool-allocator.h"
 #include <list>
 #include <utility>
 #include <stdint.h>
@@ -58,8 +59,9 @@ public:
   virtual void Remove (const Event &ev);
 
 private:
-  typedef std::list<Event> Events;
-  typedef std::list<Event>::iterator EventsI;
+  /** The list nodes come from the SmallObjectPool. */
+  typedef std::list<Event, PoolAllocator<Event> > Events;
+  typedef Events::iterator EventsI;
   Events m_events;
 };
 
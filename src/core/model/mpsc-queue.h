@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+/**
+ * \file
+ * \ingroup thread
+ * Declaration and template implementation of ns3::MpscQueue.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup thread
+ * \brief a multiple producer, single consumer FIFO queue
+ *
+ * Any number of threads can Push without a lock: Push is wait-free,
+ * a single atomic exchange. A single thread, the consumer, calls
+ * IsEmpty and Pop.
+ *
+ * The items are kept in a singly linked list, from the oldest to the
+ * newest. A producer first exchanges the newest node with its own node,
+ * then links the previous newest node to it. Between these two steps,
+ * the items which follow are not visible yet: Pop returns false and the
+ * consumer gets them at its next attempt.
+ *
+ * \tparam T The type of the items, copied in and out of the queue.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+  MpscQueue ();
+  ~MpscQueue ();
+
+  /**
+   * Append an item. Can be called from any thread.
+   * \param [in] item The item.
+   */
+  void Push (const T &item);
+  /**
+   * Remove the oldest item. Must only be called from the consumer thread.
+   * \param [out] item The item.
+   * \returns false if no item was available.
+   */
+  bool Pop (T &item);
+  /**
+   * Must only be called from the consumer thread. This is a single
+   * relaxed load: items which were just pushed might not be seen yet.
+   * \returns true if no item is available.
+   */
+  bool IsEmpty (void) const;
+
+private:
+  /** A node of the list. */
+  struct Node
+  {
+    std::atomic<Node *> next;  /**< The next newer node. */
+    T item;                    /**< The item. */
+  };
+
+  /** Copying a queue is not supported. */
+  MpscQueue (const MpscQueue &);
+  /** Copying a queue is not supported. */
+  MpscQueue & operator = (const MpscQueue &);
+
+  /** The newest node, shared by the producers. */
+  std::atomic<Node *> m_head;
+  /** The node before the oldest item, owned by the consumer. */
+  Node *m_tail;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the templates declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+template <typename T>
+MpscQueue<T>::MpscQueue ()
+{
+  Node *stub = new Node ();
+  stub->next.store (0, std::memory_order_relaxed);
+  m_head.store (stub, std::memory_order_relaxed);
+  m_tail = stub;
+}
+
+template <typename T>
+MpscQueue<T>::~MpscQueue ()
+{
+  T item;
+  while (Pop (item))
+    {
+    }
+  delete m_tail;
+}
+
+template <typename T>
+void
+MpscQueue<T>::Push (const T &item)
+{
+  Node *node = new Node ();
+  node->next.store (0, std::memory_order_relaxed);
+  node->item = item;
+  Node *prev = m_head.exchange (node, std::memory_order_acq_rel);
+  prev->next.store (node, std::memory_order_release);
+}
+
+template <typename T>
+bool
+MpscQueue<T>::Pop (T &item)
+{
+  Node *next = m_tail->next.load (std::memory_order_acquire);
+  if (next == 0)
+    {
+      return false;
+    }
+  item = next->item;
+  // the node of the item becomes the one before the oldest item
+  delete m_tail;
+  m_tail = next;
+  return true;
+}
+
+template <typename T>
+bool
+MpscQueue<T>::IsEmpty (void) const
+{
+  return m_tail->next.load (std::memory_order_relaxed) == 0;
+}
+
+} // namespace ns3
+
+#endif /* MPSC_QUEUE_H */
@@ -472,6 +472,16 @@ public:
   inline int64x64_t To (enum Unit unit) const
   {
     struct Information *info = PeekInformation (unit);
+    // Integer fast path, when the product fits: it gives the same
+    // result as the high precision multiplication
+    if (info->toMul)
+      {
+        int64_t bound = std::numeric_limits<int64_t>::max () / info->factor;
+        if (m_data <= bound && m_data >= -bound)
+          {
+            return int64x64_t (m_data * info->factor);
+          }
+      }
     int64x64_t retval = int64x64_t (m_data);
     if (info->toMul)
       {
@@ -220,6 +220,26 @@ public:
   virtual bool Get (const ObjectBase * object, AttributeValue &value) const;
   virtual bool HasGetter (void) const;
   virtual bool HasSetter (void) const;
+  /**
+   * Get the number of instances in the container, without the copy
+   * of the whole container made by Get.
+   *
+   * \param [in] object The container object.
+   * \param [out] n The number of instances in the container.
+   * \returns true if the value could be obtained successfully.
+   */
+  bool GetItemN (const ObjectBase *object, uint32_t *n) const;
+  /**
+   * Get an instance from the container, without the copy of the whole
+   * container made by Get.
+   *
+   * \param [in] object The container object.
+   * \param [in] i The position of the instance, in [0, n[.
+   * \param [out] index The index of the instance, as in
+   *             ObjectPtrContainerValue.
+   * \returns The instance.
+   */
+  Ptr<Object> GetItem (const ObjectBase *object, uint32_t i, uint32_t *index) const;
 private:
   /**
    * Get the number of instances in the container.
@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pool-allocator.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * \file
+ * \ingroup core
+ * Implementation of ns3::SmallObjectPool.
+ */
+
+namespace ns3 {
+
+namespace {
+
+/** Number of size classes. */
+const size_t N_CLASSES = SmallObjectPool::MAX_SIZE / SmallObjectPool::GRANULARITY;
+/**
+ * Maximum number of free blocks kept per size class, so that a burst
+ * of events does not pin its memory for the rest of the simulation.
+ */
+const uint32_t MAX_FREE = 1 << 16;
+
+/** A free block, the link to the next one is stored in the block. */
+struct FreeBlock
+{
+  FreeBlock *next;
+};
+
+/** The free lists of one thread. */
+struct FreeLists
+{
+  FreeBlock *head[N_CLASSES];
+  uint32_t count[N_CLASSES];
+};
+
+/**
+ * The free lists of the current thread. This is a plain pointer, which
+ * stays valid after the thread-local destructors ran: it is then set to
+ * g_released and the blocks go straight to malloc and free.
+ */
+thread_local FreeLists *g_lists = 0;
+/** Marker for the threads whose free lists were released. */
+FreeLists g_released;
+
+/** Releases the free lists of a thread when it exits. */
+struct FreeListsReleaser
+{
+  ~FreeListsReleaser ()
+  {
+    FreeLists *lists = g_lists;
+    g_lists = &g_released;
+    if (lists == 0 || lists == &g_released)
+      {
+        return;
+      }
+    for (size_t i = 0; i < N_CLASSES; i++)
+      {
+        while (lists->head[i] != 0)
+          {
+            FreeBlock *block = lists->head[i];
+            lists->head[i] = block->next;
+            free (block);
+          }
+      }
+    free (lists);
+  }
+};
+thread_local FreeListsReleaser g_releaser;
+
+/**
+ * \returns the free lists of the current thread, or 0 if they were
+ * already released.
+ */
+FreeLists *
+GetFreeLists (void)
+{
+  FreeLists *lists = g_lists;
+  if (lists == 0)
+    {
+      lists = static_cast<FreeLists *> (calloc (1, sizeof (FreeLists)));
+      if (lists == 0)
+        {
+          throw std::bad_alloc ();
+        }
+      g_lists = lists;
+      // odr-use the releaser, so that its destructor is registered
+      (void) &g_releaser;
+    }
+  return lists != &g_released ? lists : 0;
+}
+
+} // anonymous namespace
+
+void *
+SmallObjectPool::Allocate (size_t size)
+{
+  if (size == 0 || size > MAX_SIZE)
+    {
+      return ::operator new (size);
+    }
+  size_t sizeClass = (size - 1) / GRANULARITY;
+  FreeLists *lists = GetFreeLists ();
+  if (lists != 0 && lists->head[sizeClass] != 0)
+    {
+      FreeBlock *block = lists->head[sizeClass];
+      lists->head[sizeClass] = block->next;
+      lists->count[sizeClass]--;
+      return block;
+    }
+  void *p = malloc ((sizeClass + 1) * GRANULARITY);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+SmallObjectPool::Deallocate (void *p, size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  if (size == 0 || size > MAX_SIZE)
+    {
+      ::operator delete (p);
+      return;
+    }
+  size_t sizeClass = (size - 1) / GRANULARITY;
+  FreeLists *lists = GetFreeLists ();
+  if (lists == 0 || lists->count[sizeClass] >= MAX_FREE)
+    {
+      free (p);
+      return;
+    }
+  FreeBlock *block = static_cast<FreeBlock *> (p);
+  block->next = lists->head[sizeClass];
+  lists->head[sizeClass] = block;
+  lists->count[sizeClass]++;
+}
+
+} // namespace ns3
@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <stddef.h>
+#include <limits>
+#include <new>
+
+/**
+ * \file
+ * \ingroup core
+ * Declaration of ns3::SmallObjectPool and ns3::PoolAllocator.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ * \brief size-classed free lists for small, short-lived objects
+ *
+ * Blocks of up to MAX_SIZE bytes are rounded up to a multiple of
+ * GRANULARITY bytes. Freed blocks are kept in a free list per size
+ * class and handed out again by the next allocation of the same class,
+ * so that, once the simulation reached its steady state, events and
+ * scheduler nodes are recycled instead of going through malloc and free.
+ *
+ * The free lists are per thread, so that no lock is needed. A block
+ * can be freed by another thread than the one which allocated it: it
+ * then goes to the free list of the freeing thread. The blocks cached
+ * by a thread are released when it exits. Larger blocks are not pooled.
+ */
+class SmallObjectPool
+{
+public:
+  /**
+   * \param [in] size The size of the block, in bytes.
+   * \returns A block of at least size bytes.
+   */
+  static void * Allocate (size_t size);
+  /**
+   * \param [in] p The block, returned by Allocate.
+   * \param [in] size The size which was given to Allocate.
+   */
+  static void Deallocate (void *p, size_t size);
+
+  /** Size classes are multiples of this many bytes. */
+  static const size_t GRANULARITY = 16;
+  /** Largest pooled size. */
+  static const size_t MAX_SIZE = 256;
+};
+
+/**
+ * \ingroup core
+ * \brief a standard allocator on top of SmallObjectPool
+ *
+ * Meant for node-based containers, e.g. the std::map of MapScheduler,
+ * which allocate one node at a time.
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef PoolAllocator<U> other;
+  };
+
+  PoolAllocator () {}
+  template <typename U>
+  PoolAllocator (const PoolAllocator<U> &) {}
+
+  pointer address (reference x) const { return &x; }
+  const_pointer address (const_reference x) const { return &x; }
+  size_type max_size () const { return std::numeric_limits<size_type>::max () / sizeof (T); }
+
+  pointer allocate (size_type n, const void * = 0)
+  {
+    return static_cast<pointer> (SmallObjectPool::Allocate (n * sizeof (T)));
+  }
+  void deallocate (pointer p, size_type n)
+  {
+    SmallObjectPool::Deallocate (p, n * sizeof (T));
+  }
+  void construct (pointer p, const T &val) { new (p) T (val); }
+  void destroy (pointer p) { p->~T (); }
+};
+
+/** All pool allocators share the same pool. */
+template <typename T, typename U>
+inline bool operator == (const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+  return true;
+}
+template <typename T, typename U>
+inline bool operator != (const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+  return false;
+}
+
+} // namespace ns3
+
+#endif /* POOL_ALLOCATOR_H */
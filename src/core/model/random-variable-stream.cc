@@ -137,6 +137,16 @@ RandomVariableStream::Peek(void) const
   return m_rng;
 }
 
+void
+RandomVariableStream::GetValues (double *values, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << values << n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      values[i] = GetValue ();
+    }
+}
+
 NS_OBJECT_ENSURE_REGISTERED(UniformRandomVariable);
 
 TypeId 
@@ -207,6 +217,29 @@ UniformRandomVariable::GetInteger (void)
   NS_LOG_FUNCTION (this);
   return (uint32_t)GetValue (m_min, m_max + 1);
 }
+void
+UniformRandomVariable::GetValues (double *values, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << values << n);
+  Peek ()->RandU01 (values, n);
+  // the same operations as GetValue (min, max), on the whole array
+  double min = m_min;
+  double max = m_max;
+  if (IsAntithetic ())
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          values[i] = min + (max - (min + values[i] * (max - min)));
+        }
+    }
+  else
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          values[i] = min + values[i] * (max - min);
+        }
+    }
+}
 
 NS_OBJECT_ENSURE_REGISTERED(ConstantRandomVariable);
 
@@ -444,6 +477,34 @@ ExponentialRandomVariable::GetInteger (void)
   NS_LOG_FUNCTION (this);
   return (uint32_t)GetValue (m_mean, m_bound);
 }
+void
+ExponentialRandomVariable::GetValues (double *values, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << values << n);
+  if (m_bound != 0)
+    {
+      // a rejected value draws another uniform value: the number of
+      // uniform values is not known in advance
+      for (uint32_t i = 0; i < n; i++)
+        {
+          values[i] = GetValue (m_mean, m_bound);
+        }
+      return;
+    }
+  Peek ()->RandU01 (values, n);
+  double mean = m_mean;
+  if (IsAntithetic ())
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          values[i] = 1 - values[i];
+        }
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      values[i] = -mean*std::log (values[i]);
+    }
+}
 
 NS_OBJECT_ENSURE_REGISTERED(ParetoRandomVariable);
 
@@ -754,6 +815,17 @@ NormalRandomVariable::GetInteger (void)
   NS_LOG_FUNCTION (this);
   return (uint32_t)GetValue (m_mean, m_variance, m_bound);
 }
+void
+NormalRandomVariable::GetValues (double *values, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << values << n);
+  // the polar method rejects some pairs of uniform values: they are
+  // drawn one pair at a time, but without a virtual call per value
+  for (uint32_t i = 0; i < n; i++)
+    {
+      values[i] = GetValue (m_mean, m_variance, m_bound);
+    }
+}
 
 NS_OBJECT_ENSURE_REGISTERED(LogNormalRandomVariable);
 
@@ -874,6 +946,17 @@ LogNormalRandomVariable::GetInteger (void)
   NS_LOG_FUNCTION (this);
   return (uint32_t)GetValue (m_mu, m_sigma);
 }
+void
+LogNormalRandomVariable::GetValues (double *values, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << values << n);
+  // as NormalRandomVariable::GetValues, the polar method rejects some
+  // pairs of uniform values
+  for (uint32_t i = 0; i < n; i++)
+    {
+      values[i] = GetValue (m_mu, m_sigma);
+    }
+}
 
 NS_OBJECT_ENSURE_REGISTERED(GammaRandomVariable);
 
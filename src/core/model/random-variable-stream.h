@@ -133,6 +133,18 @@ public:
    */
   virtual uint32_t GetInteger (void) = 0;
 
+  /**
+   * \brief Fills an array with random doubles from the underlying distribution
+   * \param [out] values The random values.
+   * \param [in] n The number of values.
+   *
+   * The values are the ones that n calls to GetValue (void) would
+   * return, in the same order, and the RNG stream is left in the same
+   * state. The subclasses which draw a fixed number of uniform values
+   * per value draw them in one batch.
+   */
+  virtual void GetValues (double *values, uint32_t n);
+
 protected:
   /**
    * \brief Returns a pointer to the underlying RNG stream.
@@ -290,6 +302,15 @@ public:
    * upper bound.
    */
   virtual uint32_t GetInteger (void);
+
+  /**
+   * \brief Fills an array with random values from the current distribution.
+   * \param [out] values The random values.
+   * \param [in] n The number of values.
+   *
+   * The values are the ones that n calls to GetValue (void) would return.
+   */
+  virtual void GetValues (double *values, uint32_t n);
 private:
   /// The lower bound on values that can be returned by this RNG stream.
   double m_min;
@@ -599,6 +620,15 @@ public:
    */
   virtual uint32_t GetInteger (void);
 
+  /**
+   * \brief Fills an array with random values from the current distribution.
+   * \param [out] values The random values.
+   * \param [in] n The number of values.
+   *
+   * The values are the ones that n calls to GetValue (void) would return.
+   */
+  virtual void GetValues (double *values, uint32_t n);
+
 private:
   /// The mean value of the random variables returned by this RNG stream.
   double m_mean;
@@ -1237,6 +1267,15 @@ public:
    */
   virtual uint32_t GetInteger (void);
 
+  /**
+   * \brief Fills an array with random values from the current distribution.
+   * \param [out] values The random values.
+   * \param [in] n The number of values.
+   *
+   * The values are the ones that n calls to GetValue (void) would return.
+   */
+  virtual void GetValues (double *values, uint32_t n);
+
 private:
   /// The mean value for the normal distribution returned by this RNG stream.
   double m_mean;
@@ -1461,6 +1500,15 @@ public:
    */
   virtual uint32_t GetInteger (void);
 
+  /**
+   * \brief Fills an array with random values from the current distribution.
+   * \param [out] values The random values.
+   * \param [in] n The number of values.
+   *
+   * The values are the ones that n calls to GetValue (void) would return.
+   */
+  virtual void GetValues (double *values, uint32_t n);
+
 private:
   /// The mu value for the log-normal distribution returned by this RNG stream.
   double m_mu;
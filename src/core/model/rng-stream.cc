@@ -43,6 +43,8 @@ typedef double Matrix[3][3];
 const double m1   =       4294967087.0;
 const double m2   =       4294944443.0;
 const double norm =       1.0 / (m1 + 1.0);
+const double m1inv =      1.0 / m1;
+const double m2inv =      1.0 / m2;
 const double a12  =       1403580.0;
 const double a13n =       810728.0;
 const double a21  =       527612.0;
@@ -257,22 +259,33 @@ double RngStream::RandU01 ()
 
   /* Component 1 */
   p1 = a12 * m_currentState[1] - a13n * m_currentState[0];
-  k = static_cast<int32_t> (p1 / m1);
+  // the product by the inverse is faster than the division, but k
+  // may be off by one: p1 is brought back in [0, m1) on both sides,
+  // so it is still exactly p1 mod m1
+  k = static_cast<int32_t> (p1 * m1inv);
   p1 -= k * m1;
   if (p1 < 0.0)
     {
       p1 += m1;
     }
+  else if (p1 >= m1)
+    {
+      p1 -= m1;
+    }
   m_currentState[0] = m_currentState[1]; m_currentState[1] = m_currentState[2]; m_currentState[2] = p1;
 
   /* Component 2 */
   p2 = a21 * m_currentState[5] - a23n * m_currentState[3];
-  k = static_cast<int32_t> (p2 / m2);
+  k = static_cast<int32_t> (p2 * m2inv);
   p2 -= k * m2;
   if (p2 < 0.0)
     {
       p2 += m2;
     }
+  else if (p2 >= m2)
+    {
+      p2 -= m2;
+    }
   m_currentState[3] = m_currentState[4]; m_currentState[4] = m_currentState[5]; m_currentState[5] = p2;
 
   /* Combination */
@@ -281,6 +294,55 @@ double RngStream::RandU01 ()
   return u;
 }
 
+void
+RngStream::RandU01 (double *values, uint32_t n)
+{
+  // the same steps as RandU01 (void), with the state in registers
+  double s0 = m_currentState[0];
+  double s1 = m_currentState[1];
+  double s2 = m_currentState[2];
+  double s3 = m_currentState[3];
+  double s4 = m_currentState[4];
+  double s5 = m_currentState[5];
+  for (uint32_t i = 0; i < n; i++)
+    {
+      int32_t k;
+
+      /* Component 1 */
+      double p1 = a12 * s1 - a13n * s0;
+      k = static_cast<int32_t> (p1 * m1inv);
+      p1 -= k * m1;
+      if (p1 < 0.0)
+        {
+          p1 += m1;
+        }
+      else if (p1 >= m1)
+        {
+          p1 -= m1;
+        }
+      s0 = s1; s1 = s2; s2 = p1;
+
+      /* Component 2 */
+      double p2 = a21 * s5 - a23n * s3;
+      k = static_cast<int32_t> (p2 * m2inv);
+      p2 -= k * m2;
+      if (p2 < 0.0)
+        {
+          p2 += m2;
+        }
+      else if (p2 >= m2)
+        {
+          p2 -= m2;
+        }
+      s3 = s4; s4 = s5; s5 = p2;
+
+      /* Combination */
+      values[i] = ((p1 > p2) ? (p1 - p2) * norm : (p1 - p2 + m1) * norm);
+    }
+  m_currentState[0] = s0; m_currentState[1] = s1; m_currentState[2] = s2;
+  m_currentState[3] = s3; m_currentState[4] = s4; m_currentState[5] = s5;
+}
+
 RngStream::RngStream (uint32_t seedNumber, uint64_t stream, uint64_t substream)
 {
   if (seedNumber >= m1 || seedNumber >= m2 || seedNumber == 0)
@@ -45,6 +45,13 @@ public:
    * Uniformly distributed between 0 and 1.
    */
   double RandU01 (void);
+  /**
+   * Generate the next n random numbers for this stream, which are
+   * the values that n calls to RandU01 (void) would return.
+   * \param [out] values The random numbers.
+   * \param [in] n The number of random numbers.
+   */
+  void RandU01 (double *values, uint32_t n);
 
 private:
   void AdvanceNthBy (uint64_t nth, int by, double state[6]);
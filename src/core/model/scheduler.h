@@ -119,6 +119,14 @@ public:
    * This methods cannot be invoked if the list is empty.
    */
   virtual void Remove (const Event &ev) = 0;
+  /**
+   * \returns true if Remove takes constant time.
+   *
+   * The simulator then removes cancelled events from the event list
+   * right away, instead of leaving them there until they expire.
+   * The default implementation returns false.
+   */
+  virtual bool IsRemoveCheap (void) const;
 };
 
 /* Note the invariants which this function must provide:
@@ -0,0 +1,306 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "timer-wheel-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Implementation of ns3::TimerWheelScheduler class.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TimerWheelScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TimerWheelScheduler);
+
+TypeId
+TimerWheelScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TimerWheelScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<TimerWheelScheduler> ()
+  ;
+  return tid;
+}
+
+TimerWheelScheduler::TimerWheelScheduler ()
+  : m_head (0),
+    m_currentTs (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < N_LEVELS; i++)
+    {
+      std::fill (m_levels[i].used, m_levels[i].used + N_SLOTS / 64, 0);
+    }
+}
+
+TimerWheelScheduler::~TimerWheelScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+TimerWheelScheduler::GetLevel (uint64_t ts) const
+{
+  NS_ASSERT (ts > m_currentTs);
+  uint32_t level = (63 - __builtin_clzll (ts ^ m_currentTs)) / LEVEL_BITS;
+  if (level > N_LEVELS)
+    {
+      level = N_LEVELS;
+    }
+  return level;
+}
+
+uint32_t
+TimerWheelScheduler::GetSlot (uint64_t ts, uint32_t level) const
+{
+  return (ts >> (level * LEVEL_BITS)) & (N_SLOTS - 1);
+}
+
+void
+TimerWheelScheduler::InsertInWheel (const Event &ev)
+{
+  uint32_t level = GetLevel (ev.key.m_ts);
+  if (level == N_LEVELS)
+    {
+      m_overflow.insert (std::make_pair (ev.key, ev.impl));
+      return;
+    }
+  uint32_t slot = GetSlot (ev.key.m_ts, level);
+  m_levels[level].slots[slot].push_back (ev);
+  m_levels[level].used[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+uint32_t
+TimerWheelScheduler::FindNextSlot (uint32_t level) const
+{
+  uint32_t start = GetSlot (m_currentTs, level) + 1;
+  const uint64_t *used = m_levels[level].used;
+  for (uint32_t word = start / 64; word < N_SLOTS / 64; word++)
+    {
+      uint64_t bits = used[word];
+      if (word == start / 64)
+        {
+          // clear the bits of the slots before start
+          bits &= ~(uint64_t)0 << (start % 64);
+        }
+      if (bits != 0)
+        {
+          return word * 64 + __builtin_ctzll (bits);
+        }
+    }
+  return N_SLOTS;
+}
+
+void
+TimerWheelScheduler::Advance (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_current.empty () && m_size > 0);
+  Slot events;
+  while (m_current.empty ())
+    {
+      uint32_t level = 0;
+      uint32_t slot = N_SLOTS;
+      for (; level < N_LEVELS; level++)
+        {
+          slot = FindNextSlot (level);
+          if (slot != N_SLOTS)
+            {
+              break;
+            }
+        }
+      if (level == N_LEVELS)
+        {
+          // the wheel is empty: start again from the first overflow event
+          NS_ASSERT (!m_overflow.empty ());
+          m_currentTs = m_overflow.begin ()->first.m_ts;
+          while (!m_overflow.empty ())
+            {
+              std::map<Scheduler::EventKey, EventImpl *>::iterator i = m_overflow.begin ();
+              if (i->first.m_ts != m_currentTs && GetLevel (i->first.m_ts) == N_LEVELS)
+                {
+                  break;
+                }
+              Event ev;
+              ev.key = i->first;
+              ev.impl = i->second;
+              events.push_back (ev);
+              m_overflow.erase (i);
+            }
+        }
+      else
+        {
+          // move to the start of the slot, and spread it over the lower levels
+          uint32_t shift = level * LEVEL_BITS;
+          uint64_t base = (m_currentTs >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS);
+          m_currentTs = base | ((uint64_t)slot << shift);
+          events.swap (m_levels[level].slots[slot]);
+          m_levels[level].used[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+        }
+      for (Slot::const_iterator i = events.begin (); i != events.end (); ++i)
+        {
+          if (i->key.m_ts == m_currentTs)
+            {
+              m_current.push_back (*i);
+            }
+          else
+            {
+              InsertInWheel (*i);
+            }
+        }
+      events.clear ();
+    }
+  // all the events have the same timestamp
+  std::sort (m_current.begin (), m_current.end ());
+}
+
+void
+TimerWheelScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  m_size++;
+  if (ev.key.m_ts > m_currentTs)
+    {
+      InsertInWheel (ev);
+      return;
+    }
+  // uids increase, so most events go to the end
+  Slot::iterator head = m_current.begin () + m_head;
+  Slot::iterator pos = std::upper_bound (head, m_current.end (), ev);
+  if (pos == m_current.end ())
+    {
+      m_current.push_back (ev);
+    }
+  else if (pos == head && m_head > 0)
+    {
+      m_current[--m_head] = ev;
+    }
+  else
+    {
+      m_current.insert (pos, ev);
+    }
+}
+
+bool
+TimerWheelScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_size == 0;
+}
+
+Scheduler::Event
+TimerWheelScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_current.empty ())
+    {
+      // turning the wheel does not change the content of the queue
+      const_cast<TimerWheelScheduler *> (this)->Advance ();
+    }
+  return m_current[m_head];
+}
+
+Scheduler::Event
+TimerWheelScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_current.empty ())
+    {
+      Advance ();
+    }
+  Event ev = m_current[m_head];
+  m_head++;
+  if (m_head == m_current.size ())
+    {
+      m_current.clear ();
+      m_head = 0;
+    }
+  m_size--;
+  NS_LOG_DEBUG (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  return ev;
+}
+
+void
+TimerWheelScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  m_size--;
+  if (ev.key.m_ts <= m_currentTs)
+    {
+      Slot::iterator head = m_current.begin () + m_head;
+      Slot::iterator pos = std::lower_bound (head, m_current.end (), ev);
+      NS_ASSERT (pos != m_current.end () && pos->impl == ev.impl);
+      if (pos == head)
+        {
+          m_head++;
+          if (m_head == m_current.size ())
+            {
+              m_current.clear ();
+              m_head = 0;
+            }
+        }
+      else
+        {
+          m_current.erase (pos);
+        }
+      return;
+    }
+  uint32_t level = GetLevel (ev.key.m_ts);
+  if (level == N_LEVELS)
+    {
+      std::map<Scheduler::EventKey, EventImpl *>::iterator i = m_overflow.find (ev.key);
+      NS_ASSERT (i != m_overflow.end () && i->second == ev.impl);
+      m_overflow.erase (i);
+      return;
+    }
+  // an event stays in the same slot until the wheel reaches it
+  uint32_t slot = GetSlot (ev.key.m_ts, level);
+  Slot &events = m_levels[level].slots[slot];
+  for (Slot::iterator i = events.begin (); i != events.end (); ++i)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          *i = events.back ();
+          events.pop_back ();
+          if (events.empty ())
+            {
+              m_levels[level].used[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+            }
+          return;
+        }
+    }
+  NS_ASSERT_MSG (false, "event not found");
+}
+
+bool
+TimerWheelScheduler::IsRemoveCheap (void) const
+{
+  return true;
+}
+
+} // namespace ns3
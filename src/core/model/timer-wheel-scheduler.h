@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TIMER_WHEEL_SCHEDULER_H
+#define TIMER_WHEEL_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * Declaration of ns3::TimerWheelScheduler class.
+ */
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup scheduler
+ * \brief a hierarchical timer wheel event scheduler
+ *
+ * This event scheduler is meant for simulations dominated by short
+ * timeouts which are cancelled most of the time, e.g. ACK and CTS
+ * timeouts, backoffs and retransmission timers.
+ *
+ * The wheel has N_LEVELS levels of N_SLOTS slots: a slot of level k
+ * spans N_SLOTS^k time steps. An event goes to the lowest level whose
+ * slot does not contain the current time, and is moved down to the
+ * lower levels when the wheel reaches its slot. The slots are not
+ * sorted, only the events due at the current time are. Events
+ * beyond the last level, i.e. more than 2^32 time steps ahead, are kept
+ * in a std::map.
+ *
+ * Insert is O(1), and so is Remove as long as the slots are small:
+ * the slot of an event is found from its timestamp. IsRemoveCheap
+ * returns true, so DefaultSimulatorImpl removes a cancelled event
+ * right away instead of keeping it in the queue until it expires.
+ */
+class TimerWheelScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TimerWheelScheduler ();
+  virtual ~TimerWheelScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+  virtual bool IsRemoveCheap (void) const;
+
+private:
+  /** log2 of N_SLOTS. */
+  static const uint32_t LEVEL_BITS = 8;
+  /** Number of slots per level. */
+  static const uint32_t N_SLOTS = 1 << LEVEL_BITS;
+  /** Number of levels. */
+  static const uint32_t N_LEVELS = 4;
+
+  typedef std::vector<Scheduler::Event> Slot;
+
+  struct Level
+  {
+    Slot slots[N_SLOTS];
+    // one bit per non-empty slot
+    uint64_t used[N_SLOTS / 64];
+  };
+
+  // level of a timestamp later than the current one, N_LEVELS for the overflow
+  inline uint32_t GetLevel (uint64_t ts) const;
+  inline uint32_t GetSlot (uint64_t ts, uint32_t level) const;
+  void InsertInWheel (const Event &ev);
+  // first non-empty slot after the current one in the level, N_SLOTS if none
+  uint32_t FindNextSlot (uint32_t level) const;
+  // advance the current time to the next event, m_current must be empty
+  void Advance (void);
+
+  Level m_levels[N_LEVELS];
+  // events of the current time, sorted, starting at m_head
+  Slot m_current;
+  uint32_t m_head;
+  uint64_t m_currentTs;
+  std::map<Scheduler::EventKey, EventImpl *> m_overflow;
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* TIMER_WHEEL_SCHEDULER_H */
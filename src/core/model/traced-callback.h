@@ -21,7 +21,7 @@
 #ifndef TRACED_CALLBACK_H
 #define TRACED_CALLBACK_H
 
-#include <list>
+#include <vector>
 #include "callback.h"
 
 /**
@@ -46,6 +46,11 @@ namespace ns3 {
  * calling one of the \c operator() forms with the appropriate
  * number of arguments.
  *
+ * Most trace sources have no Callback, or a single one: the first
+ * Callback is stored in the TracedCallback itself, and the others
+ * in a vector. Invoking a TracedCallback without Callbacks costs a
+ * single test.
+ *
  * \tparam T1 Type of the first argument to the functor.
  * \tparam T2 Type of the second argument to the functor.
  * \tparam T3 Type of the third argument to the functor.
@@ -93,6 +98,13 @@ public:
    * \param path Context path which was used to connect the Callback.
    */
   void Disconnect (const CallbackBase & callback, std::string path);
+  /**
+   * \returns true if no Callback is connected.
+   *
+   * The arguments of the functors are copied even when the chain is
+   * empty: a source can check this first to avoid building them.
+   */
+  bool IsEmpty (void) const;
   /**
    * \name Functors taking various numbers of arguments.
    *
@@ -222,21 +234,22 @@ public:
 
   
 private:
+  /** The type of the Callbacks of the chain. */
+  typedef Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> ChainCallback;
+  /** Container type for holding the Callbacks after the first one. */
+  typedef std::vector<ChainCallback> CallbackVector;
+
   /**
-   * Container type for holding the chain of Callbacks.
+   * Append a Callback to the chain.
    *
-   * \tparam T1 Type of the first argument to the functor.
-   * \tparam T2 Type of the second argument to the functor.
-   * \tparam T3 Type of the third argument to the functor.
-   * \tparam T4 Type of the fourth argument to the functor.
-   * \tparam T5 Type of the fifth argument to the functor.
-   * \tparam T6 Type of the sixth argument to the functor.
-   * \tparam T7 Type of the seventh argument to the functor.
-   * \tparam T8 Type of the eighth argument to the functor.
+   * \param callback Callback to add to chain.
    */
-  typedef std::list<Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> > CallbackList;
-  /** The chain of Callbacks. */
-  CallbackList m_callbackList;
+  void Add (const ChainCallback & callback);
+
+  /** The first Callback of the chain, null if the chain is empty. */
+  ChainCallback m_first;
+  /** The other Callbacks of the chain. */
+  CallbackVector m_others;
 };
 
 } // namespace ns3
@@ -253,7 +266,8 @@ template<typename T1, typename T2,
          typename T5, typename T6,
          typename T7, typename T8>
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::TracedCallback ()
-  : m_callbackList () 
+  : m_first (),
+    m_others ()
 {
 }
 template<typename T1, typename T2,
@@ -261,11 +275,27 @@ template<typename T1, typename T2,
          typename T5, typename T6,
          typename T7, typename T8>
 void
+TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Add (const ChainCallback & callback)
+{
+  if (m_first.IsNull ())
+    {
+      m_first = callback;
+    }
+  else
+    {
+      m_others.push_back (callback);
+    }
+}
+template<typename T1, typename T2,
+         typename T3, typename T4,
+         typename T5, typename T6,
+         typename T7, typename T8>
+void
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::ConnectWithoutContext (const CallbackBase & callback)
 {
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> cb;
   cb.Assign (callback);
-  m_callbackList.push_back (cb);
+  Add (cb);
 }
 template<typename T1, typename T2,
          typename T3, typename T4,
@@ -277,7 +307,7 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Connect (const CallbackBase & callback,
   Callback<void,std::string,T1,T2,T3,T4,T5,T6,T7,T8> cb;
   cb.Assign (callback);
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
-  m_callbackList.push_back (realCb);
+  Add (realCb);
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -286,18 +316,30 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::DisconnectWithoutContext (const CallbackBase & callback)
 {
-  for (typename CallbackList::iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); /* empty */)
+  for (typename CallbackVector::iterator i = m_others.begin ();
+       i != m_others.end (); /* empty */)
     {
       if ((*i).IsEqual (callback))
         {
-          i = m_callbackList.erase (i);
+          i = m_others.erase (i);
         }
       else
         {
           i++;
         }
     }
+  if (!m_first.IsNull () && m_first.IsEqual (callback))
+    {
+      if (m_others.empty ())
+        {
+          m_first.Nullify ();
+        }
+      else
+        {
+          m_first = m_others.front ();
+          m_others.erase (m_others.begin ());
+        }
+    }
 }
 template<typename T1, typename T2, 
          typename T3, typename T4,
@@ -311,6 +353,15 @@ TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Disconnect (const CallbackBase & callba
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
   DisconnectWithoutContext (realCb);
 }
+template<typename T1, typename T2, 
+         typename T3, typename T4,
+         typename T5, typename T6,
+         typename T7, typename T8>
+bool
+TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::IsEmpty (void) const
+{
+  return m_first.IsNull ();
+}
 template<typename T1, typename T2, 
          typename T3, typename T4,
          typename T5, typename T6,
@@ -318,10 +369,15 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (void) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
     {
-      (*i)();
+      return;
+    }
+  m_first ();
+  // by index: a Callback may connect another one
+  for (std::size_t i = 0; i < m_others.size (); i++)
+    {
+      m_others[i] ();
     }
 }
 template<typename T1, typename T2, 
@@ -331,10 +387,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
+    {
+      return;
+    }
+  m_first (a1);
+  for (std::size_t i = 0; i < m_others.size (); i++)
     {
-      (*i)(a1);
+      m_others[i] (a1);
     }
 }
 template<typename T1, typename T2, 
@@ -344,10 +404,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
     {
-      (*i)(a1, a2);
+      return;
+    }
+  m_first (a1, a2);
+  for (std::size_t i = 0; i < m_others.size (); i++)
+    {
+      m_others[i] (a1, a2);
     }
 }
 template<typename T1, typename T2, 
@@ -357,10 +421,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
+    {
+      return;
+    }
+  m_first (a1, a2, a3);
+  for (std::size_t i = 0; i < m_others.size (); i++)
     {
-      (*i)(a1, a2, a3);
+      m_others[i] (a1, a2, a3);
     }
 }
 template<typename T1, typename T2, 
@@ -370,10 +438,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
     {
-      (*i)(a1, a2, a3, a4);
+      return;
+    }
+  m_first (a1, a2, a3, a4);
+  for (std::size_t i = 0; i < m_others.size (); i++)
+    {
+      m_others[i] (a1, a2, a3, a4);
     }
 }
 template<typename T1, typename T2, 
@@ -383,10 +455,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
+    {
+      return;
+    }
+  m_first (a1, a2, a3, a4, a5);
+  for (std::size_t i = 0; i < m_others.size (); i++)
     {
-      (*i)(a1, a2, a3, a4, a5);
+      m_others[i] (a1, a2, a3, a4, a5);
     }
 }
 template<typename T1, typename T2, 
@@ -396,10 +472,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
+    {
+      return;
+    }
+  m_first (a1, a2, a3, a4, a5, a6);
+  for (std::size_t i = 0; i < m_others.size (); i++)
     {
-      (*i)(a1, a2, a3, a4, a5, a6);
+      m_others[i] (a1, a2, a3, a4, a5, a6);
     }
 }
 template<typename T1, typename T2, 
@@ -409,10 +489,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
     {
-      (*i)(a1, a2, a3, a4, a5, a6, a7);
+      return;
+    }
+  m_first (a1, a2, a3, a4, a5, a6, a7);
+  for (std::size_t i = 0; i < m_others.size (); i++)
+    {
+      m_others[i] (a1, a2, a3, a4, a5, a6, a7);
     }
 }
 template<typename T1, typename T2, 
@@ -422,10 +506,14 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::operator() (T1 a1, T2 a2, T3 a3, T4 a4, T5 a5, T6 a6, T7 a7, T8 a8) const
 {
-  for (typename CallbackList::const_iterator i = m_callbackList.begin ();
-       i != m_callbackList.end (); i++)
+  if (m_first.IsNull ())
+    {
+      return;
+    }
+  m_first (a1, a2, a3, a4, a5, a6, a7, a8);
+  for (std::size_t i = 0; i < m_others.size (); i++)
     {
-      (*i)(a1, a2, a3, a4, a5, a6, a7, a8);
+      m_others[i] (a1, a2, a3, a4, a5, a6, a7, a8);
     }
 }
 
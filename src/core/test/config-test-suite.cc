@@ -721,6 +721,102 @@ SearchAttributesOfParentObjectsTestCase::DoRun (void)
 
 }
 
+// ===========================================================================
+// Test for the paths which are parsed once and resolved several times.
+// ===========================================================================
+class CompiledPathConfigTestCase : public TestCase
+{
+public:
+  CompiledPathConfigTestCase ();
+  virtual ~CompiledPathConfigTestCase () {}
+
+  void Trace (int16_t oldValue, int16_t newValue) { m_traces++; }
+
+private:
+  virtual void DoRun (void);
+  uint32_t m_traces;
+};
+
+CompiledPathConfigTestCase::CompiledPathConfigTestCase ()
+  : TestCase ("Check that Config::Path and Config::SetMany match as Config::LookupMatches"),
+    m_traces (0)
+{
+}
+
+void
+CompiledPathConfigTestCase::DoRun (void)
+{
+  IntegerValue iv;
+
+  Ptr<ConfigTestObject> root = CreateObject<ConfigTestObject> ();
+  Config::RegisterRootNamespaceObject (root);
+  std::vector<Ptr<ConfigTestObject> > objects;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      objects.push_back (CreateObject<ConfigTestObject> ());
+      root->AddNodeA (objects[i]);
+    }
+
+  //
+  // The matches of a path, and their matched paths, do not depend on how the
+  // path is resolved.
+  //
+  Config::Path path ("/NodesA/[1-2]|3");
+  Config::MatchContainer matches = path.LookupMatches ();
+  Config::MatchContainer reference = Config::LookupMatches ("/NodesA/[1-2]|3");
+  NS_TEST_ASSERT_MSG_EQ (matches.GetN (), 3, "Unexpected number of matches");
+  NS_TEST_ASSERT_MSG_EQ (reference.GetN (), 3, "Unexpected number of matches");
+  for (uint32_t i = 0; i < matches.GetN (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (matches.Get (i), objects[i + 1], "Unexpected match");
+      NS_TEST_ASSERT_MSG_EQ (matches.GetMatchedPath (i), reference.GetMatchedPath (i),
+                             "Unexpected matched path");
+    }
+
+  //
+  // Set two attributes of the matching objects at once.
+  //
+  Config::AttributeValueList values;
+  values.push_back (std::make_pair ("A", Create<IntegerValue> (-5)));
+  values.push_back (std::make_pair ("B", Create<IntegerValue> (-6)));
+  path.SetMany (values);
+  objects[0]->GetAttribute ("A", iv);
+  NS_TEST_ASSERT_MSG_EQ (iv.Get (), 10, "Object Attribute \"A\" unexpectedly set");
+  for (uint32_t i = 1; i < 4; i++)
+    {
+      objects[i]->GetAttribute ("A", iv);
+      NS_TEST_ASSERT_MSG_EQ (iv.Get (), -5, "Object Attribute \"A\" not set as expected");
+      objects[i]->GetAttribute ("B", iv);
+      NS_TEST_ASSERT_MSG_EQ (iv.Get (), -6, "Object Attribute \"B\" not set as expected");
+    }
+
+  //
+  // A path sees the objects added after it was parsed.
+  //
+  Config::Path single ("/NodesA/4");
+  NS_TEST_ASSERT_MSG_EQ (single.LookupMatches ().GetN (), 0, "Unexpected match");
+  objects.push_back (CreateObject<ConfigTestObject> ());
+  root->AddNodeA (objects[4]);
+  single.Set ("A", IntegerValue (-7));
+  objects[4]->GetAttribute ("A", iv);
+  NS_TEST_ASSERT_MSG_EQ (iv.Get (), -7, "Object Attribute \"A\" not set as expected");
+  NS_TEST_ASSERT_MSG_EQ (single.LookupMatches ().GetMatchedPath (0), "/NodesA/4/",
+                         "Unexpected matched path");
+
+  //
+  // Connect and disconnect the trace sources of all the objects.
+  //
+  Config::Path all ("/NodesA/*");
+  all.ConnectWithoutContext ("Source", MakeCallback (&CompiledPathConfigTestCase::Trace, this));
+  Config::SetMany ("/NodesA/*", Config::AttributeValueList (1, std::make_pair ("Source", Create<IntegerValue> (3))));
+  NS_TEST_ASSERT_MSG_EQ (m_traces, 5, "Unexpected number of traces");
+  all.DisconnectWithoutContext ("Source", MakeCallback (&CompiledPathConfigTestCase::Trace, this));
+  all.Set ("Source", IntegerValue (4));
+  NS_TEST_ASSERT_MSG_EQ (m_traces, 5, "Trace source not disconnected");
+
+  Config::UnregisterRootNamespaceObject (root);
+}
+
 // ===========================================================================
 // The Test Suite that glues all of the Test Cases together.
 // ===========================================================================
@@ -737,6 +833,7 @@ ConfigTestSuite::ConfigTestSuite ()
   AddTestCase (new UnderRootNamespaceConfigTestCase, TestCase::QUICK);
   AddTestCase (new ObjectVectorConfigTestCase, TestCase::QUICK);
   AddTestCase (new SearchAttributesOfParentObjectsTestCase, TestCase::QUICK);
+  AddTestCase (new CompiledPathConfigTestCase, TestCase::QUICK);
 }
 
 static ConfigTestSuite configTestSuite;
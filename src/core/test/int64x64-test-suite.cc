@@ -964,6 +964,68 @@ Int64x64InvertTestCase::DoRun (void)
 }
 
 
+class Int64x64IntegerOperandTestCase : public TestCase
+{
+public:
+  Int64x64IntegerOperandTestCase ();
+  virtual void DoRun (void);
+  void Check (const int64x64_t value, const int64_t factor);
+};
+
+Int64x64IntegerOperandTestCase::Int64x64IntegerOperandTestCase ()
+  : TestCase ("Multiplication and division by small integers")
+{
+}
+
+void
+Int64x64IntegerOperandTestCase::Check (const int64x64_t value, const int64_t factor)
+{
+  // A factor beyond 2^31 takes the general path: scaling it by 2^32
+  // gives exact reference results, as long as they stay below 2^63.
+  const int64x64_t scale = int64x64_t (1LL << 32);
+  const int64x64_t big = int64x64_t (factor * (1LL << 32));
+
+  int64x64_t product = value;
+  product *= int64x64_t (factor);
+  int64x64_t reference = value;
+  reference *= big;
+  reference /= scale;
+  NS_TEST_ASSERT_MSG_EQ (product, reference, value << " * " << factor);
+
+  product = int64x64_t (factor);
+  product *= value;
+  NS_TEST_ASSERT_MSG_EQ (product, reference, factor << " * " << value);
+
+  int64x64_t quotient = value;
+  quotient /= int64x64_t (factor);
+  reference = value;
+  reference *= scale;
+  reference /= big;
+  NS_TEST_ASSERT_MSG_EQ (quotient, reference, value << " / " << factor);
+}
+
+void
+Int64x64IntegerOperandTestCase::DoRun (void)
+{
+  const int64_t factors[] = { 1, -1, 3, 7, -10, 1000, 1000000000, -2147483647 };
+  const int64x64_t values[] = { int64x64_t (0), int64x64_t (1), int64x64_t (-5),
+                                int64x64_t (123456, 0x8000000000000001ULL),
+                                int64x64_t (0, 0x8000000000000001ULL),
+                                int64x64_t (-7, 0x0123456789abcdefULL),
+                                int64x64_t (0.1), int64x64_t (-1234.5678) };
+  for (uint32_t i = 0; i < sizeof (factors) / sizeof (factors[0]); i++)
+    {
+      for (uint32_t j = 0; j < sizeof (values) / sizeof (values[0]); j++)
+        {
+          if (std::fabs (values[j].GetDouble () * factors[i]) < 1e9)
+            {
+              Check (values[j], factors[i]);
+            }
+        }
+    }
+}
+
+
 class Int64x64DoubleTestCase : public TestCase
 {
 public:
@@ -1240,6 +1302,7 @@ public:
     AddTestCase (new Int64x64Bug863TestCase (), TestCase::QUICK);
     AddTestCase (new Int64x64Bug1786TestCase (), TestCase::QUICK);
     AddTestCase (new Int64x64InvertTestCase (), TestCase::QUICK);
+    AddTestCase (new Int64x64IntegerOperandTestCase (), TestCase::QUICK);
     AddTestCase (new Int64x64DoubleTestCase (), TestCase::QUICK);
   }
 }  g_int64x64TestSuite;
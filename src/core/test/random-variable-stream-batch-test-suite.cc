@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/object-factory.h"
+#include "ns3/random-variable-stream.h"
+#include <vector>
+
+using namespace ns3;
+
+// ===========================================================================
+// Test case for RandomVariableStream::GetValues: the values must be the
+// ones of the same number of GetValue calls, on the same stream.
+// ===========================================================================
+
+class RandomVariableStreamBatchTestCase : public TestCase
+{
+public:
+  RandomVariableStreamBatchTestCase (ObjectFactory factory, std::string description);
+  virtual ~RandomVariableStreamBatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  ObjectFactory m_factory;
+};
+
+RandomVariableStreamBatchTestCase::RandomVariableStreamBatchTestCase (ObjectFactory factory,
+                                                                      std::string description)
+  : TestCase ("GetValues of " + description),
+    m_factory (factory)
+{
+}
+
+RandomVariableStreamBatchTestCase::~RandomVariableStreamBatchTestCase ()
+{
+}
+
+void
+RandomVariableStreamBatchTestCase::DoRun (void)
+{
+  Ptr<RandomVariableStream> scalar = m_factory.Create<RandomVariableStream> ();
+  Ptr<RandomVariableStream> batch = m_factory.Create<RandomVariableStream> ();
+  scalar->SetStream (7);
+  batch->SetStream (7);
+
+  // odd sizes, and single GetValue calls in between: the batches must
+  // leave the stream, and the cached value of the normal variables, as
+  // the GetValue calls do
+  uint32_t sizes[] = { 1, 2, 7, 64, 1001, 3 };
+  std::vector<double> values;
+  for (uint32_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    {
+      values.resize (sizes[i]);
+      batch->GetValues (&values[0], sizes[i]);
+      for (uint32_t j = 0; j < sizes[i]; j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (values[j], scalar->GetValue (), "Value " << j << " of batch " << i);
+        }
+      NS_TEST_ASSERT_MSG_EQ (batch->GetValue (), scalar->GetValue (), "Value after batch " << i);
+    }
+}
+
+class RandomVariableStreamBatchTestSuite : public TestSuite
+{
+public:
+  RandomVariableStreamBatchTestSuite ();
+
+private:
+  void AddBatchTestCase (std::string typeId, std::string description,
+                         std::string n1 = "", const AttributeValue &v1 = EmptyAttributeValue (),
+                         std::string n2 = "", const AttributeValue &v2 = EmptyAttributeValue ());
+};
+
+void
+RandomVariableStreamBatchTestSuite::AddBatchTestCase (std::string typeId, std::string description,
+                                                      std::string n1, const AttributeValue &v1,
+                                                      std::string n2, const AttributeValue &v2)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (typeId);
+  if (n1 != "")
+    {
+      factory.Set (n1, v1);
+    }
+  if (n2 != "")
+    {
+      factory.Set (n2, v2);
+    }
+  AddTestCase (new RandomVariableStreamBatchTestCase (factory, description), TestCase::QUICK);
+}
+
+RandomVariableStreamBatchTestSuite::RandomVariableStreamBatchTestSuite ()
+  : TestSuite ("random-variable-stream-batch", UNIT)
+{
+  AddBatchTestCase ("ns3::UniformRandomVariable", "uniform",
+                    "Min", DoubleValue (-3), "Max", DoubleValue (5));
+  AddBatchTestCase ("ns3::UniformRandomVariable", "antithetic uniform",
+                    "Min", DoubleValue (-3), "Antithetic", BooleanValue (true));
+  AddBatchTestCase ("ns3::ExponentialRandomVariable", "exponential",
+                    "Mean", DoubleValue (2));
+  AddBatchTestCase ("ns3::ExponentialRandomVariable", "antithetic exponential",
+                    "Antithetic", BooleanValue (true));
+  AddBatchTestCase ("ns3::ExponentialRandomVariable", "bounded exponential",
+                    "Bound", DoubleValue (1.5));
+  AddBatchTestCase ("ns3::NormalRandomVariable", "normal",
+                    "Mean", DoubleValue (1), "Variance", DoubleValue (4));
+  AddBatchTestCase ("ns3::NormalRandomVariable", "bounded normal",
+                    "Bound", DoubleValue (0.5));
+  AddBatchTestCase ("ns3::LogNormalRandomVariable", "log-normal",
+                    "Mu", DoubleValue (0.5), "Sigma", DoubleValue (2));
+  // the default implementation of GetValues
+  AddBatchTestCase ("ns3::ParetoRandomVariable", "pareto");
+}
+
+static RandomVariableStreamBatchTestSuite randomVariableStreamBatchTestSuite;
@@ -23,6 +23,12 @@
 #include "ns3/heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/timer-wheel-scheduler.h"
+#include "ns3/event-profiler.h"
+#include "ns3/make-event.h"
+#include <sstream>
+#include <vector>
 
 using namespace ns3;
 
@@ -459,6 +465,196 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+  virtual void DoRun (void);
+  uint32_t Rand (void);
+  uint32_t m_seed;
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that " + schedulerFactory.GetTypeId ().GetName () +
+              " returns the events in the same order as ns3::MapScheduler"),
+    m_seed (1),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+uint32_t
+SchedulerOrderTestCase::Rand (void)
+{
+  m_seed = m_seed * 1103515245 + 12345;
+  return m_seed >> 8;
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  Ptr<Scheduler> reference = CreateObject<MapScheduler> ();
+  std::vector<Scheduler::Event> pending;
+  std::vector<bool> removed;
+  uint64_t now = 0;
+  uint32_t uid = 0;
+
+  for (uint32_t step = 0; step < 200000; step++)
+    {
+      uint32_t op = Rand () % 16;
+      if (op < 7 || pending.empty ())
+        {
+          // mostly near-future events, some far ones and bursts of
+          // events with the same timestamp
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_context = 0;
+          uint32_t kind = Rand () % 8;
+          if (kind < 5)
+            {
+              ev.key.m_ts = now + Rand () % 1000;
+            }
+          else if (kind < 7)
+            {
+              ev.key.m_ts = now + Rand () % 10000000;
+            }
+          else if (Rand () % 32 != 0)
+            {
+              ev.key.m_ts = now + 500;
+            }
+          else
+            {
+              // a few very far events, e.g. the end of the simulation
+              ev.key.m_ts = now + ((uint64_t)Rand () << 24);
+            }
+          uint32_t burst = (step % 1000 == 0) ? 300 : 1;
+          for (uint32_t i = 0; i < burst; i++)
+            {
+              ev.key.m_uid = uid++;
+              scheduler->Insert (ev);
+              reference->Insert (ev);
+              pending.push_back (ev);
+              removed.push_back (false);
+            }
+        }
+      else if (op < 14)
+        {
+          Scheduler::Event expected = reference->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid, expected.key.m_uid, "wrong next event");
+          Scheduler::Event ev = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (ev.key.m_uid, expected.key.m_uid, "wrong event removed");
+          NS_TEST_ASSERT_MSG_EQ (ev.key.m_ts, expected.key.m_ts, "wrong event removed");
+          now = ev.key.m_ts;
+          removed[ev.key.m_uid] = true;
+        }
+      else
+        {
+          // cancel a random pending event, if it did not run already
+          uint32_t i = Rand () % pending.size ();
+          if (!removed[pending[i].key.m_uid])
+            {
+              scheduler->Remove (pending[i]);
+              reference->Remove (pending[i]);
+              removed[pending[i].key.m_uid] = true;
+            }
+          pending[i] = pending.back ();
+          pending.pop_back ();
+        }
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), reference->IsEmpty (), "wrong emptiness");
+    }
+
+  while (!reference->IsEmpty ())
+    {
+      Scheduler::Event expected = reference->RemoveNext ();
+      Scheduler::Event ev = scheduler->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (ev.key.m_uid, expected.key.m_uid, "wrong event removed while draining");
+    }
+  NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "events left");
+}
+
+class EventProfilerTestCase : public TestCase
+{
+public:
+  EventProfilerTestCase ();
+  virtual void DoRun (void);
+  void Member (void);
+  static void Function (int value);
+  uint32_t m_member;
+  static int m_function;
+};
+
+int EventProfilerTestCase::m_function = 0;
+
+EventProfilerTestCase::EventProfilerTestCase ()
+  : TestCase ("Check the reports of ns3::EventProfiler"),
+    m_member (0)
+{
+}
+
+void
+EventProfilerTestCase::Member (void)
+{
+  m_member++;
+}
+
+void
+EventProfilerTestCase::Function (int value)
+{
+  m_function += value;
+}
+
+void
+EventProfilerTestCase::DoRun (void)
+{
+  EventProfiler profiler;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      EventImpl *event = MakeEvent (&EventProfilerTestCase::Member, this);
+      profiler.Invoke (event, 7);
+      event->Unref ();
+    }
+  EventImpl *event = MakeEvent (&EventProfilerTestCase::Function, 2);
+  profiler.Invoke (event, 0xffffffff);
+  profiler.Record (typeid (*event), 0xffffffff, 1);
+  event->Unref ();
+  NS_TEST_ASSERT_MSG_EQ (m_member, 3, "events not invoked");
+  NS_TEST_ASSERT_MSG_EQ (m_function, 2, "event not invoked");
+
+  std::ostringstream report;
+  profiler.PrintReport (report);
+  NS_TEST_ASSERT_MSG_NE (report.str ().find ("Event profile: 5 events"), std::string::npos,
+                         "wrong total in " << report.str ());
+  NS_TEST_ASSERT_MSG_NE (report.str ().find ("EventProfilerTestCase"), std::string::npos,
+                         "type name not found in " << report.str ());
+  NS_TEST_ASSERT_MSG_NE (report.str ().find ("node 7"), std::string::npos,
+                         "context not found in " << report.str ());
+  NS_TEST_ASSERT_MSG_NE (report.str ().find ("no context"), std::string::npos,
+                         "context not found in " << report.str ());
+
+  std::istringstream folded;
+  std::ostringstream os;
+  profiler.PrintFolded (os);
+  folded.str (os.str ());
+  std::string line;
+  uint32_t lines = 0;
+  while (std::getline (folded, line))
+    {
+      std::string::size_type semicolon = line.find (';');
+      NS_TEST_ASSERT_MSG_NE (semicolon, std::string::npos, "no stack in " << line);
+      std::string context = line.substr (0, semicolon);
+      NS_TEST_ASSERT_MSG_EQ ((context == "node 7" || context == "no context"), true,
+                             "wrong context in " << line);
+      NS_TEST_ASSERT_MSG_EQ (line.find (';', semicolon + 1), std::string::npos,
+                             "too many frames in " << line);
+      std::string::size_type space = line.rfind (' ');
+      NS_TEST_ASSERT_MSG_EQ (line.find_first_not_of ("0123456789", space + 1), std::string::npos,
+                             "wrong time in " << line);
+      lines++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (lines, 2, "one line per type and context");
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -475,5 +671,18 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (TimerWheelScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (TimerWheelScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+
+    AddTestCase (new EventProfilerTestCase (), TestCase::QUICK);
   }
 } g_simulatorTestSuite;
@@ -108,6 +108,93 @@ BasicTracedCallbackTestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (m_two, true, "Callback CbTwo not called");
 }
 
+class OrderTracedCallbackTestCase : public TestCase
+{
+public:
+  OrderTracedCallbackTestCase ();
+  virtual ~OrderTracedCallbackTestCase () {}
+
+private:
+  virtual void DoRun (void);
+
+  void CbA (uint32_t value);
+  void CbB (uint32_t value);
+  void CbConnect (uint32_t value);
+
+  std::string m_calls;
+  TracedCallback<uint32_t> m_trace;
+};
+
+OrderTracedCallbackTestCase::OrderTracedCallbackTestCase ()
+  : TestCase ("Check the order of the Callbacks of a TracedCallback")
+{
+}
+
+void
+OrderTracedCallbackTestCase::CbA (uint32_t value)
+{
+  m_calls += "a";
+}
+
+void
+OrderTracedCallbackTestCase::CbB (uint32_t value)
+{
+  m_calls += "b";
+}
+
+void
+OrderTracedCallbackTestCase::CbConnect (uint32_t value)
+{
+  m_calls += "c";
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbA, this));
+}
+
+void
+OrderTracedCallbackTestCase::DoRun (void)
+{
+  //
+  // An empty chain does nothing.
+  //
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "", "Unexpected call");
+
+  //
+  // The Callbacks are called in the order of their connection, also after
+  // the first one was disconnected.
+  //
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbA, this));
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbB, this));
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "ab", "Unexpected calls");
+
+  m_calls = "";
+  m_trace.DisconnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbA, this));
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbA, this));
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbB, this));
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "bab", "Unexpected calls");
+
+  //
+  // Disconnect removes all the copies of a Callback.
+  //
+  m_calls = "";
+  m_trace.DisconnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbB, this));
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "a", "Unexpected calls");
+
+  m_calls = "";
+  m_trace.DisconnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbA, this));
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "", "Unexpected call");
+
+  //
+  // A Callback connected by a Callback is called by the same invocation.
+  //
+  m_trace.ConnectWithoutContext (MakeCallback (&OrderTracedCallbackTestCase::CbConnect, this));
+  m_trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "ca", "Unexpected calls");
+}
+
 class TracedCallbackTestSuite : public TestSuite
 {
 public:
@@ -118,6 +205,7 @@ TracedCallbackTestSuite::TracedCallbackTestSuite ()
   : TestSuite ("traced-callback", UNIT)
 {
   AddTestCase (new BasicTracedCallbackTestCase, TestCase::QUICK);
+  AddTestCase (new OrderTracedCallbackTestCase, TestCase::QUICK);
 }
 
 static TracedCallbackTestSuite tracedCallbackTestSuite;
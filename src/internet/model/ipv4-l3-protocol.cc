@@ -1327,9 +1327,6 @@ Ipv4L3Protocol::DoFragmentation (Ptr<Packet> packet, uint32_t outIfaceMtu, std::
       NS_LOG_LOGIC ("New fragment Header " << fragmentHeader);
       fragment->AddHeader (fragmentHeader);
 
-      std::ostringstream oss;
-      fragment->Print (oss);
-
       NS_LOG_LOGIC ("New fragment " << *fragment);
 
       listFragments.push_back (fragment);
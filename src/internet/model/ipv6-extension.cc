@@ -580,9 +580,6 @@ void Ipv6ExtensionFragment::GetFragments (Ptr<Packet> packet, uint32_t maxFragme
 
       ipv6Header.SetPayloadLength (fragment->GetSize ());
       fragment->AddHeader (ipv6Header);
-
-      std::ostringstream oss;
-      fragment->Print (oss);
       listFragments.push_back (fragment);
     }
   while (moreFragment);
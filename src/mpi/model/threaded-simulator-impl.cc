@@ -0,0 +1,688 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "threaded-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/channel.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/ptr.h"
+#include "ns3/pointer.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <limits>
+#include <sched.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ThreadedSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (ThreadedSimulatorImpl);
+
+struct ThreadedSimulatorImpl::LogicalProcess
+{
+  uint32_t id;
+  Ptr<Scheduler> events;
+  uint32_t uid;
+  uint32_t currentUid;
+  uint64_t currentTs;
+  uint32_t currentContext;
+  // next packet uid, so that the uids do not depend on the threads
+  uint32_t packetUid;
+  // events sent to each logical process during the current window
+  std::vector<std::vector<RemoteEvent> > outbox;
+  // smallest timestamp of the events sent during the current window
+  uint64_t minSentTs;
+};
+
+thread_local ThreadedSimulatorImpl::LogicalProcess *ThreadedSimulatorImpl::m_current = 0;
+
+TypeId
+ThreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ThreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Mpi")
+    .AddConstructor<ThreadedSimulatorImpl> ()
+    .AddAttribute ("MaxThreads",
+                   "The maximum number of threads which run the logical processes, "
+                   "0 for one thread per logical process.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ThreadedSimulatorImpl::m_maxThreads),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+ThreadedSimulatorImpl::ThreadedSimulatorImpl ()
+  : m_maxThreads (0),
+    m_uid (4),
+    m_lookAhead (0),
+    m_running (false),
+    m_windowEnd (0),
+    m_stopTs (std::numeric_limits<uint64_t>::max ()),
+    m_finished (false),
+    m_currentTs (0),
+    m_nThreads (1),
+    m_barrierCount (0),
+    m_barrierGeneration (0)
+{
+  NS_LOG_FUNCTION (this);
+  // uids are allocated from 4, as by DefaultSimulatorImpl.
+  // uid 2 is "destroy" events
+}
+
+ThreadedSimulatorImpl::~ThreadedSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+ThreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      LogicalProcess *lp = *i;
+      while (!lp->events->IsEmpty ())
+        {
+          Scheduler::Event next = lp->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (uint32_t j = 0; j < lp->outbox.size (); j++)
+        {
+          for (std::vector<RemoteEvent>::iterator k = lp->outbox[j].begin (); k != lp->outbox[j].end (); ++k)
+            {
+              k->event->Unref ();
+            }
+        }
+      delete lp;
+    }
+  m_lps.clear ();
+  for (std::vector<Scheduler::Event>::iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      i->impl->Unref ();
+    }
+  m_pending.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+ThreadedSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+ThreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  m_schedulerFactory = schedulerFactory;
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      while (!(*i)->events->IsEmpty ())
+        {
+          scheduler->Insert ((*i)->events->RemoveNext ());
+        }
+      (*i)->events = scheduler;
+    }
+}
+
+// The system id of the logical process of the current event, as with
+// DistributedSimulatorImpl: it makes the packet uids unique.
+uint32_t
+ThreadedSimulatorImpl::GetSystemId (void) const
+{
+  LogicalProcess *lp = GetCurrent ();
+  return lp != 0 ? lp->id : 0;
+}
+
+void
+ThreadedSimulatorImpl::Partition (void)
+{
+  NS_LOG_FUNCTION (this);
+  NodeContainer c = NodeContainer::GetGlobal ();
+  m_lpOfContext.resize (c.GetN ());
+  uint32_t nLps = std::max<uint32_t> (1, m_lps.size ());
+  for (NodeContainer::Iterator iter = c.Begin (); iter != c.End (); ++iter)
+    {
+      m_lpOfContext[(*iter)->GetId ()] = (*iter)->GetSystemId ();
+      nLps = std::max (nLps, (*iter)->GetSystemId () + 1);
+    }
+  while (m_lps.size () < nLps)
+    {
+      LogicalProcess *lp = new LogicalProcess ();
+      lp->id = m_lps.size ();
+      lp->events = m_schedulerFactory.Create<Scheduler> ();
+      lp->uid = m_uid;
+      lp->currentUid = 0;
+      lp->currentTs = m_currentTs;
+      lp->currentContext = 0xffffffff;
+      lp->packetUid = 0;
+      lp->minSentTs = std::numeric_limits<uint64_t>::max ();
+      m_lps.push_back (lp);
+    }
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      (*i)->outbox.resize (nLps);
+    }
+
+  // the smallest delay of the point to point links between logical processes,
+  // as in DistributedSimulatorImpl::CalculateLookAhead
+  Time lookAhead = GetMaximumSimulationTime ();
+  for (NodeContainer::Iterator iter = c.Begin (); iter != c.End (); ++iter)
+    {
+      for (uint32_t i = 0; i < (*iter)->GetNDevices (); ++i)
+        {
+          Ptr<NetDevice> localNetDevice = (*iter)->GetDevice (i);
+          // only works for p2p links currently
+          if (!localNetDevice->IsPointToPoint ())
+            {
+              continue;
+            }
+          Ptr<Channel> channel = localNetDevice->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+          Ptr<Node> remoteNode;
+          if (channel->GetDevice (0) == localNetDevice)
+            {
+              remoteNode = (channel->GetDevice (1))->GetNode ();
+            }
+          else
+            {
+              remoteNode = (channel->GetDevice (0))->GetNode ();
+            }
+          if (remoteNode->GetSystemId () == (*iter)->GetSystemId ())
+            {
+              continue;
+            }
+          TimeValue delay;
+          channel->GetAttribute ("Delay", delay);
+          if (delay.Get () < lookAhead)
+            {
+              lookAhead = delay.Get ();
+            }
+        }
+    }
+  NS_ABORT_MSG_IF (!lookAhead.IsStrictlyPositive (),
+                   "ThreadedSimulatorImpl needs links with a positive delay between logical processes");
+  m_lookAhead = lookAhead.GetTimeStep ();
+  NS_LOG_LOGIC ("logical processes " << m_lps.size () << " lookahead " << m_lookAhead);
+}
+
+ThreadedSimulatorImpl::LogicalProcess *
+ThreadedSimulatorImpl::GetLogicalProcess (uint32_t context) const
+{
+  if (context < m_lpOfContext.size ())
+    {
+      return m_lps[m_lpOfContext[context]];
+    }
+  return m_lps[0];
+}
+
+ThreadedSimulatorImpl::LogicalProcess *
+ThreadedSimulatorImpl::GetCurrent (void) const
+{
+  return m_current;
+}
+
+EventId
+ThreadedSimulatorImpl::Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = lp->uid;
+  lp->uid++;
+  lp->events->Insert (ev);
+  return EventId (event, ts, context, ev.key.m_uid);
+}
+
+void
+ThreadedSimulatorImpl::ReceiveEvents (LogicalProcess *lp)
+{
+  // always in the order of the senders, whatever the thread which ran them
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      std::vector<RemoteEvent> &events = (*i)->outbox[lp->id];
+      for (std::vector<RemoteEvent>::const_iterator j = events.begin (); j != events.end (); ++j)
+        {
+          Insert (lp, j->ts, j->context, j->event);
+        }
+      events.clear ();
+    }
+}
+
+void
+ThreadedSimulatorImpl::ProcessWindow (LogicalProcess *lp)
+{
+  m_current = lp;
+  Packet::ExchangeUidCounter (lp->packetUid);
+  ReceiveEvents (lp);
+  while (!lp->events->IsEmpty () && lp->events->PeekNext ().key.m_ts < m_windowEnd)
+    {
+      Scheduler::Event next = lp->events->RemoveNext ();
+      NS_ASSERT (next.key.m_ts >= lp->currentTs);
+      lp->currentTs = next.key.m_ts;
+      lp->currentContext = next.key.m_context;
+      lp->currentUid = next.key.m_uid;
+      next.impl->Invoke ();
+      next.impl->Unref ();
+    }
+  lp->packetUid = Packet::ExchangeUidCounter (0);
+  m_current = 0;
+}
+
+bool
+ThreadedSimulatorImpl::NextWindow (void)
+{
+  uint64_t next = std::numeric_limits<uint64_t>::max ();
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      LogicalProcess *lp = *i;
+      if (!lp->events->IsEmpty ())
+        {
+          next = std::min (next, lp->events->PeekNext ().key.m_ts);
+        }
+      next = std::min (next, lp->minSentTs);
+      lp->minSentTs = std::numeric_limits<uint64_t>::max ();
+    }
+  uint64_t stopTs = m_stopTs.load ();
+  if (next == std::numeric_limits<uint64_t>::max () || next > stopTs)
+    {
+      return false;
+    }
+  uint64_t end = std::numeric_limits<uint64_t>::max ();
+  if (next < end - m_lookAhead)
+    {
+      end = next + m_lookAhead;
+    }
+  if (stopTs < end - 1)
+    {
+      end = stopTs + 1;
+    }
+  m_windowEnd = end;
+  return true;
+}
+
+void
+ThreadedSimulatorImpl::Barrier (void)
+{
+  uint32_t generation = m_barrierGeneration.load (std::memory_order_acquire);
+  if (m_barrierCount.fetch_add (1, std::memory_order_acq_rel) + 1 == m_nThreads)
+    {
+      m_barrierCount.store (0, std::memory_order_relaxed);
+      m_barrierGeneration.fetch_add (1, std::memory_order_release);
+      return;
+    }
+  uint32_t spins = 0;
+  while (m_barrierGeneration.load (std::memory_order_acquire) == generation)
+    {
+      // windows are short, spin for a while before giving up the cpu
+      if (++spins > 1000)
+        {
+          sched_yield ();
+        }
+    }
+}
+
+void
+ThreadedSimulatorImpl::RunThread (uint32_t thread)
+{
+  while (true)
+    {
+      // the logical processes are always run by the same thread
+      for (uint32_t i = thread; i < m_lps.size (); i += m_nThreads)
+        {
+          ProcessWindow (m_lps[i]);
+        }
+      Barrier ();
+      if (thread == 0)
+        {
+          m_finished = !NextWindow ();
+        }
+      Barrier ();
+      if (m_finished)
+        {
+          return;
+        }
+    }
+}
+
+void
+ThreadedSimulatorImpl::StartThread (std::pair<ThreadedSimulatorImpl *, uint32_t> thread)
+{
+  thread.first->RunThread (thread.second);
+}
+
+void
+ThreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  Partition ();
+  for (std::vector<Scheduler::Event>::const_iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      GetLogicalProcess (i->key.m_context)->events->Insert (*i);
+    }
+  m_pending.clear ();
+  // the logical processes go on with the packet uids of this thread
+  uint32_t packetUid = Packet::ExchangeUidCounter (0);
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      (*i)->uid = std::max ((*i)->uid, m_uid);
+      (*i)->packetUid = std::max ((*i)->packetUid, packetUid);
+    }
+
+  m_nThreads = m_maxThreads == 0 ? m_lps.size () : std::min<uint32_t> (m_maxThreads, m_lps.size ());
+  m_running = true;
+  m_finished = !NextWindow ();
+  if (!m_finished)
+    {
+      for (uint32_t i = 1; i < m_nThreads; i++)
+        {
+          Ptr<SystemThread> thread = Create<SystemThread> (
+              MakeBoundCallback (&ThreadedSimulatorImpl::StartThread,
+                                 std::pair<ThreadedSimulatorImpl *, uint32_t> (this, i)));
+          m_threads.push_back (thread);
+          thread->Start ();
+        }
+      RunThread (0);
+      for (std::vector<Ptr<SystemThread> >::iterator i = m_threads.begin (); i != m_threads.end (); ++i)
+        {
+          (*i)->Join ();
+        }
+      m_threads.clear ();
+    }
+  m_running = false;
+
+  for (std::vector<LogicalProcess *>::iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      m_currentTs = std::max (m_currentTs, (*i)->currentTs);
+      m_uid = std::max (m_uid, (*i)->uid);
+      packetUid = std::max (packetUid, (*i)->packetUid);
+    }
+  Packet::ExchangeUidCounter (packetUid);
+  // a stop only applies to the current run
+  m_stopTs.store (std::numeric_limits<uint64_t>::max ());
+}
+
+bool
+ThreadedSimulatorImpl::IsFinished (void) const
+{
+  if (!m_pending.empty ())
+    {
+      return false;
+    }
+  for (std::vector<LogicalProcess *>::const_iterator i = m_lps.begin (); i != m_lps.end (); ++i)
+    {
+      if (!(*i)->events->IsEmpty ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+ThreadedSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  Stop (Seconds (0));
+}
+
+void
+ThreadedSimulatorImpl::Stop (Time const &time)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep ());
+  uint64_t ts = (Now () + time).GetTimeStep ();
+  if (m_running && ts < m_windowEnd - 1)
+    {
+      // the other logical processes may already have run up to the end
+      // of the window, all of them stop there
+      ts = m_windowEnd - 1;
+    }
+  uint64_t stopTs = m_stopTs.load ();
+  while (ts < stopTs && !m_stopTs.compare_exchange_weak (stopTs, ts))
+    {
+    }
+}
+
+EventId
+ThreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep () << event);
+  NS_ASSERT_MSG (!time.IsStrictlyNegative (), "ThreadedSimulatorImpl::Schedule(): Negative delay");
+  LogicalProcess *lp = GetCurrent ();
+  if (lp == 0)
+    {
+      return SchedulePending (0xffffffff, time, event);
+    }
+  return Insert (lp, lp->currentTs + time.GetTimeStep (), lp->currentContext, event);
+}
+
+void
+ThreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+  NS_ASSERT_MSG (!time.IsStrictlyNegative (), "ThreadedSimulatorImpl::ScheduleWithContext(): Negative delay");
+  LogicalProcess *lp = GetCurrent ();
+  if (lp == 0)
+    {
+      SchedulePending (context, time, event);
+      return;
+    }
+  uint64_t ts = lp->currentTs + time.GetTimeStep ();
+  LogicalProcess *remote = GetLogicalProcess (context);
+  if (remote == lp)
+    {
+      Insert (lp, ts, context, event);
+      return;
+    }
+  NS_ABORT_MSG_IF (ts < m_windowEnd,
+                   "Event scheduled for another logical process within the lookahead");
+  RemoteEvent ev;
+  ev.ts = ts;
+  ev.context = context;
+  ev.event = event;
+  lp->outbox[remote->id].push_back (ev);
+  if (ts < lp->minSentTs)
+    {
+      lp->minSentTs = ts;
+    }
+}
+
+EventId
+ThreadedSimulatorImpl::SchedulePending (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_ABORT_MSG_IF (m_running,
+                   "ThreadedSimulatorImpl does not support events scheduled from foreign threads");
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = m_currentTs + time.GetTimeStep ();
+  ev.key.m_context = context;
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_pending.push_back (ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+ThreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << event);
+  return Schedule (TimeStep (0), event);
+}
+
+EventId
+ThreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << event);
+  EventId id (Ptr<EventImpl> (event, false), Now ().GetTimeStep (), 0xffffffff, 2);
+  CriticalSection cs (m_destroyMutex);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+ThreadedSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  LogicalProcess *lp = GetCurrent ();
+  return TimeStep (lp != 0 ? lp->currentTs : m_currentTs);
+}
+
+Time
+ThreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs ()) - Now ();
+    }
+}
+
+void
+ThreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  bool found = false;
+  for (std::vector<Scheduler::Event>::iterator i = m_pending.begin (); i != m_pending.end (); ++i)
+    {
+      if (i->key.m_uid == event.key.m_uid && i->impl == event.impl)
+        {
+          m_pending.erase (i);
+          found = true;
+          break;
+        }
+    }
+  if (!found)
+    {
+      LogicalProcess *lp = GetLogicalProcess (id.GetContext ());
+      NS_ABORT_MSG_IF (m_running && lp != GetCurrent (),
+                       "Simulator::Remove of an event of another logical process");
+      lp->events->Remove (event);
+    }
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+ThreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+ThreadedSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0 ||
+          id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (m_destroyMutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (id.PeekEventImpl () == 0 ||
+      id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  if (m_lps.empty ())
+    {
+      // the simulation did not start yet
+      return false;
+    }
+  // compare with the current event of the logical process of the event
+  const LogicalProcess *lp = GetLogicalProcess (id.GetContext ());
+  return id.GetTs () < lp->currentTs ||
+         (id.GetTs () == lp->currentTs && id.GetUid () <= lp->currentUid);
+}
+
+Time
+ThreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+ThreadedSimulatorImpl::GetContext (void) const
+{
+  LogicalProcess *lp = GetCurrent ();
+  return lp != 0 ? lp->currentContext : 0xffffffff;
+}
+
+} // namespace ns3
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NS3_THREADED_SIMULATOR_IMPL_H
+#define NS3_THREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/ptr.h"
+
+#include <atomic>
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup mpi
+ *
+ * \brief conservative parallel simulator on the threads of one process
+ *
+ * The nodes are partitioned into logical processes by their system id,
+ * as for DistributedSimulatorImpl: a node created with
+ * CreateObject<Node> (n) belongs to the logical process n. The events
+ * of a context go to the logical process of its node; the events
+ * without a node context go to the logical process 0. Each logical
+ * process has its own event list, its own event uids and its own
+ * packet uids.
+ *
+ * The simulation advances in windows of the lookahead, which is the
+ * smallest delay of the point to point channels which join two logical
+ * processes, as computed by DistributedSimulatorImpl. In a window, the
+ * logical processes run their events in parallel, on up to MaxThreads
+ * threads. An event scheduled for another logical process must fall
+ * after the current window: it is buffered by the sender and inserted
+ * in the event list of the receiver at the next window. Events are
+ * passed as they are. With this simulator only, a PointToPointChannel
+ * which joins two logical processes delivers a deep copy of the
+ * packet, made by Packet::CreateDeepCopy, which keeps its uid, tags
+ * and metadata. Its TxRxPointToPoint trace is fired on the thread of
+ * the sender, with a reference to the destination device, which the
+ * thread of the receiver uses meanwhile: connect it only with
+ * MaxThreads set to 1.
+ *
+ * The events sent to a logical process are inserted in the order of
+ * the sending logical processes, so the order of the events does not
+ * depend on the number of threads: a run with MaxThreads set to 1,
+ * which processes the logical processes one after the other, is
+ * bit-identical to a run with any number of threads, for the same
+ * partition.
+ *
+ * The models must not share state between logical processes, except
+ * through the events. Simulator::Stop (delay) stops the simulation
+ * after all the events scheduled at or before the stop time, in all
+ * logical processes, or at the end of the current window if the stop
+ * time falls in it, as the other logical processes may already have
+ * run the whole window. Simulator::Stop () stops it at the end of the
+ * current window. Events cannot be scheduled from threads which do not
+ * run the simulation.
+ */
+class ThreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ThreadedSimulatorImpl ();
+  ~ThreadedSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /** The event list and the current event of a partition. */
+  struct LogicalProcess;
+
+  /** An event sent to another logical process. */
+  struct RemoteEvent
+  {
+    uint64_t ts;
+    uint32_t context;
+    EventImpl *event;
+  };
+
+  /** Create the logical processes and compute the lookahead. */
+  void Partition (void);
+  /** \returns the logical process of the context. */
+  LogicalProcess * GetLogicalProcess (uint32_t context) const;
+  /** \returns the logical process running on this thread, or 0. */
+  LogicalProcess * GetCurrent (void) const;
+  /** Insert an event in a logical process. */
+  EventId Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event);
+  /** Keep an event scheduled while the simulation is not running. */
+  EventId SchedulePending (uint32_t context, Time const &time, EventImpl *event);
+  /** Insert the events received by a logical process. */
+  void ReceiveEvents (LogicalProcess *lp);
+  /** Run the events of the current window of a logical process. */
+  void ProcessWindow (LogicalProcess *lp);
+  /** Compute the next window. \returns false when the simulation ends. */
+  bool NextWindow (void);
+  /** Wait until all the threads reached the barrier. */
+  void Barrier (void);
+  /** The loop of a thread. */
+  void RunThread (uint32_t thread);
+  /** Entry point of the other threads. */
+  static void StartThread (std::pair<ThreadedSimulatorImpl *, uint32_t> thread);
+
+  /** The logical process run by the current thread, if any. */
+  static thread_local LogicalProcess *m_current;
+
+  typedef std::list<EventId> DestroyEvents;
+  DestroyEvents m_destroyEvents;
+  // ScheduleDestroy can be called from any logical process
+  mutable SystemMutex m_destroyMutex;
+
+  ObjectFactory m_schedulerFactory;
+  uint32_t m_maxThreads;
+
+  // the logical processes, indexed by system id
+  std::vector<LogicalProcess *> m_lps;
+  // the logical process of each node context
+  std::vector<uint32_t> m_lpOfContext;
+  // events scheduled from the main thread, when the simulation is not running
+  std::vector<Scheduler::Event> m_pending;
+  // next uid of the events scheduled when the simulation is not running
+  uint32_t m_uid;
+  uint64_t m_lookAhead;
+  bool m_running;
+
+  // timestamp of the current window end, not included
+  uint64_t m_windowEnd;
+  // the simulation stops after this timestamp
+  std::atomic<uint64_t> m_stopTs;
+  bool m_finished;
+  // the current time, when the simulation is not running
+  uint64_t m_currentTs;
+
+  uint32_t m_nThreads;
+  std::vector<Ptr<SystemThread> > m_threads;
+  std::atomic<uint32_t> m_barrierCount;
+  std::atomic<uint32_t> m_barrierGeneration;
+};
+
+} // namespace ns3
+
+#endif /* NS3_THREADED_SIMULATOR_IMPL_H */
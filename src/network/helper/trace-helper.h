@@ -101,6 +101,26 @@ public:
    */
   Ptr<PcapFileWrapper> CreateFile (std::string filename, std::ios::openmode filemode,
                                    uint32_t dataLinkType,  uint32_t snapLen = std::numeric_limits<uint32_t>::max (), int32_t tzCorrection = 0);
+
+  /**
+   * @brief Write the captures of all the pcap helpers to a single pcapng file.
+   *
+   * The files created afterwards by CreateFile are interfaces of the pcapng
+   * file instead, named after the file each would have been: a scenario
+   * which enables pcap on hundreds of devices opens a single file.  The
+   * pcapng file is written until Simulator::Destroy or DisablePcapNg, and
+   * closed once the last interface is.
+   *
+   * @param filename file name of the pcapng file
+   */
+  static void EnablePcapNg (std::string filename);
+
+  /**
+   * @brief Create a pcap file per call to CreateFile again.
+   *
+   * The interfaces already created keep writing to the pcapng file.
+   */
+  static void DisablePcapNg (void);
   /**
    * @brief Hook a trace source to the default trace sink
    * 
@@ -194,6 +214,10 @@ public:
    * run into object lifetime issues.  Ns-3 has a nice reference counted object
    * that can solve the problem so we use one of those to carry the stream
    * around and deal with the lifetime issues.
+   *
+   * The default trace sinks below do not flush the stream after each line:
+   * the file is complete once the stream is destroyed, usually by
+   * Simulator::Destroy.
    * 
    * @param filename file name
    * @param filemode file mode
@@ -50,7 +50,8 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
 
-uint32_t Buffer::g_recommendedStart = 0;
+thread_local uint32_t Buffer::g_recommendedStart = 0;
+thread_local struct Buffer::Footprint Buffer::g_footprint = { 0, 0, 0 };
 #ifdef BUFFER_FREE_LIST
 /* The following macros are pretty evil but they are needed to allow us to
  * keep track of 3 possible states for the g_freeList variable:
@@ -75,9 +76,9 @@ uint32_t Buffer::g_recommendedStart = 0;
 #define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
 #define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
 #define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
+thread_local uint32_t Buffer::g_maxSize = 0;
+thread_local Buffer::FreeList *Buffer::g_freeList = 0;
+thread_local struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
 
 Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
 {
@@ -123,6 +124,8 @@ Buffer::Create (uint32_t dataSize)
   if (IS_UNINITIALIZED (g_freeList))
     {
       g_freeList = new Buffer::FreeList ();
+      // make sure the destructor of this thread runs
+      (void)&g_localStaticDestructor;
     }
   else if (IS_INITIALIZED (g_freeList))
     {
@@ -173,6 +176,8 @@ Buffer::Allocate (uint32_t reqSize)
   struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
   data->m_size = reqSize;
   data->m_count = 1;
+  g_footprint.m_dataBytes += reqSize;
+  g_footprint.m_maxDataBytes = std::max (g_footprint.m_maxDataBytes, g_footprint.m_dataBytes);
   return data;
 }
 
@@ -181,23 +186,27 @@ Buffer::Deallocate (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
+  g_footprint.m_dataBytes -= data->m_size;
   uint8_t *buf = reinterpret_cast<uint8_t *> (data);
   delete [] buf;
 }
 
 Buffer::Buffer ()
+  : m_fragments (0)
 {
   NS_LOG_FUNCTION (this);
   Initialize (0);
 }
 
 Buffer::Buffer (uint32_t dataSize)
+  : m_fragments (0)
 {
   NS_LOG_FUNCTION (this << dataSize);
   Initialize (dataSize);
 }
 
 Buffer::Buffer (uint32_t dataSize, bool initialize)
+  : m_fragments (0)
 {
   NS_LOG_FUNCTION (this << dataSize << initialize);
   if (initialize == true)
@@ -276,6 +285,17 @@ Buffer::operator = (Buffer const&o)
   m_zeroAreaEnd = o.m_zeroAreaEnd;
   m_start = o.m_start;
   m_end = o.m_end;
+  // last, because o may be one of our own fragments
+  struct Fragments *fragments = o.m_fragments;
+  if (fragments != m_fragments)
+    {
+      if (fragments != 0)
+        {
+          fragments->m_count++;
+        }
+      ReleaseFragments ();
+      m_fragments = fragments;
+    }
   NS_ASSERT (CheckInternalState ());
   return *this;
 }
@@ -284,6 +304,7 @@ Buffer::~Buffer ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
+  ReleaseFragments ();
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
   m_data->m_count--;
   if (m_data->m_count == 0) 
@@ -310,6 +331,10 @@ Buffer::AddAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   bool dirty;
+  if (m_fragments != 0)
+    {
+      Flatten (0);
+    }
   NS_ASSERT (CheckInternalState ());
   bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
   if (m_start >= start && !isDirty)
@@ -361,6 +386,11 @@ Buffer::AddAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   bool dirty;
+  if (m_fragments != 0)
+    {
+      // reserve the new bytes in the single data buffer
+      Flatten (end);
+    }
   NS_ASSERT (CheckInternalState ());
   bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
   if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
@@ -415,7 +445,17 @@ void
 Buffer::AddAtEnd (const Buffer &o)
 {
   NS_LOG_FUNCTION (this << &o);
-  if (m_data->m_count == 1 &&
+  if (o.GetSize () == 0)
+    {
+      return;
+    }
+  if (GetSize () == 0 && m_fragments == 0)
+    {
+      *this = o;
+      return;
+    }
+  if (m_fragments == 0 && o.m_fragments == 0 &&
+      m_data->m_count == 1 &&
       m_end == m_zeroAreaEnd &&
       m_end == m_data->m_dirtyEnd &&
       o.m_start == o.m_zeroAreaStart &&
@@ -441,14 +481,20 @@ Buffer::AddAtEnd (const Buffer &o)
       return;
     }
 
-  Buffer dst = CreateFullCopy ();
-  Buffer src = o.CreateFullCopy ();
-
-  dst.AddAtEnd (src.GetSize ());
-  Buffer::Iterator destStart = dst.End ();
-  destStart.Prev (src.GetSize ());
-  destStart.Write (src.Begin (), src.End ());
-  *this = dst;
+  // o may be this buffer
+  Buffer src = o;
+  UnshareFragments ();
+  if (src.m_fragments != 0)
+    {
+      m_fragments->m_buffers.insert (m_fragments->m_buffers.end (),
+                                     src.m_fragments->m_buffers.begin (),
+                                     src.m_fragments->m_buffers.end ());
+    }
+  else
+    {
+      m_fragments->m_buffers.push_back (src);
+    }
+  m_fragments->m_end += src.GetSize ();
   NS_ASSERT (CheckInternalState ());
 }
 
@@ -457,6 +503,37 @@ Buffer::RemoveAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
+  if (m_fragments != 0)
+    {
+      UnshareFragments ();
+      std::vector<Buffer> &buffers = m_fragments->m_buffers;
+      uint32_t size = GetSize () - std::min (start, GetSize ());
+      std::vector<Buffer>::iterator i = buffers.begin ();
+      while (i != buffers.end () && start >= i->GetSize ())
+        {
+          start -= i->GetSize ();
+          i++;
+        }
+      buffers.erase (buffers.begin (), i);
+      if (buffers.size () > 1)
+        {
+          buffers.front ().RemoveAtStart (start);
+          // the offsets follow the first fragment
+          m_fragments->m_start = buffers.front ().m_start;
+          m_fragments->m_end = m_fragments->m_start + size;
+        }
+      else if (buffers.size () == 1)
+        {
+          Buffer last = buffers.front ();
+          last.RemoveAtStart (start);
+          *this = last;
+        }
+      else
+        {
+          ReleaseFragments ();
+        }
+      return;
+    }
   uint32_t newStart = m_start + start;
   if (newStart <= m_zeroAreaStart)
     {
@@ -502,6 +579,32 @@ Buffer::RemoveAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
+  if (m_fragments != 0)
+    {
+      UnshareFragments ();
+      std::vector<Buffer> &buffers = m_fragments->m_buffers;
+      m_fragments->m_end -= std::min (end, GetSize ());
+      while (!buffers.empty () && end >= buffers.back ().GetSize ())
+        {
+          end -= buffers.back ().GetSize ();
+          buffers.pop_back ();
+        }
+      if (buffers.size () > 1)
+        {
+          buffers.back ().RemoveAtEnd (end);
+        }
+      else if (buffers.size () == 1)
+        {
+          Buffer first = buffers.front ();
+          first.RemoveAtEnd (end);
+          *this = first;
+        }
+      else
+        {
+          ReleaseFragments ();
+        }
+      return;
+    }
   uint32_t newEnd = m_end - std::min (end, m_end - m_start);
   if (newEnd > m_zeroAreaEnd)
     {
@@ -550,8 +653,15 @@ Buffer::CreateFullCopy (void) const
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
+  if (m_fragments != 0)
+    {
+      Buffer tmp = *this;
+      tmp.Flatten (0);
+      return tmp.CreateFullCopy ();
+    }
   if (m_zeroAreaEnd - m_zeroAreaStart != 0) 
     {
+      g_footprint.m_materializedZeroBytes += m_zeroAreaEnd - m_zeroAreaStart;
       Buffer tmp;
       tmp.AddAtStart (m_zeroAreaEnd - m_zeroAreaStart);
       tmp.Begin ().WriteU8 (0, m_zeroAreaEnd - m_zeroAreaStart);
@@ -570,10 +680,37 @@ Buffer::CreateFullCopy (void) const
   return *this;
 }
 
+Buffer
+Buffer::CreateDeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (CheckInternalState ());
+  Buffer copy = *this;
+  if (copy.m_fragments != 0)
+    {
+      // the fragments are copied into new data, owned by the copy only
+      copy.Flatten (0);
+      return copy;
+    }
+  struct Buffer::Data *data = Buffer::Create (GetInternalEnd ());
+  memcpy (data->m_data + m_start, m_data->m_data + m_start, GetInternalSize ());
+  data->m_dirtyStart = m_start;
+  data->m_dirtyEnd = m_end;
+  // this buffer still holds a reference to the shared data
+  copy.m_data->m_count--;
+  copy.m_data = data;
+  NS_ASSERT (copy.CheckInternalState ());
+  return copy;
+}
+
 uint32_t 
 Buffer::GetSerializedSize (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragments != 0)
+    {
+      Flatten (0);
+    }
   uint32_t dataStart = (m_zeroAreaStart - m_start + 3) & (~0x3);
   uint32_t dataEnd = (m_end - m_zeroAreaEnd + 3) & (~0x3);
 
@@ -594,6 +731,10 @@ uint32_t
 Buffer::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  if (m_fragments != 0)
+    {
+      Flatten (0);
+    }
   uint32_t* p = reinterpret_cast<uint32_t *> (buffer);
   uint32_t size = 0;
 
@@ -664,6 +805,7 @@ uint32_t
 Buffer::Deserialize (const uint8_t *buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &buffer << size);
+  ReleaseFragments ();
   const uint32_t* p = reinterpret_cast<const uint32_t *> (buffer);
   uint32_t sizeCheck = size-4;
 
@@ -704,19 +846,181 @@ Buffer::Deserialize (const uint8_t *buffer, uint32_t size)
   return (sizeCheck != 0) ? 0 : 1;
 }
 
+struct Buffer::Footprint
+Buffer::GetFootprint (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return g_footprint;
+}
+
 int32_t 
 Buffer::GetCurrentStartOffset (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragments != 0)
+    {
+      return m_fragments->m_start;
+    }
   return m_start;
 }
 int32_t 
 Buffer::GetCurrentEndOffset (void) const
 {
   NS_LOG_FUNCTION (this);
+  if (m_fragments != 0)
+    {
+      return m_fragments->m_end;
+    }
   return m_end;
 }
 
+void
+Buffer::UnshareFragments (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fragments == 0)
+    {
+      struct Fragments *fragments = new Fragments ();
+      fragments->m_count = 1;
+      fragments->m_start = m_start;
+      fragments->m_end = m_end;
+      if (GetSize () > 0)
+        {
+          fragments->m_buffers.push_back (*this);
+        }
+      // the other fields are not used anymore: make them an empty buffer
+      m_zeroAreaStart = m_start;
+      m_zeroAreaEnd = m_start;
+      m_end = m_start;
+      m_fragments = fragments;
+    }
+  else if (m_fragments->m_count > 1)
+    {
+      struct Fragments *fragments = new Fragments (*m_fragments);
+      fragments->m_count = 1;
+      m_fragments->m_count--;
+      m_fragments = fragments;
+    }
+}
+
+void
+Buffer::ReleaseFragments (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fragments != 0)
+    {
+      m_fragments->m_count--;
+      if (m_fragments->m_count == 0)
+        {
+          delete m_fragments;
+        }
+      m_fragments = 0;
+    }
+}
+
+void
+Buffer::Flatten (uint32_t end) const
+{
+  NS_LOG_FUNCTION (this << end);
+  NS_ASSERT (m_fragments != 0);
+  const std::vector<Buffer> &buffers = m_fragments->m_buffers;
+  uint32_t start = m_fragments->m_start;
+
+  /* Find the largest run of adjacent zero areas: it stays virtual.
+   * The other zero areas are written as real zero bytes.
+   */
+  uint32_t zeroStart = start;
+  uint32_t zeroEnd = start;
+  uint32_t runStart = start;
+  uint32_t runEnd = start;
+  uint32_t current = start;
+  for (std::vector<Buffer>::const_iterator i = buffers.begin (); i != buffers.end (); i++)
+    {
+      uint32_t dataStart = i->m_zeroAreaStart - i->m_start;
+      uint32_t zeroSize = i->m_zeroAreaEnd - i->m_zeroAreaStart;
+      uint32_t dataEnd = i->m_end - i->m_zeroAreaEnd;
+      if (dataStart > 0)
+        {
+          current += dataStart;
+          runStart = current;
+          runEnd = current;
+        }
+      if (zeroSize > 0)
+        {
+          if (runEnd != current)
+            {
+              runStart = current;
+            }
+          current += zeroSize;
+          runEnd = current;
+          if (runEnd - runStart > zeroEnd - zeroStart)
+            {
+              zeroStart = runStart;
+              zeroEnd = runEnd;
+            }
+        }
+      if (dataEnd > 0)
+        {
+          current += dataEnd;
+          runStart = current;
+          runEnd = current;
+        }
+    }
+  NS_ASSERT (current == m_fragments->m_end);
+
+  /* Copy the bytes, at the same offsets. The bytes after the virtual
+   * zero area are stored right after the bytes before it.
+   */
+  uint32_t zeroSize = zeroEnd - zeroStart;
+  uint32_t internalEnd = m_fragments->m_end - zeroSize;
+  struct Buffer::Data *data = Buffer::Create (internalEnd + end);
+  current = start;
+  for (std::vector<Buffer>::const_iterator i = buffers.begin (); i != buffers.end (); i++)
+    {
+      uint32_t dataStart = i->m_zeroAreaStart - i->m_start;
+      uint32_t size = i->m_zeroAreaEnd - i->m_zeroAreaStart;
+      uint32_t dataEnd = i->m_end - i->m_zeroAreaEnd;
+      uint8_t *dst = data->m_data;
+      if (current < zeroEnd)
+        {
+          dst += std::min (current, zeroStart);
+        }
+      else
+        {
+          dst += current - zeroSize;
+        }
+      memcpy (dst, i->m_data->m_data + i->m_start, dataStart);
+      dst += dataStart;
+      current += dataStart;
+      if (current < zeroStart || current >= zeroEnd)
+        {
+          memset (dst, 0, size);
+          dst += size;
+          g_footprint.m_materializedZeroBytes += size;
+        }
+      current += size;
+      memcpy (dst, i->m_data->m_data + i->m_zeroAreaStart, dataEnd);
+      current += dataEnd;
+    }
+
+  Buffer *self = const_cast<Buffer *> (this);
+  self->m_data->m_count--;
+  if (self->m_data->m_count == 0)
+    {
+      Buffer::Recycle (self->m_data);
+    }
+  self->m_data = data;
+  self->m_start = start;
+  self->m_zeroAreaStart = zeroStart;
+  self->m_zeroAreaEnd = zeroEnd;
+  self->m_end = m_fragments->m_end;
+  self->m_maxZeroAreaStart = start;
+  data->m_dirtyStart = self->m_start;
+  data->m_dirtyEnd = self->m_end;
+  self->ReleaseFragments ();
+  NS_ASSERT (CheckInternalState ());
+}
+
 
 void
 Buffer::TransformIntoRealBuffer (void) const
@@ -743,6 +1047,17 @@ void
 Buffer::CopyData (std::ostream *os, uint32_t size) const
 {
   NS_LOG_FUNCTION (this << &os << size);
+  if (m_fragments != 0)
+    {
+      for (std::vector<Buffer>::const_iterator i = m_fragments->m_buffers.begin ();
+           i != m_fragments->m_buffers.end () && size > 0; i++)
+        {
+          uint32_t tmpsize = std::min (i->GetSize (), size);
+          i->CopyData (os, tmpsize);
+          size -= tmpsize;
+        }
+      return;
+    }
   if (size > 0)
     {
       uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
@@ -772,6 +1087,16 @@ uint32_t
 Buffer::CopyData (uint8_t *buffer, uint32_t size) const
 {
   NS_LOG_FUNCTION (this << &buffer << size);
+  if (m_fragments != 0)
+    {
+      uint32_t copied = 0;
+      for (std::vector<Buffer>::const_iterator i = m_fragments->m_buffers.begin ();
+           i != m_fragments->m_buffers.end () && copied < size; i++)
+        {
+          copied += i->CopyData (buffer + copied, size - copied);
+        }
+      return copied;
+    }
   uint32_t originalSize = size;
   if (size > 0)
     {
@@ -65,10 +65,9 @@ namespace ns3 {
  * contains real data bytes in its BufferData instance but it also
  * contains "virtual zero data" which typically is used to represent
  * application-level payload. No memory is allocated to store the
- * zero bytes of application-level payload unless the user fragments
- * a Buffer: this application-level payload is kept track of with
- * a pair of integers which describe where in the buffer content
- * the "virtual zero area" starts and ends.
+ * zero bytes of application-level payload: this application-level
+ * payload is kept track of with a pair of integers which describe
+ * where in the buffer content the "virtual zero area" starts and ends.
  *
  * \verbatim
  * ***: unused bytes
@@ -88,6 +87,20 @@ namespace ns3 {
  * \endverbatim
  *
  * A simple state invariant is that m_start <= m_zeroStart <= m_zeroEnd <= m_end
+ *
+ * Appending a Buffer to another one does not copy their bytes: the
+ * result is a list of fragments, Buffer instances which share the data
+ * of the appended buffers. CreateFragment, RemoveAtStart and RemoveAtEnd
+ * work on this list, CopyData reads it directly. The first call which
+ * needs contiguous bytes, Begin, End, PeekData or Serialize for example,
+ * copies the fragments into a single data buffer. The virtual zero
+ * areas of the fragments are merged when they are adjacent, and the
+ * largest one stays virtual.
+ *
+ * Fragmenting, appending, serializing and copying out a Buffer thus
+ * keep a zero-filled payload virtual. The zero bytes are written into
+ * memory only by PeekData, and when fragments with zero areas which
+ * are not adjacent are merged. GetFootprint counts them.
  */
 class Buffer 
 {
@@ -520,7 +533,8 @@ private:
   /**
    * \param o the buffer to append to the end of this buffer.
    *
-   * Add bytes at the end of the Buffer.
+   * Add bytes at the end of the Buffer. The bytes are not copied:
+   * this buffer becomes a list of fragments which share the data of o.
    * Any call to this method invalidates any Iterator
    * pointing to this Buffer.
    */
@@ -570,6 +584,17 @@ private:
    */
   Buffer CreateFullCopy (void) const;
 
+  /**
+   * \brief Create a copy of the buffer which shares no data with it.
+   *
+   * The copy has the same offsets as the buffer, but the copies of a
+   * buffer share their data through a reference count which is not
+   * thread-safe: a buffer handed to another thread must be a deep copy.
+   *
+   * \returns a copy of the buffer
+   */
+  Buffer CreateDeepCopy (void) const;
+
   /**
    * \brief Return the number of bytes required for serialization.
    * \return the number of bytes.
@@ -626,6 +651,30 @@ private:
    */
   uint32_t CopyData (uint8_t *buffer, uint32_t size) const;
 
+  /**
+   * \brief Memory used by the buffers of a thread.
+   */
+  struct Footprint
+  {
+    /**
+     * Bytes of the data buffers currently allocated, including the
+     * free list. A data buffer released by another thread is subtracted
+     * from the footprint of that thread: sum the values of all the
+     * threads.
+     */
+    int64_t m_dataBytes;
+    int64_t m_maxDataBytes; //!< The maximum value of m_dataBytes
+    /**
+     * Virtual zero bytes written into data buffers, by PeekData or by
+     * the merge of fragments.
+     */
+    uint64_t m_materializedZeroBytes;
+  };
+  /**
+   * \returns the memory footprint of the buffers of the calling thread.
+   */
+  static struct Footprint GetFootprint (void);
+
   /**
    * \brief Copy constructor
    * \param o the buffer to copy
@@ -700,10 +749,34 @@ private:
     uint8_t m_data[1];
   };
 
+  /**
+   * The list of fragments of a buffer built by AddAtEnd (const Buffer &).
+   * It is shared between the copies of the buffer, and copied before
+   * being modified if it is shared.
+   */
+  struct Fragments;
+
   /**
    * \brief Transform a "Virtual byte buffer" into a "Real byte buffer"
    */
   void TransformIntoRealBuffer (void) const;
+  /**
+   * \brief Copy the fragments into a single data buffer
+   * \param end the number of bytes to reserve after the data
+   *
+   * The start and end offsets of the buffer do not change.
+   */
+  void Flatten (uint32_t end) const;
+  /**
+   * \brief Make the fragments writable by this buffer only
+   *
+   * A buffer which has no fragments becomes a list of one fragment.
+   */
+  void UnshareFragments (void);
+  /**
+   * \brief Release the reference of this buffer to its fragments
+   */
+  void ReleaseFragments (void);
   /**
    * \brief Checks the internal buffer structures consistency
    *
@@ -774,7 +847,9 @@ private:
    * writing data. i.e., m_start should be initialized to this 
    * value.
    */
-  static uint32_t g_recommendedStart;
+  static thread_local uint32_t g_recommendedStart;
+  /// Memory used by the buffers of the thread
+  static thread_local struct Footprint g_footprint;
 
   /**
    * offset to the start of the virtual zero area from the start
@@ -797,6 +872,12 @@ private:
    */
   uint32_t m_end;
 
+  /**
+   * the fragments of the buffer, or zero if its bytes are in m_data.
+   * When non zero, the other fields are not used.
+   */
+  struct Fragments *m_fragments;
+
 #ifdef BUFFER_FREE_LIST
   /// Container for buffer data
   typedef std::vector<struct Buffer::Data*> FreeList;
@@ -805,12 +886,28 @@ private:
   {
     ~LocalStaticDestructor ();
   };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
+  // the free list is per thread, for the threads of ThreadedSimulatorImpl
+  static thread_local uint32_t g_maxSize; //!< Max observed data size
+  static thread_local FreeList *g_freeList; //!< Buffer data container
+  static thread_local struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
 #endif
 };
 
+/**
+ * \internal
+ * The fragments are never empty and never have fragments themselves.
+ * m_start and m_end are the start and end offsets of the buffer: m_start
+ * is the start offset of the first fragment, and the fragments follow
+ * each other from there.
+ */
+struct Buffer::Fragments
+{
+  uint32_t m_count; //!< the number of buffers which reference the list
+  uint32_t m_start; //!< the start offset of the buffer
+  uint32_t m_end; //!< the end offset of the buffer
+  std::vector<Buffer> m_buffers; //!< the fragments, in order
+};
+
 } // namespace ns3
 
 #include "ns3/assert.h"
@@ -1060,27 +1157,44 @@ Buffer::Buffer (Buffer const&o)
     m_zeroAreaStart (o.m_zeroAreaStart),
     m_zeroAreaEnd (o.m_zeroAreaEnd),
     m_start (o.m_start),
-    m_end (o.m_end)
+    m_end (o.m_end),
+    m_fragments (o.m_fragments)
 {
   m_data->m_count++;
+  if (m_fragments != 0)
+    {
+      m_fragments->m_count++;
+    }
   NS_ASSERT (CheckInternalState ());
 }
 
 uint32_t 
 Buffer::GetSize (void) const
 {
+  if (m_fragments != 0)
+    {
+      return m_fragments->m_end - m_fragments->m_start;
+    }
   return m_end - m_start;
 }
 
 Buffer::Iterator 
 Buffer::Begin (void) const
 {
+  if (m_fragments != 0)
+    {
+      Flatten (0);
+    }
   NS_ASSERT (CheckInternalState ());
   return Buffer::Iterator (this);
 }
 Buffer::Iterator 
 Buffer::End (void) const
 {
+  if (m_fragments != 0)
+    {
+      Flatten (0);
+    }
   NS_ASSERT (CheckInternalState ());
   return Buffer::Iterator (this, false);
 }
@@ -21,6 +21,7 @@
 #include "ns3/log.h"
 #include <vector>
 #include <cstring>
+#include <limits>
 
 #define USE_FREE_LIST 1
 #define FREE_LIST_SIZE 1000
@@ -52,12 +53,14 @@ struct ByteTagListData {
  *
  * Internal use only.
  */
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
+class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
 {
 public:
   ~ByteTagListDataFreeList ();
-} g_freeList; //!< Container for struct ByteTagListData
-static uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
+};
+static thread_local ByteTagListDataFreeList g_freeList; //!< Container for struct ByteTagListData, per thread
+static thread_local bool g_freeListDestroyed = false; //!< g_freeList of this thread was destroyed
+static thread_local uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
 
 ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 {
@@ -68,6 +71,7 @@ ByteTagListDataFreeList::~ByteTagListDataFreeList ()
       uint8_t *buffer = (uint8_t *)(*i);
       delete [] buffer;
     }
+  g_freeListDestroyed = true;
 }
 #endif /* USE_FREE_LIST */
 
@@ -106,8 +110,8 @@ ByteTagList::Iterator::PrepareForNext (void)
       TagBuffer buf = TagBuffer (m_current, m_end);
       m_nextTid = buf.ReadU32 ();
       m_nextSize = buf.ReadU32 ();
-      m_nextStart = buf.ReadU32 ();
-      m_nextEnd = buf.ReadU32 ();
+      m_nextStart = buf.ReadU32 () + m_adjustment;
+      m_nextEnd = buf.ReadU32 () + m_adjustment;
       if (m_nextStart >= m_offsetEnd || m_nextEnd <= m_offsetStart)
         {
           m_current += 4 + 4 + 4 + 4 + m_nextSize;
@@ -118,13 +122,15 @@ ByteTagList::Iterator::PrepareForNext (void)
         }
     }
 }
-ByteTagList::Iterator::Iterator (uint8_t *start, uint8_t *end, int32_t offsetStart, int32_t offsetEnd)
+ByteTagList::Iterator::Iterator (uint8_t *start, uint8_t *end, int32_t offsetStart, int32_t offsetEnd,
+                                int32_t adjustment)
   : m_current (start),
     m_end (end),
     m_offsetStart (offsetStart),
-    m_offsetEnd (offsetEnd)
+    m_offsetEnd (offsetEnd),
+    m_adjustment (adjustment)
 {
-  NS_LOG_FUNCTION (this << &start << &end << offsetStart << offsetEnd);
+  NS_LOG_FUNCTION (this << &start << &end << offsetStart << offsetEnd << adjustment);
   PrepareForNext ();
 }
 
@@ -138,13 +144,19 @@ ByteTagList::Iterator::GetOffsetStart (void) const
 
 ByteTagList::ByteTagList ()
   : m_used (0),
-    m_data (0)
+    m_data (0),
+    m_minStart (std::numeric_limits<int32_t>::max ()),
+    m_maxEnd (std::numeric_limits<int32_t>::min ()),
+    m_adjustment (0)
 {
   NS_LOG_FUNCTION (this);
 }
 ByteTagList::ByteTagList (const ByteTagList &o)
   : m_used (o.m_used),
-    m_data (o.m_data)
+    m_data (o.m_data),
+    m_minStart (o.m_minStart),
+    m_maxEnd (o.m_maxEnd),
+    m_adjustment (o.m_adjustment)
 {
   NS_LOG_FUNCTION (this << &o);
   if (m_data != 0)
@@ -163,6 +175,9 @@ ByteTagList::operator = (const ByteTagList &o)
   Deallocate (m_data);
   m_data = o.m_data;
   m_used = o.m_used;
+  m_minStart = o.m_minStart;
+  m_maxEnd = o.m_maxEnd;
+  m_adjustment = o.m_adjustment;
   if (m_data != 0)
     {
       m_data->count++;
@@ -198,10 +213,15 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
     }
   TagBuffer tag = TagBuffer (&m_data->data[m_used], 
                              &m_data->data[spaceNeeded]);
+  // the offsets are stored without the pending adjustment
+  start -= m_adjustment;
+  end -= m_adjustment;
   tag.WriteU32 (tid.GetUid ());
   tag.WriteU32 (bufferSize);
   tag.WriteU32 (start);
   tag.WriteU32 (end);
+  m_minStart = std::min (m_minStart, start);
+  m_maxEnd = std::max (m_maxEnd, end);
   m_used = spaceNeeded;
   m_data->dirty = m_used;
   return tag;
@@ -227,6 +247,9 @@ ByteTagList::RemoveAll (void)
   Deallocate (m_data);
   m_data = 0;
   m_used = 0;
+  m_minStart = std::numeric_limits<int32_t>::max ();
+  m_maxEnd = std::numeric_limits<int32_t>::min ();
+  m_adjustment = 0;
 }
 
 ByteTagList::Iterator 
@@ -244,11 +267,12 @@ ByteTagList::Begin (int32_t offsetStart, int32_t offsetEnd) const
   NS_LOG_FUNCTION (this << offsetStart << offsetEnd);
   if (m_data == 0)
     {
-      return Iterator (0, 0, offsetStart, offsetEnd);
+      return Iterator (0, 0, offsetStart, offsetEnd, 0);
     }
   else
     {
-      return Iterator (m_data->data, &m_data->data[m_used], offsetStart, offsetEnd);
+      return Iterator (m_data->data, &m_data->data[m_used], offsetStart, offsetEnd,
+                       m_adjustment);
     }
 }
 
@@ -256,39 +280,22 @@ bool
 ByteTagList::IsDirtyAtEnd (int32_t appendOffset)
 {
   NS_LOG_FUNCTION (this << appendOffset);
-  ByteTagList::Iterator i = BeginAll ();
-  while (i.HasNext ())
-    {
-      ByteTagList::Iterator::Item item = i.Next ();
-      if (item.end > appendOffset)
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_used != 0 && m_maxEnd + m_adjustment > appendOffset;
 }
 
 bool 
 ByteTagList::IsDirtyAtStart (int32_t prependOffset)
 {
   NS_LOG_FUNCTION (this << prependOffset);
-  ByteTagList::Iterator i = BeginAll ();
-  while (i.HasNext ())
-    {
-      ByteTagList::Iterator::Item item = i.Next ();
-      if (item.start < prependOffset)
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_used != 0 && m_minStart + m_adjustment < prependOffset;
 }
 
 void 
 ByteTagList::AddAtEnd (int32_t adjustment, int32_t appendOffset)
 {
   NS_LOG_FUNCTION (this << adjustment << appendOffset);
-  if (adjustment == 0 && !IsDirtyAtEnd (appendOffset))
+  m_adjustment += adjustment;
+  if (!IsDirtyAtEnd (appendOffset))
     {
       return;
     }
@@ -297,8 +304,6 @@ ByteTagList::AddAtEnd (int32_t adjustment, int32_t appendOffset)
   while (i.HasNext ())
     {
       ByteTagList::Iterator::Item item = i.Next ();
-      item.start += adjustment;
-      item.end += adjustment;
 
       if (item.start >= appendOffset)
         {
@@ -322,7 +327,8 @@ void
 ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
 {
   NS_LOG_FUNCTION (this << adjustment << prependOffset);
-  if (adjustment == 0 && !IsDirtyAtStart (prependOffset))
+  m_adjustment += adjustment;
+  if (!IsDirtyAtStart (prependOffset))
     {
       return;
     }
@@ -331,8 +337,6 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
   while (i.HasNext ())
     {
       ByteTagList::Iterator::Item item = i.Next ();
-      item.start += adjustment;
-      item.end += adjustment;
 
       if (item.end <= prependOffset)
         {
@@ -358,7 +362,7 @@ struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
+  while (!g_freeListDestroyed && !g_freeList.empty ())
     {
       struct ByteTagListData *data = g_freeList.back ();
       g_freeList.pop_back ();
@@ -392,7 +396,8 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
   data->count--;
   if (data->count == 0)
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
+      if (g_freeListDestroyed ||
+          g_freeList.size () > FREE_LIST_SIZE ||
           data->size < g_maxSize)
         {
           uint8_t *buffer = (uint8_t *)data;
@@ -59,6 +59,11 @@ struct ByteTagListData;
  *     the Packet class calls ByteTagList::AddAtEnd and ByteTagList::AddAtStart to update
  *     the byte offsets of each tag in the ByteTagList.
  *
+ *   - The offset updates are accumulated in m_adjustment, which is added to the
+ *     stored offsets whenever they are read. The tag byte buffer is rewritten only
+ *     when some tags must be trimmed, that is, when the smallest start offset or
+ *     the largest end offset of the list crosses the offset where bytes were added.
+ *
  *   - Whenever bytes are removed from the packet byte buffer, the ByteTagList offsets
  *     are never updated because we rely on the fact that they will be updated in
  *     either the next call to Packet::AddHeader or Packet::AddTrailer or when
@@ -125,8 +130,10 @@ private:
      * \param end End tag
      * \param offsetStart offset to the start of the tag from the virtual byte buffer
      * \param offsetEnd offset to the end of the tag from the virtual byte buffer
+     * \param adjustment value to add to the stored offsets
      */
-    Iterator (uint8_t *start, uint8_t *end, int32_t offsetStart, int32_t offsetEnd);
+    Iterator (uint8_t *start, uint8_t *end, int32_t offsetStart, int32_t offsetEnd,
+              int32_t adjustment);
 
     /**
      * \brief Prepare the iterator for the next tag
@@ -136,6 +143,7 @@ private:
     uint8_t *m_end;         //!< End tag
     int32_t m_offsetStart;  //!< Offset to the start of the tag from the virtual byte buffer
     int32_t m_offsetEnd;    //!< Offset to the end of the tag from the virtual byte buffer
+    int32_t m_adjustment;   //!< Value to add to the stored offsets
     uint32_t m_nextTid;     //!< TypeId of the next tag
     uint32_t m_nextSize;    //!< Size of the next tag
     int32_t m_nextStart;    //!< Start of the next tag
@@ -228,6 +236,9 @@ private:
 private:
   /**
    * \brief Check that all offsets are smaller than appendOffset
+   *
+   * This compares appendOffset with the largest end offset of the tags.
+   *
    * \param appendOffset the append offset to check
    * \returns true if the check is false
    */
@@ -261,6 +272,9 @@ private:
 
   uint16_t m_used; //!< the number of used bytes in the buffer
   struct ByteTagListData *m_data; //!< the ByteTagListData structure
+  int32_t m_minStart; //!< smallest stored start offset of the tags
+  int32_t m_maxEnd; //!< largest stored end offset of the tags
+  int32_t m_adjustment; //!< value to add to the stored offsets
 };
 
 } // namespace ns3
@@ -17,8 +17,8 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
-#include <utility>
-#include <list>
+#include <algorithm>
+#include <vector>
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
@@ -34,18 +34,18 @@ NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
-uint32_t PacketMetadata::m_maxSize = 0;
-uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+thread_local uint16_t PacketMetadata::m_chunkUid = 0;
+thread_local PacketMetadata::RecordFreeList PacketMetadata::m_freeList;
+thread_local bool PacketMetadata::m_freeListDestroyed = false;
 
-PacketMetadata::DataFreeList::~DataFreeList ()
+PacketMetadata::RecordFreeList::~RecordFreeList ()
 {
   NS_LOG_FUNCTION (this);
   for (iterator i = begin (); i != end (); i++)
     {
-      PacketMetadata::Deallocate (*i);
+      delete *i;
     }
-  PacketMetadata::m_enable = false;
+  PacketMetadata::m_freeListDestroyed = true;
 }
 
 void 
@@ -70,577 +70,192 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
-void
-PacketMetadata::ReserveCopy (uint32_t size)
+bool
+PacketMetadata::IsStateOk (void) const
 {
-  NS_LOG_FUNCTION (this << size);
-  struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
-  memcpy (newData->m_data, m_data->m_data, m_used);
-  newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  NS_LOG_FUNCTION (this);
+  for (const struct Record *record = m_front; record != 0; record = record->m_next)
     {
-      PacketMetadata::Recycle (m_data);
+      if (record->m_count == 0
+          || record->m_fragmentStart > record->m_fragmentEnd
+          || record->m_fragmentEnd > record->m_size)
+        {
+          return false;
+        }
     }
-  m_data = newData;
-  if (m_head != 0xffff)
+  for (const struct Record *record = m_back; record != 0; record = record->m_next)
     {
-      uint8_t *start;
-      NS_ASSERT (m_tail != 0xffff);
-      // clear the next field of the tail
-      start = &m_data->m_data[m_tail];
-      Append16 (0xffff, start);
-      // clear the prev field of the head
-      start = &m_data->m_data[m_head] + 2;
-      Append16 (0xffff, start);
+      if (record->m_count == 0
+          || record->m_fragmentStart > record->m_fragmentEnd
+          || record->m_fragmentEnd > record->m_size)
+        {
+          return false;
+        }
     }
+  return true;
 }
-void
-PacketMetadata::Reserve (uint32_t size)
+
+struct PacketMetadata::Record *
+PacketMetadata::Create (const struct Record &item, struct Record *next)
 {
-  NS_LOG_FUNCTION (this << size);
-  NS_ASSERT (m_data != 0);
-  if (m_data->m_size >= m_used + size &&
-      (m_head == 0xffff ||
-       m_data->m_count == 1 ||
-       m_data->m_dirtyEnd == m_used))
+  NS_LOG_FUNCTION (&item << next);
+  struct Record *record;
+  if (!m_freeList.empty ())
     {
-      /* enough room, not dirty. */
+      record = m_freeList.back ();
+      m_freeList.pop_back ();
     }
-  else 
+  else
     {
-      /* (enough room and dirty) or (not enough room) */
-      ReserveCopy (size);
+      record = new struct Record;
     }
+  record->m_next = next;
+  record->m_packetUid = item.m_packetUid;
+  record->m_count = 1;
+  record->m_typeUid = item.m_typeUid;
+  record->m_size = item.m_size;
+  record->m_fragmentStart = item.m_fragmentStart;
+  record->m_fragmentEnd = item.m_fragmentEnd;
+  record->m_chunkUid = item.m_chunkUid;
+  return record;
 }
 
-bool
-PacketMetadata::IsSharedPointerOk (uint16_t pointer) const
-{
-  NS_LOG_FUNCTION (this << pointer);
-  bool ok = pointer == 0xffff || pointer <= m_data->m_size;
-  return ok;
-}
-bool
-PacketMetadata::IsPointerOk (uint16_t pointer) const
-{
-  NS_LOG_FUNCTION (this << pointer);
-  bool ok = pointer == 0xffff || pointer <= m_used;
-  return ok;
-}
-
-bool
-PacketMetadata::IsStateOk (void) const
+void
+PacketMetadata::Unref (struct Record *record)
 {
-  NS_LOG_FUNCTION (this);
-  bool ok = m_used <= m_data->m_size;
-  ok &= IsPointerOk (m_head);
-  ok &= IsPointerOk (m_tail);
-  uint16_t current = m_head;
-  while (ok && current != 0xffff)
+  NS_LOG_FUNCTION (record);
+  while (record != 0)
     {
-      struct PacketMetadata::SmallItem item;
-      PacketMetadata::ExtraItem extraItem;
-      ReadItems (current, &item, &extraItem);
-      ok &= IsSharedPointerOk (item.next);
-      ok &= IsSharedPointerOk (item.prev);
-      if (current != m_head)
+      NS_ASSERT (record->m_count > 0);
+      record->m_count--;
+      if (record->m_count != 0)
         {
-          ok &= IsPointerOk (item.prev);
+          return;
         }
-      if (current != m_tail)
+      // the record held the only reference to its next record
+      struct Record *next = record->m_next;
+      if (m_freeListDestroyed)
         {
-          ok &= IsPointerOk (item.next);
+          delete record;
         }
-      if (current == m_tail)
+      else
         {
-          break;
+          m_freeList.push_back (record);
         }
-      current = item.next;
+      record = next;
     }
-  return ok;
 }
 
-uint32_t 
-PacketMetadata::GetUleb128Size (uint32_t value) const
+struct PacketMetadata::Record *
+PacketMetadata::Reverse (const struct Record *stack)
 {
-  NS_LOG_FUNCTION (this << value);
-  if (value < 0x80)
-    {
-      return 1;
-    }
-  if (value < 0x4000)
-    {
-      return 2;
-    }
-  if (value < 0x200000)
-    {
-      return 3;
-    }
-  if (value < 0x10000000)
-    {
-      return 4;
-    }
-  return 5;
-}
-uint32_t
-PacketMetadata::ReadUleb128 (const uint8_t **pBuffer) const
-{
-  NS_LOG_FUNCTION (this << &pBuffer);
-  const uint8_t *buffer = *pBuffer;
-  uint32_t result = 0;
-  uint8_t byte;
-  result = 0;
-  byte = buffer[0];
-  result = (byte & (~0x80));
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 1;
-      return result;
-    }
-  byte = buffer[1];
-  result |= (byte & (~0x80)) << 7;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 2;
-      return result;
-    }
-  byte = buffer[2];
-  result |= (byte & (~0x80)) << 14;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 3;
-      return result;
-    }
-  byte = buffer[3];
-  result |= (byte & (~0x80)) << 21;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 4;
-      return result;
-    }
-  byte = buffer[4];
-  result |= (byte & (~0x80)) << 28;
-  if (!(byte & 0x80))
+  NS_LOG_FUNCTION (stack);
+  struct Record *reversed = 0;
+  for (const struct Record *record = stack; record != 0; record = record->m_next)
     {
-      *pBuffer = buffer + 5;
-      return result;
+      reversed = Create (*record, reversed);
     }
-  /* This means that the LEB128 number was not valid.
-   * ie: the last (5th) byte did not have the high-order bit zeroed.
-   */
-  NS_ASSERT (false);
-  return 0;
-}
-
-void
-PacketMetadata::Append16 (uint16_t value, uint8_t *buffer)
-{
-  NS_LOG_FUNCTION (this << value << &buffer);
-  buffer[0] = value & 0xff;
-  value >>= 8;
-  buffer[1] = value;
-}
-void
-PacketMetadata::Append32 (uint32_t value,  uint8_t *buffer)
-{
-  NS_LOG_FUNCTION (this << value << &buffer);
-  buffer[0] = value & 0xff;
-  buffer[1] = (value >> 8) & 0xff;
-  buffer[2] = (value >> 16) & 0xff;
-  buffer[3] = (value >> 24) & 0xff;
+  return reversed;
 }
 
-void
-PacketMetadata::AppendValueExtra (uint32_t value, uint8_t *buffer)
+const struct PacketMetadata::Record *
+PacketMetadata::Front (void)
 {
-  NS_LOG_FUNCTION (this << value << &buffer);
-  if (value < 0x200000)
-    {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[1] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[2] = value;
-      return;
-    }
-  if (value < 0x10000000)
+  NS_LOG_FUNCTION (this);
+  if (m_front == 0 && m_back != 0)
     {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[1] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[2] = 0x80 | byte;
-      value >>= 7;
-      buffer[3] = value;
-      return;
+      if (m_back->m_next == 0)
+        {
+          // a single record is its own reverse.
+          m_front = m_back;
+        }
+      else
+        {
+          m_front = Reverse (m_back);
+          Unref (m_back);
+        }
+      m_back = 0;
     }
-  {
-    uint8_t byte = value & (~0x80);
-    buffer[0] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[1] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[2] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[3] = 0x80 | byte;
-    value >>= 7;
-    buffer[4] = value;
-  }
+  return m_front;
 }
 
-void
-PacketMetadata::AppendValue (uint32_t value, uint8_t *buffer)
+const struct PacketMetadata::Record *
+PacketMetadata::Back (void)
 {
-  NS_LOG_FUNCTION (this << value << &buffer);
-  if (value < 0x80)
-    {
-      buffer[0] = value;
-      return;
-    }
-  if (value < 0x4000)
+  NS_LOG_FUNCTION (this);
+  if (m_back == 0 && m_front != 0)
     {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      buffer[1] = value;
-      return;
+      if (m_front->m_next == 0)
+        {
+          m_back = m_front;
+        }
+      else
+        {
+          m_back = Reverse (m_front);
+          Unref (m_front);
+        }
+      m_front = 0;
     }
-  AppendValueExtra (value, buffer);
+  return m_back;
 }
 
 void
-PacketMetadata::UpdateTail (uint16_t written)
+PacketMetadata::PushFront (const struct Record &item)
 {
-  NS_LOG_FUNCTION (this << written);
-  if (m_head == 0xffff)
-    {
-      NS_ASSERT (m_tail == 0xffff);
-      m_head = m_used;
-      m_tail = m_used;
-    } 
-  else
-    {
-      NS_ASSERT (m_tail != 0xffff);
-      // overwrite the next field of the previous tail of the list.
-      uint8_t *previousTail = &m_data->m_data[m_tail];
-      Append16 (m_used, previousTail);
-      // update the tail of the list to the new node.
-      m_tail = m_used;
-    }
-  NS_ASSERT (m_tail != 0xffff);
-  NS_ASSERT (m_head != 0xffff);
-  NS_ASSERT (written >= 8);
-  m_used += written;
-  m_data->m_dirtyEnd = m_used;
+  NS_LOG_FUNCTION (this << &item);
+  m_front = Create (item, m_front);
 }
 
-
 void
-PacketMetadata::UpdateHead (uint16_t written)
-{
-  NS_LOG_FUNCTION (this << written);
-  if (m_head == 0xffff)
-    {
-      NS_ASSERT (m_tail == 0xffff);
-      m_head = m_used;
-      m_tail = m_used;
-    } 
-  else
-    {
-      NS_ASSERT (m_head != 0xffff);
-      // overwrite the prev field of the previous head of the list.
-      uint8_t *previousHead = &m_data->m_data[m_head + 2];
-      Append16 (m_used, previousHead);
-      // update the head of list to the new node.
-      m_head = m_used;
-    }
-  NS_ASSERT (m_tail != 0xffff);
-  NS_ASSERT (m_head != 0xffff);
-  NS_ASSERT (written >= 8);
-  m_used += written;
-  m_data->m_dirtyEnd = m_used;
-}
-
-uint16_t
-PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
-{
-  NS_LOG_FUNCTION (this << item->next << item->prev << item->typeUid << item->size << item->chunkUid);
-  NS_ASSERT (m_data != 0);
-  NS_ASSERT (m_used != item->prev && m_used != item->next);
-  uint32_t typeUidSize = GetUleb128Size (item->typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
-  if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
-    {
-      ReserveCopy (n);
-    }
-  uint8_t *buffer = &m_data->m_data[m_used];
-  Append16 (item->next, buffer);
-  buffer += 2;
-  Append16 (item->prev, buffer);
-  buffer += 2;
-  AppendValue (item->typeUid, buffer);
-  buffer += typeUidSize;
-  AppendValue (item->size, buffer);
-  buffer += sizeSize;
-  Append16 (item->chunkUid, buffer);
-  return n;
-}
-
-uint16_t
-PacketMetadata::AddBig (uint32_t next, uint32_t prev, 
-                        const PacketMetadata::SmallItem *item,
-                        const PacketMetadata::ExtraItem *extraItem)
+PacketMetadata::PushBack (const struct Record &item)
 {
-  NS_LOG_FUNCTION (this << next << prev <<
-                   item->next << item->prev << item->typeUid << item->size << item->chunkUid <<
-                   extraItem->fragmentStart << extraItem->fragmentEnd << extraItem->packetUid);
-  NS_ASSERT (m_data != 0);
-  uint32_t typeUid = ((item->typeUid & 0x1) == 0x1) ? item->typeUid : item->typeUid+1;
-  NS_ASSERT (m_used != prev && m_used != next);
-
-  uint32_t typeUidSize = GetUleb128Size (typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  uint32_t fragStartSize = GetUleb128Size (extraItem->fragmentStart);
-  uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
-  uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
-
-  if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
-       m_used != m_data->m_dirtyEnd))
-    {
-      ReserveCopy (n);
-    }
-
-  uint8_t *buffer = &m_data->m_data[m_used];
-
-  Append16 (next, buffer);
-  buffer += 2;
-  Append16 (prev, buffer);
-  buffer += 2;
-  AppendValue (typeUid, buffer);
-  buffer += typeUidSize;
-  AppendValue (item->size, buffer);
-  buffer += sizeSize;
-  Append16 (item->chunkUid, buffer);
-  buffer += 2;
-  AppendValue (extraItem->fragmentStart, buffer);
-  buffer += fragStartSize;
-  AppendValue (extraItem->fragmentEnd, buffer);
-  buffer += fragEndSize;
-  Append32 (extraItem->packetUid, buffer);
-
-  return n;
+  NS_LOG_FUNCTION (this << &item);
+  m_back = Create (item, m_back);
 }
 
 void
-PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item, 
-                             PacketMetadata::ExtraItem *extraItem,
-                             uint32_t available)
-{
-  NS_LOG_FUNCTION (this <<
-                   item->next << item->prev << item->typeUid << item->size << item->chunkUid <<
-                   extraItem->fragmentStart << extraItem->fragmentEnd << extraItem->packetUid <<
-                   available);
-
-  NS_ASSERT (m_data != 0);
-  /* If the tail we want to replace is located at the end of the data array,
-   * and if there is extra room at the end of this array, then, 
-   * we can try to use that extra space to avoid falling in the slow
-   * path below.
-   */
-  if (m_tail + available == m_used &&
-      m_used == m_data->m_dirtyEnd)
-    {
-      available = m_data->m_size - m_tail;
-    }
-
-  uint32_t typeUid = ((item->typeUid & 0x1) == 0x1) ? item->typeUid : item->typeUid+1;
-  uint32_t typeUidSize = GetUleb128Size (typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  uint32_t fragStartSize = GetUleb128Size (extraItem->fragmentStart);
-  uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
-  uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
-
-  if (available >= n &&
-      m_data->m_count == 1)
-    {
-      uint8_t *buffer = &m_data->m_data[m_tail];
-      Append16 (item->next, buffer);
-      buffer += 2;
-      Append16 (item->prev, buffer);
-      buffer += 2;
-      AppendValue (typeUid, buffer);
-      buffer += typeUidSize;
-      AppendValue (item->size, buffer);
-      buffer += sizeSize;
-      Append16 (item->chunkUid, buffer);
-      buffer += 2;
-      AppendValue (extraItem->fragmentStart, buffer);
-      buffer += fragStartSize;
-      AppendValue (extraItem->fragmentEnd, buffer);
-      buffer += fragEndSize;
-      Append32 (extraItem->packetUid, buffer);
-      m_used = std::max (m_used, (uint16_t)(buffer - &m_data->m_data[0]));
-      m_data->m_dirtyEnd = m_used;
-      return;
-    }
-
-  /* Below is the slow path which is hit if the new tail we want 
-   * to append is bigger than the previous tail.
-   */
-
-  // create a copy of the packet without its tail.
-  PacketMetadata h (m_packetUid, 0);
-  uint16_t current = m_head;
-  while (current != 0xffff && current != m_tail)
-    {
-      struct PacketMetadata::SmallItem tmpItem;
-      PacketMetadata::ExtraItem tmpExtraItem;
-      ReadItems (current, &tmpItem, &tmpExtraItem);
-      uint16_t written = h.AddBig (0xffff, h.m_tail, 
-                                   &tmpItem, &tmpExtraItem);
-      h.UpdateTail (written);
-      current = tmpItem.next;
-    }
-  // append new tail.
-  uint16_t written = h.AddBig (0xffff, h.m_tail, item, extraItem);
-  h.UpdateTail (written);
-
-  *this = h;
-}
-
-
-uint32_t
-PacketMetadata::ReadItems (uint16_t current, 
-                           struct PacketMetadata::SmallItem *item,
-                           struct PacketMetadata::ExtraItem *extraItem) const
+PacketMetadata::PopFront (void)
 {
-  NS_LOG_FUNCTION (this << current << item->chunkUid << item->prev << item->next << item->size <<
-                        item->typeUid << extraItem->fragmentEnd << extraItem->fragmentStart <<
-                        extraItem->packetUid);
-  NS_ASSERT (current <= m_data->m_size);
-  const uint8_t *buffer = &m_data->m_data[current];
-  item->next = buffer[0];
-  item->next |= (buffer[1]) << 8;
-  item->prev = buffer[2];
-  item->prev |= (buffer[3]) << 8;
-  buffer += 4;
-  item->typeUid = ReadUleb128 (&buffer);
-  item->size = ReadUleb128 (&buffer);
-  item->chunkUid = buffer[0];
-  item->chunkUid |= (buffer[1]) << 8;
-  buffer += 2;
-
-  bool isExtra = (item->typeUid & 0x1) == 0x1;
-  if (isExtra)
-    {
-      extraItem->fragmentStart = ReadUleb128 (&buffer);
-      extraItem->fragmentEnd = ReadUleb128 (&buffer);
-      extraItem->packetUid = buffer[0];
-      extraItem->packetUid |= buffer[1] << 8;
-      extraItem->packetUid |= buffer[2] << 16;
-      extraItem->packetUid |= buffer[3] << 24;
-      buffer += 4;
-    }
-  else
+  NS_LOG_FUNCTION (this);
+  struct Record *top = m_front;
+  m_front = top->m_next;
+  if (m_front != 0)
     {
-      extraItem->fragmentStart = 0;
-      extraItem->fragmentEnd = item->size;
-      extraItem->packetUid = m_packetUid;
+      m_front->m_count++;
     }
-  NS_ASSERT (buffer <= &m_data->m_data[m_data->m_size]);
-  return buffer - &m_data->m_data[current];
+  Unref (top);
 }
 
-struct PacketMetadata::Data *
-PacketMetadata::Create (uint32_t size)
+void
+PacketMetadata::PopBack (void)
 {
-  NS_LOG_FUNCTION (size);
-  NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
-  if (size > m_maxSize)
-    {
-      m_maxSize = size;
-    }
-  while (!m_freeList.empty ()) 
+  NS_LOG_FUNCTION (this);
+  struct Record *top = m_back;
+  m_back = top->m_next;
+  if (m_back != 0)
     {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
-      if (data->m_size >= size) 
-        {
-          NS_LOG_LOGIC ("create found size="<<data->m_size);
-          data->m_count = 1;
-          return data;
-        }
-      PacketMetadata::Deallocate (data);
-      NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
+      m_back->m_count++;
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
+  Unref (top);
 }
 
 void
-PacketMetadata::Recycle (struct PacketMetadata::Data *data)
+PacketMetadata::GetItems (std::vector<const struct Record *> *items) const
 {
-  NS_LOG_FUNCTION (data);
-  if (!m_enable)
-    {
-      PacketMetadata::Deallocate (data);
-      return;
-    } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
-  NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
+  NS_LOG_FUNCTION (this << items);
+  for (const struct Record *record = m_front; record != 0; record = record->m_next)
     {
-      PacketMetadata::Deallocate (data);
-    } 
-  else 
-    {
-      m_freeList.push_back (data);
+      items->push_back (record);
     }
-}
-
-struct PacketMetadata::Data *
-PacketMetadata::Allocate (uint32_t n)
-{
-  NS_LOG_FUNCTION (n);
-  uint32_t size = sizeof (struct Data);
-  if (n <= PACKET_METADATA_DATA_M_DATA_SIZE)
+  // the back stack starts with the tail of the list.
+  std::vector<const struct Record *>::size_type middle = items->size ();
+  for (const struct Record *record = m_back; record != 0; record = record->m_next)
     {
-      n = PACKET_METADATA_DATA_M_DATA_SIZE;
+      items->push_back (record);
     }
-  size += n - PACKET_METADATA_DATA_M_DATA_SIZE;
-  uint8_t *buf = new uint8_t [size];
-  struct PacketMetadata::Data *data = (struct PacketMetadata::Data *)buf;
-  data->m_size = n;
-  data->m_count = 1;
-  data->m_dirtyEnd = 0;
-  return data;
-}
-void 
-PacketMetadata::Deallocate (struct PacketMetadata::Data *data)
-{
-  NS_LOG_FUNCTION (data);
-  uint8_t *buf = (uint8_t *)data;
-  delete [] buf;
+  std::reverse (items->begin () + middle, items->end ());
 }
 
-
 PacketMetadata 
 PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
 {
@@ -651,12 +266,27 @@ PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
   return fragment;
 }
 
+PacketMetadata
+PacketMetadata::CreateDeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  PacketMetadata copy (m_packetUid, 0);
+  std::vector<const struct Record *> items;
+  GetItems (&items);
+  for (std::vector<const struct Record *>::const_iterator i = items.begin ();
+       i != items.end (); i++)
+    {
+      copy.PushBack (**i);
+    }
+  return copy;
+}
+
 void 
 PacketMetadata::AddHeader (const Header &header, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &header << size);
   NS_ASSERT (IsStateOk ());
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
+  uint32_t uid = header.GetInstanceTypeId ().GetUid ();
   DoAddHeader (uid, size);
   NS_ASSERT (IsStateOk ());
 }
@@ -670,20 +300,20 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       return;
     }
 
-  struct PacketMetadata::SmallItem item;
-  item.next = m_head;
-  item.prev = 0xffff;
-  item.typeUid = uid;
-  item.size = size;
-  item.chunkUid = m_chunkUid;
+  struct PacketMetadata::Record item;
+  item.m_packetUid = m_packetUid;
+  item.m_typeUid = uid;
+  item.m_size = size;
+  item.m_fragmentStart = 0;
+  item.m_fragmentEnd = size;
+  item.m_chunkUid = m_chunkUid;
   m_chunkUid++;
-  uint16_t written = AddSmall (&item);
-  UpdateHead (written);
+  PushFront (item);
 }
 void 
 PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
 {
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
+  uint32_t uid = header.GetInstanceTypeId ().GetUid ();
   NS_LOG_FUNCTION (this << &header << size);
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
@@ -691,11 +321,10 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-  struct PacketMetadata::SmallItem item;
-  struct PacketMetadata::ExtraItem extraItem;
-  uint32_t read = ReadItems (m_head, &item, &extraItem);
-  if ((item.typeUid & 0xfffffffe) != uid ||
-      item.size != size)
+  const struct PacketMetadata::Record *item = Front ();
+  if (item == 0 ||
+      item->m_typeUid != uid ||
+      item->m_size != size)
     {
       if (m_enableChecking)
         {
@@ -703,9 +332,8 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
         }
       return;
     }
-  else if (item.typeUid != uid &&
-           (extraItem.fragmentStart != 0 ||
-            extraItem.fragmentEnd != size))
+  else if (item->m_fragmentStart != 0 ||
+           item->m_fragmentEnd != size)
     {
       if (m_enableChecking)
         {
@@ -713,25 +341,13 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
         }
       return;
     }
-  if (m_head + read == m_used)
-    {
-      m_used = m_head;
-    }
-  if (m_head == m_tail)
-    {
-      m_head = 0xffff;
-      m_tail = 0xffff;
-    }
-  else
-    {
-      m_head = item.next;
-    }
+  PopFront ();
   NS_ASSERT (IsStateOk ());
 }
 void 
 PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
 {
-  uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
+  uint32_t uid = trailer.GetInstanceTypeId ().GetUid ();
   NS_LOG_FUNCTION (this << &trailer << size);
   NS_ASSERT (IsStateOk ());
   if (!m_enable)
@@ -739,21 +355,21 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-  struct PacketMetadata::SmallItem item;
-  item.next = 0xffff;
-  item.prev = m_tail;
-  item.typeUid = uid;
-  item.size = size;
-  item.chunkUid = m_chunkUid;
+  struct PacketMetadata::Record item;
+  item.m_packetUid = m_packetUid;
+  item.m_typeUid = uid;
+  item.m_size = size;
+  item.m_fragmentStart = 0;
+  item.m_fragmentEnd = size;
+  item.m_chunkUid = m_chunkUid;
   m_chunkUid++;
-  uint16_t written = AddSmall (&item);
-  UpdateTail (written);
+  PushBack (item);
   NS_ASSERT (IsStateOk ());
 }
 void 
 PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
 {
-  uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
+  uint32_t uid = trailer.GetInstanceTypeId ().GetUid ();
   NS_LOG_FUNCTION (this << &trailer << size);
   NS_ASSERT (IsStateOk ());
   if (!m_enable) 
@@ -761,11 +377,10 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-  struct PacketMetadata::SmallItem item;
-  struct PacketMetadata::ExtraItem extraItem;
-  uint32_t read = ReadItems (m_tail, &item, &extraItem);
-  if ((item.typeUid & 0xfffffffe) != uid ||
-      item.size != size)
+  const struct PacketMetadata::Record *item = Back ();
+  if (item == 0 ||
+      item->m_typeUid != uid ||
+      item->m_size != size)
     {
       if (m_enableChecking)
         {
@@ -773,9 +388,8 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
         }
       return;
     }
-  else if (item.typeUid != uid &&
-           (extraItem.fragmentStart != 0 ||
-            extraItem.fragmentEnd != size))
+  else if (item->m_fragmentStart != 0 ||
+           item->m_fragmentEnd != size)
     {
       if (m_enableChecking)
         {
@@ -783,19 +397,7 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
         }
       return;
     }
-  if (m_tail + read == m_used)
-    {
-      m_used = m_tail;
-    }
-  if (m_head == m_tail)
-    {
-      m_head = 0xffff;
-      m_tail = 0xffff;
-    }
-  else
-    {
-      m_tail = item.prev;
-    }
+  PopBack ();
   NS_ASSERT (IsStateOk ());
 }
 void
@@ -808,7 +410,7 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
-  if (m_tail == 0xffff)
+  if (m_front == 0 && m_back == 0)
     {
       // We have no items so 'AddAtEnd' is 
       // equivalent to self-assignment.
@@ -816,63 +418,46 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       NS_ASSERT (IsStateOk ());
       return;
     }
-  if (o.m_head == 0xffff)
+  if (o.m_front == 0 && o.m_back == 0)
     {
-      NS_ASSERT (o.m_tail == 0xffff);
       // we have nothing to append.
       return;
     }
-  NS_ASSERT (m_head != 0xffff && m_tail != 0xffff);
+
+  // keep the records of o alive: o may be this metadata.
+  PacketMetadata other = o;
+  std::vector<const struct PacketMetadata::Record *> items;
+  other.GetItems (&items);
+  std::vector<const struct PacketMetadata::Record *>::const_iterator i = items.begin ();
 
   // We read the current tail because we are going to append
   // after this item.
-  struct PacketMetadata::SmallItem tailItem;
-  PacketMetadata::ExtraItem tailExtraItem;
-  uint32_t tailSize = ReadItems (m_tail, &tailItem, &tailExtraItem);
-
-  uint16_t current;
-  struct PacketMetadata::SmallItem item;
-  PacketMetadata::ExtraItem extraItem;
-  o.ReadItems (o.m_head, &item, &extraItem);
-  if (extraItem.packetUid == tailExtraItem.packetUid &&
-      item.typeUid == tailItem.typeUid &&
-      item.chunkUid == tailItem.chunkUid &&
-      item.size == tailItem.size &&
-      extraItem.fragmentStart == tailExtraItem.fragmentEnd)
+  const struct PacketMetadata::Record *tail = Back ();
+  const struct PacketMetadata::Record *item = *i;
+  if (item->m_packetUid == tail->m_packetUid &&
+      item->m_typeUid == tail->m_typeUid &&
+      item->m_chunkUid == tail->m_chunkUid &&
+      item->m_size == tail->m_size &&
+      item->m_fragmentStart == tail->m_fragmentEnd)
     {
       /* If the previous tail came from the same header as
-       * the next item we want to append to our array, then, 
-       * we merge them and attempt to reuse the previous tail's
-       * location.
+       * the next item we want to append to our list, then, 
+       * we merge them.
        */
-      tailExtraItem.fragmentEnd = extraItem.fragmentEnd;
-      ReplaceTail (&tailItem, &tailExtraItem, tailSize);
-      if (o.m_head == o.m_tail)
-        {
-          // there is only one item to append to self from other.
-          return;
-        }
-      current = item.next;
-    }
-  else
-    {
-      current = o.m_head;
+      struct PacketMetadata::Record merged = *tail;
+      merged.m_fragmentEnd = item->m_fragmentEnd;
+      PopBack ();
+      PushBack (merged);
+      i++;
     }
 
   /* Now that we have merged our current tail with the head of the
    * next packet, we just append all items from the next packet
    * to the current packet.
    */
-  while (current != 0xffff)
+  for (; i != items.end (); i++)
     {
-      o.ReadItems (current, &item, &extraItem);
-      uint16_t written = AddBig (0xffff, m_tail, &item, &extraItem);
-      UpdateTail (written);
-      if (current == o.m_tail)
-        {
-          break;
-        }
-      current = item.next;
+      PushBack (**i);
     }
   NS_ASSERT (IsStateOk ());
 }
@@ -896,57 +481,29 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
-  NS_ASSERT (m_data != 0);
+  NS_ASSERT (start <= GetTotalSize ());
   uint32_t leftToRemove = start;
-  uint16_t current = m_head;
-  while (current != 0xffff && leftToRemove > 0)
+  while (leftToRemove > 0)
     {
-      struct PacketMetadata::SmallItem item;
-      PacketMetadata::ExtraItem extraItem;
-      ReadItems (current, &item, &extraItem);
-      uint32_t itemRealSize = extraItem.fragmentEnd - extraItem.fragmentStart;
+      const struct PacketMetadata::Record *item = Front ();
+      NS_ASSERT (item != 0);
+      uint32_t itemRealSize = item->m_fragmentEnd - item->m_fragmentStart;
       if (itemRealSize <= leftToRemove)
         {
           // remove from list.
-          if (m_head == m_tail)
-            {
-              m_head = 0xffff;
-              m_tail = 0xffff;
-            }
-          else
-            {
-              m_head = item.next;
-            }
+          PopFront ();
           leftToRemove -= itemRealSize;
         }
       else
         {
           // fragment the list item.
-          PacketMetadata fragment (m_packetUid, 0);
-          extraItem.fragmentStart += leftToRemove;
+          struct PacketMetadata::Record fragment = *item;
+          fragment.m_fragmentStart += leftToRemove;
           leftToRemove = 0;
-          uint16_t written = fragment.AddBig (0xffff, fragment.m_tail,
-                                              &item, &extraItem);
-          fragment.UpdateTail (written);
-          while (current != 0xffff && current != m_tail)
-            {
-              current = item.next;
-              ReadItems (current, &item, &extraItem);
-              written = fragment.AddBig (0xffff, fragment.m_tail,
-                                         &item, &extraItem);
-              fragment.UpdateTail (written);
-            }
-          *this = fragment;
-        }
-      NS_ASSERT (item.size >= extraItem.fragmentEnd - extraItem.fragmentStart &&
-                 extraItem.fragmentStart <= extraItem.fragmentEnd);
-      if (current == m_tail)
-        {
-          break;
+          PopFront ();
+          PushFront (fragment);
         }
-      current = item.next;
     }
-  NS_ASSERT (leftToRemove == 0);
   NS_ASSERT (IsStateOk ());
 }
 void 
@@ -959,59 +516,29 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
-  NS_ASSERT (m_data != 0);
-
+  NS_ASSERT (end <= GetTotalSize ());
   uint32_t leftToRemove = end;
-  uint16_t current = m_tail;
-  while (current != 0xffff && leftToRemove > 0)
+  while (leftToRemove > 0)
     {
-      struct PacketMetadata::SmallItem item;
-      PacketMetadata::ExtraItem extraItem;
-      ReadItems (current, &item, &extraItem);
-      uint32_t itemRealSize = extraItem.fragmentEnd - extraItem.fragmentStart;
+      const struct PacketMetadata::Record *item = Back ();
+      NS_ASSERT (item != 0);
+      uint32_t itemRealSize = item->m_fragmentEnd - item->m_fragmentStart;
       if (itemRealSize <= leftToRemove)
         {
           // remove from list.
-          if (m_head == m_tail)
-            {
-              m_head = 0xffff;
-              m_tail = 0xffff;
-            }
-          else
-            {
-              m_tail = item.prev;
-            }
+          PopBack ();
           leftToRemove -= itemRealSize;
         }
       else
         {
           // fragment the list item.
-          PacketMetadata fragment (m_packetUid, 0);
-          NS_ASSERT (extraItem.fragmentEnd > leftToRemove);
-          extraItem.fragmentEnd -= leftToRemove;
+          struct PacketMetadata::Record fragment = *item;
+          fragment.m_fragmentEnd -= leftToRemove;
           leftToRemove = 0;
-          uint16_t written = fragment.AddBig (fragment.m_head, 0xffff,
-                                              &item, &extraItem);
-          fragment.UpdateHead (written);
-          while (current != 0xffff && current != m_head)
-            {
-              current = item.prev;
-              ReadItems (current, &item, &extraItem);
-              written = fragment.AddBig (fragment.m_head, 0xffff,
-                                         &item, &extraItem);
-              fragment.UpdateHead (written);
-            }
-          *this = fragment;
+          PopBack ();
+          PushBack (fragment);
         }
-      NS_ASSERT (item.size >= extraItem.fragmentEnd - extraItem.fragmentStart &&
-                 extraItem.fragmentStart <= extraItem.fragmentEnd);
-      if (current == m_head)
-        {
-          break;
-        }
-      current = item.prev;
     }
-  NS_ASSERT (leftToRemove == 0);
   NS_ASSERT (IsStateOk ());
 }
 uint32_t
@@ -1019,20 +546,13 @@ PacketMetadata::GetTotalSize (void) const
 {
   NS_LOG_FUNCTION (this);
   uint32_t totalSize = 0;
-  uint16_t current = m_head;
-  uint16_t tail = m_tail;
-  while (current != 0xffff)
+  for (const struct Record *record = m_front; record != 0; record = record->m_next)
     {
-      struct PacketMetadata::SmallItem item;
-      PacketMetadata::ExtraItem extraItem;
-      ReadItems (current, &item, &extraItem);
-      totalSize += extraItem.fragmentEnd - extraItem.fragmentStart;
-      if (current == tail)
-        {
-          break;
-        }
-      NS_ASSERT (current != item.next);
-      current = item.next;
+      totalSize += record->m_fragmentEnd - record->m_fragmentStart;
+    }
+  for (const struct Record *record = m_back; record != 0; record = record->m_next)
+    {
+      totalSize += record->m_fragmentEnd - record->m_fragmentStart;
     }
   return totalSize;
 }
@@ -1050,47 +570,49 @@ PacketMetadata::BeginItem (Buffer buffer) const
   return ItemIterator (this, buffer);
 }
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
-  : m_metadata (metadata),
-    m_buffer (buffer),
-    m_current (metadata->m_head),
-    m_offset (0),
-    m_hasReadTail (false)
+  : m_buffer (buffer),
+    m_current (metadata->m_front),
+    m_offset (0)
 {
   NS_LOG_FUNCTION (this << metadata << &buffer);
+  // Begin copies the fragments of m_buffer into a single data, which
+  // the items share: they must not point into the data of a temporary
+  // buffer flattened for a header across two fragments.
+  m_buffer.Begin ();
+  for (const struct Record *record = metadata->m_back; record != 0; record = record->m_next)
+    {
+      m_back.push_back (record);
+    }
 }
 bool
 PacketMetadata::ItemIterator::HasNext (void) const
 {
   NS_LOG_FUNCTION (this);
-  if (m_current == 0xffff)
-    {
-      return false;
-    }
-  if (m_hasReadTail)
-    {
-      return false;
-    }
-  return true;
+  return m_current != 0 || !m_back.empty ();
 }
 PacketMetadata::Item
 PacketMetadata::ItemIterator::Next (void)
 {
   NS_LOG_FUNCTION (this);
   struct PacketMetadata::Item item;
-  struct PacketMetadata::SmallItem smallItem;
-  struct PacketMetadata::ExtraItem extraItem;
-  m_metadata->ReadItems (m_current, &smallItem, &extraItem);
-  if (m_current == m_metadata->m_tail)
+  const struct PacketMetadata::Record *record;
+  if (m_current != 0)
+    {
+      record = m_current;
+      m_current = record->m_next;
+    }
+  else
     {
-      m_hasReadTail = true;
+      // the bottom of the back stack follows the front stack.
+      record = m_back.back ();
+      m_back.pop_back ();
     }
-  m_current = smallItem.next;
-  uint32_t uid = (smallItem.typeUid & 0xfffffffe) >> 1;
+  uint32_t uid = record->m_typeUid;
   item.tid.SetUid (uid);
-  item.currentTrimedFromStart = extraItem.fragmentStart;
-  item.currentTrimedFromEnd = extraItem.fragmentEnd - smallItem.size;
-  item.currentSize = extraItem.fragmentEnd - extraItem.fragmentStart;
-  if (extraItem.fragmentStart != 0 || extraItem.fragmentEnd != smallItem.size)
+  item.currentTrimedFromStart = record->m_fragmentStart;
+  item.currentTrimedFromEnd = record->m_fragmentEnd - record->m_size;
+  item.currentSize = record->m_fragmentEnd - record->m_fragmentStart;
+  if (record->m_fragmentStart != 0 || record->m_fragmentEnd != record->m_size)
     {
       item.isFragment = true;
     }
@@ -1121,7 +643,7 @@ PacketMetadata::ItemIterator::Next (void)
       if (!item.isFragment)
         {
           ns3::Buffer tmp = m_buffer;
-          tmp.RemoveAtEnd (tmp.GetSize () - (m_offset + smallItem.size));
+          tmp.RemoveAtEnd (tmp.GetSize () - (m_offset + record->m_size));
           tmp.RemoveAtStart (tmp.GetSize () - item.currentSize);
           item.current = tmp.End ();
         }
@@ -1130,7 +652,7 @@ PacketMetadata::ItemIterator::Next (void)
     {
       NS_ASSERT (false);
     }
-  m_offset += extraItem.fragmentEnd - extraItem.fragmentStart;
+  m_offset += item.currentSize;
   return item;
 }
 
@@ -1151,13 +673,12 @@ PacketMetadata::GetSerializedSize (void) const
       return totalSize;
     }
 
-  struct PacketMetadata::SmallItem item;
-  struct PacketMetadata::ExtraItem extraItem;
-  uint32_t current = m_head;
-  while (current != 0xffff)
+  std::vector<const struct PacketMetadata::Record *> items;
+  GetItems (&items);
+  for (std::vector<const struct PacketMetadata::Record *>::const_iterator i = items.begin ();
+       i != items.end (); i++)
     {
-      ReadItems (current, &item, &extraItem);
-      uint32_t uid = (item.typeUid & 0xfffffffe) >> 1;
+      uint32_t uid = (*i)->m_typeUid;
       if (uid == 0)
         {
           totalSize += 4;
@@ -1169,12 +690,6 @@ PacketMetadata::GetSerializedSize (void) const
           totalSize += 4 + tid.GetName ().size ();
         }
       totalSize += 1 + 4 + 2 + 4 + 4 + 8;
-      if (current == m_tail)
-        {
-          break;
-        }
-      NS_ASSERT (current != item.next);
-      current = item.next;
     }
   return totalSize;
 }
@@ -1191,18 +706,18 @@ PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
       return 0;
     }
 
-  struct PacketMetadata::SmallItem item;
-  struct PacketMetadata::ExtraItem extraItem;
-  uint32_t current = m_head;
-  while (current != 0xffff)
+  std::vector<const struct PacketMetadata::Record *> items;
+  GetItems (&items);
+  for (std::vector<const struct PacketMetadata::Record *>::const_iterator i = items.begin ();
+       i != items.end (); i++)
     {
-      ReadItems (current, &item, &extraItem);
+      const struct PacketMetadata::Record *item = *i;
       NS_LOG_LOGIC ("bytesWritten=" << static_cast<uint32_t> (buffer - start) << ", typeUid="<<
-                    item.typeUid << ", size="<<item.size<<", chunkUid="<<item.chunkUid<<
-                    ", fragmentStart="<<extraItem.fragmentStart<<", fragmentEnd="<<
-                    extraItem.fragmentEnd<< ", packetUid="<<extraItem.packetUid);
+                    item->m_typeUid << ", size="<<item->m_size<<", chunkUid="<<item->m_chunkUid<<
+                    ", fragmentStart="<<item->m_fragmentStart<<", fragmentEnd="<<
+                    item->m_fragmentEnd<< ", packetUid="<<item->m_packetUid);
 
-      uint32_t uid = (item.typeUid & 0xfffffffe) >> 1;
+      uint32_t uid = item->m_typeUid;
       if (uid != 0)
         {
           TypeId tid;
@@ -1230,50 +745,46 @@ PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
             }
         }
 
-      uint8_t isBig = item.typeUid & 0x1;
+      // kept in the format for compatibility: an item is 'big' when
+      // it is a fragment or it comes from another packet.
+      uint8_t isBig = (item->m_fragmentStart != 0 ||
+                       item->m_fragmentEnd != item->m_size ||
+                       item->m_packetUid != m_packetUid) ? 1 : 0;
       buffer = AddToRawU8 (isBig, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
 
-      buffer = AddToRawU32 (item.size, start, buffer, maxSize);
+      buffer = AddToRawU32 (item->m_size, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
 
-      buffer = AddToRawU16 (item.chunkUid, start, buffer, maxSize);
+      buffer = AddToRawU16 (item->m_chunkUid, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
 
-      buffer = AddToRawU32 (extraItem.fragmentStart, start, buffer, maxSize);
+      buffer = AddToRawU32 (item->m_fragmentStart, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
 
-      buffer = AddToRawU32 (extraItem.fragmentEnd, start, buffer, maxSize);
+      buffer = AddToRawU32 (item->m_fragmentEnd, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
 
-      buffer = AddToRawU64 (extraItem.packetUid, start, buffer, maxSize);
+      buffer = AddToRawU64 (item->m_packetUid, start, buffer, maxSize);
       if (buffer == 0) 
         {
           return 0;
         }
-
-      if (current == m_tail)
-        {
-          break;
-        }
-
-      NS_ASSERT (current != item.next);
-      current = item.next;
     }
 
   NS_ASSERT (static_cast<uint32_t> (buffer - start) == maxSize);
@@ -1290,8 +801,7 @@ PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
   buffer = ReadFromRawU64 (m_packetUid, start, buffer, size);
   desSize -= 8;
 
-  struct PacketMetadata::SmallItem item = {0};
-  struct PacketMetadata::ExtraItem extraItem = {0};
+  struct PacketMetadata::Record item = {0};
   while (desSize > 0)
     {
       uint32_t uidStringSize = 0;
@@ -1316,26 +826,26 @@ PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
           TypeId tid = TypeId::LookupByName (uidString);
           uid = tid.GetUid ();
         }
+      // the fragment bounds and the packet uid are always present.
       uint8_t isBig = 0;
       buffer = ReadFromRawU8 (isBig, start, buffer, size);
       desSize--;
-      item.typeUid = (uid << 1) | isBig;
-      buffer = ReadFromRawU32 (item.size, start, buffer, size);
+      item.m_typeUid = uid;
+      buffer = ReadFromRawU32 (item.m_size, start, buffer, size);
       desSize -= 4;
-      buffer = ReadFromRawU16 (item.chunkUid, start, buffer, size);
+      buffer = ReadFromRawU16 (item.m_chunkUid, start, buffer, size);
       desSize -= 2;
-      buffer = ReadFromRawU32 (extraItem.fragmentStart, start, buffer, size);
+      buffer = ReadFromRawU32 (item.m_fragmentStart, start, buffer, size);
       desSize -= 4;
-      buffer = ReadFromRawU32 (extraItem.fragmentEnd, start, buffer, size);
+      buffer = ReadFromRawU32 (item.m_fragmentEnd, start, buffer, size);
       desSize -= 4;
-      buffer = ReadFromRawU64 (extraItem.packetUid, start, buffer, size);
+      buffer = ReadFromRawU64 (item.m_packetUid, start, buffer, size);
       desSize -= 8;
-      NS_LOG_LOGIC ("size=" << size << ", typeUid="<<item.typeUid <<
-                    ", size="<<item.size<<", chunkUid="<<item.chunkUid<<
-                    ", fragmentStart="<<extraItem.fragmentStart<<", fragmentEnd="<<
-                    extraItem.fragmentEnd<< ", packetUid="<<extraItem.packetUid);
-      uint32_t tmp = AddBig (0xffff, m_tail, &item, &extraItem);
-      UpdateTail (tmp);
+      NS_LOG_LOGIC ("size=" << size << ", typeUid="<<item.m_typeUid <<
+                    ", size="<<item.m_size<<", chunkUid="<<item.m_chunkUid<<
+                    ", fragmentStart="<<item.m_fragmentStart<<", fragmentEnd="<<
+                    item.m_fragmentEnd<< ", packetUid="<<item.m_packetUid);
+      PushBack (item);
     }
   NS_ASSERT (desSize == 0);
   return (desSize !=0) ? 0 : 1;
@@ -44,14 +44,11 @@ class Trailer;
  * an implementation of the Packet::Print methods which uses
  * the metadata to analyse the content of the packet's buffer.
  *
- * To achieve this, this class maintains a linked list of so-called
+ * To achieve this, this class maintains a list of so-called
  * "items", each of which represents a header or a trailer, or 
- * payload, or a fragment of any of these. Each item contains a "next"
- * and a "prev" field which point to the next and previous entries
- * in the linked list. The PacketMetadata class maintains a pair
- * of pointers to the head and the tail of the linked list.
+ * payload, or a fragment of any of these.
  *
- * Each entry in the list also maintains:
+ * Each item maintains:
  *   - its native size (the size it had when it was first added
  *     to the packet)
  *   - its type: identifies what kind of header, what kind of trailer,
@@ -60,23 +57,26 @@ class Trailer;
  *   - the start and end of the area represented by a fragment
  *     if it is one.
  *
- * This linked list is flattened in a byte buffer stored in
- * struct PacketMetadata::Data. Each entry of the linked list is
- * identified by an offset which identifies the first byte of the
- * entry from the start of the data buffer. The size of this data
- * buffer is 2^16-1 bytes maximum which somewhat limits the number
- * of entries which can be stored in this linked list but it is
- * quite unlikely to hit this limit in practice.
+ * Each item is stored in a fixed-size record which is never modified
+ * once it is in the list. The records are reference-counted and
+ * recycled through a per-thread free list. The list is kept as two
+ * stacks of records: the top of the front stack is the head of the
+ * list, the top of the back stack is the tail of the list, and each
+ * record points to the next record of its stack, toward the middle
+ * of the list.
  *
- * Each item of the linked list is a variable-sized byte buffer
- * made of a number of fields. Some of these fields are stored
- * as fixed-size 32 bit integers, others as fixed-size 16 bit 
- * integers, and some others as variable-size 32-bit integers.
- * The variable-size 32 bit integers are stored using the uleb128
- * encoding.
+ * Adding or removing a header pushes or pops a record on the front
+ * stack, adding or removing a trailer does the same on the back stack.
+ * A copy of a PacketMetadata shares all the records of the original:
+ * changing the copy later pushes new records on top of the shared
+ * ones, and never copies the list. An item trimmed by RemoveAtStart
+ * or RemoveAtEnd is replaced by a new record. When the stack of an end
+ * of the list is empty, the other stack is reversed into it.
  */
 class PacketMetadata 
 {
+private:
+  struct Record;
 public:
 
   /**
@@ -116,7 +116,8 @@ public:
     uint32_t currentTrimedFromEnd;
     /**
      * an iterator which can be fed to Deserialize. Valid only
-     * if isFragment and isPayload are false.
+     * if isFragment and isPayload are false, and while the
+     * ItemIterator which returned the item exists.
      */
     Buffer::Iterator current;
   };
@@ -144,11 +145,11 @@ public:
      */
     Item Next (void);
 private:
-    const PacketMetadata *m_metadata; //!< pointer to the metadata
-    Buffer m_buffer; //!< buffer the metadata refers to
-    uint16_t m_current; //!< current position
+    Buffer m_buffer; //!< buffer the metadata refers to, flattened, which holds the data of the items
+    const struct Record *m_current; //!< current position in the front stack
+    /// the records of the back stack, the tail first
+    std::vector<const struct Record *> m_back;
     uint32_t m_offset; //!< offset
-    bool m_hasReadTail; //!< true if the metadata tail has been read
   };
 
   /**
@@ -216,6 +217,15 @@ private:
    * and then, RemoveAtEnd (end).
    */
   PacketMetadata CreateFragment (uint32_t start, uint32_t end) const;
+  /**
+   * \brief Create a copy which shares no record with this metadata.
+   *
+   * The records are shared through reference counts which are not
+   * thread-safe: metadata handed to another thread must be a deep copy.
+   *
+   * \return a copy with the same uid and items
+   */
+  PacketMetadata CreateDeepCopy (void) const;
 
   /**
    * \brief Add a metadata at the metadata start
@@ -400,215 +410,129 @@ private:
                                   uint32_t maxSize);
 
   /**
-   * the size of PacketMetadata::Data::m_data such that the total size
-   * of PacketMetadata::Data is 16 bytes
-   */ 
-#define PACKET_METADATA_DATA_M_DATA_SIZE 8
-  
-  /**
-   * Data structure
+   * \brief An item of the list.
+   *
+   * The records of the list are shared with the copies of the
+   * metadata, and are never modified once they are in a stack.
    */
-  struct Data {
-    /** number of references to this struct Data instance. */
+  struct Record
+  {
+    /** the next record of the stack, toward the middle of the list.
+        zero if this record is at the bottom of its stack. */
+    struct Record *m_next;
+    /** the packetUid of the packet in which this header or trailer
+        was first added. It could be different from the m_packetUid
+        field if the user has aggregated multiple packets into one. */
+    uint64_t m_packetUid;
+    /** number of references to this record: the metadata whose
+        stack starts with it, and the records whose next it is. */
     uint32_t m_count;
-    /** size (in bytes) of m_data buffer below */
-    uint16_t m_size;
-    /** max of the m_used field over all objects which
-     * reference this struct Data instance */
-    uint16_t m_dirtyEnd;
-    /** variable-sized buffer of bytes */
-    uint8_t m_data[PACKET_METADATA_DATA_M_DATA_SIZE]; 
-  };
-  /* Note that since the next and prev fields are 16 bit integers
-     and since the value 0xffff is reserved to identify the 
-     fact that the end or the start of the list is reached,
-     only a limited number of elements can be stored in 
-     a m_data byte buffer.
-   */
-  /**
-   * \brief SmallItem structure
-   */
-  struct SmallItem {
-    /** offset (in bytes) from start of m_data buffer
-       to next element in linked list. value is 0xffff 
-       if next element does not exist.
-       stored as a fixed-size 16 bit integer.
-    */
-    uint16_t next;
-    /** offset (in bytes) from start of m_data buffer
-       to previous element in linked list. value is 0xffff 
-       if previous element does not exist.
-       stored as a fixed-size 16 bit integer.
-     */
-    uint16_t prev;
-    /** the high 31 bits of this field identify the
-       type of the header or trailer represented by 
-       this item: the value zero represents payload.
-       If the low bit of this uid is one, an ExtraItem
-       structure follows this SmallItem structure.
-       stored as a variable-size 32 bit integer.
-     */
-    uint32_t typeUid;
+    /** the uid of the TypeId of the header or trailer represented
+        by this item, zero for payload. */
+    uint32_t m_typeUid;
     /** the size (in bytes) of the header or trailer represented
-       by this element.
-       stored as a variable-size 32 bit integer.
-     */
-    uint32_t size;
-    /** this field tries to uniquely identify each header or
-       trailer _instance_ while the typeUid field uniquely
-       identifies each header or trailer _type_. This field
-       is used to test whether two items are equal in the sense 
-       that they represent the same header or trailer instance.
-       That equality test is based on the typeUid and chunkUid
-       fields so, the likelyhood that two header instances 
-       share the same chunkUid _and_ typeUid is very small 
-       unless they are really representations of the same header
-       instance.
-       stored as a fixed-size 16 bit integer.
-     */
-    uint16_t chunkUid;
-  };
-
-  /**
-   * \brief ExtraItem structure
-   */
-  struct ExtraItem {
+        by this item. */
+    uint32_t m_size;
     /** offset (in bytes) from start of original header to
-       the start of the fragment still present.
-       stored as a variable-size 32 bit integer.
-     */
-    uint32_t fragmentStart;
+        the start of the fragment still present. */
+    uint32_t m_fragmentStart;
     /** offset (in bytes) from start of original header to
-       the end of the fragment still present.
-       stored as a variable-size 32 bit integer.
-     */
-    uint32_t fragmentEnd;
-    /** the packetUid of the packet in which this header or trailer
-       was first added. It could be different from the m_packetUid
-       field if the user has aggregated multiple packets into one.
-       stored as a fixed-size 64 bit integer.
-     */
-    uint64_t packetUid;
+        the end of the fragment still present. */
+    uint32_t m_fragmentEnd;
+    /** this field tries to uniquely identify each header or
+        trailer _instance_ while the m_typeUid field uniquely
+        identifies each header or trailer _type_. This field
+        is used to test whether two items are equal in the sense 
+        that they represent the same header or trailer instance.
+        That equality test is based on the m_typeUid and m_chunkUid
+        fields so, the likelyhood that two header instances 
+        share the same m_chunkUid _and_ m_typeUid is very small 
+        unless they are really representations of the same header
+        instance. */
+    uint16_t m_chunkUid;
   };
 
   /**
-   * \brief Class to hold all the metadata
+   * \brief The recycled records of a thread
    */
-  class DataFreeList : public std::vector<struct Data *>
+  class RecordFreeList : public std::vector<struct Record *>
   {
 public:
-    ~DataFreeList ();
+    ~RecordFreeList ();
   };
 
-  friend DataFreeList::~DataFreeList ();
+  friend RecordFreeList::~RecordFreeList ();
   friend class ItemIterator;
 
   PacketMetadata ();
 
   /**
-   * \brief Add a SmallItem
-   * \param item the SmallItem to add
-   * \return added size
+   * \brief Create a record
+   * \param item the item to copy into the record
+   * \param next the next record of the stack, whose reference is
+   *        transferred to the new record
+   * \returns the new record, with one reference
    */
-  inline uint16_t AddSmall (const PacketMetadata::SmallItem *item);
+  static struct Record *Create (const struct Record &item, struct Record *next);
   /**
-   * \brief Add a "Big" Item (a SmallItem plus an ExtraItem)
-   * \param head the head
-   * \param tail the tail
-   * \param item the SmallItem to add
-   * \param extraItem the ExtraItem to add
-   * \return added size
-   */
-  uint16_t AddBig (uint32_t head, uint32_t tail,
-                   const PacketMetadata::SmallItem *item, 
-                   const PacketMetadata::ExtraItem *extraItem);
-  /**
-   * \brief Replace the tail
-   * \param item the item data to write
-   * \param extraItem the extra item data to write
-   * \param available the number of bytes which can
-   *        be written without having to rewrite the buffer entirely.
-   */
-  void ReplaceTail (PacketMetadata::SmallItem *item, 
-                    PacketMetadata::ExtraItem *extraItem,
-                    uint32_t available);
-  /**
-   * \brief Update the head
-   * \param written the used bytes
+   * \brief Release a reference to a record
+   *
+   * The record is recycled when it is not referenced anymore, and
+   * the reference it held to the next record is released.
+   *
+   * \param record the record, or zero
    */
-  inline void UpdateHead (uint16_t written);
+  static void Unref (struct Record *record);
   /**
-   * \brief Update the tail
-   * \param written the used bytes
+   * \brief Reverse a stack
+   * \param stack the top of the stack
+   * \returns the top of a new stack with the items of stack in the
+   *          reverse order, with one reference
    */
-  inline void UpdateTail (uint16_t written);
+  static struct Record *Reverse (const struct Record *stack);
 
   /**
-   * \brief Get the ULEB128 (Unsigned Little Endian Base 128) size
-   * \param value the value
-   * \returns the value's ULEB128 size
-   */
-  inline uint32_t GetUleb128Size (uint32_t value) const;
-  /**
-   * \brief Read a ULEB128 (Unsigned Little Endian Base 128) coded number
-   * \param pBuffer the buffer to read from
-   * \returns the value
+   * \brief Get the head of the list, moving the items of the back
+   * stack to the front stack if needed.
+   * \returns the head of the list, zero if the list is empty
    */
-  uint32_t ReadUleb128 (const uint8_t **pBuffer) const;
+  const struct Record *Front (void);
   /**
-   * \brief Append a 16-bit value to the buffer
-   * \param value the value to add
-   * \param buffer the buffer to write to
+   * \brief Get the tail of the list, moving the items of the front
+   * stack to the back stack if needed.
+   * \returns the tail of the list, zero if the list is empty
    */
-  inline void Append16 (uint16_t value, uint8_t *buffer);
+  const struct Record *Back (void);
   /**
-   * \brief Append a 32-bit value to the buffer
-   * \param value the value to add
-   * \param buffer the buffer to write to
+   * \brief Add an item at the head of the list
+   * \param item the item
    */
-  inline void Append32 (uint32_t value, uint8_t *buffer);
+  void PushFront (const struct Record &item);
   /**
-   * \brief Append a value to the buffer
-   * \param value the value to add
-   * \param buffer the buffer to write to
+   * \brief Add an item at the tail of the list
+   * \param item the item
    */
-  inline void AppendValue (uint32_t value, uint8_t *buffer);
+  void PushBack (const struct Record &item);
   /**
-   * \brief Append a value to the buffer - extra
-   *
-   * This function is called by AppendValue
-   *
-   * \param value the value to add
-   * \param buffer the buffer to write to
+   * \brief Remove the head of the list, returned by Front
    */
-  void AppendValueExtra (uint32_t value, uint8_t *buffer);
-
+  void PopFront (void);
   /**
-   * \brief Reserve space
-   * \param n space to reserve
+   * \brief Remove the tail of the list, returned by Back
    */
-  inline void Reserve (uint32_t n);
+  void PopBack (void);
   /**
-   * \brief Reserve space and make a metadata copy
-   * \param n space to reserve
+   * \brief Get the items of the list
+   * \param items the vector to which the items are appended, from
+   *        the head to the tail of the list
    */
-  void ReserveCopy (uint32_t n);
+  void GetItems (std::vector<const struct Record *> *items) const;
 
   /**
    * \brief Get the total size used by the metadata
    */
   uint32_t GetTotalSize (void) const;
 
-  /**
-   * \brief Read items
-   * \param current the offset we should start reading the data from
-   * \param item pointer to where we should store the data to return to the caller
-   * \param extraItem pointer to where we should store the data to return to the caller
-   * \returns the number of bytes read.
-   */
-  uint32_t ReadItems (uint16_t current, 
-                      struct PacketMetadata::SmallItem *item,
-                      struct PacketMetadata::ExtraItem *extraItem) const;
   /**
    * \brief Add an header
    * \param uid header's uid to add
@@ -620,43 +544,9 @@ public:
    * \returns true if the internal state is ok
    */
   bool IsStateOk (void) const;
-  /**
-   * \brief Check if the position is valid
-   * \param pointer the position to check
-   * \returns true if the position is valid
-   */
-  bool IsPointerOk (uint16_t pointer) const;
-  /**
-   * \brief Check if the position is valid
-   * \param pointer the position to check
-   * \returns true if the position is valid
-   */
-  bool IsSharedPointerOk (uint16_t pointer) const;
 
-  /**
-   * \brief Recycle the buffer memory
-   * \param data the buffer data storage
-   */
-  static void Recycle (struct PacketMetadata::Data *data);
-  /**
-   * \brief Create a buffer data storage
-   * \param size the storage size to create
-   * \returns a pointer to the created buffer storage
-   */
-  static struct PacketMetadata::Data *Create (uint32_t size);
-  /**
-   * \brief Allocate a buffer data storage
-   * \param n the storage size to create
-   * \returns a pointer to the allocated buffer storage
-   */
-  static struct PacketMetadata::Data *Allocate (uint32_t n);
-  /**
-   * \brief Deallocate the buffer memory
-   * \param data the buffer data storage
-   */
-  static void Deallocate (struct PacketMetadata::Data *data);
-
-  static DataFreeList m_freeList; //!< the metadata data storage
+  static thread_local RecordFreeList m_freeList; //!< the recycled records, per thread
+  static thread_local bool m_freeListDestroyed; //!< the free list of this thread was destroyed
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
 
@@ -667,18 +557,14 @@ public:
    */
   static bool m_metadataSkipped;
 
-  static uint32_t m_maxSize; //!< maximum metadata size
-  static uint16_t m_chunkUid; //!< Chunk Uid
+  static thread_local uint16_t m_chunkUid; //!< Chunk Uid
 
-  struct Data *m_data; //!< Metadata storage
   /*
-     head -(next)-> tail
-       ^             |
-        \---(prev)---|
+     m_front -(next)-> ... -(next)-> bottom | bottom <-(next)- ... <-(next)- m_back
+     head of the list                                           tail of the list
    */
-  uint16_t m_head; //!< list head
-  uint16_t m_tail; //!< list tail
-  uint16_t m_used; //!< used portion
+  struct Record *m_front; //!< front stack, starting with the head of the list
+  struct Record *m_back; //!< back stack, starting with the tail of the list
   uint64_t m_packetUid; //!< packet Uid
 };
 
@@ -687,58 +573,65 @@ public:
 namespace ns3 {
 
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
-    m_head (0xffff),
-    m_tail (0xffff),
-    m_used (0),
+  : m_front (0),
+    m_back (0),
     m_packetUid (uid)
 {
-  memset (m_data->m_data, 0xff, 4);
   if (size > 0)
     {
       DoAddHeader (0, size);
     }
 }
 PacketMetadata::PacketMetadata (PacketMetadata const &o)
-  : m_data (o.m_data),
-    m_head (o.m_head),
-    m_tail (o.m_tail),
-    m_used (o.m_used),
+  : m_front (o.m_front),
+    m_back (o.m_back),
     m_packetUid (o.m_packetUid)
 {
-  NS_ASSERT (m_data != 0);
-  NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
-  m_data->m_count++;
+  if (m_front != 0)
+    {
+      NS_ASSERT (m_front->m_count < std::numeric_limits<uint32_t>::max());
+      m_front->m_count++;
+    }
+  if (m_back != 0)
+    {
+      NS_ASSERT (m_back->m_count < std::numeric_limits<uint32_t>::max());
+      m_back->m_count++;
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
 {
-  if (m_data != o.m_data) 
+  // take the references first: o may share our records
+  if (o.m_front != 0)
     {
-      // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
-        {
-          PacketMetadata::Recycle (m_data);
-        }
-      m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      o.m_front->m_count++;
     }
-  m_head = o.m_head;
-  m_tail = o.m_tail;
-  m_used = o.m_used;
+  if (o.m_back != 0)
+    {
+      o.m_back->m_count++;
+    }
+  if (m_front != 0)
+    {
+      Unref (m_front);
+    }
+  if (m_back != 0)
+    {
+      Unref (m_back);
+    }
+  m_front = o.m_front;
+  m_back = o.m_back;
   m_packetUid = o.m_packetUid;
   return *this;
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_front != 0)
+    {
+      Unref (m_front);
+    }
+  if (m_back != 0)
     {
-      PacketMetadata::Recycle (m_data);
+      Unref (m_back);
     }
 }
 
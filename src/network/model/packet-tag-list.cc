@@ -20,7 +20,7 @@
 
 /**
 \file   packet-tag-list.cc
-\brief  Implements a linked list of Packet tags, including copy-on-write semantics.
+\brief  Implements a table of Packet tags, stored inline in the packet.
 */
 
 #include "packet-tag-list.h"
@@ -34,255 +34,156 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
-bool
-PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
+uint32_t
+PacketTagList::Find (TypeId tid) const
 {
-  TypeId tid = tag.GetInstanceTypeId ();
   NS_LOG_FUNCTION (this << tid);
-  NS_LOG_INFO     ("looking for " << tid);
-
-  // trivial case when list is empty
-  if (m_next == 0)
-    {
-      return false;
-    }
-
-  bool found = false;
-
-  struct TagData ** prevNext = &m_next; // previous node's next pointer
-  struct TagData  * cur      =  m_next; // cursor to current node
-  struct TagData  * it = 0;             // utility
-
-  // Search from the head of the list until we find tid or a merge
-  while (cur != 0)
+  uint32_t i = 0;
+  for (; i < m_size && i < INLINE_SIZE; i++)
     {
-      if (cur->count > 1)
+      if (m_tags[i].tid == tid)
         {
-          // found merge
-          NS_LOG_INFO ("found initial merge before tid");
-          break;
+          return i;
         }
-      else if (cur->tid == tid)
-        {
-          NS_LOG_INFO ("found tid before initial merge, calling writer");
-          found = (this->*Writer)(tag, true, cur, prevNext);
-          break;
-        }
-      else
-        {
-          // no merge or tid found yet, move on
-          prevNext = &cur->next;
-          cur      =  cur->next;
-        }
-    }  // while !found && !cow
-
-  // did we find it or run out of tags?
-  if (cur == 0 || found)
-    {
-      NS_LOG_INFO ("returning after header with found: " << found);
-      return found;
     }
-
-  // From here on out, we have to copy the list
-  // until we find tid, then link past it
-
-  // Before we do all that work, let's make sure tid really exists
-  for (it = cur; it != 0; it = it->next)
+  for (; i < m_size; i++)
     {
-      if (it->tid == tid)
+      if (m_overflow->tags[i - INLINE_SIZE].tid == tid)
         {
-          break;
+          return i;
         }
     }
-  if (it == 0)
-    {
-      // got to end of list without finding tid
-      NS_LOG_INFO ("tid not found after first merge");
-      return found;
-    }
-
-  // At this point cur is a merge, but untested for tid
-  NS_ASSERT (cur != 0);
-  NS_ASSERT (cur->count > 1);
-
-  /*
-     Walk the remainder of the list, copying, until we find tid
-     As we put a copy of the cur node onto our list,
-     we move the merge point down the list.
-
-     Starting position                  End position
-       T1 is a merge                     T1.count decremented
-                                         T2 is a merge
-                                         T1' is a copy of T1
-
-          other                             other
-               \                                 \
-      Prev  ->  T1  ->  T2  -> ...                T1  ->  T2  -> ...
-           /   /                                         /|
-      pNext cur                         Prev  ->  T1' --/ |
-                                                     /    |
-                                                pNext   cur
-
-     When we reach tid, we link past it, decrement count, and we're done.
-  */
+  return m_size;
+}
 
-  // Should normally check for null cur pointer,
-  // but since we know tid exists, we'll skip this test
-  while ( /* cur && */ cur->tid != tid)
+void
+PacketTagList::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_overflow != 0 && m_overflow->count > 1)
     {
-      NS_ASSERT (cur != 0);
-      NS_ASSERT (cur->count > 1);
-      cur->count--;                       // unmerge cur
-      struct TagData * copy = new struct TagData ();
-      copy->tid = cur->tid;
+      struct Overflow *copy = new struct Overflow ();
       copy->count = 1;
-      memcpy (copy->data, cur->data, TagData::MAX_SIZE);
-      copy->next = cur->next;             // merge into tail
-      copy->next->count++;                // mark new merge
-      *prevNext = copy;                   // point prior list at copy
-      prevNext = &copy->next;             // advance
-      cur      =  copy->next;
+      copy->tags = m_overflow->tags;
+      m_overflow->count--;
+      m_overflow = copy;
     }
-  // Sanity check:
-  NS_ASSERT (cur != 0);                 // cur should be non-zero
-  NS_ASSERT (cur->tid == tid);          // cur->tid should be tid
-  NS_ASSERT (cur->count > 1);           // cur should be a merge
-
-  // link around tid, removing it from our list
-  found = (this->*Writer)(tag, false, cur, prevNext);
-  return found;
+}
 
+PacketTagList
+PacketTagList::CreateDeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  PacketTagList copy = *this;
+  copy.Unshare ();
+  return copy;
 }
 
-bool
-PacketTagList::Remove (Tag & tag)
+struct PacketTagList::TagData *
+PacketTagList::GetWritable (uint32_t i)
 {
-  return COWTraverse (tag, &PacketTagList::RemoveWriter);
+  NS_ASSERT (i < m_size);
+  if (i < INLINE_SIZE)
+    {
+      return &m_tags[i];
+    }
+  Unshare ();
+  return &m_overflow->tags[i - INLINE_SIZE];
 }
 
-// COWWriter implementing Remove
 bool
-PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
-                             struct PacketTagList::TagData  * cur,
-                             struct PacketTagList::TagData ** prevNext)
+PacketTagList::Remove (Tag & tag)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  tag.Deserialize (TagBuffer (cur->data,
-                              cur->data + TagData::MAX_SIZE));
-  *prevNext = cur->next;            // link around cur
-
-  if (preMerge)
+  TypeId tid = tag.GetInstanceTypeId ();
+  NS_LOG_FUNCTION (this << tid);
+  uint32_t i = Find (tid);
+  if (i == m_size)
     {
-      // found tid before first merge, so delete cur
-      delete cur;
+      return false;
     }
-  else
+  uint8_t *data = const_cast<uint8_t *> (Get (i)->data);
+  tag.Deserialize (TagBuffer (data, data + TagData::MAX_SIZE));
+  // keep the other tags in the order they were added
+  for (; i + 1 < m_size; i++)
+    {
+      *GetWritable (i) = *Get (i + 1);
+    }
+  m_size--;
+  if (m_size >= INLINE_SIZE)
     {
-      // cur is always a merge at this point
-      // unmerge cur, since we linked around it already
-      cur->count--;
-      if (cur->next != 0)
+      Unshare ();
+      m_overflow->tags.pop_back ();
+      if (m_overflow->tags.empty ())
         {
-          // there's a next, so make it a merge
-          cur->next->count++;
+          ReleaseOverflow ();
         }
     }
-  return found;
+  return true;
 }
 
 bool
 PacketTagList::Replace (Tag & tag)
 {
-  bool found = COWTraverse (tag, &PacketTagList::ReplaceWriter);
-  if (!found)
+  TypeId tid = tag.GetInstanceTypeId ();
+  NS_LOG_FUNCTION (this << tid);
+  uint32_t i = Find (tid);
+  if (i == m_size)
     {
       Add (tag);
+      return false;
     }
-  return found;
+  NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
+  struct TagData *data = GetWritable (i);
+  tag.Serialize (TagBuffer (data->data, data->data + tag.GetSerializedSize ()));
+  return true;
 }
 
-// COWWriter implementing Replace
-bool
-PacketTagList::ReplaceWriter (Tag & tag, bool preMerge,
-                              struct PacketTagList::TagData  * cur,
-                              struct PacketTagList::TagData ** prevNext)
+void 
+PacketTagList::Add (const Tag &tag) const
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  if (preMerge)
+  NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
+  // ensure this id was not yet added
+  NS_ASSERT (Find (tag.GetInstanceTypeId ()) == m_size);
+  PacketTagList *self = const_cast<PacketTagList *> (this);
+  struct TagData *data;
+  if (m_size < INLINE_SIZE)
     {
-      // found tid before first merge, so just rewrite
-      tag.Serialize (TagBuffer (cur->data,
-                                cur->data + tag.GetSerializedSize ()));
+      data = &self->m_tags[m_size];
     }
   else
     {
-      // cur is always a merge at this point
-      // need to copy, replace, and link past cur
-      cur->count--;                     // unmerge cur
-      struct TagData * copy = new struct TagData ();
-      copy->tid = tag.GetInstanceTypeId ();
-      copy->count = 1;
-      tag.Serialize (TagBuffer (copy->data,
-                                copy->data + tag.GetSerializedSize ()));
-      copy->next = cur->next;           // merge into tail
-      if (copy->next != 0)
+      if (m_overflow == 0)
         {
-          copy->next->count++;          // mark new merge
+          self->m_overflow = new struct Overflow ();
+          self->m_overflow->count = 1;
         }
-      *prevNext = copy;                 // point prior list at copy
-    }
-  return found;
-}
-
-void 
-PacketTagList::Add (const Tag &tag) const
-{
-  NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  // ensure this id was not yet added
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
-    {
-      NS_ASSERT (cur->tid != tag.GetInstanceTypeId ());
+      else
+        {
+          self->Unshare ();
+        }
+      self->m_overflow->tags.push_back (TagData ());
+      data = &self->m_overflow->tags.back ();
     }
-  struct TagData * head = new struct TagData ();
-  head->count = 1;
-  head->next = 0;
-  head->tid = tag.GetInstanceTypeId ();
-  head->next = m_next;
+  std::memset (data->data, 0, TagData::MAX_SIZE);
+  data->tid = tag.GetInstanceTypeId ();
   NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
-  tag.Serialize (TagBuffer (head->data, head->data + tag.GetSerializedSize ()));
-
-  const_cast<PacketTagList *> (this)->m_next = head;
+  tag.Serialize (TagBuffer (data->data, data->data + tag.GetSerializedSize ()));
+  self->m_size++;
 }
 
 bool
 PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  uint32_t i = Find (tag.GetInstanceTypeId ());
+  if (i == m_size)
     {
-      if (cur->tid == tid) 
-        {
-          /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data + TagData::MAX_SIZE));
-          return true;
-        }
+      /* no tag found */
+      return false;
     }
-  /* no tag found */
-  return false;
-}
-
-const struct PacketTagList::TagData *
-PacketTagList::Head (void) const
-{
-  return m_next;
+  uint8_t *data = const_cast<uint8_t *> (Get (i)->data);
+  tag.Deserialize (TagBuffer (data, data + TagData::MAX_SIZE));
+  return true;
 }
 
 } /* namespace ns3 */
-
@@ -22,11 +22,12 @@
 
 /**
 \file   packet-tag-list.h
-\brief  Defines a linked list of Packet tags, including copy-on-write semantics.
+\brief  Defines a table of Packet tags, stored inline in the packet.
 */
 
 #include <stdint.h>
 #include <ostream>
+#include <vector>
 #include "ns3/type-id.h"
 
 namespace ns3 {
@@ -43,96 +44,30 @@ class Tag;
  *
  * \internal
  *
- * The implementation of this class is a bit tricky.  Refer to this
- * diagram in the discussion that follows.
+ *   - Tags are stored in serialized form in a table of TagData,
+ *     in the order they were added.  A packet holds at most one tag
+ *     of each type, and a tag is found by comparing the uid of its
+ *     TypeId, which is a small index assigned when the type is
+ *     registered.
  *
- * \dot
- *    digraph {
- *        rankdir = "LR";
- *        clusterrank = local;
- *        node [ shape = record, fontname="FreeSans", fontsize="10" ];
- *        oth  [ label="<l> Other branch | <n> next | <c> ..." ];
- *        PTL1 [ label="<l> PacketTagList A | <n> m_next" , shape=Mrecord];
- *        PTL2 [ label="<l> PacketTagList B | <n> m_next" , shape=Mrecord];
- *        oth:n  -> T7:l ;
- *        PTL2:n -> T6:l ;
- *        PTL1:n -> T5:l ;
- *        T1   [ label="<l> T1  | <n> next | <c> count = 1" ];
- *        T2   [ label="<l> T2  | <n> next | <c> count = 1" ];
- *        T3   [ label="<l> T3  | <n> next | <c> count = 2" ];
- *        T4   [ label="<l> T4  | <n> next | <c> count = 1" ];
- *        T5   [ label="<l> T5  | <n> next | <c> count = 2" ];
- *        T6   [ label="<l> T6  | <n> next | <c> count = 1" ];
- *        T7   [ label="<l> T7  | <n> next | <c> count = 1" ];
- *        NULL [ label="0", shape = ellipse ];
- *        subgraph cluster_list {
- *          penwidth = 0;
- *          T6:n -> T5:l ;
- *          T5:n -> T4:l ;
- *          T4:n -> T3:l ;
- *          T7:n -> T3:l ;
- *          T3:n -> T2:l ;
- *          T2:n -> T1:l ;
- *          T1:n -> NULL ;
- *        };
- *      };
- * \enddot
+ *   - The first #INLINE_SIZE tags are stored in the PacketTagList
+ *     itself: the common packet, with one to three tags, does not
+ *     allocate any memory for them, and copying the list copies the
+ *     used entries of the table.
  *
- *   - Tags are stored in serialized form in a tree of TagData
- *     structures. (<tt>T1-T7</tt> in the diagram)
- *
- *   - Each TagData points (\c next pointers in the diagram)
- *     toward the root of the tree, which is a null pointer.
- *
- *   - \c count is the number of incoming pointers to this
- *     TagData.  Branch points, where branches merge or join, have
- *     <tt>count \> 1</tt> (\c T3, \c T5); successive links along
- *     a branch have <tt>count = 1</tt> (\c T1, \c T2, \c T4, \c T6, \c T7).
- *
- *   - Each PacketTagList points to a specific TagData,
- *     which is the most recent Tag added to the packet. (<tt>T5-T7</tt>)
- *
- *   - Conceptually, therefore, each Packet has a PacketTagList which
- *     points to a singly-linked list of TagData.
- *
- * \par <b> Copy-on-write </b> is implemented as follows:
- *
- *   - #Add prepends the new tag to the list (growing that branch of the tree,
- *     as \c T6). This is a constant time operation, and does not affect
- *     any other #PacketTagList's, hence this is a \c const function.
- *
- *   - Copy constructor (PacketTagList(const PacketTagList & o))
- *     and assignment (#operator=(const PacketTagList & o)
- *     simply join the tree at the same place as the original
- *     PacketTagList \c o, incrementing the \c count.
- *     For assignment, the old branch is deleted, up to
- *     the first branch point, which has its \c count decremented.
- *     (PacketTagList \c B started as a copy of PacketTagList \c A,
- *     before \c T6 was added to \c B).
- *
- *   - #Remove and #Replace are a little tricky, depending on where the
- *     target tag is found relative to the first branch point:
- *     - \e Target before <em> the first branch point: </em> \n
- *       The target is just dealt with in place (linked around and deleted,
- *       in the case of #Remove; rewritten in the case of #Replace).
- *     - \e Target at or after <em> the first branch point: </em> \n
- *       The portion of the list between the first branch and the target is
- *       shared. This portion is copied before the #Remove or #Replace is
- *       performed.
+ *   - The tags beyond #INLINE_SIZE are stored in an overflow table,
+ *     shared by the copies of the list and copied when a list sharing
+ *     it is changed (copy-on-write).
  *
  * \par <b> Memory Management: </b>
  * \n
  * Packet tags must serialize to a finite maximum size, see TagData
- *
- * This documentation entitles the original author to a free beer.
  */
 class PacketTagList 
 {
 public:
   /**
-   * Tree node for sharing serialized tags.
-   *
-   * See PacketTagList for a discussion of the data structure.
+   * Entry of the table of serialized tags.
    *
    * See TagData::TagData_e for a discussion of the size limit on
    * tag serialization.
@@ -146,15 +81,9 @@ public:
      * in this constant.
      *
      * \internal
-     * Ideally, TagData would be 32 bytes in size, so they require
-     * no padding on 64-bit architectures.  (The architecture
-     * affects the size because of the \c #next pointer.)
-     * This would leave 18 bytes for \c #data.  However,
-     * ns3:Ipv6PacketInfoTag needs 19 bytes!  The current
+     * ns3:Ipv6PacketInfoTag needs 19 bytes.  The current
      * implementation allows 20 bytes, which gives TagData
-     * a size of 30 bytes on 32-byte machines (which gets
-     * padded with 2 bytes), and 34 bytes on 64-bit machines, which
-     * gets padded to 40 bytes.
+     * a size of 22 bytes.
      */
     enum TagData_e
     {
@@ -162,11 +91,17 @@ public:
   };
 
     uint8_t data[MAX_SIZE];   /**< Serialization buffer */
-    struct TagData * next;   /**< Pointer to next in list */
     TypeId tid;               /**< Type of the tag serialized into #data */
-    uint32_t count;           /**< Number of incoming links */
   };  /* struct TagData */
 
+  /**
+   * \brief Number of tags stored in the PacketTagList itself
+   */
+  enum InlineSize_e
+  {
+    INLINE_SIZE = 4
+  };
+
   /**
    * Create a new PacketTagList.
    */
@@ -176,8 +111,8 @@ public:
    *
    * \param [in] o The PacketTagList to copy.
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This copies the inline tags of \pname{o} and shares
+   * its overflow table.
    */
   inline PacketTagList (PacketTagList const &o);
   /**
@@ -186,19 +121,19 @@ public:
    * \param [in] o The PacketTagList to copy.
    * \returns the copied object
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This copies the inline tags of \pname{o} and shares
+   * its overflow table.
    */
   inline PacketTagList &operator = (PacketTagList const &o);
   /**
    * Destructor
    *
-   * #RemoveAll's the tags up to the first merge.
+   * Releases the overflow table, if any.
    */
   inline ~PacketTagList ();
 
   /**
-   * Add a tag to the head of this branch.
+   * Add a tag to the list.
    *
    * \param [in] tag The tag to add
    */
@@ -230,67 +165,66 @@ public:
    */
   bool Peek (Tag &tag) const;
   /**
-   * Remove all tags from this list (up to the first merge).
+   * Create a copy of the list which shares no overflow table with it.
+   *
+   * The overflow table is shared through a reference count which is not
+   * thread-safe: a list handed to another thread must be a deep copy.
+   *
+   * \returns The copy.
+   */
+  PacketTagList CreateDeepCopy (void) const;
+  /**
+   * Remove all tags from this list.
    */
   inline void RemoveAll (void);
   /**
-   * \returns pointer to head of tag list
+   * \returns the number of tags in the list
+   */
+  inline uint32_t GetN (void) const;
+  /**
+   * \param [in] i The index of the tag, in the order the tags were added.
+   * \returns the tag
    */
-  const struct PacketTagList::TagData *Head (void) const;
+  inline const struct PacketTagList::TagData *Get (uint32_t i) const;
 
 private:
   /**
-   * Typedef of method function pointer for copy-on-write operations
-   *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True if operation successful, false otherwise
+   * Table of the tags beyond #INLINE_SIZE, shared by the copies
+   * of a list.
    */
-  typedef bool (PacketTagList::*COWWriter)
-    (Tag       & tag, bool         preMerge,
-    struct TagData * cur, struct TagData ** prevNext);
+  struct Overflow
+  {
+    uint32_t count;                   /**< Number of lists sharing the table */
+    std::vector<struct TagData> tags; /**< The tags, in the order they were added */
+  };
+
   /**
-   * Traverse the list implementing copy-on-write, using \pname{Writer}.
+   * Find a tag.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] Writer The copy-on-write function to use.
-   * \returns True if \pname{tag} found, false otherwise.
+   * \param [in] tid The type of the tag.
+   * \returns the index of the tag, #GetN if there is no such tag.
    */
-  bool COWTraverse   (Tag & tag, PacketTagList::COWWriter Writer);
+  uint32_t Find (TypeId tid) const;
   /**
-   * Copy-on-write implementing Remove.
+   * Get a tag for writing, copying the overflow table first if it
+   * is shared.
    *
-   * \param [in] tag The target tag type to remove.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag will definitely be removed.
+   * \param [in] i The index of the tag.
+   * \returns the tag
    */
-  bool RemoveWriter  (Tag       & tag, bool         preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  struct TagData *GetWritable (uint32_t i);
   /**
-   * Copy-on-write implementing Replace
-   *
-   * \param [in] tag The target tag type to replace
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *          false otherwise.
-   * \param [in] cur Pointer to the tag
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag value will definitely be replaced.
+   * Copy the overflow table if it is shared with another list.
    */
-  bool ReplaceWriter (Tag & tag, bool preMerge, struct TagData * cur, struct TagData ** prevNext);
-
+  void Unshare (void);
   /**
-   * Pointer to first \ref TagData on the list
+   * Release the overflow table, if any.
    */
-  struct TagData *m_next;
+  inline void ReleaseOverflow (void);
+
+  struct TagData m_tags[INLINE_SIZE]; //!< The first tags of the list
+  uint32_t m_size;                    //!< Number of tags in the list
+  struct Overflow *m_overflow;        //!< The other tags, or zero
 };
 
 } // namespace ns3
@@ -302,16 +236,23 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_size (0),
+    m_overflow (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_size (o.m_size),
+    m_overflow (o.m_overflow)
 {
-  if (m_next != 0)
+  // copy the used entries only
+  for (uint32_t i = 0; i < m_size && i < INLINE_SIZE; i++)
+    {
+      m_tags[i] = o.m_tags[i];
+    }
+  if (m_overflow != 0)
     {
-      m_next->count++;
+      m_overflow->count++;
     }
 }
 
@@ -319,46 +260,64 @@ PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
-  RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
+  if (o.m_overflow != 0)
     {
-      m_next->count++;
+      o.m_overflow->count++;
+    }
+  ReleaseOverflow ();
+  m_size = o.m_size;
+  m_overflow = o.m_overflow;
+  for (uint32_t i = 0; i < m_size && i < INLINE_SIZE; i++)
+    {
+      m_tags[i] = o.m_tags[i];
     }
   return *this;
 }
 
 PacketTagList::~PacketTagList ()
 {
-  RemoveAll ();
+  ReleaseOverflow ();
 }
 
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  ReleaseOverflow ();
+  m_size = 0;
+}
+
+uint32_t
+PacketTagList::GetN (void) const
+{
+  return m_size;
+}
+
+const struct PacketTagList::TagData *
+PacketTagList::Get (uint32_t i) const
+{
+  if (i < INLINE_SIZE)
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
-        {
-	  delete prev;
-        }
-      prev = cur;
+      return &m_tags[i];
     }
-  if (prev != 0) 
+  return &m_overflow->tags[i - INLINE_SIZE];
+}
+
+void
+PacketTagList::ReleaseOverflow (void)
+{
+  if (m_overflow != 0)
     {
-      delete prev;
+      m_overflow->count--;
+      if (m_overflow->count == 0)
+        {
+          delete m_overflow;
+        }
+      m_overflow = 0;
     }
-  m_next = 0;
 }
 
 } // namespace ns3
@@ -23,12 +23,13 @@
 #include "ns3/simulator.h"
 #include <string>
 #include <cstdarg>
+#include <algorithm>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
 
-uint32_t Packet::m_globalUid = 0;
+thread_local uint32_t Packet::m_globalUid = 0;
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -81,8 +82,9 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 }
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const PacketTagList *list)
+  : m_list (list),
+    m_current (list->GetN ())
 {
 }
 bool
@@ -94,9 +96,8 @@ PacketTagIterator::Item
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
-  const struct PacketTagList::TagData *prev = m_current;
-  m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  m_current--;
+  return PacketTagIterator::Item (m_list->Get (m_current));
 }
 
 PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
@@ -127,6 +128,22 @@ Packet::Copy (void) const
   return Ptr<Packet> (new Packet (*this), false);
 }
 
+Ptr<Packet>
+Packet::CreateDeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  ByteTagList byteTagList;
+  byteTagList.Add (m_byteTagList);
+  Ptr<Packet> copy (new Packet (m_buffer.CreateDeepCopy (), byteTagList,
+                                m_packetTagList.CreateDeepCopy (),
+                                m_metadata.CreateDeepCopy ()), false);
+  if (m_nixVector != 0)
+    {
+      copy->SetNixVector (m_nixVector->Copy ());
+    }
+  return copy;
+}
+
 Packet::Packet ()
   : m_buffer (),
     m_byteTagList (),
@@ -234,7 +251,22 @@ Packet::CreateFragment (uint32_t start, uint32_t length) const
   PacketMetadata metadata = m_metadata.CreateFragment (start, end);
   // again, call the constructor directly rather than
   // through Create because it is private.
-  return Ptr<Packet> (new Packet (buffer, m_byteTagList, m_packetTagList, metadata), false);
+  Ptr<Packet> fragment (new Packet (buffer, m_byteTagList, m_packetTagList, metadata), false);
+  fragment->AdjustByteTagsAfterRemove (m_buffer.GetCurrentStartOffset () + start);
+  return fragment;
+}
+
+void
+Packet::AdjustByteTagsAfterRemove (int32_t start)
+{
+  // The start offset of the buffer does not move by the number of
+  // bytes removed when virtual zero bytes or whole buffer fragments
+  // are removed: the byte tags must follow.
+  int32_t adjustment = m_buffer.GetCurrentStartOffset () - start;
+  if (adjustment != 0)
+    {
+      m_byteTagList.AddAtStart (adjustment, m_buffer.GetCurrentStartOffset ());
+    }
 }
 
 void
@@ -269,7 +301,9 @@ Packet::RemoveHeader (Header &header)
 {
   uint32_t deserialized = header.Deserialize (m_buffer.Begin ());
   NS_LOG_FUNCTION (this << header.GetInstanceTypeId ().GetName () << deserialized);
+  int32_t start = m_buffer.GetCurrentStartOffset () + deserialized;
   m_buffer.RemoveAtStart (deserialized);
+  AdjustByteTagsAfterRemove (start);
   m_metadata.RemoveHeader (header, deserialized);
   return deserialized;
 }
@@ -353,7 +387,9 @@ void
 Packet::RemoveAtStart (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
+  int32_t start = m_buffer.GetCurrentStartOffset () + std::min (size, m_buffer.GetSize ());
   m_buffer.RemoveAtStart (size);
+  AdjustByteTagsAfterRemove (start);
   m_metadata.RemoveAtStart (size);
 }
 
@@ -557,6 +593,15 @@ Packet::EnableChecking (void)
   PacketMetadata::EnableChecking ();
 }
 
+uint32_t
+Packet::ExchangeUidCounter (uint32_t uid)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  uint32_t old = m_globalUid;
+  m_globalUid = uid;
+  return old;
+}
+
 uint32_t Packet::GetSerializedSize (void) const
 {
   uint32_t size = 0;
@@ -893,7 +938,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (&m_packetTagList);
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
@@ -168,10 +168,11 @@ private:
   friend class Packet;
   /**
    * Constructor
-   * \param head head of the items
+   * \param list the tags of the packet
    */
-  PacketTagIterator (const struct PacketTagList::TagData *head);
-  const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
+  PacketTagIterator (const PacketTagList *list);
+  const PacketTagList *m_list;  //!< the tags of the packet
+  uint32_t m_current;  //!< number of tags left, the most recent first
 };
 
 /**
@@ -423,6 +424,18 @@ public:
    */
   Ptr<Packet> Copy (void) const;
 
+  /**
+   * \brief performs a deep copy of the packet.
+   *
+   * \returns a copy of the packet, with the same uid, bytes, metadata,
+   *          tags and nix vector, which shares nothing with the original.
+   *
+   * The copies made by Copy share their datasets through reference
+   * counts which are not thread-safe: a packet handed to another
+   * thread, as by ThreadedSimulatorImpl, must be a deep copy.
+   */
+  Ptr<Packet> CreateDeepCopy (void) const;
+
   /**
    * \brief Returns the packet's Uid.
    *
@@ -501,6 +514,17 @@ public:
    */
   static void EnableChecking (void);
 
+  /**
+   * \brief Replace the counter of packet uids of the calling thread.
+   *
+   * This is used by simulators which run several partitions on a
+   * thread, so that each partition numbers its packets on its own.
+   *
+   * \param uid the uid of the next packet created by this thread
+   * \returns the previous value of the counter
+   */
+  static uint32_t ExchangeUidCounter (uint32_t uid);
+
   /**
    * \brief Returns number of bytes required for packet
    * serialization.
@@ -628,6 +652,10 @@ public:
    * \brief Returns an object which can be used to iterate over the list of
    *  packet tags.
    *
+   * The tags are visited from the most recently added one.  The iterator
+   * refers to the tags of this packet: it must not be used after a tag
+   * is removed from the packet.
+   *
    * \returns an object which can be used to iterate over the list of
    *  packet tags.
    */
@@ -693,6 +721,13 @@ private:
 
   uint32_t Deserialize (uint8_t const*buffer, uint32_t size);
 
+  /**
+   * \brief Move the byte tags with the start offset of the buffer
+   * \param start the start offset the buffer would have if it
+   * followed the bytes removed at its start
+   */
+  void AdjustByteTagsAfterRemove (int32_t start);
+
   Buffer m_buffer;                //!< the packet buffer (it's actual contents)
   ByteTagList m_byteTagList;      //!< the ByteTag list
   PacketTagList m_packetTagList;  //!< the packet's Tag list
@@ -701,7 +736,12 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
-  static uint32_t m_globalUid; //!< Global counter of packets Uid
+  /**
+   * Counter of packets Uid, one per thread, which a threaded simulator
+   * swaps for the counter of the partition it runs. The Uid of a packet
+   * is unique when combined with the system id of its creator.
+   */
+  static thread_local uint32_t m_globalUid;
 };
 
 /**
@@ -22,6 +22,7 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/double.h"
 #include "ns3/test.h"
+#include <vector>
 
 using namespace ns3;
 
@@ -360,6 +361,117 @@ BufferTest::DoRun (void)
   val2 <<= 8;
   val2 |= i.ReadU8 ();
   NS_TEST_ASSERT_MSG_EQ (val1, val2, "Bad ReadNtohU16()");
+
+  // appended buffers are kept as fragments until their bytes are needed
+  Buffer head;
+  head.AddAtStart (2);
+  i = head.Begin ();
+  i.WriteU8 (0x1);
+  i.WriteU8 (0x2);
+  Buffer tail;
+  tail.AddAtStart (2);
+  i = tail.Begin ();
+  i.WriteU8 (0x3);
+  i.WriteU8 (0x4);
+  buffer = head;
+  buffer.AddAtEnd (Buffer (3));
+  buffer.AddAtEnd (tail);
+  buffer.AddAtEnd (buffer);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 14, "Bad size of fragmented buffer");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetCurrentEndOffset () - buffer.GetCurrentStartOffset (), 14,
+                         "Bad offsets of fragmented buffer");
+  uint8_t copied[14];
+  NS_TEST_ASSERT_MSG_EQ (buffer.CopyData (copied, 14), 14, "Bad copy of fragmented buffer");
+  uint8_t expected[14] = { 0x1, 0x2, 0x0, 0x0, 0x0, 0x3, 0x4, 0x1, 0x2, 0x0, 0x0, 0x0, 0x3, 0x4 };
+  NS_TEST_ASSERT_MSG_EQ (memcmp (copied, expected, 14), 0, "Bad content of fragmented buffer");
+  std::ostringstream oss;
+  buffer.CopyData (&oss, 14);
+  NS_TEST_ASSERT_MSG_EQ (oss.str (), std::string ((char *)expected, 14), "Bad stream copy of fragmented buffer");
+  // the appended buffers are not modified
+  ENSURE_WRITTEN_BYTES (head, 2, 0x1, 0x2);
+  ENSURE_WRITTEN_BYTES (tail, 2, 0x3, 0x4);
+
+  frag0 = buffer.CreateFragment (1, 8);
+  ENSURE_WRITTEN_BYTES (frag0, 8, 0x2, 0x0, 0x0, 0x0, 0x3, 0x4, 0x1, 0x2);
+  other = buffer;
+  other.RemoveAtStart (6);
+  other.RemoveAtEnd (5);
+  NS_TEST_ASSERT_MSG_EQ (other.GetSize (), 3, "Bad size after removing fragments");
+  ENSURE_WRITTEN_BYTES (other, 3, 0x4, 0x1, 0x2);
+  other = buffer;
+  other.RemoveAtEnd (14);
+  NS_TEST_ASSERT_MSG_EQ (other.GetSize (), 0, "Bad size after removing all fragments");
+
+  int32_t start = buffer.GetCurrentStartOffset ();
+  int32_t end = buffer.GetCurrentEndOffset ();
+  buffer.PeekData ();
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetCurrentStartOffset (), start,
+                         "Flattening a fragmented buffer must preserve its offsets");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetCurrentEndOffset (), end,
+                         "Flattening a fragmented buffer must preserve its offsets");
+  buffer.AddAtStart (1);
+  buffer.Begin ().WriteU8 (0xff);
+  ENSURE_WRITTEN_BYTES (buffer, 15, 0xff, 0x1, 0x2, 0x0, 0x0, 0x0, 0x3, 0x4, 0x1, 0x2, 0x0, 0x0, 0x0, 0x3, 0x4);
+}
+//-----------------------------------------------------------------------------
+/**
+ * The virtual zero area of a payload stays virtual when the payload is
+ * fragmented, reassembled, serialized and copied.
+ */
+class BufferZeroAreaTest : public TestCase {
+public:
+  virtual void DoRun (void);
+  BufferZeroAreaTest ();
+};
+
+BufferZeroAreaTest::BufferZeroAreaTest ()
+  : TestCase ("Buffer zero area footprint") {
+}
+
+void
+BufferZeroAreaTest::DoRun (void)
+{
+  const uint32_t size = 1000000;
+  Buffer::Footprint before = Buffer::GetFootprint ();
+  Buffer payload (size);
+
+  // fragment the payload, add a header to each fragment, as a transport
+  // protocol, then remove the headers and reassemble the payload
+  Buffer reassembled;
+  for (uint32_t offset = 0; offset < size; offset += 1000)
+    {
+      Buffer segment = payload.CreateFragment (offset, 1000);
+      segment.AddAtStart (20);
+      segment.Begin ().WriteU8 (0x45, 20);
+      segment.RemoveAtStart (20);
+      reassembled.AddAtEnd (segment);
+    }
+  NS_TEST_ASSERT_MSG_EQ (reassembled.GetSize (), size, "Bad size of reassembled payload");
+  reassembled.AddAtStart (8);
+  reassembled.Begin ().WriteU8 (0x11, 8);
+
+  std::vector<uint32_t> serialized (reassembled.GetSerializedSize () / 4 + 1);
+  NS_TEST_ASSERT_MSG_EQ (reassembled.Serialize (reinterpret_cast<uint8_t *> (&serialized[0]),
+                                                serialized.size () * 4), 1, "Serialize failed");
+  // as Packet, with the 4 bytes of the length of the serialized buffer
+  Buffer received;
+  received.Deserialize (reinterpret_cast<uint8_t *> (&serialized[0]), reassembled.GetSerializedSize () + 4);
+  NS_TEST_ASSERT_MSG_EQ (received.GetSize (), size + 8, "Bad size of deserialized payload");
+  std::ostringstream oss;
+  received.CopyData (&oss, received.GetSize ());
+  NS_TEST_ASSERT_MSG_EQ (oss.str ().size (), size + 8, "Bad size of copied payload");
+
+  Buffer::Footprint after = Buffer::GetFootprint ();
+  NS_TEST_ASSERT_MSG_EQ (after.m_materializedZeroBytes - before.m_materializedZeroBytes, 0,
+                         "Zero bytes written into memory");
+  NS_TEST_ASSERT_MSG_LT (after.m_dataBytes - before.m_dataBytes, size / 10,
+                         "The zero area must not be allocated");
+
+  // PeekData needs the zero bytes
+  received.PeekData ();
+  after = Buffer::GetFootprint ();
+  NS_TEST_ASSERT_MSG_EQ (after.m_materializedZeroBytes - before.m_materializedZeroBytes, size,
+                         "PeekData must write the zero area");
 }
 //-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
@@ -372,6 +484,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest, TestCase::QUICK);
+  AddTestCase (new BufferZeroAreaTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite;
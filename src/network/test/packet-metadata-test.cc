@@ -20,6 +20,7 @@
 #include <cstdarg>
 #include <iostream>
 #include <sstream>
+#include <vector>
 #include "ns3/test.h"
 #include "ns3/header.h"
 #include "ns3/trailer.h"
@@ -248,6 +249,51 @@ HistoryTrailer<N>::Deserialize (Buffer::Iterator start)
   return N;
 }
 
+/**
+ * A header which prints the two words it holds, to check what the
+ * metadata iterator reads.
+ */
+class PrintedHeader : public Header
+{
+public:
+  PrintedHeader () : m_a (0), m_b (0) {}
+  PrintedHeader (uint32_t a, uint32_t b) : m_a (a), m_b (b) {}
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::PrintedHeader")
+      .SetParent<Header> ()
+      .AddConstructor<PrintedHeader> ()
+    ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "a=" << m_a << " b=" << m_b;
+  }
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 8;
+  }
+  virtual void Serialize (Buffer::Iterator start) const
+  {
+    start.WriteHtonU32 (m_a);
+    start.WriteHtonU32 (m_b);
+  }
+  virtual uint32_t Deserialize (Buffer::Iterator start)
+  {
+    m_a = start.ReadNtohU32 ();
+    m_b = start.ReadNtohU32 ();
+    return 8;
+  }
+private:
+  uint32_t m_a;
+  uint32_t m_b;
+};
+
 }
 
 class PacketMetadataTest : public TestCase {
@@ -256,6 +302,8 @@ public:
   virtual ~PacketMetadataTest ();
   void CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual void DoRun (void);
+protected:
+  PacketMetadataTest (std::string name);
 private:
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
 };
@@ -265,6 +313,11 @@ PacketMetadataTest::PacketMetadataTest ()
 {
 }
 
+PacketMetadataTest::PacketMetadataTest (std::string name)
+  : TestCase (name)
+{
+}
+
 PacketMetadataTest::~PacketMetadataTest ()
 {
 }
@@ -822,6 +875,136 @@ PacketMetadataTest::DoRun (void)
   delete [] buf;
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
 }
+
+//-----------------------------------------------------------------------------
+/**
+ * Copies share the records of the metadata: changing, trimming or
+ * appending one packet must leave the history of the others intact.
+ */
+class PacketMetadataSharingTest : public PacketMetadataTest {
+public:
+  PacketMetadataSharingTest ();
+  virtual void DoRun (void);
+};
+
+PacketMetadataSharingTest::PacketMetadataSharingTest ()
+  : PacketMetadataTest ("Packet metadata shared between copies")
+{
+}
+
+void
+PacketMetadataSharingTest::DoRun (void)
+{
+  PacketMetadata::Enable ();
+
+  Ptr<Packet> p = Create<Packet> (10);
+  ADD_HEADER (p, 1);
+  ADD_HEADER (p, 2);
+  ADD_TRAILER (p, 3);
+
+  // copy, then let both sides diverge
+  Ptr<Packet> copy = p->Copy ();
+  ADD_HEADER (copy, 4);
+  ADD_TRAILER (copy, 5);
+  CHECK_HISTORY (copy, 6, 4, 2, 1, 10, 3, 5);
+  CHECK_HISTORY (p, 4, 2, 1, 10, 3);
+  REM_HEADER (p, 2);
+  REM_TRAILER (p, 3);
+  ADD_HEADER (p, 6);
+  CHECK_HISTORY (p, 3, 6, 1, 10);
+  CHECK_HISTORY (copy, 6, 4, 2, 1, 10, 3, 5);
+
+  // trim through the shared items
+  Ptr<Packet> trimmed = copy->Copy ();
+  trimmed->RemoveAtStart (5);
+  CHECK_HISTORY (trimmed, 5, 1, 1, 10, 3, 5);
+  trimmed->RemoveAtEnd (6);
+  CHECK_HISTORY (trimmed, 4, 1, 1, 10, 2);
+  CHECK_HISTORY (copy, 6, 4, 2, 1, 10, 3, 5);
+
+  // append fragments which share their records with the original
+  Ptr<Packet> first = copy->CreateFragment (0, 5);
+  Ptr<Packet> second = copy->CreateFragment (5, 20);
+  CHECK_HISTORY (first, 2, 4, 1);
+  CHECK_HISTORY (second, 5, 1, 1, 10, 3, 5);
+  first->AddAtEnd (second);
+  CHECK_HISTORY (first, 6, 4, 2, 1, 10, 3, 5);
+  CHECK_HISTORY (second, 5, 1, 1, 10, 3, 5);
+  CHECK_HISTORY (copy, 6, 4, 2, 1, 10, 3, 5);
+
+  // append a packet to itself
+  Ptr<Packet> twice = Create<Packet> (10);
+  ADD_HEADER (twice, 2);
+  twice->AddAtEnd (twice);
+  CHECK_HISTORY (twice, 4, 2, 10, 2, 10);
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Reassemble a packet whose header crosses the boundary of the buffer
+ * fragments joined by AddAtEnd: the metadata items must point into data
+ * which stays valid while the buffers allocated meanwhile are written.
+ */
+class PacketMetadataReassemblyTest : public TestCase {
+public:
+  PacketMetadataReassemblyTest ();
+  virtual void DoRun (void);
+};
+
+PacketMetadataReassemblyTest::PacketMetadataReassemblyTest ()
+  : TestCase ("Packet metadata of a header across reassembled fragments")
+{
+}
+
+void
+PacketMetadataReassemblyTest::DoRun (void)
+{
+  PacketMetadata::Enable ();
+
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (PrintedHeader (7, 2466058248U));
+
+  // the second fragment goes through the wire, as on another node
+  Ptr<Packet> first = p->CreateFragment (0, 4);
+  Ptr<Packet> second = p->CreateFragment (4, 104);
+  uint32_t size = second->GetSerializedSize ();
+  std::vector<uint8_t> wire (size);
+  second->Serialize (&wire[0], size);
+  first->AddAtEnd (Create<Packet> (&wire[0], size, true));
+
+  std::vector<PacketMetadata::Item> items;
+  PacketMetadata::ItemIterator k = first->BeginItem ();
+  while (k.HasNext ())
+    {
+      items.push_back (k.Next ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (items.size (), 2, "wrong number of items");
+  NS_TEST_ASSERT_MSG_EQ (items[0].type, PacketMetadata::Item::HEADER, "first item is not the header");
+  NS_TEST_ASSERT_MSG_EQ (items[0].isFragment, false, "header not merged back");
+
+  // take over and overwrite any data released by the iterator
+  std::vector<Buffer> others;
+  for (uint32_t i = 0; i < 16; i++)
+    {
+      Buffer other;
+      for (uint32_t j = 0; j < 256; j++)
+        {
+          other.AddAtStart (1);
+          other.Begin ().WriteU8 (0x55);
+        }
+      others.push_back (other);
+    }
+
+  PrintedHeader header;
+  header.Deserialize (items[0].current);
+  std::ostringstream oss;
+  header.Print (oss);
+  NS_TEST_EXPECT_MSG_EQ (oss.str (), "a=7 b=2466058248", "header read from released data");
+
+  oss.str ("");
+  first->Print (oss);
+  NS_TEST_EXPECT_MSG_EQ (oss.str (), "ns3::PrintedHeader (a=7 b=2466058248) Payload (size=100)", "wrong printed packet");
+}
 //-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
 {
@@ -833,6 +1016,8 @@ PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
   AddTestCase (new PacketMetadataTest, TestCase::QUICK);
+  AddTestCase (new PacketMetadataSharingTest, TestCase::QUICK);
+  AddTestCase (new PacketMetadataReassemblyTest, TestCase::QUICK);
 }
 
 PacketMetadataTestSuite g_packetMetadataTest;
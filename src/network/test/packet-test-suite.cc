@@ -508,6 +508,24 @@ PacketTest::DoRun (void)
     CHECK (tmp, 1, E (20, 1, 1001));
 #endif
   }
+
+  {
+    // byte tags of appended packets, kept as buffer fragments
+    Ptr<Packet> tmp = Create<Packet> (100);
+    tmp->AddHeader (ATestHeader<10> ());
+    tmp->AddByteTag (ATestTag<20> ());
+    Ptr<Packet> a = Create<Packet> (50);
+    a->AddByteTag (ATestTag<21> ());
+    tmp->AddAtEnd (a);
+    CHECK (tmp, 2, E (20, 0, 110), E (21, 110, 160));
+    tmp->RemoveAtStart (120);
+    CHECK (tmp, 1, E (21, 0, 40));
+    tmp->AddHeader (ATestHeader<4> ());
+    CHECK (tmp, 1, E (21, 4, 44));
+    tmp->RemoveAtEnd (20);
+    CHECK (tmp, 1, E (21, 4, 24));
+    NS_TEST_EXPECT_MSG_EQ (tmp->GetSize (), 24, "Bad size of appended packet");
+  }
 }
 //--------------------------------------
 class PacketTagListTest : public TestCase
@@ -731,6 +749,20 @@ PacketTagListTest::DoRun (void)
     ReplaceCheck (6);
     ReplaceCheck (7);
   }
+
+  { // Order
+    std::cout << GetName () << "check tags are kept in the order added"
+              << std::endl;
+    NS_TEST_EXPECT_MSG_EQ (ref.GetN (), (uint32_t)tagLast, "number of tags");
+    NS_TEST_EXPECT_MSG_EQ (ref.Get (0)->tid, t1.GetInstanceTypeId (), "first tag");
+    NS_TEST_EXPECT_MSG_EQ (ref.Get (tagLast - 1)->tid, t7.GetInstanceTypeId (), "last tag");
+    PacketTagList ptl = ref;
+    ptl.Remove (t2);
+    NS_TEST_EXPECT_MSG_EQ (ptl.GetN (), (uint32_t)tagLast - 1, "number of tags after remove");
+    NS_TEST_EXPECT_MSG_EQ (ptl.Get (1)->tid, t3.GetInstanceTypeId (), "tag after the removed one");
+    NS_TEST_EXPECT_MSG_EQ (ptl.Get (tagLast - 2)->tid, t7.GetInstanceTypeId (), "last tag after remove");
+    NS_TEST_EXPECT_MSG_EQ (ref.GetN (), (uint32_t)tagLast, "number of tags of the original");
+  }
   
   { // Timing
     std::cout << GetName () << "add+remove timing" << std::endl;
@@ -956,6 +956,135 @@ RecordHeaderTestCase::DoRun (void)
   f.Close ();
 }
 
+// ===========================================================================
+// Test case to make sure that the Pcap File Object writes the blocks of a
+// pcapng file with several interfaces.
+// ===========================================================================
+class PcapNgTestCase : public TestCase
+{
+public:
+  PcapNgTestCase ();
+  virtual ~PcapNgTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  std::string m_testFilename;
+};
+
+PcapNgTestCase::PcapNgTestCase ()
+  : TestCase ("Check to see that pcapng files are written correctly")
+{
+}
+
+PcapNgTestCase::~PcapNgTestCase ()
+{
+}
+
+void
+PcapNgTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_testFilename = CreateTempDirFilename (filename.str () + ".pcapng");
+}
+
+void
+PcapNgTestCase::DoTeardown (void)
+{
+  if (remove (m_testFilename.c_str ()))
+    {
+      NS_LOG_ERROR ("Failed to delete file " << m_testFilename);
+    }
+}
+
+void
+PcapNgTestCase::DoRun (void)
+{
+  PcapFile f;
+
+  f.Open (m_testFilename, std::ios::out);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << m_testFilename << 
+                         ", \"std::ios::out\") returns error");
+  f.InitNg ();
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "InitNg () returns error");
+
+  uint32_t if0 = f.AddInterface (9, 65535, "");
+  uint32_t if1 = f.AddInterface (1, 43, "eth0");
+  NS_TEST_ASSERT_MSG_EQ (if0, 0, "First interface id is not 0");
+  NS_TEST_ASSERT_MSG_EQ (if1, 1, "Second interface id is not 1");
+
+  uint8_t bufferOut[128];
+  for (uint32_t i = 0; i < 128; ++i)
+    {
+      bufferOut[i] = i;
+    }
+
+  //
+  // The packet of the second interface is limited to 43 bytes by its
+  // snapshot length.
+  //
+  f.Write (1, 2, bufferOut, 10, if0);
+  f.Write (4294, 967296, bufferOut, 128, if1);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Write (write-only-file " << m_testFilename << ") returns error");
+  f.Close ();
+
+  //
+  // The section header takes up 28 bytes, the interfaces 24 and 32 bytes
+  // (with the "eth0" option), and the packets 32 bytes each plus their data
+  // padded to 32 bits: 12 and 44 bytes.
+  //
+  NS_TEST_ASSERT_MSG_EQ (CheckFileLength (m_testFilename, 28 + 24 + 32 + 44 + 76), true,
+                         "Pcapng file with two interfaces and two packets is incorrect size");
+
+  FILE *p = std::fopen (m_testFilename.c_str (), "r+b");
+  NS_TEST_ASSERT_MSG_NE (p, 0, "fopen() should have been able to open a correctly created pcapng file");
+
+  //
+  // The blocks are written in the byte order of the writing system, which
+  // the byte order magic of the section header tells.
+  //
+  uint32_t blocks[37];
+  size_t result = std::fread (blocks, sizeof (blocks), 1, p);
+  NS_TEST_ASSERT_MSG_EQ (result, 1, "Unable to fread() the blocks");
+  std::fclose (p);
+
+  NS_TEST_ASSERT_MSG_EQ (blocks[0], 0x0a0d0d0a, "Section header block type written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[1], 28, "Section header length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[2], 0x1a2b3c4d, "Byte order magic written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[6], 28, "Section header trailing length written incorrectly");
+
+  NS_TEST_ASSERT_MSG_EQ (blocks[7], 1, "Interface block type written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[8], 24, "Interface length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[10], 65535, "Interface snap length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[11], 0, "Interface end of options written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[12], 24, "Interface trailing length written incorrectly");
+
+  NS_TEST_ASSERT_MSG_EQ (blocks[13], 1, "Interface block type written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[14], 32, "Interface length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[16], 43, "Interface snap length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (std::memcmp (&blocks[18], "eth0", 4), 0, "Interface name written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[20], 32, "Interface trailing length written incorrectly");
+
+  NS_TEST_ASSERT_MSG_EQ (blocks[21], 6, "Packet block type written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[22], 44, "Packet length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[23], 0, "Packet interface written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[24], 0, "Packet timestamp (high) written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[25], 1000002, "Packet timestamp (low) written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[26], 10, "Packet captured length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[27], 10, "Packet original length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[31], 44, "Packet trailing length written incorrectly");
+
+  NS_TEST_ASSERT_MSG_EQ (blocks[32], 6, "Packet block type written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[33], 76, "Packet length written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[34], 1, "Packet interface written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[35], 1, "Packet timestamp (high) written incorrectly");
+  NS_TEST_ASSERT_MSG_EQ (blocks[36], 0, "Packet timestamp (low) written incorrectly");
+}
+
 // ===========================================================================
 // Test case to make sure that the Pcap File Object can read out the contents
 // of a known good pcap file.
@@ -1136,6 +1265,7 @@ PcapFileTestSuite::PcapFileTestSuite ()
   //AddTestCase (new AppendModeCreateTestCase, TestCase::QUICK);
   AddTestCase (new FileHeaderTestCase, TestCase::QUICK);
   AddTestCase (new RecordHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new PcapNgTestCase, TestCase::QUICK);
   AddTestCase (new ReadFileTestCase, TestCase::QUICK);
   AddTestCase (new DiffTestCase, TestCase::QUICK);
 }
@@ -46,6 +46,8 @@ PcapFileWrapper::GetTypeId (void)
 
 
 PcapFileWrapper::PcapFileWrapper ()
+  : m_interface (0),
+    m_dataLinkType (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -80,6 +82,7 @@ void
 PcapFileWrapper::Close (void)
 {
   NS_LOG_FUNCTION (this);
+  m_ngFile = 0;
   m_file.Close ();
 }
 
@@ -109,6 +112,29 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
     } 
 }
 
+void
+PcapFileWrapper::InitNg (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_file.InitNg ();
+}
+
+void
+PcapFileWrapper::OpenInterface (Ptr<PcapFileWrapper> file, std::string const &name,
+                                uint32_t dataLinkType, uint32_t snapLen)
+{
+  NS_LOG_FUNCTION (this << file << name << dataLinkType << snapLen);
+  if (snapLen == std::numeric_limits<uint32_t>::max ())
+    {
+      snapLen = m_snapLen;
+    }
+  m_ngFile = file;
+  m_dataLinkType = dataLinkType;
+  m_snapLen = snapLen;
+  std::lock_guard<std::mutex> lock (m_ngFile->m_mutex);
+  m_interface = m_ngFile->m_file.AddInterface (dataLinkType, snapLen, name);
+}
+
 void
 PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
 {
@@ -117,6 +143,12 @@ PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
+  if (m_ngFile != 0)
+    {
+      std::lock_guard<std::mutex> lock (m_ngFile->m_mutex);
+      m_ngFile->m_file.Write (s, us, p, m_interface);
+      return;
+    }
   m_file.Write (s, us, p);
 }
 
@@ -128,6 +160,12 @@ PcapFileWrapper::Write (Time t, Header &header, Ptr<const Packet> p)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
+  if (m_ngFile != 0)
+    {
+      std::lock_guard<std::mutex> lock (m_ngFile->m_mutex);
+      m_ngFile->m_file.Write (s, us, header, p, m_interface);
+      return;
+    }
   m_file.Write (s, us, header, p);
 }
 
@@ -139,6 +177,12 @@ PcapFileWrapper::Write (Time t, uint8_t const *buffer, uint32_t length)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
+  if (m_ngFile != 0)
+    {
+      std::lock_guard<std::mutex> lock (m_ngFile->m_mutex);
+      m_ngFile->m_file.Write (s, us, buffer, length, m_interface);
+      return;
+    }
   m_file.Write (s, us, buffer, length);
 }
 
@@ -181,6 +225,10 @@ uint32_t
 PcapFileWrapper::GetSnapLen (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_ngFile != 0)
+    {
+      return m_snapLen;
+    }
   return m_file.GetSnapLen ();
 }
 
@@ -188,6 +236,10 @@ uint32_t
 PcapFileWrapper::GetDataLinkType (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_ngFile != 0)
+    {
+      return m_dataLinkType;
+    }
   return m_file.GetDataLinkType ();
 }
 
@@ -22,6 +22,7 @@
 #include <cstring>
 #include <limits>
 #include <fstream>
+#include <mutex>
 #include "ns3/ptr.h"
 #include "ns3/packet.h"
 #include "ns3/object.h"
@@ -109,6 +110,31 @@ public:
              uint32_t snapLen = std::numeric_limits<uint32_t>::max (), 
              int32_t tzCorrection = PcapFile::ZONE_DEFAULT);
 
+  /**
+   * Initialize the file associated with this wrapper as a pcapng file, to
+   * which other wrappers add their interface with OpenInterface.  This file
+   * must have been previously opened with write permissions.
+   */
+  void InitNg (void);
+
+  /**
+   * Write to an interface of a pcapng file instead of a file of this
+   * wrapper: the packets of all the interfaces are written, in the order
+   * of the calls to Write, to a single file.  The pcapng file is closed
+   * with the last wrapper which uses it.
+   *
+   * \param file The pcapng file, initialized with InitNg.
+   *
+   * \param name The name of the interface.
+   *
+   * \param dataLinkType The data link type of the interface, as for Init.
+   *
+   * \param snapLen An optional maximum size for the packets of the
+   * interface.  Defaults to the "CaptureSize" attribute of this wrapper.
+   */
+  void OpenInterface (Ptr<PcapFileWrapper> file, std::string const &name, uint32_t dataLinkType,
+                      uint32_t snapLen = std::numeric_limits<uint32_t>::max ());
+
   /**
    * \brief Write the next packet to file
    * 
@@ -198,7 +224,8 @@ public:
    *
    * See http://wiki.wireshark.org/Development/LibpcapFileFormat
    *
-   * \returns max length of saved packets field
+   * \returns max length of saved packets field, or of the packets of the
+   * interface opened with OpenInterface
    */ 
   uint32_t GetSnapLen (void);
 
@@ -208,13 +235,18 @@ public:
    *
    * See http://wiki.wireshark.org/Development/LibpcapFileFormat
    *
-   * \returns data link type field
+   * \returns data link type field, or the data link type of the interface
+   * opened with OpenInterface
    */ 
   uint32_t GetDataLinkType (void);
 
 private:
   PcapFile m_file; //!< Pcap file
   uint32_t m_snapLen; //!< max length of saved packets
+  Ptr<PcapFileWrapper> m_ngFile; //!< pcapng file of the interface, if any
+  uint32_t m_interface; //!< interface id in m_ngFile
+  uint32_t m_dataLinkType; //!< data link type of the interface
+  std::mutex m_mutex; //!< serializes the interfaces written by several threads
 };
 
 } // namespace ns3
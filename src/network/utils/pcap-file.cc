@@ -20,6 +20,9 @@
 
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <deque>
+#include "ns3/core-config.h"
 #include "ns3/assert.h"
 #include "ns3/packet.h"
 #include "ns3/fatal-error.h"
@@ -28,6 +31,14 @@
 #include "ns3/buffer.h"
 #include "pcap-file.h"
 #include "ns3/log.h"
+#ifdef HAVE_PTHREAD_H
+#include <set>
+#include <new>
+#include <mutex>
+#include <condition_variable>
+#include <pthread.h>
+#include "ns3/system-thread.h"
+#endif /* HAVE_PTHREAD_H */
 //
 // This file is used as part of the ns-3 test framework, so please refrain from 
 // adding any ns-3 specific constructs such as Packet to this file.
@@ -46,18 +57,324 @@ const uint32_t NS_SWAPPED_MAGIC = 0xd43cb2a1; /**< Looks this way if byte swappi
 const uint16_t VERSION_MAJOR = 2;             /**< Major version of supported pcap file format */
 const uint16_t VERSION_MINOR = 4;             /**< Minor version of supported pcap file format */
 
+const uint32_t NG_SECTION_HEADER = 0x0a0d0d0a;      /**< Block type of a pcapng section header */
+const uint32_t NG_INTERFACE_DESCRIPTION = 1;        /**< Block type of a pcapng interface */
+const uint32_t NG_ENHANCED_PACKET = 6;              /**< Block type of a pcapng packet */
+const uint32_t NG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;    /**< Byte order of a pcapng section */
+const uint16_t NG_VERSION_MAJOR = 1;                /**< Major version of the pcapng format */
+const uint16_t NG_VERSION_MINOR = 0;                /**< Minor version of the pcapng format */
+const uint16_t NG_OPTION_END = 0;                   /**< End of the options of a pcapng block */
+const uint16_t NG_OPTION_IF_NAME = 2;               /**< Name of a pcapng interface */
+
+const uint32_t BATCH_SIZE = 32 * 1024;        /**< Size of the batches handed over to the writer thread */
+const uint32_t MAX_QUEUED = 16 * 1024 * 1024; /**< Bytes queued to the writer thread before the simulation waits */
+
+/**
+ * \brief Write a value in a record, in the byte order of the system
+ * \param buffer where to write
+ * \param value the value
+ * \returns the end of the value in buffer
+ */
+static uint8_t *
+Put16 (uint8_t *buffer, uint16_t value)
+{
+  std::memcpy (buffer, &value, sizeof (value));
+  return buffer + sizeof (value);
+}
+/**
+ * \copydoc Put16
+ */
+static uint8_t *
+Put32 (uint8_t *buffer, uint32_t value)
+{
+  std::memcpy (buffer, &value, sizeof (value));
+  return buffer + sizeof (value);
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * \brief The thread which writes the batches of records of the files
+ * opened for writing only.
+ *
+ * A single thread serves all the files, in the order in which the
+ * batches are handed over.  The queue is locked once per batch, not
+ * once per record, and the written batches are recycled.
+ */
+class PcapWriter
+{
+public:
+  /**
+   * \returns the writer, which is never destroyed, so that the files
+   * closed at exit do not depend on the order of the static destructors.
+   */
+  static PcapWriter *Get (void);
+  /**
+   * Add a file opened for writing only.
+   *
+   * \param file the file
+   */
+  void Ref (PcapFile *file);
+  /**
+   * Remove a file, and stop the thread with the last one.
+   *
+   * \param file the file
+   */
+  void Unref (PcapFile *file);
+  /**
+   * Queue a batch, or wait for the queue to drain when the writer
+   * lags too far behind.  The thread is started with the first batch.
+   *
+   * \param file the file to write to
+   * \param pending the count of queued batches of the file
+   * \param batch [in,out] the batch, swapped with an empty one
+   * \param size the bytes used in batch
+   */
+  void Submit (std::fstream *file, uint32_t *pending, std::vector<uint8_t> &batch, uint32_t size);
+  /**
+   * Wait for the queued batches of a file to be written.
+   *
+   * \param pending the count of queued batches of the file
+   */
+  void Sync (uint32_t const *pending);
+
+private:
+  PcapWriter ();
+  /** Write the queued batches until there are no more files. */
+  void Run (void);
+
+  /**
+   * Write the pending records of all the files, on abnormal exit and
+   * before fork (): their streams are not registered with FatalImpl, as
+   * the thread writes them.
+   */
+  static void SyncAll (void);
+  /**
+   * Before fork (): write the pending records and flush the files, so
+   * that the child does not inherit them, and keep the writer locked
+   * until the fork is done.
+   */
+  static void PrepareFork (void);
+  /** After fork (), in the parent: release the writer. */
+  static void ParentFork (void);
+  /**
+   * After fork (), in the child: the thread did not survive the fork.
+   * It is started again with the next batch.
+   */
+  static void ChildFork (void);
+
+  /** A batch of records of a file */
+  struct Batch
+  {
+    std::fstream *file;             //!< the file to write to
+    uint32_t *pending;              //!< the count of queued batches of the file
+    std::vector<uint8_t> records;   //!< the records
+    uint32_t size;                  //!< the bytes used in records
+  };
+
+  std::mutex m_mutex;               //!< protects the members below
+  std::condition_variable m_queued; //!< signaled when a batch is queued or the thread stops
+  std::condition_variable m_written;//!< signaled when a batch is written
+  std::deque<Batch> m_queue;        //!< the batches to write
+  std::vector<std::vector<uint8_t> > m_free; //!< the written batches
+  uint32_t m_queuedBytes;           //!< the bytes queued and not yet written
+  std::set<PcapFile *> m_files;     //!< the files opened for writing only
+  bool m_stop;                      //!< the thread has to exit
+  std::mutex m_startStop;           //!< serializes Ref, Unref and fork ()
+  Ptr<SystemThread> m_thread;       //!< the thread, if started
+};
+
+PcapWriter *
+PcapWriter::Get (void)
+{
+  static PcapWriter *writer = new PcapWriter ();
+  return writer;
+}
+
+PcapWriter::PcapWriter ()
+  : m_queuedBytes (0),
+    m_stop (false)
+{
+  FatalImpl::RegisterHook (&PcapWriter::SyncAll);
+  pthread_atfork (&PcapWriter::PrepareFork, &PcapWriter::ParentFork, &PcapWriter::ChildFork);
+}
+
+void
+PcapWriter::Ref (PcapFile *file)
+{
+  // wait for the thread of the previous files to exit
+  std::lock_guard<std::mutex> startStop (m_startStop);
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_files.insert (file);
+}
+
+void
+PcapWriter::Unref (PcapFile *file)
+{
+  std::lock_guard<std::mutex> startStop (m_startStop);
+  Ptr<SystemThread> thread;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_files.erase (file);
+    if (!m_files.empty () || m_thread == 0)
+      {
+        return;
+      }
+    m_stop = true;
+    m_queued.notify_one ();
+    thread = m_thread;
+    m_thread = 0;
+  }
+  thread->Join ();
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_stop = false;
+}
+
+void
+PcapWriter::Submit (std::fstream *file, uint32_t *pending, std::vector<uint8_t> &batch, uint32_t size)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  if (m_thread == 0)
+    {
+      m_thread = Create<SystemThread> (MakeCallback (&PcapWriter::Run, this));
+      m_thread->Start ();
+    }
+  while (m_queuedBytes > MAX_QUEUED)
+    {
+      m_written.wait (lock);
+    }
+  m_queue.push_back (Batch ());
+  Batch &queued = m_queue.back ();
+  queued.file = file;
+  queued.pending = pending;
+  queued.records.swap (batch);
+  queued.size = size;
+  if (!m_free.empty ())
+    {
+      batch.swap (m_free.back ());
+      m_free.pop_back ();
+    }
+  m_queuedBytes += size;
+  (*pending)++;
+  m_queued.notify_one ();
+}
+
+void
+PcapWriter::Sync (uint32_t const *pending)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (*pending > 0)
+    {
+      m_written.wait (lock);
+    }
+}
+
+void
+PcapWriter::Run (void)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      while (m_queue.empty () && !m_stop)
+        {
+          m_queued.wait (lock);
+        }
+      if (m_queue.empty ())
+        {
+          return;
+        }
+      Batch batch;
+      batch.file = m_queue.front ().file;
+      batch.pending = m_queue.front ().pending;
+      batch.records.swap (m_queue.front ().records);
+      batch.size = m_queue.front ().size;
+      m_queue.pop_front ();
+
+      lock.unlock ();
+      batch.file->write ((const char *)&batch.records[0], batch.size);
+      lock.lock ();
+
+      m_queuedBytes -= batch.size;
+      (*batch.pending)--;
+      if (m_free.size () < 16)
+        {
+          m_free.push_back (std::vector<uint8_t> ());
+          m_free.back ().swap (batch.records);
+        }
+      m_written.notify_all ();
+    }
+}
+
+void
+PcapWriter::SyncAll (void)
+{
+  PcapWriter *writer = Get ();
+  std::set<PcapFile *> files;
+  {
+    std::lock_guard<std::mutex> lock (writer->m_mutex);
+    files = writer->m_files;
+  }
+  for (std::set<PcapFile *>::const_iterator i = files.begin (); i != files.end (); ++i)
+    {
+      (*i)->Sync ();
+      (*i)->m_file.flush ();
+    }
+}
+
+void
+PcapWriter::PrepareFork (void)
+{
+  SyncAll ();
+  PcapWriter *writer = Get ();
+  writer->m_startStop.lock ();
+  std::unique_lock<std::mutex> lock (writer->m_mutex);
+  while (writer->m_queuedBytes > 0)
+    {
+      writer->m_written.wait (lock);
+    }
+  for (std::set<PcapFile *>::const_iterator i = writer->m_files.begin (); i != writer->m_files.end (); ++i)
+    {
+      (*i)->m_file.flush ();
+    }
+  // unlocked by ParentFork or ChildFork
+  lock.release ();
+}
+
+void
+PcapWriter::ParentFork (void)
+{
+  PcapWriter *writer = Get ();
+  writer->m_mutex.unlock ();
+  writer->m_startStop.unlock ();
+}
+
+void
+PcapWriter::ChildFork (void)
+{
+  PcapWriter *writer = Get ();
+  writer->m_thread = 0;
+  writer->m_stop = false;
+  // the parent thread may have been waiting on them
+  new (&writer->m_queued) std::condition_variable ();
+  new (&writer->m_written) std::condition_variable ();
+  writer->m_mutex.unlock ();
+  writer->m_startStop.unlock ();
+}
+#endif /* HAVE_PTHREAD_H */
+
 PcapFile::PcapFile ()
   : m_file (),
-    m_swapMode (false)
+    m_swapMode (false),
+    m_batchSize (0),
+    m_async (false),
+    m_pending (0),
+    m_ng (false)
 {
   NS_LOG_FUNCTION (this);
-  FatalImpl::RegisterStream (&m_file);
 }
 
 PcapFile::~PcapFile ()
 {
   NS_LOG_FUNCTION (this);
-  FatalImpl::UnregisterStream (&m_file);
   Close ();
 }
 
@@ -66,18 +383,22 @@ bool
 PcapFile::Fail (void) const
 {
   NS_LOG_FUNCTION (this);
+  // writing the pending records does not change the content of the file
+  const_cast<PcapFile *> (this)->Sync ();
   return m_file.fail ();
 }
 bool 
 PcapFile::Eof (void) const
 {
   NS_LOG_FUNCTION (this);
+  const_cast<PcapFile *> (this)->Sync ();
   return m_file.eof ();
 }
 void 
 PcapFile::Clear (void)
 {
   NS_LOG_FUNCTION (this);
+  Sync ();
   m_file.clear ();
 }
 
@@ -86,9 +407,67 @@ void
 PcapFile::Close (void)
 {
   NS_LOG_FUNCTION (this);
+  Sync ();
+#ifdef HAVE_PTHREAD_H
+  if (m_async)
+    {
+      PcapWriter::Get ()->Unref (this);
+      m_async = false;
+    }
+#endif /* HAVE_PTHREAD_H */
+  FatalImpl::UnregisterStream (&m_file);
   m_file.close ();
 }
 
+uint8_t *
+PcapFile::Reserve (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_batchSize + size > m_batch.size ())
+    {
+      // grow with the traffic of the file, up to about a batch
+      m_batch.resize (std::max<size_t> (m_batchSize + size, 2 * m_batch.size ()));
+    }
+  uint8_t *start = &m_batch[m_batchSize];
+  m_batchSize += size;
+  return start;
+}
+
+void
+PcapFile::EndRecord (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_async)
+    {
+      m_file.write ((const char *)&m_batch[0], m_batchSize);
+      m_batchSize = 0;
+    }
+#ifdef HAVE_PTHREAD_H
+  else if (m_batchSize >= BATCH_SIZE)
+    {
+      PcapWriter::Get ()->Submit (&m_file, &m_pending, m_batch, m_batchSize);
+      m_batchSize = 0;
+    }
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+PcapFile::Sync (void)
+{
+  NS_LOG_FUNCTION (this);
+#ifdef HAVE_PTHREAD_H
+  if (m_async)
+    {
+      if (m_batchSize > 0)
+        {
+          PcapWriter::Get ()->Submit (&m_file, &m_pending, m_batch, m_batchSize);
+          m_batchSize = 0;
+        }
+      PcapWriter::Get ()->Sync (&m_pending);
+    }
+#endif /* HAVE_PTHREAD_H */
+}
+
 uint32_t
 PcapFile::GetMagic (void)
 {
@@ -197,6 +576,8 @@ PcapFile::WriteFileHeader (void)
   // If we're initializing the file, we need to write the pcap file header
   // at the start of the file.
   //
+  Sync ();
+  m_batchSize = 0;
   m_file.seekp (0, std::ios::beg);
  
   //
@@ -225,13 +606,15 @@ PcapFile::WriteFileHeader (void)
   // Watch out for memory alignment differences between machines, so write
   // them all individually.
   //
-  m_file.write ((const char *)&headerOut->m_magicNumber, sizeof(headerOut->m_magicNumber));
-  m_file.write ((const char *)&headerOut->m_versionMajor, sizeof(headerOut->m_versionMajor));
-  m_file.write ((const char *)&headerOut->m_versionMinor, sizeof(headerOut->m_versionMinor));
-  m_file.write ((const char *)&headerOut->m_zone, sizeof(headerOut->m_zone));
-  m_file.write ((const char *)&headerOut->m_sigFigs, sizeof(headerOut->m_sigFigs));
-  m_file.write ((const char *)&headerOut->m_snapLen, sizeof(headerOut->m_snapLen));
-  m_file.write ((const char *)&headerOut->m_type, sizeof(headerOut->m_type));
+  uint8_t *start = Reserve (24);
+  start = Put32 (start, headerOut->m_magicNumber);
+  start = Put16 (start, headerOut->m_versionMajor);
+  start = Put16 (start, headerOut->m_versionMinor);
+  start = Put32 (start, headerOut->m_zone);
+  start = Put32 (start, headerOut->m_sigFigs);
+  start = Put32 (start, headerOut->m_snapLen);
+  Put32 (start, headerOut->m_type);
+  EndRecord ();
 }
 
 void
@@ -323,6 +706,19 @@ PcapFile::Open (std::string const &filename, std::ios::openmode mode)
       // will set the fail bit if file header is invalid.
       ReadAndVerifyFileHeader ();
     }
+#ifdef HAVE_PTHREAD_H
+  else if ((mode & std::ios::out) && !m_file.fail () && !m_async)
+    {
+      // nothing but this object uses the stream until Close, and the
+      // writer writes the pending records on abnormal exit
+      PcapWriter::Get ()->Ref (this);
+      m_async = true;
+    }
+#endif /* HAVE_PTHREAD_H */
+  if (!m_async)
+    {
+      FatalImpl::RegisterStream (&m_file);
+    }
 }
 
 void
@@ -366,17 +762,118 @@ PcapFile::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t timeZoneCorrect
   // And set swap mode if requested or we are on a big-endian system.
   //
   m_swapMode = swapMode | bigEndian;
+  m_ng = false;
 
   WriteFileHeader ();
 }
 
+void
+PcapFile::InitNg (void)
+{
+  NS_LOG_FUNCTION (this);
+  //
+  // The in-memory file header describes the section.  The snapshot length
+  // and the data link type are those of each interface.
+  //
+  m_fileHeader.m_magicNumber = NG_SECTION_HEADER;
+  m_fileHeader.m_versionMajor = NG_VERSION_MAJOR;
+  m_fileHeader.m_versionMinor = NG_VERSION_MINOR;
+  m_fileHeader.m_zone = 0;
+  m_fileHeader.m_sigFigs = 0;
+  m_fileHeader.m_snapLen = 0;
+  m_fileHeader.m_type = 0;
+  m_swapMode = false;
+  m_ng = true;
+  m_interfaceSnapLen.clear ();
+
+  Sync ();
+  m_batchSize = 0;
+  m_file.seekp (0, std::ios::beg);
+
+  //
+  // A section header without options, of unknown length
+  //
+  uint8_t *start = Reserve (28);
+  start = Put32 (start, NG_SECTION_HEADER);
+  start = Put32 (start, 28);
+  start = Put32 (start, NG_BYTE_ORDER_MAGIC);
+  start = Put16 (start, NG_VERSION_MAJOR);
+  start = Put16 (start, NG_VERSION_MINOR);
+  start = Put32 (start, 0xffffffff);
+  start = Put32 (start, 0xffffffff);
+  Put32 (start, 28);
+  EndRecord ();
+}
+
 uint32_t
-PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen)
+PcapFile::AddInterface (uint32_t dataLinkType, uint32_t snapLen, std::string const &name)
 {
-  NS_LOG_FUNCTION (this << tsSec << tsUsec << totalLen);
-  NS_ASSERT (m_file.good ());
+  NS_LOG_FUNCTION (this << dataLinkType << snapLen << name);
+  NS_ASSERT_MSG (m_ng, "PcapFile::AddInterface(): not a pcapng file");
+
+  uint32_t nameLen = name.size ();
+  uint32_t namePadding = (4 - nameLen % 4) % 4;
+  uint32_t blockLen = 20 + 4;
+  if (nameLen > 0)
+    {
+      blockLen += 4 + nameLen + namePadding;
+    }
+
+  uint8_t *start = Reserve (blockLen);
+  start = Put32 (start, NG_INTERFACE_DESCRIPTION);
+  start = Put32 (start, blockLen);
+  start = Put16 (start, dataLinkType);
+  start = Put16 (start, 0);
+  start = Put32 (start, snapLen);
+  if (nameLen > 0)
+    {
+      start = Put16 (start, NG_OPTION_IF_NAME);
+      start = Put16 (start, nameLen);
+      std::memcpy (start, name.data (), nameLen);
+      std::memset (start + nameLen, 0, namePadding);
+      start += nameLen + namePadding;
+    }
+  start = Put16 (start, NG_OPTION_END);
+  start = Put16 (start, 0);
+  Put32 (start, blockLen);
+  EndRecord ();
+
+  m_interfaceSnapLen.push_back (snapLen);
+  return m_interfaceSnapLen.size () - 1;
+}
+
+uint8_t *
+PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen,
+                             uint32_t interfaceId, uint32_t &inclLen)
+{
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << totalLen << interfaceId);
+  // the stream of an asynchronous file belongs to the writer thread
+  NS_ASSERT (m_async || m_file.good ());
+
+  if (m_ng)
+    {
+      NS_ASSERT_MSG (interfaceId < m_interfaceSnapLen.size (),
+                     "PcapFile::WritePacketHeader(): unknown interface " << interfaceId);
+      uint32_t snapLen = m_interfaceSnapLen[interfaceId];
+      inclLen = totalLen > snapLen ? snapLen : totalLen;
+      uint32_t padding = (4 - inclLen % 4) % 4;
+      uint32_t blockLen = 32 + inclLen + padding;
+      uint64_t ts = tsSec * static_cast<uint64_t> (1000000) + tsUsec;
+
+      uint8_t *start = Reserve (blockLen);
+      start = Put32 (start, NG_ENHANCED_PACKET);
+      start = Put32 (start, blockLen);
+      start = Put32 (start, interfaceId);
+      start = Put32 (start, ts >> 32);
+      start = Put32 (start, ts & 0xffffffff);
+      start = Put32 (start, inclLen);
+      start = Put32 (start, totalLen);
+      std::memset (start + inclLen, 0, padding);
+      Put32 (start + inclLen + padding, blockLen);
+      return start;
+    }
 
-  uint32_t inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
+  inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
 
   PcapRecordHeader header;
   header.m_tsSec = tsSec;
@@ -393,44 +890,52 @@ PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen)
   // Watch out for memory alignment differences between machines, so write
   // them all individually.
   //
-  m_file.write ((const char *)&header.m_tsSec, sizeof(header.m_tsSec));
-  m_file.write ((const char *)&header.m_tsUsec, sizeof(header.m_tsUsec));
-  m_file.write ((const char *)&header.m_inclLen, sizeof(header.m_inclLen));
-  m_file.write ((const char *)&header.m_origLen, sizeof(header.m_origLen));
-  return inclLen;
+  uint8_t *start = Reserve (16 + inclLen);
+  start = Put32 (start, header.m_tsSec);
+  start = Put32 (start, header.m_tsUsec);
+  start = Put32 (start, header.m_inclLen);
+  start = Put32 (start, header.m_origLen);
+  return start;
 }
 
 void
-PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen)
+PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen,
+                 uint32_t interfaceId)
 {
-  NS_LOG_FUNCTION (this << tsSec << tsUsec << &data << totalLen);
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, totalLen);
-  m_file.write ((const char *)data, inclLen);
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << &data << totalLen << interfaceId);
+  uint32_t inclLen;
+  uint8_t *start = WritePacketHeader (tsSec, tsUsec, totalLen, interfaceId, inclLen);
+  std::memcpy (start, data, inclLen);
+  EndRecord ();
 }
 
 void 
-PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p)
+PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p, uint32_t interfaceId)
 {
-  NS_LOG_FUNCTION (this << tsSec << tsUsec << p);
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, p->GetSize ());
-  p->CopyData (&m_file, inclLen);
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << p << interfaceId);
+  uint32_t inclLen;
+  uint8_t *start = WritePacketHeader (tsSec, tsUsec, p->GetSize (), interfaceId, inclLen);
+  p->CopyData (start, inclLen);
+  EndRecord ();
 }
 
 void 
-PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p)
+PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p,
+                 uint32_t interfaceId)
 {
-  NS_LOG_FUNCTION (this << tsSec << tsUsec << &header << p);
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << &header << p << interfaceId);
   uint32_t headerSize = header.GetSerializedSize ();
   uint32_t totalSize = headerSize + p->GetSize ();
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, totalSize);
+  uint32_t inclLen;
+  uint8_t *start = WritePacketHeader (tsSec, tsUsec, totalSize, interfaceId, inclLen);
 
   Buffer headerBuffer;
   headerBuffer.AddAtStart (headerSize);
   header.Serialize (headerBuffer.Begin ());
   uint32_t toCopy = std::min (headerSize, inclLen);
-  headerBuffer.CopyData (&m_file, toCopy);
-  inclLen -= toCopy;
-  p->CopyData (&m_file, inclLen);
+  headerBuffer.CopyData (start, toCopy);
+  p->CopyData (start + toCopy, inclLen - toCopy);
+  EndRecord ();
 }
 
 void
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
 #include <stdint.h>
 #include "ns3/ptr.h"
 
@@ -38,6 +39,17 @@ class Header;
  * A class representing a pcap file.  This allows easy creation, writing and 
  * reading of files composed of stored packets; which may be viewed using
  * standard tools.
+ *
+ * The records of a file opened for writing only are collected in a batch,
+ * which a background thread writes to the file once it is large enough:
+ * the simulation does not wait for the disk.  The file is complete once
+ * it is closed, or up to the error on NS_FATAL_ERROR.  The pending records
+ * are written before a fork (), and the child starts its own thread.  The
+ * files opened for reading, or for reading and writing, are written record
+ * by record as before.
+ *
+ * A file initialized with InitNg is a pcapng file instead, which holds the
+ * packets of several interfaces added with AddInterface.
  */
 class PcapFile
 {
@@ -50,6 +62,8 @@ public:
   ~PcapFile ();
 
   /**
+   * Wait for the pending records to be written first.
+   *
    * \return true if the 'fail' bit is set in the underlying iostream, false otherwise.
    */
   bool Fail (void) const;
@@ -81,7 +95,7 @@ public:
   void Open (std::string const &filename, std::ios::openmode mode);
 
   /**
-   * Close the underlying file.
+   * Write the pending records and close the underlying file.
    */
   void Close (void);
 
@@ -118,6 +132,35 @@ public:
              int32_t timeZoneCorrection = ZONE_DEFAULT,
              bool swapMode = false);
 
+  /**
+   * Initialize the file associated with this object as a pcapng file, with
+   * a single section and no interface.  This file must have been previously
+   * opened with write permissions.  The packets are written with the
+   * microsecond timestamps of the pcap files, in the byte order of the
+   * writing system.
+   *
+   * See http://www.tcpdump.org/pcap/pcap.html (PCAP Next Generation Dump
+   * File Format)
+   *
+   * \warning Calling this method on an existing file will result in the loss
+   * any existing data.  A pcapng file cannot be read back with Read.
+   */
+  void InitNg (void);
+
+  /**
+   * Add an interface to a pcapng file.
+   *
+   * \param dataLinkType A data link type as defined in the pcap library, as
+   * for Init.
+   * \param snapLen The maximum size for the packets of the interface.
+   * \param name The name of the interface, shown by the tools reading the
+   * file.
+   *
+   * \returns the interface id to pass to Write for the packets of this
+   * interface.
+   */
+  uint32_t AddInterface (uint32_t dataLinkType, uint32_t snapLen, std::string const &name);
+
   /**
    * \brief Write next packet to file
    * 
@@ -125,9 +168,12 @@ public:
    * \param tsUsec      Packet timestamp, microseconds
    * \param data        Data buffer
    * \param totalLen    Total packet length
+   * \param interfaceId Interface of the packet in a pcapng file, as returned
+   *                    by AddInterface; ignored by the pcap files
    * 
    */
-  void Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen);
+  void Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen,
+              uint32_t interfaceId = 0);
 
   /**
    * \brief Write next packet to file
@@ -135,9 +181,11 @@ public:
    * \param tsSec       Packet timestamp, seconds 
    * \param tsUsec      Packet timestamp, microseconds
    * \param p           Packet to write
+   * \param interfaceId Interface of the packet in a pcapng file, as returned
+   *                    by AddInterface; ignored by the pcap files
    * 
    */
-  void Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p);
+  void Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p, uint32_t interfaceId = 0);
   /**
    * \brief Write next packet to file
    * 
@@ -145,9 +193,12 @@ public:
    * \param tsUsec      Packet timestamp, microseconds
    * \param header      Header to write, in front of packet
    * \param p           Packet to write
+   * \param interfaceId Interface of the packet in a pcapng file, as returned
+   *                    by AddInterface; ignored by the pcap files
    * 
    */
-  void Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p);
+  void Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p,
+              uint32_t interfaceId = 0);
 
 
   /**
@@ -277,6 +328,8 @@ public:
                     uint32_t snapLen = SNAPLEN_DEFAULT);
 
 private:
+  friend class PcapWriter;
+
   /**
    * \brief Pcap file header
    */
@@ -336,13 +389,38 @@ private:
    */
   void WriteFileHeader (void);
   /**
-   * \brief Write a Pcap packet header
+   * \brief Write a Pcap packet header, or the pcapng block of a packet
+   *
+   * The record is reserved in the batch with the length of the packet
+   * truncated to the snapshot length, so that the callers copy only the
+   * bytes written to the file.
+   *
    * \param tsSec Time stamp (seconds part)
    * \param tsUsec Time stamp (microseconds part)
    * \param totalLen total packet length
-   * \returns the length of the packet to write in the Pcap file
+   * \param interfaceId pcapng interface of the packet
+   * \param inclLen [out] the length of the packet to write in the Pcap file
+   * \returns where to copy the inclLen bytes of the packet
+   */
+  uint8_t *WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen,
+                              uint32_t interfaceId, uint32_t &inclLen);
+
+  /**
+   * \brief Reserve room for a record at the end of the batch
+   * \param size the size of the record
+   * \returns the start of the record
+   */
+  uint8_t *Reserve (uint32_t size);
+  /**
+   * \brief Hand over the batch once a record is complete: to the file
+   * directly, or to the writer thread once the batch is large enough.
+   */
+  void EndRecord (void);
+  /**
+   * \brief Hand over the batch to the writer thread, and wait for it
+   * to write all the records of the file.
    */
-  uint32_t WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen);
+  void Sync (void);
 
   /**
    * \brief Read and verify a Pcap file header
@@ -353,6 +431,12 @@ private:
   std::fstream   m_file;        //!< file stream
   PcapFileHeader m_fileHeader;  //!< file header
   bool m_swapMode;              //!< swap mode
+  std::vector<uint8_t> m_batch; //!< records not yet handed over
+  uint32_t m_batchSize;         //!< bytes used in m_batch
+  bool m_async;                 //!< m_file written by the writer thread
+  uint32_t m_pending;           //!< batches queued to the writer thread
+  bool m_ng;                    //!< pcapng file
+  std::vector<uint32_t> m_interfaceSnapLen; //!< snapshot length of each pcapng interface
 };
 
 } // namespace ns3
@@ -21,6 +21,9 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
 #include "ns3/log.h"
 
 namespace ns3 {
@@ -43,7 +46,10 @@ PointToPointChannel::GetTypeId (void)
     .AddTraceSource ("TxRxPointToPoint",
                      "Trace source indicating transmission of packet "
                      "from the PointToPointChannel, used by the Animation "
-                     "interface.",
+                     "interface. With ThreadedSimulatorImpl, the sinks run "
+                     "on the thread of the sender, while the receiver runs "
+                     "on its own thread: connect them with MaxThreads set "
+                     "to 1.",
                      MakeTraceSourceAccessor (&PointToPointChannel::m_txrxPointToPoint),
                      "ns3::PointToPointChannel::TxRxAnimationCallback")
   ;
@@ -80,9 +86,36 @@ PointToPointChannel::Attach (Ptr<PointToPointNetDevice> device)
       m_link[1].m_dst = m_link[0].m_src;
       m_link[0].m_state = IDLE;
       m_link[1].m_state = IDLE;
+      if (m_link[0].m_src->GetNode () != 0 && m_link[1].m_src->GetNode () != 0)
+        {
+          CacheNodes (m_link[0]);
+          CacheNodes (m_link[1]);
+        }
     }
 }
 
+/**
+ * \returns true if the simulation runs with ThreadedSimulatorImpl, the
+ * only simulator which runs the nodes of different system ids on
+ * different threads of one process.
+ */
+static bool
+IsThreaded (void)
+{
+  StringValue simulationTypeValue;
+  return GlobalValue::GetValueByNameFailSafe ("SimulatorImplementationType", simulationTypeValue)
+         && simulationTypeValue.Get () == "ns3::ThreadedSimulatorImpl";
+}
+
+void
+PointToPointChannel::CacheNodes (Link &link)
+{
+  NS_LOG_FUNCTION (this);
+  link.m_dstNodeId = link.m_dst->GetNode ()->GetId ();
+  link.m_remote = IsThreaded ()
+    && link.m_src->GetNode ()->GetSystemId () != link.m_dst->GetNode ()->GetSystemId ();
+}
+
 bool
 PointToPointChannel::TransmitStart (
   Ptr<Packet> p,
@@ -96,13 +129,37 @@ PointToPointChannel::TransmitStart (
   NS_ASSERT (m_link[1].m_state != INITIALIZING);
 
   uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+  Link &link = m_link[wire];
+  if (link.m_dstNodeId == 0xffffffff)
+    {
+      // the devices were attached before being added to their nodes
+      CacheNodes (link);
+    }
 
-  Simulator::ScheduleWithContext (m_link[wire].m_dst->GetNode ()->GetId (),
-                                  txTime + m_delay, &PointToPointNetDevice::Receive,
-                                  m_link[wire].m_dst, p);
+  if (link.m_remote)
+    {
+      // The destination runs on another thread, with
+      // ThreadedSimulatorImpl: give it a deep copy of the packet, which
+      // shares no reference count with the packets of the sender, and
+      // do not touch the reference count of the destination device,
+      // unless a sink of the trace gets it.
+      Simulator::ScheduleWithContext (link.m_dstNodeId,
+                                      txTime + m_delay, &PointToPointNetDevice::Receive,
+                                      PeekPointer (link.m_dst), p->CreateDeepCopy ());
+      if (m_txrxPointToPoint.IsEmpty ())
+        {
+          return true;
+        }
+    }
+  else
+    {
+      Simulator::ScheduleWithContext (link.m_dstNodeId,
+                                      txTime + m_delay, &PointToPointNetDevice::Receive,
+                                      link.m_dst, p);
+    }
 
   // Call the tx anim callback on the net device
-  m_txrxPointToPoint (p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
+  m_txrxPointToPoint (p, src, link.m_dst, txTime, txTime + m_delay);
   return true;
 }
 
@@ -190,13 +190,28 @@ public:
     /** \brief Create the link, it will be in INITIALIZING state
      *
      */
-    Link() : m_state (INITIALIZING), m_src (0), m_dst (0) {}
+    Link() : m_state (INITIALIZING), m_src (0), m_dst (0), m_dstNodeId (0xffffffff), m_remote (false) {}
 
     WireState                  m_state; //!< State of the link
     Ptr<PointToPointNetDevice> m_src;   //!< First NetDevice
     Ptr<PointToPointNetDevice> m_dst;   //!< Second NetDevice
+    uint32_t                   m_dstNodeId; //!< Id of the node of m_dst, 0xffffffff until known
+    bool                       m_remote; //!< The nodes are in different logical processes of ThreadedSimulatorImpl
   };
 
+  /**
+   * \brief Cache the node ids and system ids of the nodes of a link.
+   *
+   * They are read without touching the reference counts of the
+   * destination when transmitting, since the destination may run on
+   * another thread with ThreadedSimulatorImpl.  The link is remote only
+   * with ThreadedSimulatorImpl, which must be selected by the global
+   * value SimulatorImplementationType before the devices are attached.
+   *
+   * \param link the link
+   */
+  void CacheNodes (Link &link);
+
   Link    m_link[N_DEVICES]; //!< Link model
 };
 
@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/packet-metadata.h"
+#include "ns3/tag.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/point-to-point-channel.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace {
+
+/**
+ * \brief Tag carried by the packets of the test, as a packet tag and
+ * as byte tags.
+ */
+class PointToPointThreadedTestTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::PointToPointThreadedTestTag")
+      .SetParent<Tag> ()
+      .AddConstructor<PointToPointThreadedTestTag> ()
+    ;
+    return tid;
+  }
+  PointToPointThreadedTestTag ()
+    : m_value (0)
+  {
+  }
+  PointToPointThreadedTestTag (uint32_t value)
+    : m_value (value)
+  {
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 4;
+  }
+  virtual void Serialize (TagBuffer buffer) const
+  {
+    buffer.WriteU32 (m_value);
+  }
+  virtual void Deserialize (TagBuffer buffer)
+  {
+    m_value = buffer.ReadU32 ();
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "value=" << m_value;
+  }
+  uint32_t GetValue (void) const
+  {
+    return m_value;
+  }
+private:
+  uint32_t m_value;
+};
+
+/// The records of a run, per system id of the receiver or of the sender
+typedef std::vector<std::string> Records[2];
+
+bool
+Receive (Records *received, Ptr<NetDevice> device, Ptr<const Packet> packet,
+         uint16_t protocol, const Address &from)
+{
+  std::ostringstream oss;
+  oss << Simulator::Now ().GetTimeStep () << " size=" << packet->GetSize () << " bytes=";
+  std::vector<uint8_t> bytes (packet->GetSize ());
+  packet->CopyData (&bytes[0], bytes.size ());
+  for (std::vector<uint8_t>::const_iterator i = bytes.begin (); i != bytes.end (); i++)
+    {
+      oss << static_cast<uint32_t> (*i) << ",";
+    }
+  PointToPointThreadedTestTag tag;
+  if (packet->PeekPacketTag (tag))
+    {
+      oss << " packet tag=" << tag.GetValue ();
+    }
+  ByteTagIterator i = packet->GetByteTagIterator ();
+  while (i.HasNext ())
+    {
+      ByteTagIterator::Item item = i.Next ();
+      item.GetTag (tag);
+      oss << " byte tag=" << tag.GetValue () << " [" << item.GetStart () << "," << item.GetEnd () << "[";
+    }
+  oss << " metadata=";
+  packet->Print (oss);
+  (*received)[device->GetNode ()->GetSystemId ()].push_back (oss.str ());
+  return true;
+}
+
+void
+TxRx (Records *sent, Ptr<const Packet> packet, Ptr<NetDevice> txDevice, Ptr<NetDevice> rxDevice,
+      Time duration, Time lastBitTime)
+{
+  std::ostringstream oss;
+  oss << Simulator::Now ().GetTimeStep () << " size=" << packet->GetSize ()
+      << " to=" << rxDevice->GetNode ()->GetId ()
+      << " duration=" << duration.GetTimeStep ()
+      << " last bit=" << lastBitTime.GetTimeStep ();
+  (*sent)[txDevice->GetNode ()->GetSystemId ()].push_back (oss.str ());
+}
+
+/*
+ * A packet made of two buffers, the second one with a zero area, which
+ * carry a byte tag each, with a packet tag.
+ */
+void
+Send (Ptr<NetDevice> device, uint32_t i)
+{
+  uint32_t side = device->GetNode ()->GetSystemId ();
+  uint8_t data[40];
+  for (uint32_t j = 0; j < sizeof (data); j++)
+    {
+      data[j] = side * 100 + i + j;
+    }
+  Ptr<Packet> packet = Create<Packet> (data, sizeof (data));
+  packet->AddByteTag (PointToPointThreadedTestTag (side * 1000 + i));
+  Ptr<Packet> zeros = Create<Packet> (100 + i);
+  zeros->AddByteTag (PointToPointThreadedTestTag (side * 1000 + 500 + i));
+  packet->AddAtEnd (zeros);
+  packet->AddPacketTag (PointToPointThreadedTestTag (side * 1000 + i));
+  device->Send (packet, device->GetBroadcast (), 0x800);
+}
+
+} // anonymous namespace
+
+/**
+ * \brief Run two nodes of different system ids, which send packets to
+ * each other over a PointToPointChannel, with DefaultSimulatorImpl and
+ * with ThreadedSimulatorImpl, and compare what they receive.
+ */
+class PointToPointThreadedTest : public TestCase
+{
+public:
+  PointToPointThreadedTest ();
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \brief Run the topology once
+   * \param simulator the SimulatorImplementationType
+   * \param received the records of the received packets
+   * \param sent the records of the TxRxPointToPoint trace, or zero to
+   *        leave the trace unconnected
+   */
+  void RunTopology (std::string simulator, Records *received, Records *sent);
+  /**
+   * \brief Compare the records of two runs
+   * \param got the records of the run under test
+   * \param expected the records of the reference run
+   * \param what what the records are
+   */
+  void CheckRecords (const Records &got, const Records &expected, std::string what);
+};
+
+PointToPointThreadedTest::PointToPointThreadedTest ()
+  : TestCase ("PointToPoint across logical processes of ThreadedSimulatorImpl")
+{
+}
+
+void
+PointToPointThreadedTest::RunTopology (std::string simulator, Records *received, Records *sent)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (simulator));
+
+  Ptr<Node> a = CreateObject<Node> (0);
+  Ptr<Node> b = CreateObject<Node> (1);
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
+  NetDeviceContainer devices = p2p.Install (a, b);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      devices.Get (i)->SetReceiveCallback (MakeBoundCallback (&Receive, received));
+    }
+  if (sent != 0)
+    {
+      devices.Get (0)->GetChannel ()->TraceConnectWithoutContext ("TxRxPointToPoint",
+                                                                  MakeBoundCallback (&TxRx, sent));
+    }
+
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<NetDevice> device = devices.Get (j);
+          Simulator::ScheduleWithContext (device->GetNode ()->GetId (), MilliSeconds (1000 + 3 * i + j),
+                                          &Send, device, i);
+        }
+    }
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+PointToPointThreadedTest::CheckRecords (const Records &got, const Records &expected, std::string what)
+{
+  for (uint32_t side = 0; side < 2; side++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (got[side].size (), expected[side].size (),
+                             what << ": wrong number of records of system id " << side);
+      for (uint32_t i = 0; i < got[side].size (); i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (got[side][i], expected[side][i],
+                                 what << ": record " << i << " of system id " << side << " differs");
+        }
+    }
+}
+
+void
+PointToPointThreadedTest::DoRun (void)
+{
+  PacketMetadata::Enable ();
+  Simulator::Destroy ();
+
+  Records defaultReceived;
+  Records defaultSent;
+  RunTopology ("ns3::DefaultSimulatorImpl", &defaultReceived, &defaultSent);
+  NS_TEST_ASSERT_MSG_EQ (defaultReceived[0].size (), 20, "packets lost");
+  NS_TEST_ASSERT_MSG_EQ (defaultReceived[1].size (), 20, "packets lost");
+
+  // one thread: the trace can be connected
+  Config::SetDefault ("ns3::ThreadedSimulatorImpl::MaxThreads", UintegerValue (1));
+  Records received;
+  Records sent;
+  RunTopology ("ns3::ThreadedSimulatorImpl", &received, &sent);
+  CheckRecords (received, defaultReceived, "received with 1 thread");
+  CheckRecords (sent, defaultSent, "traced with 1 thread");
+
+  // one thread per logical process
+  Config::SetDefault ("ns3::ThreadedSimulatorImpl::MaxThreads", UintegerValue (0));
+  Records parallelReceived;
+  RunTopology ("ns3::ThreadedSimulatorImpl", &parallelReceived, 0);
+  CheckRecords (parallelReceived, defaultReceived, "received with 2 threads");
+
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+/**
+ * \brief TestSuite for PointToPointChannel with ThreadedSimulatorImpl
+ */
+class PointToPointThreadedTestSuite : public TestSuite
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  PointToPointThreadedTestSuite ();
+};
+
+PointToPointThreadedTestSuite::PointToPointThreadedTestSuite ()
+  : TestSuite ("devices-point-to-point-threaded", UNIT)
+{
+  AddTestCase (new PointToPointThreadedTest, TestCase::QUICK);
+}
+
+static PointToPointThreadedTestSuite g_pointToPointThreadedTestSuite; //!< The testsuite
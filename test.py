@@ -43,6 +43,7 @@ from utils import get_list_from_file
 #
 interesting_config_items = [
     "NS3_ENABLED_MODULES",
+    "NS3_ENABLED_CONTRIBUTED_MODULES",
     "NS3_MODULE_PATH",
     "NSC_ENABLED",
     "ENABLE_REAL_TIME",
@@ -61,6 +62,7 @@ interesting_config_items = [
     "VALGRIND_FOUND",
 ]
 
+NS3_ENABLED_CONTRIBUTED_MODULES = []
 NSC_ENABLED = False
 ENABLE_REAL_TIME = False
 ENABLE_THREADING = False
@@ -1138,6 +1140,28 @@ def run_tests():
             example_names_original,
             python_tests)
 
+    for module in NS3_ENABLED_CONTRIBUTED_MODULES:
+        # Remove the "ns3-" from the module name.
+        module = module[len("ns3-"):]
+
+        # Set the directories and paths for this example.  The programs
+        # of a contributed module are either examples or test programs
+        # built next to its wscript.
+        module_directory     = os.path.join("contrib", module)
+        examples_to_run_path = os.path.join(module_directory, "test", "examples-to-run.py")
+        for directory in (os.path.join(module_directory, "examples"), module_directory):
+            cpp_executable_dir = os.path.join(NS3_BUILDDIR, directory)
+            python_script_dir  = os.path.join(directory)
+
+            # Parse this module's file.
+            parse_examples_to_run_file(
+                examples_to_run_path,
+                cpp_executable_dir,
+                python_script_dir,
+                example_tests,
+                example_names_original,
+                python_tests)
+
     #
     # If lots of logging is enabled, we can crash Python when it tries to 
     # save all of the text.  We just don't allow logging to be turned on when
@@ -93,7 +93,7 @@ template <int N>
 void 
 BenchHeader<N>::Print (std::ostream &os) const
 {
-  NS_ASSERT (false);
+  os << "N=" << N;
 }
 template <int N>
 uint32_t 
@@ -253,6 +253,43 @@ benchC (uint32_t n)
   }
 }
 
+static void
+benchE (uint32_t n)
+{
+  BenchHeader<25> ipv4;
+  BenchHeader<8> udp;
+  std::ostringstream os;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Ptr<Packet> p = Create<Packet> (2000);
+    p->AddHeader (udp);
+    p->AddHeader (ipv4);
+    // as the ascii trace sinks
+    os.str ("");
+    os << *p;
+  }
+}
+
+static void
+benchF (uint32_t n)
+{
+  BenchHeader<25> ipv4;
+  BenchHeader<8> udp;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Ptr<Packet> p = Create<Packet> (2000);
+    p->AddHeader (udp);
+    // as a segmentation and reassembly
+    Ptr<Packet> first = p->CreateFragment (0, 1000);
+    Ptr<Packet> second = p->CreateFragment (1000, p->GetSize () - 1000);
+    first->AddHeader (ipv4);
+    second->AddHeader (ipv4);
+    first->RemoveHeader (ipv4);
+    second->RemoveHeader (ipv4);
+    first->AddAtEnd (second);
+    first->RemoveHeader (udp);
+  }
+}
 
 static void
 runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
@@ -273,6 +310,7 @@ runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
 int main (int argc, char *argv[])
 {
   uint32_t n = 0;
+  bool printing = false;
   while (argc > 0) {
       if (strncmp ("--n=", argv[0],strlen ("--n=")) == 0) 
         {
@@ -284,6 +322,7 @@ int main (int argc, char *argv[])
       if (strncmp ("--enable-printing", argv[0], strlen ("--enable-printing")) == 0)
         {
           Packet::EnablePrinting ();
+          printing = true;
         }
       argc--;
       argv++;
@@ -301,6 +340,11 @@ int main (int argc, char *argv[])
   runBench (&benchB, n, "Just add headers");
   runBench (&benchC, n, "Remove by func call");
   runBench (&benchD, n, "Intermixed add/remove headers and tags");
+  runBench (&benchF, n, "Fragment and reassemble");
+  if (printing)
+    {
+      runBench (&benchE, n, "Print headers");
+    }
 
   return 0;
 }
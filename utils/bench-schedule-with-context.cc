@@ -0,0 +1,125 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+/*
+ * Several threads inject events with Simulator::ScheduleWithContext,
+ * as the reader threads of FdNetDevice or TapBridge do, while the
+ * main thread runs the simulation. Reports the injection throughput.
+ */
+
+class Bench
+{
+public:
+  Bench (uint32_t threads, uint32_t events)
+    : m_threads (threads),
+      m_events (events),
+      m_received (0)
+  {}
+
+  void Start (void)
+  {
+    // the simulator is running, foreign threads can now inject events
+    m_clock.Start ();
+    for (uint32_t i = 0; i < m_threads; i++)
+      {
+        Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&Bench::Produce, this));
+        m_threadList.push_back (thread);
+        thread->Start ();
+      }
+    Poll ();
+  }
+
+  void Produce (void)
+  {
+    for (uint32_t i = 0; i < m_events; i++)
+      {
+        Simulator::ScheduleWithContext (i, Seconds (0), &Bench::Receive, this);
+      }
+  }
+
+  void Receive (void)
+  {
+    m_received++;
+  }
+
+  void Poll (void)
+  {
+    // keep the simulation alive until all the events were received
+    if (m_received < m_threads * m_events)
+      {
+        Simulator::Schedule (NanoSeconds (1), &Bench::Poll, this);
+      }
+    else
+      {
+        m_elapsed = m_clock.End ();
+      }
+  }
+
+  void Join (void)
+  {
+    for (std::vector<Ptr<SystemThread> >::iterator i = m_threadList.begin (); i != m_threadList.end (); ++i)
+      {
+        (*i)->Join ();
+      }
+  }
+
+  int64_t GetElapsed (void) const
+  {
+    return m_elapsed;
+  }
+
+private:
+  uint32_t m_threads;
+  uint32_t m_events;
+  uint32_t m_received;
+  SystemWallClockMs m_clock;
+  int64_t m_elapsed;
+  std::vector<Ptr<SystemThread> > m_threadList;
+};
+
+int main (int argc, char *argv[])
+{
+  uint32_t threads = 4;
+  uint32_t events = 1000000;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the injection of events from foreign threads.");
+  cmd.AddValue ("threads", "number of injecting threads (default 4)", threads);
+  cmd.AddValue ("events",  "events injected per thread (default 1E6)", events);
+  cmd.Parse (argc, argv);
+
+  Bench bench (threads, events);
+  Simulator::ScheduleNow (&Bench::Start, &bench);
+  Simulator::Run ();
+  bench.Join ();
+  Simulator::Destroy ();
+
+  int64_t elapsed = bench.GetElapsed ();
+  uint64_t total = (uint64_t)threads * events;
+  std::cout << cmd.GetName () << ": threads: " << threads
+            << " events: " << total
+            << " time: " << elapsed << " ms"
+            << " rate: " << (elapsed > 0 ? total * 1000 / elapsed : 0) << " events/s"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+/*
+ * Micro-benchmarks of the Time and int64x64_t operations used by the
+ * models: unit conversions, and arithmetic with integer and fractional
+ * operands. Each benchmark returns a value which depends on all the
+ * iterations, so the compiler cannot drop them.
+ */
+
+// the values are not known at compile time
+static int64_t g_step = 1000;
+static double g_seconds = 1.5e-6;
+
+static int64_t
+BenchToSeconds (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // whole seconds, as the start and stop times of most models
+      Time t = MilliSeconds (1000 * (uint64_t)i);
+      sum += (int64_t)t.GetSeconds ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchToSecondsFraction (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Time t = NanoSeconds (i * g_step + 1);
+      sum += (int64_t)(t.GetSeconds () * 1e6);
+    }
+  return sum;
+}
+
+static int64_t
+BenchToPicoSeconds (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Time t = NanoSeconds (i * g_step);
+      sum += t.To (Time::PS).GetHigh ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchFromDouble (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // as the propagation delay models
+      Time t = Seconds (g_seconds * i);
+      sum += t.GetTimeStep ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchFromInteger (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Time t = MicroSeconds (i);
+      sum += t.GetTimeStep ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchMulInteger (uint32_t n)
+{
+  int64_t sum = 0;
+  Time t = NanoSeconds (g_step);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // as the scaling of a Time by a count
+      int64x64_t v = t;
+      v *= int64x64_t (i);
+      sum += Time (v).GetTimeStep ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchDivInteger (uint32_t n)
+{
+  int64_t sum = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      int64x64_t v = int64x64_t (i * g_step);
+      v /= int64x64_t (7);
+      sum += v.GetHigh ();
+    }
+  return sum;
+}
+
+static int64_t
+BenchMulFraction (uint32_t n)
+{
+  int64_t sum = 0;
+  int64x64_t f = int64x64_t (g_seconds * 1e6);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      int64x64_t v = int64x64_t (i * g_step) + f;
+      v *= f;
+      sum += v.GetHigh ();
+    }
+  return sum;
+}
+
+static void
+RunBench (int64_t (*bench) (uint32_t), uint32_t n, char const *name)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  int64_t result = (*bench) (n);
+  uint64_t deltaMs = time.End ();
+  std::cout << name << ": " << deltaMs << " ms, "
+            << (deltaMs > 0 ? n / deltaMs * 1000 : 0) << " ops/s"
+            << " (result " << result << ")"
+            << std::endl;
+}
+
+static void
+RunAll (uint32_t n)
+{
+  RunBench (&BenchToSeconds, n, "Time::GetSeconds, whole seconds");
+  RunBench (&BenchToSecondsFraction, n, "Time::GetSeconds, fractional");
+  RunBench (&BenchToPicoSeconds, n, "Time::To (PS)");
+  RunBench (&BenchFromDouble, n, "Seconds (double)");
+  RunBench (&BenchFromInteger, n, "MicroSeconds (integer)");
+  RunBench (&BenchMulInteger, n, "int64x64_t (Time) * integer");
+  RunBench (&BenchDivInteger, n, "int64x64_t / integer");
+  RunBench (&BenchMulFraction, n, "int64x64_t * fraction");
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 10000000;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the Time and int64x64_t operations.");
+  cmd.AddValue ("n", "number of operations per benchmark (default 1E7)", n);
+  cmd.Parse (argc, argv);
+
+  // run in an event, as the models: the Time objects are not recorded
+  // for a change of resolution once the simulation started
+  Simulator::ScheduleNow (&RunAll, n);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/packet.h"
+
+using namespace ns3;
+
+/*
+ * Cost of the trace sources of a packet forwarding path, when no sink,
+ * one sink or two sinks are connected. Each hop fires the trace sources
+ * of a device and a phy, as a point to point or a wifi device does
+ * for each packet, and copies the packet.
+ */
+
+class Hop
+{
+public:
+  void Connect (uint32_t sinks);
+  Ptr<Packet> Forward (Ptr<Packet> packet);
+
+  static void Sink (Ptr<const Packet> packet);
+  static uint64_t m_bytes;
+
+private:
+  TracedCallback<Ptr<const Packet> > m_macTx;
+  TracedCallback<Ptr<const Packet> > m_phyTxBegin;
+  TracedCallback<Ptr<const Packet> > m_phyTxEnd;
+  TracedCallback<Ptr<const Packet> > m_phyRxEnd;
+  TracedCallback<Ptr<const Packet> > m_macRx;
+};
+
+uint64_t Hop::m_bytes = 0;
+
+void
+Hop::Sink (Ptr<const Packet> packet)
+{
+  m_bytes += packet->GetSize ();
+}
+
+void
+Hop::Connect (uint32_t sinks)
+{
+  for (uint32_t i = 0; i < sinks; i++)
+    {
+      m_macTx.ConnectWithoutContext (MakeCallback (&Hop::Sink));
+      m_phyTxBegin.ConnectWithoutContext (MakeCallback (&Hop::Sink));
+      m_phyTxEnd.ConnectWithoutContext (MakeCallback (&Hop::Sink));
+      m_phyRxEnd.ConnectWithoutContext (MakeCallback (&Hop::Sink));
+      m_macRx.ConnectWithoutContext (MakeCallback (&Hop::Sink));
+    }
+}
+
+Ptr<Packet>
+Hop::Forward (Ptr<Packet> packet)
+{
+  m_macTx (packet);
+  m_phyTxBegin (packet);
+  m_phyTxEnd (packet);
+  Ptr<Packet> received = packet->Copy ();
+  m_phyRxEnd (received);
+  m_macRx (received);
+  return received;
+}
+
+static void
+RunForwarding (uint32_t n, uint32_t hops, uint32_t sinks)
+{
+  std::vector<Hop> path (hops);
+  for (uint32_t i = 0; i < hops; i++)
+    {
+      path[i].Connect (sinks);
+    }
+  Hop::m_bytes = 0;
+
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> packet = Create<Packet> (1000);
+      for (uint32_t j = 0; j < hops; j++)
+        {
+          packet = path[j].Forward (packet);
+        }
+    }
+  uint64_t deltaMs = time.End ();
+  std::cout << "forwarding, " << sinks << " sink(s) per trace source: "
+            << deltaMs << " ms, "
+            << (double)deltaMs * 1e6 / ((uint64_t)n * hops) << " ns per hop"
+            << " (traced " << Hop::m_bytes << " bytes)"
+            << std::endl;
+}
+
+// not local, so the compiler cannot know that it stays empty
+static TracedCallback<Ptr<const Packet> > g_trace;
+
+static void
+RunEmpty (uint32_t n)
+{
+  Ptr<const Packet> packet = Create<Packet> (1000);
+
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      g_trace (packet);
+    }
+  uint64_t deltaMs = time.End ();
+  std::cout << "unconnected trace source: " << deltaMs << " ms, "
+            << (double)deltaMs * 1e6 / n << " ns per call" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  uint32_t hops = 4;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the trace sources of a packet forwarding path.");
+  cmd.AddValue ("n", "number of packets (default 1E6)", n);
+  cmd.AddValue ("hops", "number of hops of the path (default 4)", hops);
+  cmd.Parse (argc, argv);
+
+  RunEmpty (n * 10);
+  RunForwarding (n, hops, 0);
+  RunForwarding (n, hops, 1);
+  RunForwarding (n, hops, 2);
+  return 0;
+}